@@ -0,0 +1,380 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "arena.h"
+
+#include "defines.h"
+#include "misc.h"
+
+/* the default chunk size */
+#define ARENA_CHUNK_SIZE  16384
+
+/* everything handed out is aligned for any of these */
+typedef union _arena_align_type
+{
+  double  d;
+  long    l;
+  void    *p;
+} arena_align_type;
+
+/* arena_free() finds the chunk that a pointer is in through a hash
+   table of the pages (ARENA_PAGE_SIZE bytes of address space) that
+   each chunk in use overlaps */
+#define ARENA_PAGE_SHIFT  12
+#define ARENA_PAGE_SIZE   (1UL << ARENA_PAGE_SHIFT)
+#define ARENA_PAGE_HASH   1024
+
+typedef struct _arena_page_type
+{
+  unsigned long             page;
+  arena_chunk_type          *chunk;
+  struct _arena_page_type   *next;
+} arena_page_type;
+
+#define ARENA_ALIGN       sizeof(arena_align_type)
+#define ARENA_ROUND(n)    (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define CHUNK_DATA(c)     ((char *)(c) + ARENA_ROUND(sizeof(arena_chunk_type)))
+
+static arena_type *bound_arena = NULL;
+
+/* the pages of every chunk in use, so arena_free() can tell arena
+   memory from the heap's */
+static arena_page_type *page_table[ARENA_PAGE_HASH];
+
+/* ------------------- Local Functions --------------------- */
+
+/* add_chunk_pages: enters 'chunk' in the page table under each page
+   it overlaps */
+static void
+add_chunk_pages(chunk)
+  arena_chunk_type  *chunk;
+{
+  arena_page_type *entry;
+  unsigned long   page;
+  unsigned long   last;
+
+  page = (unsigned long) CHUNK_DATA(chunk) >> ARENA_PAGE_SHIFT;
+  last = ((unsigned long) chunk->end - 1) >> ARENA_PAGE_SHIFT;
+
+  for (; page <= last; page++)
+  {
+    entry        = xmalloc(sizeof(*entry));
+    entry->page  = page;
+    entry->chunk = chunk;
+    entry->next  = page_table[page % ARENA_PAGE_HASH];
+    page_table[page % ARENA_PAGE_HASH] = entry;
+  }
+}
+
+/* remove_chunk_pages: takes 'chunk' out of the page table */
+static void
+remove_chunk_pages(chunk)
+  arena_chunk_type  *chunk;
+{
+  arena_page_type *entry;
+  arena_page_type **p;
+  unsigned long   page;
+  unsigned long   last;
+
+  page = (unsigned long) CHUNK_DATA(chunk) >> ARENA_PAGE_SHIFT;
+  last = ((unsigned long) chunk->end - 1) >> ARENA_PAGE_SHIFT;
+
+  for (; page <= last; page++)
+  {
+    for (p = &page_table[page % ARENA_PAGE_HASH]; *p; p = &((*p)->next))
+    {
+      if ((*p)->chunk == chunk && (*p)->page == page)
+      {
+        entry = *p;
+        *p    = entry->next;
+        free(entry);
+        break;
+      }
+    }
+  }
+}
+
+/* find_chunk: returns the chunk in use that 'ptr' was handed out
+   from, or NULL if it isn't arena memory */
+static arena_chunk_type *
+find_chunk(ptr)
+  char  *ptr;
+{
+  arena_page_type *entry;
+  unsigned long   page  = (unsigned long) ptr >> ARENA_PAGE_SHIFT;
+
+  for (entry = page_table[page % ARENA_PAGE_HASH]; entry;
+       entry = entry->next)
+  {
+    if (entry->page == page && ptr >= CHUNK_DATA(entry->chunk) &&
+        ptr < entry->chunk->end)
+    {
+      return(entry->chunk);
+    }
+  }
+
+  return(NULL);
+}
+
+/* new_chunk: starts a new chunk in 'arena' with room for at least
+   'bytes' */
+static void
+new_chunk(arena, bytes)
+  arena_type  *arena;
+  size_t      bytes;
+{
+  arena_chunk_type  *chunk;
+  size_t            size    = arena->chunk_size;
+
+  if (bytes > size)
+  {
+    size = bytes;
+  }
+
+  if (arena->spare && size == arena->chunk_size)
+  {
+    chunk        = arena->spare;
+    arena->spare = NULL;
+  }
+  else
+  {
+    chunk      = xmalloc(ARENA_ROUND(sizeof(*chunk)) + size);
+    chunk->end = CHUNK_DATA(chunk) + size;
+  }
+
+  chunk->next     = arena->chunks;
+  chunk->arena    = arena;
+  arena->chunks   = chunk;
+  arena->free_ptr = CHUNK_DATA(chunk);
+
+  add_chunk_pages(chunk);
+}
+
+/* drop_chunk: takes the newest chunk out of 'arena', keeping it as
+   the spare if it is an ordinary one and there isn't a spare yet */
+static void
+drop_chunk(arena)
+  arena_type  *arena;
+{
+  arena_chunk_type  *chunk  = arena->chunks;
+
+  arena->chunks = chunk->next;
+
+  remove_chunk_pages(chunk);
+
+  if (!arena->spare &&
+      (size_t) (chunk->end - CHUNK_DATA(chunk)) == arena->chunk_size)
+  {
+    arena->spare = chunk;
+  }
+  else
+  {
+    free(chunk);
+  }
+}
+
+/* arena_alloc: hands out 'bytes' of 'arena' */
+static void *
+arena_alloc(arena, bytes)
+  arena_type  *arena;
+  size_t      bytes;
+{
+  char  *ptr;
+
+  bytes = ARENA_ROUND(bytes ? bytes : 1);
+
+  if (!arena->chunks ||
+      (size_t) (arena->chunks->end - arena->free_ptr) < bytes)
+  {
+    new_chunk(arena, bytes);
+  }
+
+  ptr              = arena->free_ptr;
+  arena->free_ptr += bytes;
+  arena->last      = ptr;
+
+  return(ptr);
+}
+
+/* ------------------- Public Functions -------------------- */
+
+arena_type *
+arena_create(chunk_size)
+  size_t  chunk_size;
+{
+  arena_type  *arena;
+
+  arena             = xcalloc(1, sizeof(*arena));
+  arena->chunk_size = ARENA_ROUND(chunk_size ? chunk_size : ARENA_CHUNK_SIZE);
+
+  return(arena);
+}
+
+arena_type *
+arena_bind(arena)
+  arena_type  *arena;
+{
+  arena_type  *old  = bound_arena;
+
+  bound_arena = arena;
+
+  return(old);
+}
+
+void *
+arena_xcalloc(nelem, size)
+  size_t  nelem;
+  size_t  size;
+{
+  void  *ptr;
+
+  if (!bound_arena)
+  {
+    return(xcalloc(nelem, size));
+  }
+
+  ptr = arena_alloc(bound_arena, nelem * size);
+  bzero(ptr, nelem * size);
+
+  return(ptr);
+}
+
+char *
+arena_xstrdup(str)
+  const char  *str;
+{
+  char  *s;
+
+  if (!str)
+  {
+    return NULL;
+  }
+
+  if (!bound_arena)
+  {
+    return(xstrdup(str));
+  }
+
+  s = arena_alloc(bound_arena, strlen(str) + 1);
+  strcpy(s, str);
+
+  return(s);
+}
+
+void
+arena_free(ptr)
+  void  *ptr;
+{
+  arena_chunk_type  *chunk;
+  arena_type        *arena;
+
+  if (!ptr)
+  {
+    return;
+  }
+
+  if ((chunk = find_chunk(ptr)) == NULL)
+  {
+    free(ptr);
+    return;
+  }
+
+  /* a value that is decoded, looked at and freed costs nothing */
+  arena = chunk->arena;
+  if (ptr == arena->last)
+  {
+    arena->free_ptr = arena->last;
+    arena->last     = NULL;
+  }
+}
+
+void
+arena_get_mark(mark)
+  arena_mark_type *mark;
+{
+  mark->arena = bound_arena;
+
+  if (bound_arena)
+  {
+    mark->chunk    = bound_arena->chunks;
+    mark->free_ptr = bound_arena->free_ptr;
+    mark->last     = bound_arena->last;
+  }
+}
+
+void
+arena_release(mark)
+  arena_mark_type *mark;
+{
+  arena_type  *arena  = mark->arena;
+
+  if (!arena)
+  {
+    return;
+  }
+
+  while (arena->chunks && arena->chunks != mark->chunk)
+  {
+    drop_chunk(arena);
+  }
+
+  if (arena->chunks)
+  {
+    arena->free_ptr = mark->free_ptr;
+    arena->last     = mark->last;
+  }
+  else
+  {
+    arena->free_ptr = NULL;
+    arena->last     = NULL;
+  }
+}
+
+void
+arena_reset(arena)
+  arena_type  *arena;
+{
+  arena_mark_type empty;
+
+  if (!arena)
+  {
+    return;
+  }
+
+  empty.arena    = arena;
+  empty.chunk    = NULL;
+  empty.free_ptr = NULL;
+  empty.last     = NULL;
+
+  arena_release(&empty);
+}
+
+void
+arena_destroy(arena)
+  arena_type  *arena;
+{
+  if (!arena)
+  {
+    return;
+  }
+
+  arena_reset(arena);
+
+  if (arena->spare)
+  {
+    free(arena->spare);
+  }
+
+  if (bound_arena == arena)
+  {
+    bound_arena = NULL;
+  }
+
+  free(arena);
+}
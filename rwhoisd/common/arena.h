@@ -0,0 +1,84 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+/* includes */
+#include "common.h"
+
+/* types */
+
+/* arena_type: a region of memory handed out by bumping a pointer
+   through large chunks, and given back all at once.  It is meant for
+   the many small objects of a single query or indexing batch: bind
+   it with arena_bind(), and arena_xcalloc() and arena_xstrdup() take
+   from it until it is unbound; arena_reset() then releases it all. */
+typedef struct _arena_chunk_type
+{
+  struct _arena_chunk_type  *next;      /* the chunk before it */
+  struct _arena_type        *arena;     /* the arena it belongs to */
+  char                      *end;
+} arena_chunk_type;
+
+typedef struct _arena_type
+{
+  arena_chunk_type    *chunks;          /* newest first */
+  arena_chunk_type    *spare;           /* an emptied chunk, to reuse */
+  size_t              chunk_size;
+  char                *free_ptr;        /* in the newest chunk */
+  char                *last;            /* the last thing handed out */
+} arena_type;
+
+/* arena_mark_type: a point in an arena to release back to */
+typedef struct _arena_mark_type
+{
+  arena_type          *arena;
+  arena_chunk_type    *chunk;
+  char                *free_ptr;
+  char                *last;
+} arena_mark_type;
+
+/* prototypes */
+
+/* creates an empty arena taking memory 'chunk_size' bytes at a time
+   (0 for the default) */
+arena_type *arena_create PROTO((size_t chunk_size));
+
+/* binds 'arena' (NULL for none), returning the one bound before it.
+   Binding NULL is how to opt out for objects that must outlive the
+   bound arena:
+     old = arena_bind(NULL); ...allocate...; arena_bind(old); */
+arena_type *arena_bind PROTO((arena_type *arena));
+
+/* like xcalloc() and xstrdup(), but from the bound arena, if any */
+void *arena_xcalloc PROTO((size_t nelem, size_t size));
+
+char *arena_xstrdup PROTO((const char *str));
+
+/* frees what arena_xcalloc() or arena_xstrdup() returned.  Arena
+   memory is left for arena_reset(), except for the last thing handed
+   out, which is given back at once; anything else is free()d.  It
+   takes the same time however many arenas and chunks there are. */
+void arena_free PROTO((void *ptr));
+
+/* remembers the current point of the bound arena in 'mark' */
+void arena_get_mark PROTO((arena_mark_type *mark));
+
+/* releases everything handed out since 'mark' was taken by
+   arena_get_mark(), which must all be garbage by now */
+void arena_release PROTO((arena_mark_type *mark));
+
+/* releases everything in 'arena' */
+void arena_reset PROTO((arena_type *arena));
+
+/* releases 'arena' itself, unbinding it if it is bound */
+void arena_destroy PROTO((arena_type *arena));
+
+#endif /* _ARENA_H_ */
@@ -11,12 +11,42 @@
 
 #include "client_msgs.h"
 #include "defines.h"
+#include "hash_table.h"
 #include "log.h"
 #include "misc.h"
 #include "strutil.h"
 #include "types.h"
 #include "fileutils.h"
 
+/* local types */
+
+/* attribute_lookup_struct: a class's attributes by name (and alias),
+   and by local and global id.  Built from the class's attribute list
+   when first needed, and thrown away when the list changes. */
+typedef struct _attribute_lookup_struct
+{
+  hash_table_type  *names;
+  attribute_struct **by_local_id;
+  int              num_local_ids;
+  attribute_struct **by_global_id;
+  int              num_global_ids;
+} attribute_lookup_struct;
+
+/* attr_ref_lookup_struct: the same, for a global attribute reference
+   list (there is one per auth area schema) */
+typedef struct _attr_ref_lookup_struct
+{
+  dl_list_type         *attr_ref_list;
+  hash_table_type      *names;
+  attribute_ref_struct **by_id;
+  int                  num_ids;
+} attr_ref_lookup_struct;
+
+/* local statics */
+
+static dl_list_type attr_ref_lookup_list;
+static int          attr_ref_lookup_list_init = FALSE;
+
 /* local prototypes */
 static attribute_struct *
 create_attribute PROTO((char            *name,
@@ -50,6 +80,240 @@ verify_attribute_defs PROTO((auth_area_struct *aa,
 
 /* -------------------- LOCAL FUNCTIONS ------------------------ */
 
+/* get_attribute_lookup: returns the lookup tables of 'class',
+   building them if necessary */
+static attribute_lookup_struct *
+get_attribute_lookup(class)
+  class_struct  *class;
+{
+  attribute_lookup_struct *al;
+  attribute_struct        *attr;
+  dl_list_type            *list;
+  dl_node_type            *orig_posn;
+  int                     num_attrs  = 0;
+  int                     not_done;
+  int                     i;
+
+  if (class->attribute_lookup)
+  {
+    return(class->attribute_lookup);
+  }
+
+  list      = &(class->attribute_list);
+  orig_posn = dl_list_get_pos(list);
+  al        = xcalloc(1, sizeof(*al));
+
+  /* size the id arrays */
+  not_done = dl_list_first(list);
+  while (not_done)
+  {
+    attr = dl_list_value(list);
+    num_attrs += attr->num_aliases + 1;
+    if (attr->local_id >= al->num_local_ids)
+    {
+      al->num_local_ids = attr->local_id + 1;
+    }
+    if (attr->global_id >= al->num_global_ids)
+    {
+      al->num_global_ids = attr->global_id + 1;
+    }
+    not_done = dl_list_next(list);
+  }
+
+  al->names = hash_table_create(num_attrs);
+  if (al->num_local_ids > 0)
+  {
+    al->by_local_id = xcalloc(al->num_local_ids, sizeof(attribute_struct *));
+  }
+  if (al->num_global_ids > 0)
+  {
+    al->by_global_id = xcalloc(al->num_global_ids,
+                               sizeof(attribute_struct *));
+  }
+
+  /* the first attribute in the list with a given name or id is the
+     one found, as when searching the list itself */
+  not_done = dl_list_first(list);
+  while (not_done)
+  {
+    attr = dl_list_value(list);
+
+    hash_table_insert(al->names, attr->name, attr);
+    for (i = 0; i < attr->num_aliases; i++)
+    {
+      hash_table_insert(al->names, attr->aliases[i], attr);
+    }
+
+    if (attr->local_id >= 0 && !al->by_local_id[attr->local_id])
+    {
+      al->by_local_id[attr->local_id] = attr;
+    }
+    if (attr->global_id >= 0 && !al->by_global_id[attr->global_id])
+    {
+      al->by_global_id[attr->global_id] = attr;
+    }
+
+    not_done = dl_list_next(list);
+  }
+
+  dl_list_put_pos(list, orig_posn);
+
+  class->attribute_lookup = al;
+
+  return(al);
+}
+
+static int
+destroy_attr_ref_lookup_data(arl)
+  attr_ref_lookup_struct *arl;
+{
+  if (!arl)
+  {
+    return TRUE;
+  }
+
+  hash_table_destroy(arl->names);
+
+  if (arl->by_id)
+  {
+    free(arl->by_id);
+  }
+
+  free(arl);
+
+  return TRUE;
+}
+
+/* find_attr_ref_lookup: returns the lookup tables of 'attr_ref_list',
+   leaving the list of them positioned on it, or NULL if they haven't
+   been built */
+static attr_ref_lookup_struct *
+find_attr_ref_lookup(attr_ref_list)
+  dl_list_type  *attr_ref_list;
+{
+  attr_ref_lookup_struct *arl;
+  int                    not_done;
+
+  if (!attr_ref_lookup_list_init)
+  {
+    dl_list_default(&attr_ref_lookup_list, FALSE,
+                    destroy_attr_ref_lookup_data);
+    attr_ref_lookup_list_init = TRUE;
+  }
+
+  not_done = dl_list_first(&attr_ref_lookup_list);
+  while (not_done)
+  {
+    arl = dl_list_value(&attr_ref_lookup_list);
+    if (arl->attr_ref_list == attr_ref_list)
+    {
+      return(arl);
+    }
+    not_done = dl_list_next(&attr_ref_lookup_list);
+  }
+
+  return NULL;
+}
+
+/* get_attr_ref_lookup: returns the lookup tables of 'attr_ref_list',
+   building them if necessary */
+static attr_ref_lookup_struct *
+get_attr_ref_lookup(attr_ref_list)
+  dl_list_type  *attr_ref_list;
+{
+  attr_ref_lookup_struct *arl;
+  attribute_ref_struct   *ref;
+  dl_node_type           *orig_posn;
+  int                    num_refs   = 0;
+  int                    not_done;
+  int                    i;
+
+  if ((arl = find_attr_ref_lookup(attr_ref_list)) != NULL)
+  {
+    return(arl);
+  }
+
+  orig_posn          = dl_list_get_pos(attr_ref_list);
+  arl                = xcalloc(1, sizeof(*arl));
+  arl->attr_ref_list = attr_ref_list;
+
+  not_done = dl_list_first(attr_ref_list);
+  while (not_done)
+  {
+    ref = dl_list_value(attr_ref_list);
+    num_refs += ref->num_aliases + 1;
+    if (ref->global_id >= arl->num_ids)
+    {
+      arl->num_ids = ref->global_id + 1;
+    }
+    not_done = dl_list_next(attr_ref_list);
+  }
+
+  arl->names = hash_table_create(num_refs);
+  if (arl->num_ids > 0)
+  {
+    arl->by_id = xcalloc(arl->num_ids, sizeof(attribute_ref_struct *));
+  }
+
+  not_done = dl_list_first(attr_ref_list);
+  while (not_done)
+  {
+    ref = dl_list_value(attr_ref_list);
+
+    hash_table_insert(arl->names, ref->name, ref);
+    for (i = 0; i < ref->num_aliases; i++)
+    {
+      hash_table_insert(arl->names, ref->aliases[i], ref);
+    }
+
+    if (ref->global_id >= 0 && !arl->by_id[ref->global_id])
+    {
+      arl->by_id[ref->global_id] = ref;
+    }
+
+    not_done = dl_list_next(attr_ref_list);
+  }
+
+  dl_list_put_pos(attr_ref_list, orig_posn);
+
+  dl_list_append(&attr_ref_lookup_list, arl);
+
+  return(arl);
+}
+
+/* compile_attribute_format: compiles the format of 'attr', if it is a
+   regular expression ("re: <regular expression>"), so that values can
+   be checked against it without compiling it each time */
+static void
+compile_attribute_format(attr)
+  attribute_struct  *attr;
+{
+  char  tag[MAX_LINE];
+  char  datum[MAX_LINE];
+
+  if (attr->format_prog)
+  {
+    free(attr->format_prog);
+    attr->format_prog = NULL;
+  }
+
+  if (!attr->format || strlen(attr->format) >= MAX_LINE ||
+      !parse_line(attr->format, tag, datum) || !STR_EQ(tag, "re"))
+  {
+    return;
+  }
+
+  ltrim(datum);
+
+  attr->format_prog = regcomp(datum);
+  if (!attr->format_prog)
+  {
+    log(L_LOG_WARNING, CONFIG,
+        "attribute format '%s' is not a valid regular expression %s",
+        attr->format, file_context_str());
+  }
+}
+
 static attribute_struct *
 create_attribute(name, desc, format, index, type, is_hierarchical,
                  is_required, is_repeatable, is_primary_key, is_multi_line,
@@ -82,6 +346,7 @@ create_attribute(name, desc, format, index, type, is_hierarchical,
   if (format)
   {
     attr->format = xstrdup(format);
+    compile_attribute_format(attr);
   }
 
   attr->index               = index;
@@ -462,6 +727,7 @@ read_attributes(class, attr_ref_list)
           free(attr->format);
         }
         attr->format = xstrdup(datum);
+        compile_attribute_format(attr);
       }
       else if (STR_EQ(tag, A_INDEX))
       {
@@ -570,6 +836,7 @@ add_attribute(attr, class, attr_ref_list)
 
   /* add it to the internal_list */
   dl_list_append(attr_list, attr);
+  clear_attribute_lookup(class);
 
   return TRUE;
 }
@@ -627,6 +894,7 @@ add_global_attribute(attr, class, attr_ref_list, global_id)
     ref->global_id = *global_id;
 
     dl_list_append(attr_ref_list, ref);
+    clear_global_attr_lookup(attr_ref_list);
   }
 
   /* now we need to deal with the aliases */
@@ -640,6 +908,7 @@ add_global_attribute(attr, class, attr_ref_list, global_id)
     {
       add_attribute_alias(&(ref->aliases), &(ref->num_aliases),
                           attr->aliases[i]);
+      clear_global_attr_lookup(attr_ref_list);
     }
     else
     {
@@ -859,41 +1128,12 @@ find_attribute_by_name(class, name)
   class_struct  *class;
   char          *name;
 {
-  int               not_done;
-  attribute_struct  *val;
-  dl_list_type      *list;
-  int               i;
-  
   if (!class || !name)
   {
     return NULL;
   }
 
-  list = &(class->attribute_list);
-  
-  not_done = dl_list_first(list);
-  while (not_done)
-  {
-    val = dl_list_value(list);
-
-    if (STR_EQ(val->name, name))
-    {
-      return(val);
-    }
-
-    for (i = 0; i < val->num_aliases; i++)
-    {
-      if (STR_EQ(val->aliases[i], name))
-      {
-        return(val);
-      }
-    }
-
-    not_done = dl_list_next(list);
-  }
-
-  /* we didn't find anything */
-  return NULL;
+  return(hash_table_find(get_attribute_lookup(class)->names, name));
 }
 
 attribute_struct *
@@ -901,32 +1141,20 @@ find_attribute_by_id(class, id)
   class_struct  *class;
   int           id;
 {
-  int               not_done;
-  attribute_struct  *val;
-  dl_list_type      *list;
-  
+  attribute_lookup_struct *al;
+
   if (!class)
   {
     return NULL;
   }
 
-  list = &(class->attribute_list);
-  
-  not_done = dl_list_first(list);
-  while (not_done)
+  al = get_attribute_lookup(class);
+  if (id < 0 || id >= al->num_local_ids)
   {
-    val = dl_list_value(list);
-
-    if (val->local_id == id)
-    {
-      return(val);
-    }
-
-    not_done = dl_list_next(list);
+    return NULL;
   }
 
-  /* we didn't find anything */
-  return NULL;
+  return(al->by_local_id[id]);
 }
 
 attribute_struct *
@@ -934,32 +1162,20 @@ find_attribute_by_global_id(class, global_id)
   class_struct  *class;
   int           global_id;
 {
-  int               not_done;
-  attribute_struct  *val;
-  dl_list_type      *list;
-  
+  attribute_lookup_struct *al;
+
   if (!class)
   {
     return NULL;
   }
 
-  list = &(class->attribute_list);
-  
-  not_done = dl_list_first(list);
-  while (not_done)
+  al = get_attribute_lookup(class);
+  if (global_id < 0 || global_id >= al->num_global_ids)
   {
-    val = dl_list_value(list);
-
-    if (val->global_id == global_id)
-    {
-      return(val);
-    }
-
-    not_done = dl_list_next(list);
+    return NULL;
   }
 
-  /* we didn't find anything */
-  return NULL;
+  return(al->by_global_id[global_id]);
 }
 
 attribute_ref_struct *
@@ -967,38 +1183,12 @@ find_global_attr_by_name(attr_ref_list, name)
   dl_list_type  *attr_ref_list;
   char          *name;
 {
-  int                   not_done;
-  attribute_ref_struct  *val;
-  int                   i;
-
   if (!attr_ref_list || !name)
   {
     return NULL;
   }
 
-  not_done = dl_list_first(attr_ref_list);
-  while (not_done)
-  {
-    val = dl_list_value(attr_ref_list);
-
-    if (STR_EQ(val->name, name))
-    {
-      return(val);
-    }
-
-    for (i = 0; i < val->num_aliases; i++)
-    {
-      if (STR_EQ(val->aliases[i], name))
-      {
-        return(val);
-      }
-    }
-
-    not_done = dl_list_next(attr_ref_list);
-  }
-
-  /* we didn't find anything */
-  return NULL;
+  return(hash_table_find(get_attr_ref_lookup(attr_ref_list)->names, name));
 }
 
 attribute_ref_struct *
@@ -1006,29 +1196,20 @@ find_global_attr_by_id(attr_ref_list, id)
   dl_list_type  *attr_ref_list;
   int           id;
 {
-  int                   not_done;
-  attribute_ref_struct  *val;
+  attr_ref_lookup_struct *arl;
 
   if (!attr_ref_list)
   {
     return NULL;
   }
 
-  not_done = dl_list_first(attr_ref_list);
-  while (not_done)
+  arl = get_attr_ref_lookup(attr_ref_list);
+  if (id < 0 || id >= arl->num_ids)
   {
-    val = dl_list_value(attr_ref_list);
-
-    if (val->global_id == id)
-    {
-      return(val);
-    }
-
-    not_done = dl_list_next(attr_ref_list);
+    return NULL;
   }
 
-  /* we didn't find anything */
-  return NULL;
+  return(arl->by_id[id]);
 }
 
 
@@ -1149,6 +1330,11 @@ destroy_attr_data(attr)
   {
     free(attr->format);
   }
+
+  if (attr->format_prog)
+  {
+    free(attr->format_prog);
+  }
   
   for (i = 0; i < attr->num_aliases; i++)
   {
@@ -1466,5 +1652,80 @@ add_new_attribute_alias(aa, class, attr, alias)
     return FALSE;
   }
 
-  return( add_attribute_alias(&(attr->aliases), &(attr->num_aliases), alias) );
+  if (!add_attribute_alias(&(attr->aliases), &(attr->num_aliases), alias))
+  {
+    return FALSE;
+  }
+
+  clear_attribute_lookup(class);
+
+  return TRUE;
+}
+
+void
+build_attribute_lookups(schema)
+  schema_struct *schema;
+{
+  dl_list_type  *list;
+  dl_node_type  *orig_posn;
+  int           not_done;
+
+  if (!schema)
+  {
+    return;
+  }
+
+  list      = &(schema->class_list);
+  orig_posn = dl_list_get_pos(list);
+
+  not_done = dl_list_first(list);
+  while (not_done)
+  {
+    get_attribute_lookup(dl_list_value(list));
+    not_done = dl_list_next(list);
+  }
+
+  dl_list_put_pos(list, orig_posn);
+
+  get_attr_ref_lookup(&(schema->attribute_ref_list));
+}
+
+void
+clear_attribute_lookup(class)
+  class_struct  *class;
+{
+  attribute_lookup_struct *al;
+
+  if (!class || !class->attribute_lookup)
+  {
+    return;
+  }
+
+  al = class->attribute_lookup;
+
+  hash_table_destroy(al->names);
+
+  if (al->by_local_id)
+  {
+    free(al->by_local_id);
+  }
+
+  if (al->by_global_id)
+  {
+    free(al->by_global_id);
+  }
+
+  free(al);
+
+  class->attribute_lookup = NULL;
+}
+
+void
+clear_global_attr_lookup(attr_ref_list)
+  dl_list_type  *attr_ref_list;
+{
+  if (attr_ref_list && find_attr_ref_lookup(attr_ref_list))
+  {
+    dl_list_delete(&attr_ref_lookup_list);
+  }
 }
@@ -132,4 +132,18 @@ int add_new_attribute_alias PROTO((auth_area_struct *aa,
                                    class_struct *class, 
                                    attribute_struct *attr, char *alias));
 
+/* builds the tables the attribute lookup functions keep for each class
+   in 'schema', and for its attribute reference list, so that they
+   don't have to be built on the first lookup (in each child) */
+void build_attribute_lookups PROTO((schema_struct *schema));
+
+/* throws away the tables that find_attribute_by_name(), _by_id() and
+   _by_global_id() keep for 'class', for when the class is destroyed.
+   (Changes made through this module clear them on their own.) */
+void clear_attribute_lookup PROTO((class_struct *class));
+
+/* the same, for the tables find_global_attr_by_name() and _by_id()
+   keep for 'attr_ref_list' */
+void clear_global_attr_lookup PROTO((dl_list_type *attr_ref_list));
+
 #endif /* _ATTRIBUTES_H_ */
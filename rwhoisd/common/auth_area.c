@@ -16,6 +16,7 @@
 #include "defines.h"
 #include "dl_list.h"
 #include "fileutils.h"
+#include "hash_table.h"
 #include "ip_network.h"
 #include "log.h"
 #include "main_config.h"
@@ -74,9 +75,21 @@ static int verify_auth_area PROTO((auth_area_struct *aa));
 
 static dl_list_type *auth_area_list = NULL;
 
+/* auth_area_list by name, built when first needed */
+static hash_table_type *auth_area_names = NULL;
+
 
 /* ------------------ Local Functions ------------------ */
 
+/* clear_auth_area_names: throws away the auth_area_list lookup table,
+   for when the list changes */
+static void
+clear_auth_area_names()
+{
+  hash_table_destroy(auth_area_names);
+  auth_area_names = NULL;
+}
+
 
 /* check_soa: given an auth-area record, check for null or illegal
    values.  If found, log errors and return FALSE */
@@ -1248,6 +1261,7 @@ add_auth_area(aa)
 
 
   dl_list_append(auth_area_list, aa);
+  clear_auth_area_names();
 
   return TRUE;
 }
@@ -1718,6 +1732,7 @@ destroy_server_data(server)
 void
 destroy_auth_area_list()
 {
+  clear_auth_area_names();
   dl_list_destroy(auth_area_list);
   auth_area_list = NULL;
 }
@@ -1794,25 +1809,31 @@ find_auth_area_by_name(name)
   char *name;
 {
   auth_area_struct  *auth_area;
+  dl_node_type      *orig_posn;
   int               not_done;
 
   if (!auth_area_list) return NULL;
 
   if (NOT_STR_EXISTS(name)) return NULL;
 
-  not_done = dl_list_first(auth_area_list);
-  while (not_done)
+  if (!auth_area_names)
   {
-    auth_area = dl_list_value(auth_area_list);
-    if (STR_EQ(auth_area->name, name))
+    auth_area_names = hash_table_create(0);
+    orig_posn       = dl_list_get_pos(auth_area_list);
+
+    not_done = dl_list_first(auth_area_list);
+    while (not_done)
     {
-      return(auth_area);
+      auth_area = dl_list_value(auth_area_list);
+      hash_table_insert(auth_area_names, auth_area->name, auth_area);
+
+      not_done = dl_list_next(auth_area_list);
     }
 
-    not_done = dl_list_next(auth_area_list);
+    dl_list_put_pos(auth_area_list, orig_posn);
   }
 
-  return NULL;
+  return(hash_table_find(auth_area_names, name));
 }
 
 
@@ -2264,6 +2285,7 @@ create_auth_area(aa)
   }
 
   dl_list_append(auth_area_list, newaa);
+  clear_auth_area_names();
 
   return TRUE;
 }
@@ -2273,13 +2295,26 @@ int
 delete_auth_area(name)
   char *name;
 {
-  if (!find_auth_area_by_name(name))
+  auth_area_struct  *aa;
+  int               not_done;
+
+  if (!(aa = find_auth_area_by_name(name)))
   {
     log(L_LOG_ERR, CONFIG,
         "'%s' authority area does not exist", name);
     return FALSE;
   }
-  if (!dl_list_delete(auth_area_list))
+
+  /* position the list on it */
+  not_done = dl_list_first(auth_area_list);
+  while (not_done && dl_list_value(auth_area_list) != aa)
+  {
+    not_done = dl_list_next(auth_area_list);
+  }
+
+  clear_auth_area_names();
+
+  if (!not_done || !dl_list_delete(auth_area_list))
   {
     log(L_LOG_ERR, CONFIG,
         "'%s' authority area could not be deleted", name);
@@ -108,6 +108,10 @@
 #include <crypt.h>
 #endif /* HAVE_CRYPT_H */
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
+
 #ifdef HAVE_INTTYPES_H
 #include <inttypes.h>
 #else
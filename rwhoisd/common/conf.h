@@ -102,9 +102,6 @@
    substring searches (query strings start with a wildcard) */
 #define DEFAULT_QUERY_ALLOW_SUBSTR FALSE
 
-/* where the client software is (for -forward) */
-#define DEFAULT_CLIENT_PROG "/usr/local/bin/rwhois"
-
 /* server_state_default */
 #define DEFAULT_HOLDCONNECT "OFF"
 #define DEFAULT_FORWARD     "OFF"
@@ -113,6 +110,32 @@
 /* the maximum number of children, if a daemon.  0 means no limit */
 #define DEFAULT_MAX_CHILDREN 0
 
+/* the number of pre-forked worker processes, if a daemon.  Each
+   worker accepts connections itself and serves many sessions over its
+   lifetime.  0 means fork a new child for every connection */
+#define DEFAULT_WORKER_POOL_SIZE 0
+
+/* the number of sessions a pooled worker serves before it is replaced
+   by a fresh one.  0 means no limit */
+#define DEFAULT_WORKER_MAX_SESSIONS 1000
+
+/* the number of slave authority area refreshes (SOA polls, schema and
+   data transfers) a daemon runs at once.  0 means no limit */
+#define DEFAULT_MAX_SLAVE_REFRESHES 4
+
+/* the number of seconds to wait on an upstream server when following
+   referrals for a -forward client, for the connection and then for
+   each line of the response */
+#define DEFAULT_FORWARD_TIMEOUT 10
+
+/* the number of seconds a response from an upstream server is reused
+   for the same forwarded query.  0 means don't keep them */
+#define DEFAULT_FORWARD_CACHE_TTL 0
+
+/* the size, in bytes, of the buffer used to batch up log file writes.
+   0 means write each line as soon as it is logged */
+#define DEFAULT_LOG_BUFFER_SIZE 0
+
 /* define this if you wish to use system file locking (lockf() or
    flock()) for basic concurrency control during registration.  This
    is more efficient and reliable, normally, but may not work at all
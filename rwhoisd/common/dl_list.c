@@ -9,18 +9,27 @@
 
 #include "dl_list.h"
 
+#include "arena.h"
 #include "defines.h"
 
 /* create_new_node:
-   malloc()s a new node into existance, and defaults the member
-   variables. */
+   malloc()s a new node into existance (or takes it from the arena, if
+   the list uses one), and defaults the member variables. */
 static dl_node_type *
-create_new_node(data)
-  void  *data;
+create_new_node(list, data)
+  dl_list_type  *list;
+  void          *data;
 {
   dl_node_type  *node;
   
-  node = (dl_node_type *) malloc(sizeof(dl_node_type));
+  if (list->arena_nodes)
+  {
+    node = (dl_node_type *) arena_xcalloc(1, sizeof(dl_node_type));
+  }
+  else
+  {
+    node = (dl_node_type *) malloc(sizeof(dl_node_type));
+  }
   if (!node) return NULL;
     
   node->next = NULL;
@@ -41,12 +50,24 @@ dl_list_default(list, destroy_head_flag, destroy_data)
     list->current           = NULL;
     list->destroy_head_flag = destroy_head_flag;
     list->destroy_data      = destroy_data;
+    list->arena_nodes       = FALSE;
 
     return TRUE;
   }
   return FALSE;
 }
 
+int
+dl_list_use_arena(list)
+  dl_list_type  *list;
+{
+  if (!list) return FALSE;
+
+  list->arena_nodes = TRUE;
+
+  return TRUE;
+}
+
 void *
 dl_list_value(list)
   dl_list_type  *list;
@@ -179,7 +200,7 @@ dl_list_insert(list, data)
 {
   dl_node_type  *node;
     
-  node = create_new_node(data);
+  node = create_new_node(list, data);
   if (!node) return FALSE;
 
   if (dl_list_empty(list))
@@ -214,7 +235,7 @@ dl_list_insert_before(list, data)
 {
   dl_node_type  *node;
 
-  node = create_new_node(data);
+  node = create_new_node(list, data);
   if (!node) return FALSE;
 
   if (dl_list_empty(list))
@@ -390,7 +411,14 @@ dl_list_delete(list)
     list->head = current->next;
   } 
     
-  free(current);
+  if (list->arena_nodes)
+  {
+    arena_free(current);
+  }
+  else
+  {
+    free(current);
+  }
   return TRUE;
 }
 
@@ -30,6 +30,7 @@ typedef struct _dl_list_type
   dl_node_type        *current;
   int                 destroy_head_flag;
   int                 (*destroy_data) PROTO((void *data));
+  int                 arena_nodes;
 } dl_list_type;
 
 /* prototypes */
@@ -43,6 +44,11 @@ int dl_list_default PROTO((dl_list_type *list,
                            int destroy_head_flag,
                            int (*destroy_data)()));
 
+/* makes the list take its nodes from the bound arena, if there is one
+   (see arena.h), rather than the heap.  Only for lists that go when
+   the arena is reset, such as the av pairs of a record. */
+int dl_list_use_arena PROTO((dl_list_type *list));
+
 /* returns the value (a pointer to the data element) at the current
    position */ 
 void *dl_list_value PROTO((dl_list_type *list));
@@ -0,0 +1,174 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "hash_table.h"
+
+#include "defines.h"
+#include "misc.h"
+
+/* the smallest number of buckets */
+#define MIN_HASH_TABLE_SIZE 16
+
+/* ------------------- Local Functions --------------------- */
+
+/* hash_key: hashes 'key' without regard to case */
+static unsigned long
+hash_key(key)
+  char  *key;
+{
+  unsigned long h = 5381;
+  char          *p;
+
+  for (p = key; *p; p++)
+  {
+    h = (h << 5) + h + (unsigned char) tolower((unsigned char) *p);
+  }
+
+  return(h);
+}
+
+/* grow_hash_table: doubles the number of buckets in 'table' */
+static void
+grow_hash_table(table)
+  hash_table_type *table;
+{
+  hash_entry_type **buckets;
+  hash_entry_type *entry;
+  hash_entry_type *next;
+  int             size;
+  int             i;
+  int             b;
+
+  size    = table->size * 2;
+  buckets = xcalloc(size, sizeof(*buckets));
+
+  for (i = 0; i < table->size; i++)
+  {
+    for (entry = table->buckets[i]; entry; entry = next)
+    {
+      next        = entry->next;
+      b           = hash_key(entry->key) & (size - 1);
+      entry->next = buckets[b];
+      buckets[b]  = entry;
+    }
+  }
+
+  free(table->buckets);
+  table->buckets = buckets;
+  table->size    = size;
+}
+
+/* ------------------- Public Functions -------------------- */
+
+hash_table_type *
+hash_table_create(num_entries)
+  int num_entries;
+{
+  hash_table_type *table;
+  int             size   = MIN_HASH_TABLE_SIZE;
+
+  while (size < num_entries)
+  {
+    size *= 2;
+  }
+
+  table          = xcalloc(1, sizeof(*table));
+  table->size    = size;
+  table->buckets = xcalloc(size, sizeof(*(table->buckets)));
+
+  return(table);
+}
+
+int
+hash_table_insert(table, key, data)
+  hash_table_type *table;
+  char            *key;
+  void            *data;
+{
+  hash_entry_type *entry;
+  int             b;
+
+  if (!table || !key)
+  {
+    return FALSE;
+  }
+
+  if (hash_table_find(table, key))
+  {
+    return FALSE;
+  }
+
+  if (table->count >= table->size)
+  {
+    grow_hash_table(table);
+  }
+
+  b = hash_key(key) & (table->size - 1);
+
+  entry       = xcalloc(1, sizeof(*entry));
+  entry->key  = xstrdup(key);
+  entry->data = data;
+  entry->next = table->buckets[b];
+
+  table->buckets[b] = entry;
+  table->count++;
+
+  return TRUE;
+}
+
+void *
+hash_table_find(table, key)
+  hash_table_type *table;
+  char            *key;
+{
+  hash_entry_type *entry;
+
+  if (!table || !key)
+  {
+    return NULL;
+  }
+
+  entry = table->buckets[hash_key(key) & (table->size - 1)];
+  for ( ; entry; entry = entry->next)
+  {
+    if (STR_EQ(entry->key, key))
+    {
+      return(entry->data);
+    }
+  }
+
+  return NULL;
+}
+
+void
+hash_table_destroy(table)
+  hash_table_type *table;
+{
+  hash_entry_type *entry;
+  hash_entry_type *next;
+  int             i;
+
+  if (!table)
+  {
+    return;
+  }
+
+  for (i = 0; i < table->size; i++)
+  {
+    for (entry = table->buckets[i]; entry; entry = next)
+    {
+      next = entry->next;
+      free(entry->key);
+      free(entry);
+    }
+  }
+
+  free(table->buckets);
+  free(table);
+}
@@ -0,0 +1,51 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _HASH_TABLE_H_
+#define _HASH_TABLE_H_
+
+/* includes */
+#include "common.h"
+
+/* types */
+
+/* hash_table_type: a table of data pointers keyed by strings.  Keys
+   are compared without regard to case (like STR_EQ), as names in the
+   configuration are. */
+typedef struct _hash_entry_type
+{
+  char                    *key;
+  void                    *data;
+  struct _hash_entry_type *next;
+} hash_entry_type;
+
+typedef struct _hash_table_type
+{
+  int             size;       /* number of buckets; a power of two */
+  int             count;      /* number of entries */
+  hash_entry_type **buckets;
+} hash_table_type;
+
+/* prototypes */
+
+/* creates an empty table sized for about 'num_entries' entries */
+hash_table_type *hash_table_create PROTO((int num_entries));
+
+/* adds 'data' to the table under (a copy of) 'key'.  Returns FALSE,
+   leaving the table alone, if 'key' is already there, so the first
+   data added under a key is the one found. */
+int hash_table_insert PROTO((hash_table_type *table, char *key, void *data));
+
+/* returns the data under 'key', or NULL if there isn't any */
+void *hash_table_find PROTO((hash_table_type *table, char *key));
+
+/* frees the table and its keys, but not the data */
+void hash_table_destroy PROTO((hash_table_type *table));
+
+#endif /* _HASH_TABLE_H_ */
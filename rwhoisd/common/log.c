@@ -458,6 +458,10 @@ get_log_filename(level)
 void
 setup_logging()
 {
+  /* (re)open the log files on first use, so that a SIGHUP after the
+     logs have been rotated starts new ones */
+  close_log_files();
+
 #ifndef NO_SYSLOG
   openlog("rwhoisd", LOG_PID, get_log_facility());
 #endif
@@ -119,6 +119,13 @@ char *timestamp PROTO(());
 
 void setup_logging PROTO((void));
 
+/* writes out any batched log lines */
+void flush_log_files PROTO((void));
+
+/* flushes and closes the open log files; they are reopened (by name)
+   the next time something is logged to them */
+void close_log_files PROTO((void));
+
 log_context_struct *get_log_context PROTO((void));
 
 int set_log_context PROTO((char *file, long line_num, log_section section));
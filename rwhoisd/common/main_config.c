@@ -310,6 +310,34 @@ read_main_config_file(config_file, chrooted)
       {
         set_child_priority(atoi(datum));
       }
+      else if (STR_EQ(tag, I_WORKER_POOL_SIZE))
+      {
+        set_worker_pool_size(atoi(datum));
+      }
+      else if (STR_EQ(tag, I_WORKER_MAX_SESSIONS))
+      {
+        set_worker_max_sessions(atoi(datum));
+      }
+      else if (STR_EQ(tag, I_MAX_SLAVE_REFRESHES))
+      {
+        set_max_slave_refreshes(atoi(datum));
+      }
+      else if (STR_EQ(tag, I_FORWARD_TIMEOUT))
+      {
+        if (!set_forward_timeout_str(datum))
+        {
+          log(L_LOG_WARNING, CONFIG, "invalid %s '%s' %s",
+              I_FORWARD_TIMEOUT, datum, file_context_str());
+        }
+      }
+      else if (STR_EQ(tag, I_FORWARD_CACHE_TTL))
+      {
+        set_forward_cache_ttl(atoi(datum));
+      }
+      else if (STR_EQ(tag, I_LOG_BUFFER_SIZE))
+      {
+        set_log_buffer_size(atoi(datum));
+      }
       else
       {
         log(L_LOG_WARNING, CONFIG, "config file tag '%s' unrecognized %s",
@@ -366,6 +394,12 @@ init_server_config_data()
   set_skip_referral_search(FALSE);
   set_listen_queue_length(5);
   set_child_priority(0);
+  set_worker_pool_size(DEFAULT_WORKER_POOL_SIZE);
+  set_worker_max_sessions(DEFAULT_WORKER_MAX_SESSIONS);
+  set_max_slave_refreshes(DEFAULT_MAX_SLAVE_REFRESHES);
+  set_forward_timeout(DEFAULT_FORWARD_TIMEOUT);
+  set_forward_cache_ttl(DEFAULT_FORWARD_CACHE_TTL);
+  set_log_buffer_size(DEFAULT_LOG_BUFFER_SIZE);
 
   /* logging variables */
   set_use_syslog(DEFAULT_USE_SYSLOG);
@@ -1460,6 +1494,217 @@ set_child_priority(val)
   return TRUE;
 }
 
+
+int
+get_worker_pool_size()
+{
+  return(server_config_data.worker_pool_size);
+}
+
+int
+set_worker_pool_size(val)
+  int val;
+{
+  if (val < 0)
+  {
+    val = 0;
+  }
+  server_config_data.worker_pool_size = val;
+  return TRUE;
+}
+
+
+int
+get_worker_max_sessions()
+{
+  return(server_config_data.worker_max_sessions);
+}
+
+int
+set_worker_max_sessions(val)
+  int val;
+{
+  if (val < 0)
+  {
+    val = 0;
+  }
+  server_config_data.worker_max_sessions = val;
+  return TRUE;
+}
+
+
+int
+get_max_slave_refreshes()
+{
+  return(server_config_data.max_slave_refreshes);
+}
+
+int
+set_max_slave_refreshes(val)
+  int val;
+{
+  if (val < 0)
+  {
+    val = 0;
+  }
+  server_config_data.max_slave_refreshes = val;
+  return TRUE;
+}
+
+int
+get_forward_timeout()
+{
+  return(server_config_data.forward_timeout);
+}
+
+int
+set_forward_timeout(val)
+  int val;
+{
+  if (val < 0)
+  {
+    val = 0;
+  }
+  server_config_data.forward_timeout = val;
+  return TRUE;
+}
+
+/* set_forward_timeout_str: "seconds" sets the default forward
+   timeout, and "host [port] seconds" the one for an upstream server
+   (on any port, if none is given) */
+int
+set_forward_timeout_str(str)
+  char  *str;
+{
+  forward_timeout_struct  *ft;
+  char                    host[MAX_LINE];
+  int                     port;
+  int                     timeout;
+  int                     i;
+
+  switch (sscanf(str, "%511s %d %d", host, &port, &timeout))
+  {
+  case 1:
+    if (!is_number_str(host))
+    {
+      return FALSE;
+    }
+    return(set_forward_timeout(atoi(host)));
+  case 2:
+    timeout = port;
+    port    = 0;
+    break;
+  case 3:
+    if (port <= 0)
+    {
+      return FALSE;
+    }
+    break;
+  default:
+    return FALSE;
+  }
+
+  if (timeout < 0)
+  {
+    timeout = 0;
+  }
+
+  /* a later entry for the same server replaces the earlier one */
+  for (i = 0; i < server_config_data.num_forward_timeouts; i++)
+  {
+    ft = &(server_config_data.forward_timeouts[i]);
+    if (ft->port == port && STR_EQ(ft->host, host))
+    {
+      ft->timeout = timeout;
+      return TRUE;
+    }
+  }
+
+  if (server_config_data.num_forward_timeouts >= MAX_FORWARD_TIMEOUTS)
+  {
+    log(L_LOG_WARNING, CONFIG, "more than %d upstream forward timeouts",
+        MAX_FORWARD_TIMEOUTS);
+    return FALSE;
+  }
+
+  ft = &(server_config_data.forward_timeouts[
+           server_config_data.num_forward_timeouts++]);
+  strcpy(ft->host, host);
+  ft->port    = port;
+  ft->timeout = timeout;
+
+  return TRUE;
+}
+
+/* get_upstream_forward_timeout: returns the forward timeout for the
+   server at host:port: its own, if it has one, or else the default */
+int
+get_upstream_forward_timeout(host, port)
+  char  *host;
+  int   port;
+{
+  forward_timeout_struct  *ft;
+  int                     timeout = get_forward_timeout();
+  int                     i;
+
+  for (i = 0; i < server_config_data.num_forward_timeouts; i++)
+  {
+    ft = &(server_config_data.forward_timeouts[i]);
+    if (!STR_EQ(ft->host, host))
+    {
+      continue;
+    }
+
+    /* an entry for the port wins over one for the whole host */
+    if (ft->port == port)
+    {
+      return(ft->timeout);
+    }
+    if (ft->port == 0)
+    {
+      timeout = ft->timeout;
+    }
+  }
+
+  return(timeout);
+}
+
+int
+get_forward_cache_ttl()
+{
+  return(server_config_data.forward_cache_ttl);
+}
+
+int
+set_forward_cache_ttl(val)
+  int val;
+{
+  if (val < 0)
+  {
+    val = 0;
+  }
+  server_config_data.forward_cache_ttl = val;
+  return TRUE;
+}
+
+int
+get_log_buffer_size()
+{
+  return(server_config_data.log_buffer_size);
+}
+
+int
+set_log_buffer_size(val)
+  int val;
+{
+  if (val < 0)
+  {
+    val = 0;
+  }
+  server_config_data.log_buffer_size = val;
+  return TRUE;
+}
+
 /* returns the server type string associated with the server type */
 char *
 get_server_type_str(serv_type)
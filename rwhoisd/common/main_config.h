@@ -62,9 +62,28 @@
 #define I_SKIP_REFERAL_SEARCH "skip-referral-search"
 #define I_LISTEN_QUEUE      "listen-queue-length"
 #define I_CHILD_PRIORITY    "child-priority-offset"
+#define I_WORKER_POOL_SIZE  "worker-pool-size"
+#define I_WORKER_MAX_SESSIONS "worker-max-sessions"
+#define I_MAX_SLAVE_REFRESHES "max-slave-refreshes"
+#define I_FORWARD_TIMEOUT   "forward-timeout"
+#define I_FORWARD_CACHE_TTL "forward-cache-ttl"
+#define I_LOG_BUFFER_SIZE   "log-buffer-size"
+
+/* the number of upstream servers that can be given a forward-timeout
+   of their own */
+#define MAX_FORWARD_TIMEOUTS  16
 
 /* structures */
 
+/* forward_timeout_struct: the forward-timeout for one upstream
+   server */
+typedef struct _forward_timeout_struct
+{
+  char   host[MAX_LINE];
+  int    port;                  /* 0 for any port */
+  int    timeout;
+} forward_timeout_struct;
+
 /* All data read from configuration file rwhois.conf at the
    server level.  For example, root-dir, deadman-time, etc */
 typedef struct _server_config_struct
@@ -110,6 +129,14 @@ typedef struct _server_config_struct
   int    skip_referral_search;
   int    listen_queue_length;
   int    child_priority_offset;
+  int    worker_pool_size;
+  int    worker_max_sessions;
+  int    max_slave_refreshes;
+  int    forward_timeout;
+  int    num_forward_timeouts;
+  forward_timeout_struct forward_timeouts[MAX_FORWARD_TIMEOUTS];
+  int    forward_cache_ttl;
+  int    log_buffer_size;
 } server_config_struct;
 
 
@@ -269,6 +296,27 @@ int  get_listen_queue_length PROTO((void));
 int  set_child_priority PROTO((int val));
 int  get_child_priority PROTO((void));
 
+int  set_worker_pool_size PROTO((int val));
+int  get_worker_pool_size PROTO((void));
+
+int  set_worker_max_sessions PROTO((int val));
+int  get_worker_max_sessions PROTO((void));
+
+int  set_max_slave_refreshes PROTO((int val));
+int  get_max_slave_refreshes PROTO((void));
+
+int  set_forward_timeout PROTO((int val));
+int  get_forward_timeout PROTO((void));
+
+int  set_forward_timeout_str PROTO((char *str));
+int  get_upstream_forward_timeout PROTO((char *host, int port));
+
+int  set_forward_cache_ttl PROTO((int val));
+int  get_forward_cache_ttl PROTO((void));
+
+int  set_log_buffer_size PROTO((int val));
+int  get_log_buffer_size PROTO((void));
+
 /* server_state guards */
 int  set_hit_limit PROTO((int limit));
 int  get_hit_limit PROTO((void));
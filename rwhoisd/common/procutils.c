@@ -120,7 +120,11 @@ run_program(program, param)
 
   /* split_arg_list should leave argv NULL terminated */
   split_arg_list(buf, &argc, &argv);
-  
+
+  /* anything we've buffered for the client must go out before the
+     program's own output, and must not be copied into the child */
+  fflush(stdout);
+
   pid = fork();
 
   if ( pid == -1 )
@@ -218,6 +222,9 @@ run_env_program(argv, envargv)
     myenv[i++] = xstrdup(environ[j]);
   }
   
+  /* send our buffered output first (see run_program) */
+  fflush(stdout);
+
   /* do the fork thing */
   pid = fork();
   
@@ -16,6 +16,213 @@
 #include "misc.h"
 #include "types.h"
 
+/* the most distinct log files we can have open: one per level */
+#define MAX_LOG_FILES       (L_LOG_DEBUG + 1)
+
+/* the longest single log line we will write */
+#define MAX_LOG_LINE        (MAX_LINE * 4)
+
+/* local types */
+
+/* log_file_struct: an open log file, shared by every level that logs
+   to it.  When batching, 'buf' holds lines not yet written; 'buf_pid'
+   is the process that wrote them, so a forked child never writes out
+   its parent's lines a second time. */
+typedef struct _log_file_struct
+{
+  char   filename[MAX_FILE];
+  int    fd;
+  char   *buf;
+  int    buf_len;
+  int    buf_size;
+  pid_t  buf_pid;
+} log_file_struct;
+
+/* local statics */
+
+static log_file_struct  log_files[MAX_LOG_FILES];
+static int              num_log_files = 0;
+static int              log_atexit_set = FALSE;
+
+/* ------------------- Local Functions --------------------- */
+
+/* write_log_data: write() the whole of 'data', retrying partial writes */
+static void
+write_log_data(fd, data, len)
+  int   fd;
+  char  *data;
+  int   len;
+{
+  int   n;
+
+  while (len > 0)
+  {
+    n = write(fd, data, len);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return;
+    }
+    data += n;
+    len  -= n;
+  }
+}
+
+static void
+flush_log_file(lf)
+  log_file_struct *lf;
+{
+  if (lf->buf_len > 0 && lf->buf_pid == getpid())
+  {
+    write_log_data(lf->fd, lf->buf, lf->buf_len);
+  }
+  lf->buf_len = 0;
+}
+
+static void
+flush_log_files_at_exit()
+{
+  flush_log_files();
+}
+
+/* get_log_file: returns the open log file for 'filename', opening it
+   if this is the first time we've logged there */
+static log_file_struct *
+get_log_file(filename)
+  char  *filename;
+{
+  log_file_struct *lf;
+  int             i;
+
+  for (i = 0; i < num_log_files; i++)
+  {
+    if (STR_EQ(log_files[i].filename, filename))
+    {
+      return(&log_files[i]);
+    }
+  }
+
+  if (num_log_files >= MAX_LOG_FILES)
+  {
+    /* can't happen: every level has exactly one file */
+    return(NULL);
+  }
+
+  lf = &log_files[num_log_files];
+  bzero(lf, sizeof(*lf));
+  strncpy(lf->filename, filename, sizeof(lf->filename) - 1);
+
+  if (STR_EQ(filename, "stderr"))
+  {
+    lf->fd = fileno(stderr);
+  }
+  else
+  {
+    lf->fd = open(filename, O_WRONLY | O_APPEND | O_CREAT, 0666);
+    if (lf->fd < 0)
+    {
+      fprintf(stderr, "error: could not open file %s\n",
+              filename);
+      fprintf(stderr, "error: fatal error; terminating\n");
+      exit(1);
+    }
+    /* don't hand our log files to programs we run */
+    fcntl(lf->fd, F_SETFD, FD_CLOEXEC);
+  }
+
+  lf->buf_size = get_log_buffer_size();
+  if (lf->buf_size > 0)
+  {
+    lf->buf = xcalloc(1, lf->buf_size);
+  }
+  lf->buf_pid = getpid();
+
+  num_log_files++;
+
+  if (!log_atexit_set)
+  {
+    atexit(flush_log_files_at_exit);
+    log_atexit_set = TRUE;
+  }
+
+  return(lf);
+}
+
+/* write_log_line: writes one complete line.  Without a log buffer the
+   line goes out immediately in a single write(), which (since the file
+   is opened for append) keeps lines from different processes from
+   being mixed together.  With a log buffer, lines are batched and
+   written when the buffer fills, when something at WARNING or worse is
+   logged, or when flush_log_files() is called. */
+static void
+write_log_line(lf, level, line, len)
+  log_file_struct     *lf;
+  internal_log_levels level;
+  char                *line;
+  int                 len;
+{
+  if (lf->buf_pid != getpid())
+  {
+    /* these were our parent's, and it will write them itself */
+    lf->buf_len = 0;
+    lf->buf_pid = getpid();
+  }
+
+  if (!lf->buf || level <= L_LOG_WARNING || len > lf->buf_size)
+  {
+    flush_log_file(lf);
+    write_log_data(lf->fd, line, len);
+    return;
+  }
+
+  if (lf->buf_len + len > lf->buf_size)
+  {
+    flush_log_file(lf);
+  }
+
+  bcopy(line, lf->buf + lf->buf_len, len);
+  lf->buf_len += len;
+}
+
+/* ------------------- Public Functions -------------------- */
+
+void
+flush_log_files()
+{
+  int   i;
+
+  for (i = 0; i < num_log_files; i++)
+  {
+    flush_log_file(&log_files[i]);
+  }
+}
+
+void
+close_log_files()
+{
+  int   i;
+
+  for (i = 0; i < num_log_files; i++)
+  {
+    flush_log_file(&log_files[i]);
+
+    if (log_files[i].fd != fileno(stderr))
+    {
+      close(log_files[i].fd);
+    }
+    if (log_files[i].buf)
+    {
+      free(log_files[i].buf);
+    }
+  }
+
+  bzero(log_files, sizeof(log_files));
+  num_log_files = 0;
+}
+
 void
 #ifndef HAVE_STDARG_H
 log(va_alist)
@@ -25,13 +232,14 @@ log(internal_log_levels level, int section, char *format, ...)
 #endif
 {
   va_list             ap;
-  FILE                *fp;
+  log_file_struct     *lf;
   char                *filename;
   char                *hostname;
   char                message[MAX_LINE];
   char                tmp[MAX_LINE];
+  char                line[MAX_LOG_LINE];
   char                *section_name;
-  int                 fd;
+  int                 len;
   int                 use_syslog;
   int                 syslog_level;
 #ifndef HAVE_STDARG_H
@@ -102,52 +310,31 @@ log(internal_log_levels level, int section, char *format, ...)
 
     if (filename == NULL) goto end_proc;	/* single point for va_end(ap) and return */
 
-    if (STR_EQ(filename, "stderr"))
-    {
-      fp = stderr;
-    }
-    else
-    {
-      fp = fopen(filename, "a");
-      if (!fp)
-      {
-        fprintf(stderr, "error: could not open file %s\n",
-                filename);
-        fprintf(stderr, "error: fatal error; terminating\n");
-        exit(1);
-      }
-    }
-
-    fd = fileno(fp);
-
-    /* lock for exclusive use  - default is to wait */
-    /* FIXME:  maybe should use more general get_file_lock() routine */
-/*     if (sys_file_lock(fd, FILE_LOCK) != 0) */
-/*     { */
-/*       fprintf(stderr, "save_into_log: could not start lock %s\n", filename); */
-/*     } */
+    if ((lf = get_log_file(filename)) == NULL) goto end_proc;
 
-    fprintf(fp,
-            "%s %s rwhoisd[%d]: %s: ",
-            timestamp(),
-            get_local_hostname(),
-            (int) getpid(),
-            section_to_name(section));
+    /* build the whole line first, so it can be written all at once */
+    len = sprintf(line,
+                  "%s %s rwhoisd[%d]: %s: ",
+                  timestamp(),
+                  get_local_hostname(),
+                  (int) getpid(),
+                  section_to_name(section));
 
     if (section == NET || section == CLIENT)
     {
       hostname = get_client_hostname(1);  /* stdout is client sock */
-      fprintf(fp, "%s: ",hostname);
+      len += sprintf(line + len, "%.*s: ", MAX_LINE, hostname);
     }
-    vfprintf(fp, format, ap);
-    fprintf(fp, "\n");
 
-/*     if (sys_file_lock(fd, FILE_UNLOCK) != 0) */
-/*     { */
-/*       fprintf(stderr,"save_into_log: could not release lock %s\n", filename); */
-/*     } */
+#ifdef HAVE_VSNPRINTF
+    vsnprintf(line + len, sizeof(line) - len - 1, format, ap);
+#else
+    vsprintf(line + len, format, ap);
+#endif
+    len += strlen(line + len);
+    line[len++] = '\n';
 
-    fclose(fp);
+    write_log_line(lf, level, line, len);
   }
 end_proc:	/* single point for va_end(ap) and return */
 	va_end(ap);
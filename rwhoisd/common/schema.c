@@ -14,6 +14,7 @@
 #include "client_msgs.h"
 #include "defines.h"
 #include "fileutils.h"
+#include "hash_table.h"
 #include "log.h"
 #include "misc.h"
 #include "strutil.h"
@@ -26,18 +27,137 @@ static int verify_class PROTO((auth_area_struct *aa, class_struct *class));
 
 static int append_class PROTO((class_struct *class, auth_area_struct *aa ));
 
+static void clear_class_lookup PROTO((schema_struct *schema));
+
 static int count_class_entries PROTO((dl_list_type *class_list, 
                                       char *class_name));
 
 
 
+/* -------------------- LOCAL TYPES ----------------------- */
+
+/* class_lookup_struct: a schema's classes by name (and alias) and by
+   id.  Built from the class list when first needed, and thrown away
+   when the list changes. */
+typedef struct _class_lookup_struct
+{
+  hash_table_type *names;
+  class_struct    **by_id;
+  int             num_ids;
+} class_lookup_struct;
+
 /* -----------------LOCAL STATICS --------------------------*/
 
 static dl_list_type *class_ref_list = NULL;
 
+/* class_ref_list by name (and alias), built when first needed */
+static hash_table_type *class_ref_names = NULL;
+
 
 /* -------------------- LOCAL FUNCTIONS ------------------- */
 
+/* get_class_lookup: returns the lookup tables of 'schema', building
+   them if necessary */
+static class_lookup_struct *
+get_class_lookup(schema)
+  schema_struct *schema;
+{
+  class_lookup_struct *cl;
+  class_struct        *class;
+  dl_list_type        *list;
+  dl_node_type        *orig_posn;
+  int                 num_classes = 0;
+  int                 not_done;
+  int                 i;
+
+  if (schema->class_lookup)
+  {
+    return(schema->class_lookup);
+  }
+
+  list      = &(schema->class_list);
+  orig_posn = dl_list_get_pos(list);
+  cl        = xcalloc(1, sizeof(*cl));
+
+  not_done = dl_list_first(list);
+  while (not_done)
+  {
+    class = dl_list_value(list);
+    num_classes += class->num_aliases + 1;
+    if (class->id >= cl->num_ids)
+    {
+      cl->num_ids = class->id + 1;
+    }
+    not_done = dl_list_next(list);
+  }
+
+  cl->names = hash_table_create(num_classes);
+  if (cl->num_ids > 0)
+  {
+    cl->by_id = xcalloc(cl->num_ids, sizeof(class_struct *));
+  }
+
+  /* the first class in the list with a given name or id is the one
+     found, as when searching the list itself */
+  not_done = dl_list_first(list);
+  while (not_done)
+  {
+    class = dl_list_value(list);
+
+    hash_table_insert(cl->names, class->name, class);
+    for (i = 0; i < class->num_aliases; i++)
+    {
+      hash_table_insert(cl->names, class->aliases[i], class);
+    }
+
+    if (class->id >= 0 && !cl->by_id[class->id])
+    {
+      cl->by_id[class->id] = class;
+    }
+
+    not_done = dl_list_next(list);
+  }
+
+  dl_list_put_pos(list, orig_posn);
+
+  schema->class_lookup = cl;
+
+  return(cl);
+}
+
+/* clear_class_lookup: throws away the lookup tables of 'schema', for
+   when its class list (or a class's aliases) change */
+static void
+clear_class_lookup(schema)
+  schema_struct *schema;
+{
+  class_lookup_struct *cl;
+
+  if (!schema || !schema->class_lookup)
+  {
+    return;
+  }
+
+  cl = schema->class_lookup;
+
+  hash_table_destroy(cl->names);
+  if (cl->by_id)
+  {
+    free(cl->by_id);
+  }
+  free(cl);
+
+  schema->class_lookup = NULL;
+}
+
+/* clear_class_ref_names: throws away the class_ref_list lookup table */
+static void
+clear_class_ref_names()
+{
+  hash_table_destroy(class_ref_names);
+  class_ref_names = NULL;
+}
+
 static int
 add_class_alias(alias_array, num_aliases, alias)
   char ***alias_array;
@@ -235,6 +355,7 @@ append_class( class, aa )
 
   /* add the object to the list */
   dl_list_append(class_list, class);
+  clear_class_lookup(aa->schema);
 
   return TRUE;
 }
@@ -431,6 +552,10 @@ read_schema(aa)
 
   fclose (fp);
 
+  /* build the lookup tables now, rather than on the first query */
+  get_class_lookup(schema);
+  build_attribute_lookups(schema);
+
   return TRUE;
 }
 
@@ -488,6 +613,7 @@ add_class(schema, class, aa)
   
   /* add the object to the list */
   dl_list_append(class_list, class);
+  clear_class_lookup(schema);
 
   /* add to the class_ref_list */
   if (!add_global_class(class, aa))
@@ -556,6 +682,7 @@ add_global_class(class, aa)
     dl_list_append(aa_list, aa);
 
     dl_list_append(class_ref_list, ref);
+    clear_class_ref_names();
   }
 
   /* aliases */
@@ -569,6 +696,7 @@ add_global_class(class, aa)
     {
       add_class_alias(&(ref->aliases), &(ref->num_aliases),
                       class->aliases[i]);
+      clear_class_ref_names();
     }
     else
     {
@@ -608,42 +736,14 @@ find_class_by_name(schema, name)
   schema_struct  *schema;
   char           *name;
 {
-  dl_list_type  *list;
-  class_struct  *class;
-  int           not_done;
-  int           i;
-  
-  if (!schema) return NULL;
-
-  list = &(schema->class_list);
+  if (!schema || !name) return NULL;
 
-  if (dl_list_empty(list) )
+  if (dl_list_empty(&(schema->class_list)))
   {
     return NULL;
   }
 
-  not_done = dl_list_first(list);
-  while (not_done)
-  {
-    class = dl_list_value(list);
-    if (STR_EQ(class->name, name))
-    {
-      return(class);
-    }
-
-    /* search the aliases */
-    for (i = 0; i < class->num_aliases; i++)
-    {
-      if (STR_EQ(class->aliases[i], name))
-      {
-        return(class);
-      }
-    }
-    
-    not_done = dl_list_next(list);
-  }
-
-  return NULL;
+  return(hash_table_find(get_class_lookup(schema)->names, name));
 }
 
 
@@ -652,32 +752,22 @@ find_class_by_id(schema, id)
   schema_struct *schema;
   int           id;
 {
-  dl_list_type  *list;
-  class_struct  *class;
-  int           not_done;
-  
-  if (!schema) return NULL;
+  class_lookup_struct *cl;
 
-  list = &(schema->class_list);
+  if (!schema) return NULL;
 
-  if (dl_list_empty(list) )
+  if (dl_list_empty(&(schema->class_list)))
   {
     return NULL;
   }
 
-  not_done = dl_list_first(list);
-  while (not_done)
+  cl = get_class_lookup(schema);
+  if (id < 0 || id >= cl->num_ids)
   {
-    class = dl_list_value(list);
-    if (class->id == id)
-    {
-      return(class);
-    }
-    
-    not_done = dl_list_next(list);
+    return NULL;
   }
 
-  return NULL;
+  return(cl->by_id[id]);
 }
 
 
@@ -730,34 +820,36 @@ find_global_class_by_name(name)
   int                   not_done;
   int                   i;
   class_ref_struct      *val;
+  dl_node_type          *orig_posn;
 
   if ( !name || !class_ref_list )
   {
     return NULL;
   }
 
-  not_done = dl_list_first(class_ref_list);
-  while (not_done)
+  if (!class_ref_names)
   {
-    val = dl_list_value(class_ref_list);
+    class_ref_names = hash_table_create(0);
+    orig_posn       = dl_list_get_pos(class_ref_list);
 
-    if (STR_EQ(val->name, name))
+    not_done = dl_list_first(class_ref_list);
+    while (not_done)
     {
-      return(val);
-    }
+      val = dl_list_value(class_ref_list);
 
-    for (i = 0; i < val->num_aliases; i++)   
-    {                                        
-      if (STR_EQ(val->aliases[i], name))     
-      {                                      
-        return(val);                         
-      }                                      
-    }                                        
+      hash_table_insert(class_ref_names, val->name, val);
+      for (i = 0; i < val->num_aliases; i++)
+      {
+        hash_table_insert(class_ref_names, val->aliases[i], val);
+      }
+
+      not_done = dl_list_next(class_ref_list);
+    }
 
-    not_done = dl_list_next(class_ref_list);
+    dl_list_put_pos(class_ref_list, orig_posn);
   }
 
-  return NULL;
+  return(hash_table_find(class_ref_names, name));
 }
 
 
@@ -814,6 +906,7 @@ destroy_class_data(class)
     free(class->aliases);
   }
   
+  clear_attribute_lookup(class);
   dl_list_destroy(&(class->attribute_list));
 
   free(class);
@@ -828,6 +921,8 @@ destroy_schema_data(schema)
 {
   if (!schema) return TRUE;
 
+  clear_class_lookup(schema);
+  clear_global_attr_lookup(&(schema->attribute_ref_list));
   dl_list_destroy(&(schema->class_list));
   dl_list_destroy(&(schema->attribute_ref_list));
 
@@ -875,6 +970,7 @@ destroy_class_ref_data( class_ref )
 int
 destroy_class_ref_list()
 {
+  clear_class_ref_names();
   dl_list_destroy(class_ref_list);
   class_ref_list = NULL;
   return TRUE;
@@ -1266,7 +1362,14 @@ add_new_class_alias(aa, class, alias)
     return FALSE;
   }
 
-  return( add_class_alias(&(class->aliases), &(class->num_aliases), alias) );
+  if (!add_class_alias(&(class->aliases), &(class->num_aliases), alias))
+  {
+    return FALSE;
+  }
+
+  clear_class_lookup(aa->schema);
+
+  return TRUE;
 }
 
 /* add class file names and directories to 'paths_list' if not in the list.
@@ -82,6 +82,7 @@ typedef struct _attribute_struct
   char              *name;          /* the real name of the attribute */
   char              *description;   /* text description of attribute */
   char              *format;        /* format of the object */
+  struct regexp     *format_prog;   /* compiled "re:" format, or NULL */
   attr_index_type   index;          /* how, and if, the attr is indexed*/
   attr_type         type;           /* the type of the attribute */
 } attribute_struct;
@@ -112,6 +113,9 @@ typedef struct _class_struct
   char         *parse_program;
   char         *version;
   dl_list_type attribute_list;
+
+  /* the attributes by name and id, built on demand (attributes.c) */
+  struct _attribute_lookup_struct *attribute_lookup;
 } class_struct;
 
 typedef struct _class_ref_struct
@@ -126,6 +130,9 @@ typedef struct _schema_struct
 {
   dl_list_type      class_list;
   dl_list_type      attribute_ref_list;
+
+  /* the classes by name and id, built on demand (schema.c) */
+  struct _class_lookup_struct *class_lookup;
 } schema_struct;
 
 /* server structure */
@@ -18,35 +18,20 @@
 
 /* ----------------- Local Functions ------------------ */
 
-/* validate_format: given a format string and the value, see if the
-     strings match.  If so, return TRUE, else FALSE.
+/* validate_format: given an attribute and the value, see if the value
+     matches the attribute's format.  If so, return TRUE, else FALSE.
 
      NOTE: currently returns true on all but tagged regular
-     expressions, i.e., format string = "re: <regular expression>" */
+     expressions, i.e., format string = "re: <regular expression>",
+     which are compiled when the attribute is loaded. */
 static int
-validate_format(format_str, value)
-  char  *format_str;
-  char  *value;
+validate_format(attr, value)
+  attribute_struct  *attr;
+  char              *value;
 {
-  regexp    *prog;
-  char      tag[MAX_LINE];
-  char      datum[MAX_LINE];
-  int       status;
-  
-  if (parse_line(format_str, tag, datum) && STR_EQ(tag, "re"))
+  if (attr->format_prog)
   {
-    ltrim(datum);
-
-    prog = regcomp(datum);
-    if (!prog)
-    {
-      return(-1);
-    }
-
-    status = regexec(prog, strupr(value));
-    free(prog);
-
-    return(status);
+    return(regexec(attr->format_prog, strupr(value)));
   }
 
   return TRUE;
@@ -362,7 +347,7 @@ check_formats(record, validate_flag)
 
     if (av->attr->format)
     {
-      if (! validate_format(av->attr->format, av->value))
+      if (! validate_format(av->attr, av->value))
       {
         if (protocol_error_flag)
         {
@@ -9,6 +9,7 @@
 
 #include "anon_record.h"
 
+#include "arena.h"
 #include "attributes.h"
 #include "client_msgs.h"
 #include "defines.h"
@@ -46,10 +47,10 @@ get_anon_av_pair(line, validate_flag, status)
     return NULL;
   }
 
-  av_pair = xcalloc(1, sizeof(*av_pair));
+  av_pair = arena_xcalloc(1, sizeof(*av_pair));
 
-  av_pair->attr_name = xstrdup(attr_name);
-  av_pair->value = xstrdup(value);
+  av_pair->attr_name = arena_xstrdup(attr_name);
+  av_pair->value = arena_xstrdup(value);
   
   return(av_pair);
 }
@@ -83,13 +84,14 @@ mkdb_read_anon_record(data_file_no, validate_flag, status, fp)
 
   decode_validate_flag(validate_flag, NULL, NULL, &find_all_flag);
   
-  rec               = xcalloc(1, sizeof(*rec));
+  rec               = arena_xcalloc(1, sizeof(*rec));
 
   rec->data_file_no = data_file_no;
   rec->offset       = ftell(fp);
   
   av_list = &(rec->anon_av_pair_list);
   dl_list_default(av_list, FALSE, destroy_anon_av_pair_data);
+  dl_list_use_arena(av_list);
 
   eof_flag = TRUE;  /* flag is set differently if loop ends for a different
                        reason */
@@ -290,7 +292,7 @@ destroy_anon_record_data(rec)
   
   dl_list_destroy(&(rec->anon_av_pair_list));
 
-  free(rec);
+  arena_free(rec);
 
   return TRUE;
 }
@@ -301,10 +303,10 @@ destroy_anon_av_pair_data(av)
 {
   if (!av) return TRUE;
 
-  if (av->attr_name) free(av->attr_name);
-  if (av->value) free(av->value);
+  if (av->attr_name) arena_free(av->attr_name);
+  if (av->value) arena_free(av->value);
 
-  free(av);
+  arena_free(av);
 
   return TRUE;
 }
@@ -0,0 +1,358 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "binary_index.h"
+
+#include "arena.h"
+#include "defines.h"
+#include "index.h"
+#include "index_map.h"
+#include "log.h"
+#include "misc.h"
+
+/* ------------------- Local Functions --------------------- */
+
+/* next_index_item: reads the next good line of the text index file
+   into 'item' (whose value must then be arena_free()d).  Returns
+   FALSE at the end of the file. */
+static int
+next_index_item(fp, item)
+  FILE          *fp;
+  index_struct  *item;
+{
+  char  line[MAX_LINE];
+
+  while (readline(fp, line, MAX_LINE))
+  {
+    bzero(item, sizeof(*item));
+    if (decode_index_line(line, item))
+    {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/* read_binary_index_file: reads the whole of the file into memory,
+   for when it can't be mapped */
+static char *
+read_binary_index_file(filename, size)
+  char  *filename;
+  off_t *size;
+{
+  struct stat sb;
+  char        *buf;
+  off_t       len   = 0;
+  int         fd;
+  int         n;
+
+  if ((fd = open(filename, O_RDONLY)) < 0)
+  {
+    log(L_LOG_ERR, MKDB, "could not open file '%s': %s", filename,
+        strerror(errno));
+    return NULL;
+  }
+
+  if (fstat(fd, &sb) < 0 || sb.st_size <= 0)
+  {
+    close(fd);
+    return NULL;
+  }
+
+  buf = xcalloc(1, sb.st_size);
+
+  while (len < sb.st_size)
+  {
+    n = read(fd, buf + len, sb.st_size - len);
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n <= 0)
+    {
+      log(L_LOG_ERR, MKDB, "could not read file '%s': %s", filename,
+          n < 0 ? strerror(errno) : "short read");
+      close(fd);
+      free(buf);
+      return NULL;
+    }
+    len += n;
+  }
+
+  close(fd);
+
+  *size = len;
+  return(buf);
+}
+
+/* check_binary_index: returns TRUE if the header of 'bi' describes a
+   file this machine wrote (or could have), and sets up the rest of
+   'bi' from it */
+static int
+check_binary_index(filename, bi)
+  char                 *filename;
+  binary_index_struct  *bi;
+{
+  binary_index_header_struct *header;
+
+  if (bi->size < (off_t) sizeof(*header))
+  {
+    log(L_LOG_ERR, MKDB, "binary index file '%s' is truncated", filename);
+    return FALSE;
+  }
+
+  header = (binary_index_header_struct *) bi->base;
+
+  if (memcmp(header->magic, BINARY_INDEX_MAGIC, sizeof(header->magic)) ||
+      header->version != BINARY_INDEX_VERSION)
+  {
+    log(L_LOG_ERR, MKDB, "'%s' is not a binary index file", filename);
+    return FALSE;
+  }
+
+  if (header->byte_order != BINARY_INDEX_BYTE_ORDER ||
+      header->off_t_size != sizeof(off_t) ||
+      header->entry_size != sizeof(binary_index_entry_struct))
+  {
+    log(L_LOG_ERR, MKDB,
+        "binary index file '%s' was written on an incompatible machine",
+        filename);
+    return FALSE;
+  }
+
+  if (header->num_entries < 0 ||
+      header->keys_offset != (off_t) sizeof(*header) +
+                             header->num_entries * header->entry_size ||
+      header->keys_size < 0 ||
+      header->keys_offset + header->keys_size > bi->size ||
+      (header->keys_size > 0 &&
+       bi->base[header->keys_offset + header->keys_size - 1] != '\0'))
+  {
+    log(L_LOG_ERR, MKDB, "binary index file '%s' is corrupt", filename);
+    return FALSE;
+  }
+
+  bi->num_entries = header->num_entries;
+  bi->entries     = (binary_index_entry_struct *)
+                    (bi->base + sizeof(*header));
+  bi->keys        = bi->base + header->keys_offset;
+  bi->keys_size   = header->keys_size;
+
+  return TRUE;
+}
+
+/* ------------------- Public Functions -------------------- */
+
+long
+write_binary_index_file(text_file, binary_file)
+  char  *text_file;
+  char  *binary_file;
+{
+  FILE                        *in;
+  FILE                        *out;
+  binary_index_header_struct  header;
+  binary_index_entry_struct   entry;
+  index_struct                item;
+  off_t                       num_entries = 0;
+  off_t                       keys_size   = 0;
+  int                         len;
+
+  if ((in = fopen(text_file, "r")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open file '%s': %s", text_file,
+        strerror(errno));
+    return(-1);
+  }
+
+  if ((out = fopen(binary_file, "w")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open file '%s': %s", binary_file,
+        strerror(errno));
+    fclose(in);
+    return(-1);
+  }
+
+  /* the first pass sizes the entry array and the key block, so that
+     the second and third passes can write each straight out */
+  while (next_index_item(in, &item))
+  {
+    num_entries++;
+    keys_size += strlen(item.value) + 1;
+    arena_free(item.value);
+  }
+
+  bzero(&header, sizeof(header));
+  bcopy(BINARY_INDEX_MAGIC, header.magic, sizeof(header.magic));
+  header.version     = BINARY_INDEX_VERSION;
+  header.byte_order  = BINARY_INDEX_BYTE_ORDER;
+  header.off_t_size  = sizeof(off_t);
+  header.entry_size  = sizeof(entry);
+  header.num_entries = num_entries;
+  header.keys_offset = sizeof(header) + num_entries * sizeof(entry);
+  header.keys_size   = keys_size;
+
+  fwrite(&header, sizeof(header), 1, out);
+
+  rewind(in);
+  keys_size = 0;
+  while (next_index_item(in, &item))
+  {
+    len = strlen(item.value);
+
+    bzero(&entry, sizeof(entry));
+    entry.offset       = item.offset;
+    entry.key_offset   = keys_size;
+    entry.data_file_no = item.data_file_no;
+    entry.deleted_flag = item.deleted_flag;
+    entry.attribute_id = item.attribute_id;
+    entry.key_len      = len;
+
+    fwrite(&entry, sizeof(entry), 1, out);
+
+    keys_size += len + 1;
+    arena_free(item.value);
+  }
+
+  rewind(in);
+  while (next_index_item(in, &item))
+  {
+    fwrite(item.value, strlen(item.value) + 1, 1, out);
+    arena_free(item.value);
+  }
+
+  fclose(in);
+
+  if (ferror(out) | fclose(out))
+  {
+    log(L_LOG_ERR, MKDB, "could not write file '%s': %s", binary_file,
+        strerror(errno));
+    unlink(binary_file);
+    return(-1);
+  }
+
+  return((long) num_entries);
+}
+
+long
+write_text_index_file(file, text_file)
+  file_struct  *file;
+  char         *text_file;
+{
+  FILE                 *out;
+  binary_index_struct  bi;
+  index_struct         item;
+  char                 line[MAX_LINE * 2];
+  off_t                n;
+
+  if (!load_binary_index(file, &bi))
+  {
+    return(-1);
+  }
+
+  if ((out = fopen(text_file, "w")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open file '%s': %s", text_file,
+        strerror(errno));
+    release_binary_index(&bi);
+    return(-1);
+  }
+
+  for (n = 0; n < bi.num_entries; n++)
+  {
+    item.offset       = bi.entries[n].offset;
+    item.data_file_no = bi.entries[n].data_file_no;
+    item.deleted_flag = bi.entries[n].deleted_flag;
+    item.attribute_id = bi.entries[n].attribute_id;
+    item.value        = binary_index_key(&bi, n);
+
+    /* every key came from a text index line, so this can't happen */
+    if (strlen(item.value) > MAX_LINE)
+    {
+      continue;
+    }
+
+    encode_index_line(line, &item);
+    fputs(line, out);
+    putc('\n', out);
+  }
+
+  release_binary_index(&bi);
+
+  if (ferror(out) | fclose(out))
+  {
+    log(L_LOG_ERR, MKDB, "could not write file '%s': %s", text_file,
+        strerror(errno));
+    unlink(text_file);
+    return(-1);
+  }
+
+  return((long) n);
+}
+
+int
+load_binary_index(file, bi)
+  file_struct          *file;
+  binary_index_struct  *bi;
+{
+  if (!file || !bi)
+  {
+    return FALSE;
+  }
+
+  bzero(bi, sizeof(*bi));
+
+  /* use the shared mapping if we can */
+  if ((bi->base = map_index_file(file, &(bi->size))) == NULL)
+  {
+    if ((bi->base = read_binary_index_file(file->filename,
+                                           &(bi->size))) == NULL)
+    {
+      return FALSE;
+    }
+    bi->allocated = TRUE;
+  }
+
+  if (!check_binary_index(file->filename, bi))
+  {
+    release_binary_index(bi);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+char *
+binary_index_key(bi, n)
+  binary_index_struct  *bi;
+  off_t                n;
+{
+  off_t key_offset = bi->entries[n].key_offset;
+
+  /* the key block is known to end in a NUL, so any offset inside it
+     is a good string */
+  if (key_offset < 0 || key_offset >= bi->keys_size)
+  {
+    return("");
+  }
+
+  return(bi->keys + key_offset);
+}
+
+void
+release_binary_index(bi)
+  binary_index_struct  *bi;
+{
+  if (bi->allocated && bi->base)
+  {
+    free(bi->base);
+  }
+
+  bzero(bi, sizeof(*bi));
+}
@@ -0,0 +1,95 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _BINARY_INDEX_H_
+#define _BINARY_INDEX_H_
+
+/* includes */
+
+#include "common.h"
+#include "mkdb_types.h"
+
+/* defines */
+
+#define BINARY_INDEX_MAGIC       "RWHOISBX"
+#define BINARY_INDEX_VERSION     1
+
+/* written in the machine's own byte order; a file written on a
+   machine with the other byte order won't match it */
+#define BINARY_INDEX_BYTE_ORDER  0x01020304
+
+/* types */
+
+/* A binary index file is the same information as an exact index file,
+   in the same order, laid out as a header, an array of fixed size
+   entries (one per index line), and a block holding each entry's
+   value as a NUL terminated string.  Everything is in the native
+   byte order and sizes of the machine that wrote it; the header
+   records enough of that for a reader to refuse a file it can't
+   use. */
+typedef struct _binary_index_header_struct
+{
+  char   magic[8];
+  int    version;
+  int    byte_order;
+  int    off_t_size;
+  int    entry_size;
+  off_t  num_entries;
+  off_t  keys_offset;
+  off_t  keys_size;
+} binary_index_header_struct;
+
+typedef struct _binary_index_entry_struct
+{
+  off_t  offset;           /* of the record in the data file */
+  off_t  key_offset;       /* of the value in the key block */
+  int    data_file_no;
+  int    deleted_flag;
+  int    attribute_id;
+  int    key_len;
+} binary_index_entry_struct;
+
+/* binary_index_struct: a binary index file loaded for searching.  If
+   the file could be mapped, 'base' is the (cached) mapping, otherwise
+   it was read into memory and 'allocated' is set. */
+typedef struct _binary_index_struct
+{
+  char                       *base;
+  off_t                      size;
+  int                        allocated;
+  off_t                      num_entries;
+  binary_index_entry_struct  *entries;
+  char                       *keys;
+  off_t                      keys_size;
+} binary_index_struct;
+
+/* prototypes */
+
+/* write_binary_index_file: converts the sorted (text) index file
+   'text_file' into the binary index file 'binary_file'.  Returns the
+   number of entries written, or -1 on error. */
+long write_binary_index_file PROTO((char *text_file, char *binary_file));
+
+/* write_text_index_file: converts the binary index file 'file' back
+   into the sorted (text) index file 'text_file'.  Returns the number
+   of entries written, or -1 on error. */
+long write_text_index_file PROTO((file_struct *file, char *text_file));
+
+/* load_binary_index: fills out 'bi' for the binary index file 'file',
+   checking that it is one this machine can read.  Returns FALSE if it
+   is not. */
+int load_binary_index PROTO((file_struct *file, binary_index_struct *bi));
+
+/* binary_index_key: returns the value of entry 'n' */
+char *binary_index_key PROTO((binary_index_struct *bi, off_t n));
+
+/* releases whatever load_binary_index() allocated */
+void release_binary_index PROTO((binary_index_struct *bi));
+
+#endif /* _BINARY_INDEX_H_ */
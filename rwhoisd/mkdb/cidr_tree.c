@@ -0,0 +1,607 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "cidr_tree.h"
+
+#include "arena.h"
+#include "auth_area.h"
+#include "defines.h"
+#include "dl_list.h"
+#include "fileinfo.h"
+#include "index.h"
+#include "log.h"
+#include "misc.h"
+
+/* local types */
+
+/* cidr_tree_struct: the network tree built from one CIDR index file,
+   along with what we need to tell if that file has since changed */
+typedef struct _cidr_tree_struct
+{
+  char             *filename;
+  off_t            size;
+  time_t           mtime;
+  int              in_use;
+  cidr_node_struct *v4_root;
+  cidr_node_struct *v6_root;
+} cidr_tree_struct;
+
+/* cidr_class_struct: the master file list of a class as it was when
+   the trees of its CIDR index files were built */
+typedef struct _cidr_class_struct
+{
+  auth_area_struct *auth_area;
+  class_struct     *class;
+  int              has_file_list;
+  ino_t            ino;
+  off_t            size;
+  time_t           mtime;
+  time_t           ctime;
+} cidr_class_struct;
+
+/* local statics */
+
+static dl_list_type cidr_tree_cache;
+static dl_list_type cidr_class_list;
+static int          cidr_tree_cache_init = FALSE;
+
+/* ------------------- Local Functions --------------------- */
+
+/* net_bit: returns the value of bit number 'bit' (0 being the most
+   significant) of the address */
+static int
+net_bit(net, bit)
+  struct netinfo *net;
+  int            bit;
+{
+  return((net->prefix[bit >> 3] >> (7 - (bit & 7))) & 1);
+}
+
+/* common_prefix_len: returns the number of leading bits 'a' and 'b'
+   have in common, up to 'max_len' */
+static int
+common_prefix_len(a, b, max_len)
+  struct netinfo *a;
+  struct netinfo *b;
+  int            max_len;
+{
+  int   len = 0;
+  int   i;
+  int   diff;
+
+  for (i = 0; len < max_len; i++, len += 8)
+  {
+    diff = a->prefix[i] ^ b->prefix[i];
+    if (diff)
+    {
+      while (!(diff & 0x80))
+      {
+        diff <<= 1;
+        len++;
+      }
+      break;
+    }
+  }
+
+  if (len > max_len)
+  {
+    len = max_len;
+  }
+
+  return(len);
+}
+
+static cidr_node_struct *
+new_cidr_node(net, len)
+  struct netinfo *net;
+  int            len;
+{
+  cidr_node_struct *node;
+
+  node = xcalloc(1, sizeof(*node));
+  bcopy(net, &(node->net), sizeof(node->net));
+  node->net.masklen = len;
+  mask_addr_to_len(&(node->net), len);
+
+  return(node);
+}
+
+static void
+add_node_position(node, position)
+  cidr_node_struct *node;
+  off_t            position;
+{
+  node->positions = xrealloc(node->positions,
+                             (node->num_positions + 1) * sizeof(off_t));
+  node->positions[node->num_positions++] = position;
+}
+
+/* insert_network: adds a run of index lines starting at 'position'
+   for the network 'net' to the tree rooted at 'root' */
+static void
+insert_network(root, net, position)
+  cidr_node_struct **root;
+  struct netinfo   *net;
+  off_t            position;
+{
+  cidr_node_struct **link = root;
+  cidr_node_struct *node;
+  cidr_node_struct *new_node;
+  cidr_node_struct *glue;
+  int              len;
+
+  while ((node = *link) != NULL)
+  {
+    len = common_prefix_len(&(node->net), net,
+                            MIN(node->net.masklen, net->masklen));
+
+    if (len < node->net.masklen)
+    {
+      /* 'net' branches off above this node */
+      break;
+    }
+
+    if (node->net.masklen == net->masklen)
+    {
+      add_node_position(node, position);
+      return;
+    }
+
+    link = &(node->child[net_bit(net, node->net.masklen)]);
+  }
+
+  new_node = new_cidr_node(net, net->masklen);
+  add_node_position(new_node, position);
+
+  if (!node)
+  {
+    *link = new_node;
+    return;
+  }
+
+  if (len == net->masklen)
+  {
+    /* the new network contains the existing node */
+    new_node->child[net_bit(&(node->net), len)] = node;
+    *link = new_node;
+    return;
+  }
+
+  /* the two diverge; join them with a position-less node */
+  glue = new_cidr_node(net, len);
+  glue->child[net_bit(net, len)]          = new_node;
+  glue->child[net_bit(&(node->net), len)] = node;
+  *link = glue;
+}
+
+static void
+destroy_cidr_nodes(node)
+  cidr_node_struct *node;
+{
+  if (!node)
+  {
+    return;
+  }
+
+  destroy_cidr_nodes(node->child[0]);
+  destroy_cidr_nodes(node->child[1]);
+
+  if (node->positions)
+  {
+    free(node->positions);
+  }
+  free(node);
+}
+
+static int
+destroy_cidr_tree_data(tree)
+  cidr_tree_struct *tree;
+{
+  if (!tree)
+  {
+    return TRUE;
+  }
+
+  destroy_cidr_nodes(tree->v4_root);
+  destroy_cidr_nodes(tree->v6_root);
+
+  if (tree->filename)
+  {
+    free(tree->filename);
+  }
+
+  free(tree);
+
+  return TRUE;
+}
+
+/* build_cidr_tree: reads the whole CIDR index file into a tree.  Each
+   change of value in the file starts a new run; normally there is
+   one run per network, but nothing here depends on that. */
+static int
+build_cidr_tree(tree)
+  cidr_tree_struct *tree;
+{
+  FILE           *fp;
+  char           line[MAX_LINE];
+  char           last_value[MAX_LINE];
+  index_struct   index_item;
+  struct netinfo net;
+  off_t          position;
+
+  if ((fp = fopen(tree->filename, "r")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open file '%s': %s", tree->filename,
+        strerror(errno));
+    return FALSE;
+  }
+
+  bzero(last_value, sizeof(last_value));
+  bzero(&index_item, sizeof(index_item));
+
+  position = ftell(fp);
+  while (readline(fp, line, MAX_LINE))
+  {
+    if (decode_index_line(line, &index_item))
+    {
+      if (strcmp(index_item.value, last_value) &&
+          get_network_prefix_and_len(index_item.value, &net))
+      {
+        insert_network(net.af == AF_INET ? &(tree->v4_root) :
+                       &(tree->v6_root), &net, position);
+      }
+
+      STR_COPY(last_value, index_item.value);
+      arena_free(index_item.value);
+      index_item.value = NULL;
+    }
+
+    position = ftell(fp);
+  }
+
+  fclose(fp);
+
+  return TRUE;
+}
+
+static void
+init_cidr_tree_cache()
+{
+  if (!cidr_tree_cache_init)
+  {
+    dl_list_default(&cidr_tree_cache, FALSE, destroy_cidr_tree_data);
+    dl_list_default(&cidr_class_list, FALSE, simple_destroy_data);
+    cidr_tree_cache_init = TRUE;
+  }
+}
+
+/* get_cidr_tree: returns the cached tree for the index file.  If
+   there is none, or the file has changed since it was built, it is
+   (re)built if 'build' is TRUE; otherwise NULL is returned. */
+static cidr_tree_struct *
+get_cidr_tree(file, build)
+  file_struct *file;
+  int         build;
+{
+  cidr_tree_struct *tree  = NULL;
+  struct stat      sb;
+  int              not_done;
+
+  if (!cidr_tree_cache_init)
+  {
+    if (!build)
+    {
+      return NULL;
+    }
+    init_cidr_tree_cache();
+  }
+
+  if (stat(file->filename, &sb) < 0)
+  {
+    if (build)
+    {
+      log(L_LOG_ERR, MKDB, "could not stat file '%s': %s", file->filename,
+          strerror(errno));
+    }
+    return NULL;
+  }
+
+  not_done = dl_list_first(&cidr_tree_cache);
+  while (not_done)
+  {
+    tree = dl_list_value(&cidr_tree_cache);
+    if (!strcmp(tree->filename, file->filename))
+    {
+      if (tree->size == sb.st_size && tree->mtime == sb.st_mtime)
+      {
+        return(tree);
+      }
+
+      /* stale: throw it away and rebuild */
+      dl_list_delete(&cidr_tree_cache);
+      break;
+    }
+    not_done = dl_list_next(&cidr_tree_cache);
+  }
+
+  if (!build)
+  {
+    return NULL;
+  }
+
+  tree           = xcalloc(1, sizeof(*tree));
+  tree->filename = xstrdup(file->filename);
+  tree->size     = sb.st_size;
+  tree->mtime    = sb.st_mtime;
+
+  if (!build_cidr_tree(tree))
+  {
+    destroy_cidr_tree_data(tree);
+    return NULL;
+  }
+
+  dl_list_append(&cidr_tree_cache, tree);
+
+  return(tree);
+}
+
+
+/* is_cidr_class_current: returns TRUE if the master file list of the
+   class is the same as when its trees were built */
+static int
+is_cidr_class_current(auth_area, class)
+  auth_area_struct *auth_area;
+  class_struct     *class;
+{
+  cidr_class_struct *cclass;
+  struct stat       sb;
+  int               has_file_list;
+  int               not_done;
+
+  not_done = dl_list_first(&cidr_class_list);
+  while (not_done)
+  {
+    cclass = dl_list_value(&cidr_class_list);
+    if (cclass->auth_area == auth_area && cclass->class == class)
+    {
+      has_file_list = stat_master_file_list(class, auth_area, &sb);
+
+      if (!has_file_list || !cclass->has_file_list)
+      {
+        return(has_file_list == cclass->has_file_list);
+      }
+
+      return(cclass->ino == sb.st_ino && cclass->size == sb.st_size &&
+             cclass->mtime == sb.st_mtime && cclass->ctime == sb.st_ctime);
+    }
+    not_done = dl_list_next(&cidr_class_list);
+  }
+
+  return FALSE;
+}
+
+/* load_cidr_class: notes the state of the master file list of the
+   class, then makes sure there is a current tree for each of its
+   CIDR index files */
+static void
+load_cidr_class(auth_area, class)
+  auth_area_struct *auth_area;
+  class_struct     *class;
+{
+  cidr_class_struct *cclass;
+  cidr_tree_struct  *tree;
+  struct stat       sb;
+  dl_list_type      file_list;
+  dl_list_type      cidr_file_list;
+  int               not_done;
+
+  /* stat first, so a change made while we read the files is caught
+     by the next refresh */
+  cclass                = xcalloc(1, sizeof(*cclass));
+  cclass->auth_area     = auth_area;
+  cclass->class         = class;
+  cclass->has_file_list = stat_master_file_list(class, auth_area, &sb);
+  if (cclass->has_file_list)
+  {
+    cclass->ino   = sb.st_ino;
+    cclass->size  = sb.st_size;
+    cclass->mtime = sb.st_mtime;
+    cclass->ctime = sb.st_ctime;
+  }
+
+  dl_list_default(&file_list, FALSE, destroy_file_struct_data);
+  dl_list_default(&cidr_file_list, FALSE, destroy_file_struct_data);
+
+  if (get_file_list(class, auth_area, &file_list) &&
+      filter_file_list(&cidr_file_list, MKDB_CIDR_INDEX_FILE, &file_list))
+  {
+    not_done = dl_list_first(&cidr_file_list);
+    while (not_done)
+    {
+      tree = get_cidr_tree(dl_list_value(&cidr_file_list), TRUE);
+      if (tree)
+      {
+        tree->in_use = TRUE;
+      }
+
+      not_done = dl_list_next(&cidr_file_list);
+    }
+  }
+
+  dl_list_destroy(&file_list);
+  dl_list_destroy(&cidr_file_list);
+
+  dl_list_append(&cidr_class_list, cclass);
+}
+
+/* scan_cidr_classes: walks every class of every authority area.  If
+   'load' is TRUE, the trees of each are loaded; otherwise TRUE is
+   returned as soon as a class is found to have changed. */
+static int
+scan_cidr_classes(load)
+  int load;
+{
+  dl_list_type     *auth_area_list;
+  auth_area_struct *auth_area;
+  class_struct     *class;
+  int              aa_not_done;
+  int              class_not_done;
+
+  auth_area_list = get_auth_area_list();
+  if (!auth_area_list)
+  {
+    return FALSE;
+  }
+
+  aa_not_done = dl_list_first(auth_area_list);
+  while (aa_not_done)
+  {
+    auth_area = dl_list_value(auth_area_list);
+    if (!auth_area->schema)
+    {
+      aa_not_done = dl_list_next(auth_area_list);
+      continue;
+    }
+
+    class_not_done = dl_list_first(&(auth_area->schema->class_list));
+    while (class_not_done)
+    {
+      class = dl_list_value(&(auth_area->schema->class_list));
+
+      if (load)
+      {
+        load_cidr_class(auth_area, class);
+      }
+      else if (!is_cidr_class_current(auth_area, class))
+      {
+        return TRUE;
+      }
+
+      class_not_done = dl_list_next(&(auth_area->schema->class_list));
+    }
+
+    aa_not_done = dl_list_next(auth_area_list);
+  }
+
+  return FALSE;
+}
+
+
+/* ------------------- Public Functions -------------------- */
+
+int
+find_covering_networks(file, net, matches)
+  file_struct      *file;
+  struct netinfo   *net;
+  cidr_node_struct **matches;
+{
+  cidr_tree_struct *tree;
+  cidr_node_struct *node;
+  cidr_node_struct *path[MAX_CIDR_MATCHES];
+  int              num_path = 0;
+  int              i;
+
+  if (!file || !net || !matches)
+  {
+    return(-1);
+  }
+
+  if ((tree = get_cidr_tree(file, FALSE)) == NULL)
+  {
+    return(-1);
+  }
+
+  node = (net->af == AF_INET) ? tree->v4_root : tree->v6_root;
+
+  /* walk down towards 'net', noting every real network on the way */
+  while (node && node->net.masklen <= net->masklen &&
+         common_prefix_len(&(node->net), net, node->net.masklen) ==
+         node->net.masklen)
+  {
+    if (node->num_positions > 0)
+    {
+      path[num_path++] = node;
+    }
+
+    if (node->net.masklen == net->masklen)
+    {
+      break;
+    }
+
+    node = node->child[net_bit(net, node->net.masklen)];
+  }
+
+  /* hand them back most specific first */
+  for (i = 0; i < num_path; i++)
+  {
+    matches[i] = path[num_path - i - 1];
+  }
+
+  return(num_path);
+}
+
+void
+clear_cidr_tree_cache()
+{
+  if (cidr_tree_cache_init)
+  {
+    dl_list_destroy(&cidr_tree_cache);
+    dl_list_destroy(&cidr_class_list);
+    cidr_tree_cache_init = FALSE;
+  }
+}
+
+void
+build_cidr_tree_cache()
+{
+  clear_cidr_tree_cache();
+
+  refresh_cidr_tree_cache();
+}
+
+void
+refresh_cidr_tree_cache()
+{
+  cidr_tree_struct *tree;
+  int              not_done;
+
+  if (cidr_tree_cache_init && !scan_cidr_classes(FALSE))
+  {
+    return;
+  }
+
+  /* something has changed: find the trees still in use, building any
+     that are new or stale, and throw the rest away */
+  init_cidr_tree_cache();
+
+  not_done = dl_list_first(&cidr_tree_cache);
+  while (not_done)
+  {
+    tree         = dl_list_value(&cidr_tree_cache);
+    tree->in_use = FALSE;
+    not_done     = dl_list_next(&cidr_tree_cache);
+  }
+  dl_list_destroy(&cidr_class_list);
+  dl_list_default(&cidr_class_list, FALSE, simple_destroy_data);
+
+  scan_cidr_classes(TRUE);
+
+  not_done = dl_list_first(&cidr_tree_cache);
+  while (not_done)
+  {
+    tree = dl_list_value(&cidr_tree_cache);
+    if (!tree->in_use)
+    {
+      dl_list_delete(&cidr_tree_cache);
+      not_done = dl_list_first(&cidr_tree_cache);
+      continue;
+    }
+    not_done = dl_list_next(&cidr_tree_cache);
+  }
+}
@@ -0,0 +1,65 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _CIDR_TREE_H_
+#define _CIDR_TREE_H_
+
+/* includes */
+
+#include "common.h"
+#include "ip_network.h"
+#include "mkdb_types.h"
+
+/* defines */
+
+/* the most networks that can cover a given address: one per prefix
+   length, 0 through 128 */
+#define MAX_CIDR_MATCHES 129
+
+/* types */
+
+/* cidr_node_struct: a node in a path compressed binary (Patricia)
+   tree of networks.  Nodes that only exist to join two subtrees have
+   no positions.  'positions' holds the index file offsets of each run
+   of index lines whose value is exactly this network. */
+typedef struct _cidr_node_struct
+{
+  struct netinfo            net;
+  int                       num_positions;
+  off_t                     *positions;
+  struct _cidr_node_struct  *child[2];
+} cidr_node_struct;
+
+/* prototypes */
+
+/* find_covering_networks: finds every network in the CIDR index file
+   'file' that is equal to or contains 'net'.  The matching nodes are
+   placed into 'matches' (which must hold MAX_CIDR_MATCHES entries),
+   most specific first.  Only the trees built by
+   build_cidr_tree_cache() and refresh_cidr_tree_cache() are used, and
+   only while their files are unchanged on disk.  Returns the number of matches, or -1 if there
+   is no usable tree for 'file'. */
+int find_covering_networks PROTO((file_struct      *file,
+                                  struct netinfo   *net,
+                                  cidr_node_struct **matches));
+
+/* frees all of the cached trees */
+void clear_cidr_tree_cache PROTO((void));
+
+/* (re)builds the trees of every CIDR index file of every class.  A
+   daemon does this once, for all of its children, rather than each
+   child reading whole index files for its first CIDR query. */
+void build_cidr_tree_cache PROTO((void));
+
+/* builds the trees of any CIDR index files added or changed since the
+   last build or refresh, and frees those of files that have gone.  It
+   only reads the master file lists of classes that have changed. */
+void refresh_cidr_tree_cache PROTO((void));
+
+#endif /* _CIDR_TREE_H_ */
@@ -11,156 +11,187 @@
 
 #include "defines.h"
 #include "fileinfo.h"
+#include "fileutils.h"
 #include "index.h"
 #include "log.h"
 #include "misc.h"
 #include "search.h"
+#include "tombstone.h"
 
 /* local prototypes */
-static int mkdb_delete_index_entry PROTO((dl_list_type *fi_list,
-                                          int          index_file_index,
-                                          int          data_file_index,
-                                          off_t        offset,
-                                          dl_list_type *changed_fi_list));
-
+static int mkdb_delete_class_records PROTO((dl_list_type *rec_list,
+                                            char         *timestamp));
 static int mkdb_delete_data_entry PROTO((dl_list_type  *fi_list,
                                          record_struct *hit_item,
                                          dl_list_type  *changed_fi_list));
 
+/* mkdb_delete_record_list: deletes the records in 'record_list'.  They
+   are taken a class (of an authority area) at a time, so that each
+   class gets one Updated index file for all of its deletions, and one
+   change to its master file list.  Returns FALSE if any record could
+   not be deleted. */
 int
 mkdb_delete_record_list (record_list)
   dl_list_type *record_list;
 {
-  record_struct *record;
-  dl_list_type  all_file_list;
-  dl_list_type  changed_fi_list;
+  record_struct **recs;
+  dl_list_type  class_rec_list;
+  char          *timestamp;
+  int           num_recs    = 0;
   int           not_done;
-  int           status      = FALSE;
+  int           status      = TRUE;
+  int           i;
+  int           j;
+
+  if (dl_list_empty(record_list))
+  {
+    return FALSE;
+  }
 
   not_done = dl_list_first(record_list);
+  while (not_done)
+  {
+    num_recs++;
+    not_done = dl_list_next(record_list);
+  }
+
+  recs = xcalloc(num_recs, sizeof(*recs));
 
+  num_recs = 0;
+  not_done = dl_list_first(record_list);
   while (not_done)
   {
-    record = dl_list_value(record_list);
+    recs[num_recs++] = dl_list_value(record_list);
+    not_done = dl_list_next(record_list);
+  }
 
-    dl_list_default(&all_file_list, FALSE, destroy_file_struct_data);
-    dl_list_default(&changed_fi_list, FALSE, destroy_file_struct_data);
+  /* when the deletions happened, for the Updated index */
+  timestamp = xstrdup(make_timestamp());
 
-    if (!get_file_list(record->class, record->auth_area, &all_file_list))
+  for (i = 0; i < num_recs; i++)
+  {
+    if (!recs[i])
     {
-      log(L_LOG_ERR, MKDB,
-          "cannot open master index file for class '%s' in auth-area '%s': %s",
-          record->class->name, record->auth_area->name, strerror(errno));
-      return FALSE;
+      continue;
     }
 
-    status = mkdb_delete_record(&all_file_list, record, &changed_fi_list);
+    dl_list_default(&class_rec_list, FALSE, null_destroy_data);
 
-    /* post the change in number of records to the master file list */
-    if (!dl_list_empty(&changed_fi_list))
+    dl_list_append(&class_rec_list, recs[i]);
+    for (j = i + 1; j < num_recs; j++)
     {
-      modify_file_list(record->class, record->auth_area, NULL, NULL,
-                       &changed_fi_list, NULL, NULL);
+      if (recs[j] && recs[j]->class == recs[i]->class &&
+          recs[j]->auth_area == recs[i]->auth_area)
+      {
+        dl_list_append(&class_rec_list, recs[j]);
+        recs[j] = NULL;
+      }
     }
 
-    dl_list_destroy(&all_file_list);
-    dl_list_destroy(&changed_fi_list);
-    not_done = dl_list_next(record_list);
-  }
-
-  return(status);
-}
-
-int
-mkdb_delete_record(file_list, hit_item, changed_fi_list)
-  dl_list_type  *file_list;
-  record_struct *hit_item;
-  dl_list_type  *changed_fi_list;
-{
-  int   status;
-
-  /* for now, we only delete the data entry */
+    if (!mkdb_delete_class_records(&class_rec_list, timestamp))
+    {
+      status = FALSE;
+    }
 
-/*   status = mkdb_delete_index_entry(file_list, hit_item->index_file_no, */
-/*                                 hit_item->data_file_no, hit_item->offset, */
-/*                                 changed_fi_list); */
-/*   if (!status) return(status); */
+    dl_list_destroy(&class_rec_list);
+  }
 
-  status = mkdb_delete_data_entry(file_list, hit_item, changed_fi_list);
+  free(timestamp);
+  free(recs);
 
   return(status);
 }
 
+/* mkdb_delete_class_records: deletes the records in 'rec_list', all of
+   one class and authority area */
 static int
-mkdb_delete_index_entry(fi_list, index_file_index, data_file_index, offset,
-                        changed_fi_list)
-  dl_list_type      *fi_list;
-  int               index_file_index;
-  int               data_file_index;
-  off_t             offset;
-  dl_list_type      *changed_fi_list;
+mkdb_delete_class_records(rec_list, timestamp)
+  dl_list_type *rec_list;
+  char         *timestamp;
 {
-  file_struct       *fi             = NULL;
-  index_struct      index_item;
-  char              line[MAX_LINE];
-  off_t             index_offset;
-  FILE              *fp;
-  int               changed_flag = FALSE;
-
-  fi = find_file_by_id(fi_list, index_file_index, MKDB_ALL_INDEX_FILES);
-  if (!fi)
-  {
-    return FALSE;
-  }
+  record_struct *record;
+  dl_list_type  all_file_list;
+  dl_list_type  changed_fi_list;
+  dl_list_type  add_fi_list;
+  dl_list_type  deleted_list;
+  int           not_done;
+  int           status      = TRUE;
 
-  /* open the index file for update */
-  if (fi->fp)
-  {
-    fclose(fi->fp);
-    fi->fp = NULL;
-  }
+  dl_list_first(rec_list);
+  record = dl_list_value(rec_list);
 
-  if ( (fp = fopen(fi->filename, "r+")) == NULL )
+  dl_list_default(&all_file_list, FALSE, destroy_file_struct_data);
+  dl_list_default(&changed_fi_list, FALSE, destroy_file_struct_data);
+  dl_list_default(&add_fi_list, FALSE, destroy_file_struct_data);
+  dl_list_default(&deleted_list, FALSE, null_destroy_data);
+
+  if (!get_file_list(record->class, record->auth_area, &all_file_list))
   {
     log(L_LOG_ERR, MKDB,
-        "could not open index file '%s' for update: %s",
-        fi->filename, strerror(errno));
+        "cannot open master index file for class '%s' in auth-area '%s': %s",
+        record->class->name, record->auth_area->name, strerror(errno));
+    dl_list_destroy(&all_file_list);
     return FALSE;
   }
 
-  /* make the file write through the cache */
-  setbuf(fp, NULL);
-
-  index_offset = 0;
-
-  while (readline(fp, line, MAX_LINE))
+  not_done = dl_list_first(rec_list);
+  while (not_done)
   {
-    if (decode_index_line(line, &index_item) &&
-        (index_item.offset == offset &&
-         index_item.data_file_no == data_file_index &&
-         !index_item.deleted_flag))
+    record = dl_list_value(rec_list);
+
+    if (mkdb_delete_record(&all_file_list, record, &changed_fi_list))
+    {
+      dl_list_append(&deleted_list, record);
+    }
+    else
     {
-      index_item.deleted_flag = TRUE;
-      encode_index_line(line, &index_item);
-      fseek(fp, index_offset, SEEK_SET);
-      fprintf(fp, "%s", line);
-      fseek(fp, index_offset, SEEK_SET);
-      fi->num_recs--; changed_flag = TRUE;
+      status = FALSE;
     }
-    index_offset = ftell(fp);
-    if (index_item.value) free(index_item.value);
+
+    not_done = dl_list_next(rec_list);
   }
 
-  fclose(fp);
+  /* carry the deletions in the Updated index, so that incremental
+     xfers see them */
+  if (!dl_list_empty(&deleted_list) &&
+      !index_deleted_records(&deleted_list, timestamp, &add_fi_list))
+  {
+    log(L_LOG_WARNING, MKDB,
+        "could not note deletions in the Updated index of class '%s'",
+        record->class->name);
+  }
 
-  if (changed_flag)
+  /* post the change in number of records (and the new index file,
+     active from the start) to the master file list */
+  if (!dl_list_empty(&changed_fi_list) || !dl_list_empty(&add_fi_list))
   {
-    dl_list_append(changed_fi_list, copy_file_struct(fi));
+    modify_file_list(record->class, record->auth_area, &add_fi_list, NULL,
+                     &changed_fi_list, &add_fi_list, NULL);
   }
 
-  return TRUE;
+  dl_list_destroy(&all_file_list);
+  dl_list_destroy(&changed_fi_list);
+  dl_list_destroy(&add_fi_list);
+  dl_list_destroy(&deleted_list);
+
+  return(status);
 }
 
+int
+mkdb_delete_record(file_list, hit_item, changed_fi_list)
+  dl_list_type  *file_list;
+  record_struct *hit_item;
+  dl_list_type  *changed_fi_list;
+{
+  int   status;
+
+  /* the record's index entries are left in place: the tombstone
+     mkdb_delete_data_entry() leaves has searches skip them until an
+     index merge drops them */
+  status = mkdb_delete_data_entry(file_list, hit_item, changed_fi_list);
+
+  return(status);
+}
 
 int
 mkdb_delete_data_entry(fi_list, hit_item, changed_fi_list)
@@ -200,6 +231,14 @@ mkdb_delete_data_entry(fi_list, hit_item, changed_fi_list)
   /* make file write through the cache */
   setbuf(fp, NULL);
 
+  if (!add_tombstone(fi, hit_item->offset))
+  {
+    fclose(fp);
+    return FALSE;
+  }
+
+  /* blot the record out of the data file too, so that reindexing the
+     file (or xferring it) doesn't bring it back */
   fseek(fp, hit_item->offset, SEEK_SET);
   pos = ftell(fp);
   fgets(buffer,MAX_LINE,fp);
@@ -13,10 +13,12 @@
 #include "schema.h"
 #include "defines.h"
 #include "fileutils.h"
+#include "index_stats.h"
 #include "log.h"
 #include "misc.h"
 #include "strutil.h"
 #include "main_config.h"
+#include "tombstone.h"
 
 #define MASTER_FILE_LIST    "local.db"
 #define MASTER_FILE_LIST_W  "local.db.write"
@@ -32,6 +34,23 @@ typedef enum
   MFL_BACKUP
 } master_inst_type;
 
+/* master_list_cache_struct: a parsed master file list, along with
+   what we need to tell if the file on disk has since been replaced or
+   changed.  The master file list is always replaced by link()ing a
+   new file into place, so the inode alone usually tells. */
+typedef struct _master_list_cache_struct
+{
+  char          *filename;
+  ino_t         ino;
+  off_t         size;
+  time_t        mtime;
+  time_t        ctime;
+  dl_list_type  file_list;
+} master_list_cache_struct;
+
+static dl_list_type master_list_cache;
+static int          master_list_cache_init = FALSE;
+
 /* ------------------- Local Functions ---------------- */
 
 static mkdb_file_type select_type PROTO((char *ftype));
@@ -68,6 +87,13 @@ static int lock_unlock_file_list PROTO((dl_list_type   *file_list,
                                         mkdb_lock_type lock));
 static int install_write_file_list PROTO((class_struct     *class,
                                           auth_area_struct *auth_area));
+static int read_master_file_list PROTO((class_struct     *class,
+                                        auth_area_struct *auth_area,
+                                        dl_list_type     *file_list));
+static int destroy_master_list_cache_data
+  PROTO((master_list_cache_struct *data));
+static master_list_cache_struct *find_master_list_cache
+  PROTO((char *filename));
 
 /* ---- file list reading and writing primitives --- */
 
@@ -92,6 +118,18 @@ select_type(ftype)
   {
     return MKDB_CIDR_INDEX_FILE;
   }
+  if (STR_EQ(ftype, MKDB_BINARY_INDEX_STR))
+  {
+    return MKDB_BINARY_INDEX_FILE;
+  }
+  if (STR_EQ(ftype, MKDB_UPDATED_INDEX_STR))
+  {
+    return MKDB_UPDATED_INDEX_FILE;
+  }
+  if (STR_EQ(ftype, MKDB_TRIGRAM_INDEX_STR))
+  {
+    return MKDB_TRIGRAM_INDEX_FILE;
+  }
 
   if (STR_EQ(ftype, MKDB_DATA_FILE_STR))
   {
@@ -113,6 +151,12 @@ select_str_from_type(type)
     return MKDB_SOUNDEX_INDEX_STR;
   case MKDB_CIDR_INDEX_FILE:
     return MKDB_CIDR_INDEX_STR;
+  case MKDB_BINARY_INDEX_FILE:
+    return MKDB_BINARY_INDEX_STR;
+  case MKDB_UPDATED_INDEX_FILE:
+    return MKDB_UPDATED_INDEX_STR;
+  case MKDB_TRIGRAM_INDEX_FILE:
+    return MKDB_TRIGRAM_INDEX_STR;
   case MKDB_DATA_FILE:
     return MKDB_DATA_FILE_STR;
   default:
@@ -120,6 +164,75 @@ select_str_from_type(type)
   }
 }
 
+static int
+is_stats_tag(tag)
+  char  *tag;
+{
+  return(STR_EQ(tag, MKDB_ENTRIES_TAG) || STR_EQ(tag, MKDB_KEYS_TAG) ||
+         STR_EQ(tag, MKDB_MIN_KEY_TAG) || STR_EQ(tag, MKDB_MAX_KEY_TAG) ||
+         STR_EQ(tag, MKDB_KEY_SAMPLE_TAG));
+}
+
+/* read_stats_tag: sets the index file statistic named by 'tag' */
+static void
+read_stats_tag(fi, tag, datum)
+  file_struct *fi;
+  char        *tag;
+  char        *datum;
+{
+  index_stats_struct  *stats;
+
+  if (!fi->stats)
+  {
+    fi->stats = xcalloc(1, sizeof(*(fi->stats)));
+  }
+  stats = fi->stats;
+
+  if (STR_EQ(tag, MKDB_ENTRIES_TAG))
+  {
+    stats->num_entries = atol(datum);
+  }
+  else if (STR_EQ(tag, MKDB_KEYS_TAG))
+  {
+    stats->num_keys = atol(datum);
+  }
+  else if (STR_EQ(tag, MKDB_MIN_KEY_TAG) && !stats->min_key)
+  {
+    stats->min_key = xstrdup(datum);
+  }
+  else if (STR_EQ(tag, MKDB_MAX_KEY_TAG) && !stats->max_key)
+  {
+    stats->max_key = xstrdup(datum);
+  }
+  else if (STR_EQ(tag, MKDB_KEY_SAMPLE_TAG) &&
+           stats->num_samples < INDEX_STATS_SAMPLES)
+  {
+    stats->samples[stats->num_samples++] = xstrdup(datum);
+  }
+}
+
+static void
+write_stats_tags(fp, stats)
+  FILE                *fp;
+  index_stats_struct  *stats;
+{
+  int i;
+
+  if (!stats || !stats->min_key || !stats->max_key)
+  {
+    return;
+  }
+
+  fprintf(fp, "%s:%ld\n", MKDB_ENTRIES_TAG, stats->num_entries);
+  fprintf(fp, "%s:%ld\n", MKDB_KEYS_TAG, stats->num_keys);
+  fprintf(fp, "%s:%s\n", MKDB_MIN_KEY_TAG, stats->min_key);
+  fprintf(fp, "%s:%s\n", MKDB_MAX_KEY_TAG, stats->max_key);
+  for (i = 0; i < stats->num_samples; i++)
+  {
+    fprintf(fp, "%s:%s\n", MKDB_KEY_SAMPLE_TAG, stats->samples[i]);
+  }
+}
+
 static file_struct *
 read_file_struct(fp)
   FILE  *fp;
@@ -170,6 +283,10 @@ read_file_struct(fp)
       {
         fi->lock = true_false(datum);
       }
+      else if (is_stats_tag(tag))
+      {
+        read_stats_tag(fi, tag, datum);
+      }
       else
       {
         log(L_LOG_WARNING, MKDB, "unknown file list tag: %s",
@@ -221,6 +338,7 @@ write_file_struct(fp, fi, not_last)
 #endif
   fprintf(fp, "%s:%ld\n", MKDB_NUMRECS_TAG, fi->num_recs);
   fprintf(fp, "%s:%s\n", MKDB_LOCK_TAG, on_off(fi->lock));
+  write_stats_tags(fp, fi->stats);
 
   if (not_last)
   {
@@ -401,6 +519,13 @@ generate_file_name(tmp_filename, base_filename, full_file_list)
   sprintf(template, "%s/%s", dir, base_file);
   sprintf(real_fname, template, index_no);
 
+  /* files an index merge has dropped from the list linger for a
+     moment before they are removed; don't collide with them */
+  while (file_exists(real_fname))
+  {
+    sprintf(real_fname, template, ++index_no);
+  }
+
   log(L_LOG_DEBUG, MKDB, "generate_file_name: generated '%s'",
       real_fname);
 
@@ -506,6 +631,9 @@ add_file_struct(file, file_list, lock_mode)
     tmp_file->type     = file->type;
     tmp_file->size     = file->size;
     tmp_file->num_recs = file->num_recs;
+
+    destroy_index_stats(tmp_file->stats);
+    tmp_file->stats    = copy_index_stats(file->stats);
   }
   else
   {
@@ -815,6 +943,91 @@ is_area_indexed(class, auth_area)
   return FALSE;
 }
 
+/* read_master_file_list: reads the master file list pointed to by
+   class & auth_area directly from disk, appending to file_list. */
+static int
+read_master_file_list(class, auth_area, file_list)
+  class_struct     *class;
+  auth_area_struct *auth_area;
+  dl_list_type     *file_list;
+{
+  char  index_file[MAX_FILE + 1];
+
+  /* calculate the master file list name */
+  bzero((char *)index_file, sizeof(index_file));
+  if (!get_master_index_file(class, auth_area, MFL_READ, index_file))
+  {
+    return FALSE;
+  }
+
+  /* first check to see if the area appears to be indexed in order to
+     avoid a possibly lengthy read_file_list() call */
+  if (! is_area_indexed(class, auth_area))
+  {
+    return TRUE;
+  }
+
+  if (!read_file_list(index_file, file_list))
+  {
+    dl_list_destroy(file_list);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static int
+destroy_master_list_cache_data(data)
+  master_list_cache_struct *data;
+{
+  if (!data)
+  {
+    return TRUE;
+  }
+
+  dl_list_destroy(&(data->file_list));
+
+  if (data->filename)
+  {
+    free(data->filename);
+  }
+
+  free(data);
+
+  return TRUE;
+}
+
+/* find_master_list_cache: returns the cached copy of the master file
+   list 'filename', leaving the cache list positioned on it, or NULL
+   if we don't have one. */
+static master_list_cache_struct *
+find_master_list_cache(filename)
+  char  *filename;
+{
+  master_list_cache_struct *mlc;
+  int                      not_done;
+
+  if (!master_list_cache_init)
+  {
+    dl_list_default(&master_list_cache, FALSE,
+                    destroy_master_list_cache_data);
+    master_list_cache_init = TRUE;
+  }
+
+  not_done = dl_list_first(&master_list_cache);
+  while (not_done)
+  {
+    mlc = dl_list_value(&master_list_cache);
+    if (STR_EQ(mlc->filename, filename))
+    {
+      return(mlc);
+    }
+    not_done = dl_list_next(&master_list_cache);
+  }
+
+  return NULL;
+}
+
 /* ------------------- Public Functions --------------- */
 
 
@@ -877,6 +1090,8 @@ copy_file_struct(fi)
     copy->base_filename = xstrdup(fi->base_filename);
   }
 
+  copy->stats = copy_index_stats(fi->stats);
+
   return(copy);
 }
 
@@ -965,14 +1180,19 @@ get_dir(class_name, auth_area_name, dir)
 
 /* get_file_list: reads in records from the master file list
      pointed to by class & auth_area, and appends them to file_list,
-     which should already be initialized. */
+     which should already be initialized.  The parsed list is kept
+     from call to call, and only read again when the master file list
+     on disk has changed. */
 int
 get_file_list(class, auth_area, file_list)
   class_struct     *class;
   auth_area_struct *auth_area;
   dl_list_type     *file_list;
 {
-  char  index_file[MAX_FILE + 1];
+  master_list_cache_struct  *mlc;
+  char                      index_file[MAX_FILE + 1];
+  struct stat               sb;
+  struct stat               post_sb;
 
   /* calculate the master file list name */
   bzero((char *)index_file, sizeof(index_file));
@@ -981,16 +1201,76 @@ get_file_list(class, auth_area, file_list)
     return FALSE;
   }
 
-  /* first check to see if the area appears to be indexed in order to
-     avoid a possibly lengthy read_file_list() call */
-  if (! is_area_indexed(class, auth_area))
+  /* no master file list at the moment (the area is unindexed, or
+     being reindexed): don't cache anything */
+  if (stat(index_file, &sb) < 0)
+  {
+    return(read_master_file_list(class, auth_area, file_list));
+  }
+
+  mlc = find_master_list_cache(index_file);
+  if (mlc && mlc->ino == sb.st_ino && mlc->size == sb.st_size &&
+      mlc->mtime == sb.st_mtime && mlc->ctime == sb.st_ctime)
+  {
+    return(copy_file_list(file_list, &(mlc->file_list)));
+  }
+
+  if (mlc)
   {
+    /* stale: find_master_list_cache left the list pointing at it */
+    dl_list_delete(&master_list_cache);
+  }
+
+  mlc = xcalloc(1, sizeof(*mlc));
+  dl_list_default(&(mlc->file_list), FALSE, destroy_file_struct_data);
+
+  if (!read_master_file_list(class, auth_area, &(mlc->file_list)))
+  {
+    destroy_master_list_cache_data(mlc);
+    return FALSE;
+  }
+
+  copy_file_list(file_list, &(mlc->file_list));
+
+  /* only keep it if the file didn't change out from under us */
+  if (stat(index_file, &post_sb) < 0 ||
+      post_sb.st_ino != sb.st_ino || post_sb.st_size != sb.st_size ||
+      post_sb.st_mtime != sb.st_mtime || post_sb.st_ctime != sb.st_ctime)
+  {
+    destroy_master_list_cache_data(mlc);
     return TRUE;
   }
 
-  if (!read_file_list(index_file, file_list))
+  mlc->filename = xstrdup(index_file);
+  mlc->ino      = sb.st_ino;
+  mlc->size     = sb.st_size;
+  mlc->mtime    = sb.st_mtime;
+  mlc->ctime    = sb.st_ctime;
+
+  dl_list_append(&master_list_cache, mlc);
+
+  return TRUE;
+}
+
+/* stat_master_file_list: stat()s the master file list pointed to by
+     class & auth_area into 'sb', for callers that keep something
+     built from the area's files.  Returns FALSE if there isn't one. */
+int
+stat_master_file_list(class, auth_area, sb)
+  class_struct     *class;
+  auth_area_struct *auth_area;
+  struct stat      *sb;
+{
+  char  index_file[MAX_FILE + 1];
+
+  bzero((char *)index_file, sizeof(index_file));
+  if (!sb || !get_master_index_file(class, auth_area, MFL_READ, index_file))
+  {
+    return FALSE;
+  }
+
+  if (stat(index_file, sb) < 0)
   {
-    dl_list_destroy(file_list);
     return FALSE;
   }
 
@@ -1233,8 +1513,9 @@ modify_file_list(class, auth_area, add_list, delete_list,
 
   log(L_LOG_DEBUG, MKDB, "master file write start: %d", (int) getpid());
 
-  /* read the current master file list */
-  if (!get_file_list(class, auth_area, &full_file_list))
+  /* read the current master file list (straight from the disk: we
+     hold the lock, so it can't change under us now) */
+  if (!read_master_file_list(class, auth_area, &full_file_list))
   {
     release_placeholder_lock(write_index_file, lock_fd);
     return FALSE;
@@ -1320,6 +1601,12 @@ unlink_file_list(file_list)
         unlink(file->filename);
       }
 
+      /* a data file's tombstones go with it */
+      if (file && file->type == MKDB_DATA_FILE)
+      {
+        unlink_tombstones(file);
+      }
+
       not_done = dl_list_next(file_list);
     }
   }
@@ -1600,6 +1887,8 @@ destroy_file_struct_data(data)
     fclose(data->fp);
   }
 
+  destroy_index_stats(data->stats);
+
   free(data);
 
   return TRUE;
@@ -27,11 +27,21 @@
 #define MKDB_NUMRECS_TAG    "num_recs"
 #define MKDB_LOCK_TAG       "lock"
 
+/* tags for an index file's statistics */
+#define MKDB_ENTRIES_TAG    "entries"
+#define MKDB_KEYS_TAG       "keys"
+#define MKDB_MIN_KEY_TAG    "min_key"
+#define MKDB_MAX_KEY_TAG    "max_key"
+#define MKDB_KEY_SAMPLE_TAG "key_sample"
+
 
 /* for types of files */
 #define MKDB_EXACT_INDEX_STR        "EXACT"
 #define MKDB_CIDR_INDEX_STR         "CIDR"
 #define MKDB_SOUNDEX_INDEX_STR      "SOUNDEX"
+#define MKDB_BINARY_INDEX_STR       "BINARY"
+#define MKDB_UPDATED_INDEX_STR      "UPDATED"
+#define MKDB_TRIGRAM_INDEX_STR      "TRIGRAM"
 #define MKDB_DATA_FILE_STR          "DATA"
 #define MKDB_OLD_INDEX_STR          "INDEX"
 #define MKDB_OLD_INDEX_FIRST_STR    "FIRST"
@@ -42,6 +52,9 @@
 #define INDEX_EXACT_FILE_TEMPL   "-exact-%d.ndx"
 #define INDEX_CIDR_FILE_TEMPL    "-cidr-%d.ndx"
 #define INDEX_SOUNDEX_FILE_TEMPL "-soundex-%d.ndx"
+#define INDEX_BINARY_FILE_TEMPL  "-binary-%d.ndx"
+#define INDEX_UPDATED_FILE_TEMPL "-updated-%d.ndx"
+#define INDEX_TRIGRAM_FILE_TEMPL "-trigram-%d.ndx"
 
 
 /* prototypes */
@@ -71,6 +84,12 @@ int get_file_list PROTO((class_struct     *class,
                          auth_area_struct *auth_area,
                          dl_list_type     *file_list));
 
+/* stat()s the master file list pointed to by class & auth_area.
+   Returns FALSE if there isn't one. */
+int stat_master_file_list PROTO((class_struct     *class,
+                                 auth_area_struct *auth_area,
+                                 struct stat      *sb));
+
 /* given a class_name and auth_area_name, or just auth_area_name, and
    a type, return the master file list. */
 int get_file PROTO((char            *class_name,
@@ -9,11 +9,16 @@
 
 #include "index.h"
 
+#include "arena.h"
+#include "attributes.h"
 #include "auth_area.h"
+#include "binary_index.h"
 #include "defines.h"
 #include "fileinfo.h"
 #include "fileutils.h"
 #include "index_file.h"
+#include "index_sort.h"
+#include "index_stats.h"
 #include "ip_network.h"
 #include "log.h"
 #include "misc.h"
@@ -22,15 +27,21 @@
 #include "schema.h"
 #include "search.h"
 #include "strutil.h"
+#include "trigram_index.h"
 #include "validate_rec.h"
 
 #define MAX_RECORD_BLOCK         100 /* read & index 100 at a time */
 
-#ifdef NEW_STYLE_BIN_SORT
-#define SORT_COMMAND "sort -o %s -k 5,5 -k 4,4n -t : %s"
-#else
-#define SORT_COMMAND "sort -o %s +4 +3 -t : %s "
-#endif
+/* local statics */
+
+/* if set, exact indexes are written as binary index files */
+static int binary_index_mode = FALSE;
+
+/* the number of processes index_files() indexes data files with */
+static int index_workers = 1;
+
+/* what the records being indexed are read into */
+static arena_type *index_arena = NULL;
 
 /* ------------------------ Local Functions ------------------ */
 
@@ -49,6 +60,35 @@ write_index_line(fp, item)
   return TRUE;
 }
 
+/* write_typed_index_line: output one index line to the index of type
+   'type' in 'files', if there is one */
+static int
+write_typed_index_line(files, type, item)
+  dl_list_type    *files;
+  mkdb_file_type  type;
+  index_struct    *item;
+{
+  index_fp_struct *index_file;
+
+  index_file = find_index_file_by_type(files, type);
+  if (!index_file)
+  {
+    return FALSE;
+  }
+
+  if (!index_file->fp)
+  {
+    if (!(index_file->fp = fopen(index_file->tmp_filename, "a")))
+    {
+      log(L_LOG_ERR, MKDB, "could not open index file '%s': %s",
+          index_file->tmp_filename, strerror(errno));
+      return FALSE;
+    }
+  }
+
+  return(write_index_line(index_file->fp, item));
+}
+
 /* ********************************************************************** */
 /* indexing functions.
 
@@ -232,19 +272,63 @@ is_soundexable(str)
   return TRUE;
 }
 
+/* write_trigram_index_lines: write a line to the trigram index in
+   'files', if there is one, for each trigram of the (exact index form
+   of the) value of 'av' */
+static void
+write_trigram_index_lines(files, rec, av)
+  dl_list_type    *files;
+  record_struct   *rec;
+  av_pair_struct  *av;
+{
+  index_struct  item;
+  char          *trigrams;
+  int           num_trigrams;
+  int           i;
+
+  if (!find_index_file_by_type(files, MKDB_TRIGRAM_INDEX_FILE))
+  {
+    return;
+  }
+
+  item.offset       = rec->offset;
+  item.data_file_no = rec->data_file_no;
+  item.attribute_id = av->attr->global_id;
+  item.deleted_flag = FALSE;
+  item.value        = exact_index((char *) av->value);
+
+  num_trigrams = split_trigrams(item.value, &trigrams);
+  free(item.value);
+
+  for (i = 0; i < num_trigrams; i++)
+  {
+    item.value = trigrams + i * (TRIGRAM_LEN + 1);
+    write_typed_index_line(files, MKDB_TRIGRAM_INDEX_FILE, &item);
+  }
+
+  if (trigrams)
+  {
+    free(trigrams);
+  }
+}
+
 /* ********************************************************************* */
 
 /* sort_index_file: given a list of files, sort each tmp file, move it
-   to its real filename, and unlink the original unsorted file */
+   to its real filename, and unlink the original unsorted file.  The
+   files are all sorted at once (see sort_index_file_list()). */
 int
 sort_index_files(files)
   dl_list_type *files;
 {
-  char            command_str[BUFSIZ + 1];
   index_fp_struct *index_file;
+  char            **in_files    = NULL;
+  char            **out_files   = NULL;
+  int             num_files     = 0;
   int             not_done;
-  struct stat     sb;
   int             status;
+  int             i;
+  struct stat     sb;
 
   not_done = dl_list_first(files);
 
@@ -260,29 +344,80 @@ sort_index_files(files)
       continue;
     }
 
-    fclose(index_file->fp);
-    index_file->fp = NULL;
+    if (index_file->fp)
+    {
+      fclose(index_file->fp);
+      index_file->fp = NULL;
+    }
+
+    in_files  = xrealloc(in_files, (num_files + 1) * sizeof(char *));
+    out_files = xrealloc(out_files, (num_files + 1) * sizeof(char *));
 
-    sprintf(command_str, SORT_COMMAND, index_file->real_filename,
-            index_file->tmp_filename);
+    in_files[num_files]  = index_file->tmp_filename;
+    out_files[num_files] = index_file->real_filename;
+    num_files++;
 
-    if (system(command_str) != 0)
+    not_done = dl_list_next(files);
+  }
+
+  status = sort_index_file_list(in_files, out_files, num_files);
+
+  if (status)
+  {
+    for (i = 0; i < num_files; i++)
     {
-      log(L_LOG_ERR, MKDB, "sort failed: %s", strerror(errno));
-      return FALSE;
+      unlink(in_files[i]);
     }
+  }
+  else
+  {
+    log(L_LOG_ERR, MKDB, "sort of index files failed");
+  }
 
-    unlink(index_file->tmp_filename);
-    not_done = dl_list_next(files);
+  if (in_files)
+  {
+    free(in_files);
+    free(out_files);
+  }
+
+  return(status);
+}
+
+/* convert_binary_index_file: given a sorted index file, replace it
+   with its binary form if it is an exact index file */
+static int
+convert_binary_index_file(index_file)
+  index_fp_struct *index_file;
+{
+  if (index_file->type != MKDB_EXACT_INDEX_FILE)
+  {
+    return TRUE;
+  }
+
+  /* the tmp file is gone by now, so reuse its name */
+  if (write_binary_index_file(index_file->real_filename,
+                              index_file->tmp_filename) < 0)
+  {
+    return FALSE;
   }
 
+  if (rename(index_file->tmp_filename, index_file->real_filename) < 0)
+  {
+    log(L_LOG_ERR, MKDB, "could not rename '%s' to '%s': %s",
+        index_file->tmp_filename, index_file->real_filename,
+        strerror(errno));
+    return FALSE;
+  }
+
+  index_file->type = MKDB_BINARY_INDEX_FILE;
+
   return TRUE;
 }
 
 /* index record: given a record, a hit_struct (the index_file_no is
    unnecessary), write to each index the appropriate lines for each
    attribute.  Return the number of index lines written */
-static long
+long
 index_record(rec, auth_area, files, status)
   record_struct    *rec;
   auth_area_struct *auth_area;
@@ -320,6 +455,19 @@ index_record(rec, auth_area, files, status)
   {
     av = dl_list_value(av_pair_list);
 
+    /* the Updated index gets every Updated value, indexed or not */
+    if (av && av->attr && av->value && STR_EQ(av->attr->name, BC_UPDATED))
+    {
+      item.offset       = rec->offset;
+      item.data_file_no = rec->data_file_no;
+      item.attribute_id = av->attr->global_id;
+      item.deleted_flag = FALSE;
+      item.value        = (char *) av->value;
+
+      write_typed_index_line(files, MKDB_UPDATED_INDEX_FILE, &item);
+      item.value        = NULL;
+    }
+
     if (!av || !av->attr || !av->value ||
         (av->attr->index == INDEX_NONE) ||
         (av->attr->index == INDEX_MAX_TYPE))
@@ -327,6 +475,8 @@ index_record(rec, auth_area, files, status)
       continue;
     }
 
+    write_trigram_index_lines(files, rec, av);
+
     /* for this attribute get the first index file to deal with */
 
     item.offset       = rec->offset;
@@ -492,6 +642,8 @@ index_data_file(class, auth_area, data_file, files, validate_flag, status)
   record_struct    *record;
   long              num_index_lines = 0;
   rec_parse_result read_status;
+  arena_type       *old_arena;
+  arena_mark_type  mark;
 
   /* check for bad parameters */
   if (!class || !auth_area || !data_file || !files || !status)
@@ -520,6 +672,15 @@ index_data_file(class, auth_area, data_file, files, validate_flag, status)
 
   set_log_context(data_file->filename, 0, -1);
 
+  /* each record is done with once it is indexed, so its memory is
+     given back in one go */
+  if (!index_arena)
+  {
+    index_arena = arena_create(0);
+  }
+  old_arena = arena_bind(index_arena);
+  arena_get_mark(&mark);
+
   /* read until a null record is returned (indicating the end-of-file) */
   while ( (record = mkdb_read_next_record(class,
                                           auth_area,
@@ -533,11 +694,13 @@ index_data_file(class, auth_area, data_file, files, validate_flag, status)
     num_index_lines += index_record(record, auth_area, files, status);
 
     destroy_record_data(record);
+    arena_release(&mark);
 
     if (! *status)
     {
       log(L_LOG_ERR, MKDB, "error indexing data file '%s'",
           data_file->filename);
+      arena_bind(old_arena);
       fclose(data_file->fp);
       data_file->fp = NULL;
       return(0);
@@ -545,12 +708,467 @@ index_data_file(class, auth_area, data_file, files, validate_flag, status)
 
   }
 
+  arena_release(&mark);
+  arena_bind(old_arena);
+
   fclose(data_file->fp);
   data_file->fp = NULL;
 
+  index_data_file_coverage(class, data_file, files);
+
   return(num_index_lines);
 }
 
+/* index_data_file_coverage: tell readers of the Updated and trigram
+   indexes in 'files' that they cover the (fully indexed) data file */
+void
+index_data_file_coverage(class, data_file, files)
+  class_struct  *class;
+  file_struct   *data_file;
+  dl_list_type  *files;
+{
+  attribute_struct *updated_attr;
+  index_struct     item;
+
+  /* a trigram cover line is of no record or attribute */
+  item.offset       = -1;
+  item.data_file_no = data_file->file_no;
+  item.attribute_id = 0;
+  item.deleted_flag = FALSE;
+  item.value        = TRIGRAM_INDEX_COVER_VALUE;
+
+  write_typed_index_line(files, MKDB_TRIGRAM_INDEX_FILE, &item);
+
+  updated_attr = find_attribute_by_name(class, BC_UPDATED);
+  if (!updated_attr)
+  {
+    return;
+  }
+
+  item.offset       = 0;
+  item.data_file_no = data_file->file_no;
+  item.attribute_id = updated_attr->global_id;
+  item.deleted_flag = FALSE;
+  item.value        = UPDATED_INDEX_COVER_VALUE;
+
+  write_typed_index_line(files, MKDB_UPDATED_INDEX_FILE, &item);
+}
+
+/* index_worker_result_struct: what an indexing worker reports back to
+   its parent for each data file it indexed */
+typedef struct _index_worker_result_struct
+{
+  int   file_idx;
+  long  num_lines;
+  long  num_recs;
+} index_worker_result_struct;
+
+/* index_worker_file_struct: used to hand out the data files */
+typedef struct _index_worker_file_struct
+{
+  int   file_idx;
+  off_t size;
+} index_worker_file_struct;
+
+static int
+compare_worker_file_size(a, b)
+  const void *a;
+  const void *b;
+{
+  const index_worker_file_struct *fa = a;
+  const index_worker_file_struct *fb = b;
+
+  if (fa->size != fb->size)
+  {
+    return(fa->size > fb->size ? -1 : 1);
+  }
+
+  return(fa->file_idx - fb->file_idx);
+}
+
+/* assign_index_workers: sets 'worker_of' for each of the data files,
+   giving the next largest file to the least loaded worker */
+static void
+assign_index_workers(data_files, num_data_files, workers, worker_of)
+  file_struct **data_files;
+  int         num_data_files;
+  int         workers;
+  int         *worker_of;
+{
+  index_worker_file_struct  *sizes;
+  off_t                     *load;
+  struct stat               sb;
+  int                       i;
+  int                       w;
+  int                       least;
+
+  sizes = xcalloc(num_data_files, sizeof(*sizes));
+  load  = xcalloc(workers, sizeof(*load));
+
+  for (i = 0; i < num_data_files; i++)
+  {
+    sizes[i].file_idx = i;
+    if (stat(data_files[i]->filename, &sb) == 0)
+    {
+      sizes[i].size = sb.st_size;
+    }
+  }
+
+  qsort(sizes, num_data_files, sizeof(*sizes), compare_worker_file_size);
+
+  for (i = 0; i < num_data_files; i++)
+  {
+    least = 0;
+    for (w = 1; w < workers; w++)
+    {
+      if (load[w] < load[least])
+      {
+        least = w;
+      }
+    }
+
+    worker_of[sizes[i].file_idx] = least;
+    load[least] += sizes[i].size;
+  }
+
+  free(sizes);
+  free(load);
+}
+
+/* worker_fragment_name: the temporary index file that worker 'worker'
+   writes in place of 'tmp_filename' */
+static char *
+worker_fragment_name(buf, tmp_filename, worker)
+  char  *buf;
+  char  *tmp_filename;
+  int   worker;
+{
+  sprintf(buf, "%.*s.w%d", MAX_FILE - 16, tmp_filename, worker);
+
+  return(buf);
+}
+
+/* run_index_worker: the child side of index_data_files_parallel(): index
+   this worker's share of the data files into its own fragments of the
+   index files, reporting the result of each on 'fd'.  Does not
+   return. */
+static void
+run_index_worker(class, auth_area, data_files, num_data_files, worker_of,
+                 worker, files, validate_flag, fd)
+  class_struct      *class;
+  auth_area_struct  *auth_area;
+  file_struct       **data_files;
+  int               num_data_files;
+  int               *worker_of;
+  int               worker;
+  dl_list_type      *files;
+  int               validate_flag;
+  int               fd;
+{
+  index_fp_struct             *index_file;
+  index_worker_result_struct  result;
+  char                        fragment[MAX_FILE];
+  int                         status        = TRUE;
+  int                         not_done;
+  int                         i;
+
+  /* this is our copy of the list, so point it at our fragments.  Any
+     open file pointer belongs to the parent. */
+  not_done = dl_list_first(files);
+  while (not_done)
+  {
+    index_file = dl_list_value(files);
+    index_file->fp = NULL;
+    worker_fragment_name(fragment, index_file->tmp_filename, worker);
+    strcpy(index_file->tmp_filename, fragment);
+
+    not_done = dl_list_next(files);
+  }
+
+  for (i = 0; i < num_data_files && status; i++)
+  {
+    if (worker_of[i] != worker)
+    {
+      continue;
+    }
+
+    bzero(&result, sizeof(result));
+    result.file_idx  = i;
+    result.num_lines = index_data_file(class, auth_area, data_files[i], files,
+                                       validate_flag, &status);
+    result.num_recs  = data_files[i]->num_recs;
+
+    if (status && write(fd, &result, sizeof(result)) != sizeof(result))
+    {
+      log(L_LOG_ERR, MKDB, "could not report indexing result: %s",
+          strerror(errno));
+      status = FALSE;
+    }
+  }
+
+  not_done = dl_list_first(files);
+  while (not_done)
+  {
+    index_file = dl_list_value(files);
+    if (index_file->fp && (ferror(index_file->fp) | fclose(index_file->fp)))
+    {
+      log(L_LOG_ERR, MKDB, "could not write index file '%s': %s",
+          index_file->tmp_filename, strerror(errno));
+      status = FALSE;
+    }
+    index_file->fp = NULL;
+
+    not_done = dl_list_next(files);
+  }
+
+  close(fd);
+  flush_log_files();
+  _exit(status ? 0 : 1);
+}
+
+/* read_worker_result: reads the next result from a worker.  Returns 1
+   if it did, 0 at the end, and -1 on error. */
+static int
+read_worker_result(fd, result)
+  int                         fd;
+  index_worker_result_struct  *result;
+{
+  char  *p    = (char *) result;
+  int   len   = 0;
+  int   n;
+
+  while (len < (int) sizeof(*result))
+  {
+    n = read(fd, p + len, sizeof(*result) - len);
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n < 0)
+    {
+      log(L_LOG_ERR, MKDB, "could not read indexing result: %s",
+          strerror(errno));
+      return(-1);
+    }
+    if (n == 0)
+    {
+      /* a partial result is as bad as a failed read */
+      return(len == 0 ? 0 : -1);
+    }
+    len += n;
+  }
+
+  return(1);
+}
+
+/* append_worker_fragments: adds each worker's fragment of each index
+   file onto the end of its temporary file, for sort_index_files().
+   The fragments are removed, whether this works or not. */
+static int
+append_worker_fragments(files, workers, status)
+  dl_list_type  *files;
+  int           workers;
+  int           status;
+{
+  index_fp_struct *index_file;
+  FILE            *in;
+  FILE            *out;
+  char            fragment[MAX_FILE];
+  char            buf[BUFSIZ];
+  int             not_done;
+  int             w;
+  size_t          n;
+
+  not_done = dl_list_first(files);
+  while (not_done)
+  {
+    index_file = dl_list_value(files);
+
+    for (w = 0; w < workers; w++)
+    {
+      worker_fragment_name(fragment, index_file->tmp_filename, w);
+
+      if (status && (in = fopen(fragment, "r")) != NULL)
+      {
+        if (!index_file->fp &&
+            !(index_file->fp = fopen(index_file->tmp_filename, "a")))
+        {
+          log(L_LOG_ERR, MKDB, "could not open index file '%s': %s",
+              index_file->tmp_filename, strerror(errno));
+          status = FALSE;
+        }
+        out = index_file->fp;
+
+        while (status && (n = fread(buf, 1, sizeof(buf), in)) > 0)
+        {
+          if (fwrite(buf, 1, n, out) != n)
+          {
+            log(L_LOG_ERR, MKDB, "could not write index file '%s': %s",
+                index_file->tmp_filename, strerror(errno));
+            status = FALSE;
+          }
+        }
+        fclose(in);
+      }
+
+      unlink(fragment);
+    }
+
+    not_done = dl_list_next(files);
+  }
+
+  return(status);
+}
+
+/* index_data_files_parallel: indexes the 'num_data_files' data files
+   'data_files' into the index files 'files' with up to
+   get_index_workers() child processes, each writing its own fragment
+   of each index file.  The fragments are gathered into the temporary
+   index files as if the data files had been indexed one at a time, so
+   the sort sees the same lines either way.  The number of index lines
+   for each data file is put in 'num_lines'.  Returns FALSE on
+   error. */
+static int
+index_data_files_parallel(class, auth_area, data_files, num_data_files,
+                          files, validate_flag, num_lines)
+  class_struct      *class;
+  auth_area_struct  *auth_area;
+  file_struct       **data_files;
+  int               num_data_files;
+  dl_list_type      *files;
+  int               validate_flag;
+  long              *num_lines;
+{
+  index_worker_result_struct  result;
+  RETSIGTYPE                  (*old_handler)();
+  pid_t                       *pids;
+  int                         *fds;
+  int                         *worker_of;
+  int                         *done;
+  int                         pipe_fds[2];
+  int                         workers;
+  int                         proc_stat;
+  int                         status        = TRUE;
+  int                         n;
+  int                         i;
+  int                         w;
+
+  workers = index_workers;
+  if (workers > num_data_files)
+  {
+    workers = num_data_files;
+  }
+
+  pids      = xcalloc(workers, sizeof(*pids));
+  fds       = xcalloc(workers, sizeof(*fds));
+  worker_of = xcalloc(num_data_files, sizeof(*worker_of));
+  done      = xcalloc(num_data_files, sizeof(*done));
+
+  assign_index_workers(data_files, num_data_files, workers, worker_of);
+
+  /* we have to be able to wait() for our own children, and they
+     shouldn't repeat anything we have yet to write out */
+  old_handler = signal(SIGCHLD, SIG_DFL);
+  flush_log_files();
+
+  for (w = 0; w < workers; w++)
+  {
+    fds[w] = -1;
+    if (pipe(pipe_fds) < 0)
+    {
+      log(L_LOG_ERR, MKDB, "pipe failed: %s", strerror(errno));
+      status = FALSE;
+      break;
+    }
+
+    pids[w] = fork();
+    if (pids[w] == 0)
+    {
+      close(pipe_fds[0]);
+      for (i = 0; i < w; i++)
+      {
+        close(fds[i]);
+      }
+      run_index_worker(class, auth_area, data_files, num_data_files,
+                       worker_of, w, files, validate_flag, pipe_fds[1]);
+    }
+
+    close(pipe_fds[1]);
+    if (pids[w] < 0)
+    {
+      log(L_LOG_ERR, MKDB, "fork failed: %s", strerror(errno));
+      close(pipe_fds[0]);
+      status = FALSE;
+      break;
+    }
+    fds[w] = pipe_fds[0];
+  }
+
+  /* collect the results, then the workers */
+  for (i = 0; i < workers; i++)
+  {
+    if (fds[i] < 0)
+    {
+      break;
+    }
+
+    while ((n = read_worker_result(fds[i], &result)) > 0)
+    {
+      if (result.file_idx < 0 || result.file_idx >= num_data_files ||
+          worker_of[result.file_idx] != i)
+      {
+        log(L_LOG_ERR, MKDB, "bad indexing result from worker %d", i);
+        status = FALSE;
+        continue;
+      }
+
+      num_lines[result.file_idx]             = result.num_lines;
+      data_files[result.file_idx]->num_recs  = result.num_recs;
+      done[result.file_idx]                  = TRUE;
+    }
+    if (n < 0)
+    {
+      status = FALSE;
+    }
+    close(fds[i]);
+
+    while (waitpid(pids[i], &proc_stat, 0) < 0)
+    {
+      if (errno != EINTR)
+      {
+        log(L_LOG_ERR, MKDB, "wait failed: %s", strerror(errno));
+        proc_stat = -1;
+        break;
+      }
+    }
+    if (!WIFEXITED(proc_stat) || WEXITSTATUS(proc_stat) != 0)
+    {
+      status = FALSE;
+    }
+  }
+
+  signal(SIGCHLD, old_handler);
+
+  for (i = 0; i < num_data_files && status; i++)
+  {
+    if (!done[i])
+    {
+      log(L_LOG_ERR, MKDB, "data file '%s' was not indexed",
+          data_files[i]->filename);
+      status = FALSE;
+    }
+  }
+
+  status = append_worker_fragments(files, workers, status);
+
+  free(pids);
+  free(fds);
+  free(worker_of);
+  free(done);
+
+  return(status);
+}
+
 /* ------------------------ Public Functions ----------------- */
 
 int
@@ -579,7 +1197,7 @@ decode_index_line(line, item)
   item->data_file_no = atoi(argv[1]);
   item->deleted_flag = atoi(argv[2]);
   item->attribute_id = atoi(argv[3]);
-  item->value        = xstrdup(argv[4]);
+  item->value        = arena_xstrdup(argv[4]);
 
   free_arg_list(argv);
 
@@ -608,6 +1226,70 @@ encode_index_line(line, item)
 }
 
 
+int
+finish_index_files(class, index_file_list, num_recs, add_list)
+  class_struct  *class;
+  dl_list_type  *index_file_list;
+  long          num_recs;
+  dl_list_type  *add_list;
+{
+  index_fp_struct     *index_fp_file;
+  file_struct         *index_file;
+  index_stats_struct  *stats;
+  struct stat         sb;
+  int                 not_done;
+
+  /* sort all tmp files and move to file (does an explicit fclose) */
+  if (!sort_index_files(index_file_list))
+  {
+    return FALSE;
+  }
+
+  not_done = dl_list_first(index_file_list);
+  while (not_done)
+  {
+    index_fp_file = dl_list_value(index_file_list);
+
+    if (stat(index_fp_file->real_filename, &sb) < 0)
+    {
+      not_done = dl_list_next(index_file_list);
+      continue;
+    }
+
+    /* the statistics are read before any conversion to binary */
+    stats = read_index_stats(index_fp_file->real_filename);
+
+    if (binary_index_mode && !convert_binary_index_file(index_fp_file))
+    {
+      destroy_index_stats(stats);
+      return FALSE;
+    }
+
+    index_file = build_tmp_base_file_struct(index_fp_file->real_filename,
+                                            NULL,
+                                            index_fp_file->type,
+                                            num_recs);
+    if (index_file)
+    {
+      index_file->base_filename
+        = generate_index_file_basename(index_file->type, class->db_dir,
+                                       index_fp_file->prefix);
+      index_file->filename = NULL;
+      index_file->stats    = stats;
+
+      dl_list_append(add_list, index_file);
+    }
+    else
+    {
+      destroy_index_stats(stats);
+    }
+
+    not_done = dl_list_next(index_file_list);
+  }
+
+  return TRUE;
+}
+
 int
 index_files(class, auth_area, index_file_list, data_file_list, validate_flag,
             hold_lock_flag)
@@ -619,15 +1301,19 @@ index_files(class, auth_area, index_file_list, data_file_list, validate_flag,
   int               hold_lock_flag;
 {
   file_struct   *data_file;
-  file_struct   *index_file;
   file_struct   *delete_file;
-  index_fp_struct *index_fp_file;
   dl_list_type  delete_list;
   dl_list_type  add_list;
   dl_list_type  unlock_list;
   int           status                          = TRUE;
   long          index_num_recs                  = 0;
   long          num_recs                        = 0;
+  file_struct   **data_files                    = NULL;
+  long          *num_lines                      = NULL;
+  int           num_data_files                  = 0;
+  int           file_idx                        = 0;
+  int           not_done;
+  int           is_last;
 
   if (!class || !auth_area)
   {
@@ -656,25 +1342,53 @@ index_files(class, auth_area, index_file_list, data_file_list, validate_flag,
     return FALSE;
   }
 
+  /* with more than one worker, index all of the data files up front,
+     in parallel */
+  if (index_workers > 1)
+  {
+    not_done = dl_list_first(data_file_list);
+    while (not_done)
+    {
+      data_files = xrealloc(data_files,
+                            (num_data_files + 1) * sizeof(file_struct *));
+      data_files[num_data_files++] = dl_list_value(data_file_list);
+      not_done = dl_list_next(data_file_list);
+    }
+
+    if (num_data_files > 1)
+    {
+      num_lines = xcalloc(num_data_files, sizeof(long));
+      status = index_data_files_parallel(class, auth_area, data_files,
+                                         num_data_files, index_file_list,
+                                         validate_flag, num_lines);
+    }
+  }
+
   /* for each data file, open and index */
-  dl_list_first(data_file_list);
+  not_done = status && dl_list_first(data_file_list);
 
-  do
+  while (not_done)
   {
     data_file = dl_list_value(data_file_list);
-    if (!data_file)
+
+    if (num_lines)
     {
-      continue;
+      /* already indexed; the list is in the same order as the array */
+      num_recs = num_lines[file_idx++];
+    }
+    else
+    {
+      num_recs = index_data_file(class, auth_area, data_file,
+                                 index_file_list, validate_flag, &status);
     }
-
-    num_recs = index_data_file(class, auth_area, data_file, index_file_list,
-                               validate_flag, &status);
     if (!status)
     {
       /* indexing failure: back out */
       break;
     }
 
+    index_num_recs += num_recs;
+
     if (num_recs == 0)
     {
       /* copy the file struct so it doesn't get free()d twice */
@@ -683,17 +1397,32 @@ index_files(class, auth_area, index_file_list, data_file_list, validate_flag,
       delete_file->fp = NULL;
 
       dl_list_append(&delete_list, delete_file);
+
+      /* dl_list_delete() leaves us on the next file, or on the previous
+         one if this was the last */
+      is_last = (dl_list_next_value(data_file_list, 1) == NULL);
       dl_list_delete(data_file_list);
+      not_done = !is_last && !dl_list_empty(data_file_list);
+      continue;
     }
 
-    index_num_recs += num_recs;
+    not_done = dl_list_next(data_file_list);
+  }
 
-  } while (dl_list_next(data_file_list));
+  if (data_files)
+  {
+    free(data_files);
+  }
+  if (num_lines)
+  {
+    free(num_lines);
+  }
 
   /* close temp file and sort into index file */
 
   /* sort all tmp files and move to file (does an explicit fclose) */
-  if (!status || !sort_index_files(index_file_list))
+  if (!status ||
+      !finish_index_files(class, index_file_list, index_num_recs, &add_list))
   {
     /* back out */
     unlink_index_tmp_files(index_file_list);
@@ -706,25 +1435,6 @@ index_files(class, auth_area, index_file_list, data_file_list, validate_flag,
 
   /* update the data files and add the index file */
 
-  dl_list_first(index_file_list);
-  do
-  {
-    index_fp_file = dl_list_value(index_file_list);
-    index_file = build_tmp_base_file_struct(index_fp_file->real_filename,
-                                            NULL,
-                                            index_fp_file->type,
-                                            index_num_recs);
-    if (index_file)
-    {
-      index_file->base_filename
-        = generate_index_file_basename(index_file->type, class->db_dir,
-                                       index_fp_file->prefix);
-      index_file->filename = NULL;
-
-      dl_list_append(&add_list, index_file);
-    }
-  } while (dl_list_next(index_file_list));
-
   if (!hold_lock_flag)
   {
     copy_file_list(&unlock_list, data_file_list);
@@ -900,6 +1610,111 @@ index_files_by_suffix(class_name, auth_area_name, suffix, validate_flag)
   return(status);
 }
 
+
+int
+index_deleted_records(rec_list, timestamp, add_list)
+  dl_list_type  *rec_list;
+  char          *timestamp;
+  dl_list_type  *add_list;
+{
+  class_struct     *class;
+  auth_area_struct *auth_area;
+  attribute_struct *updated_attr;
+  record_struct    *rec;
+  dl_list_type     index_file_list;
+  index_struct     item;
+  long             num_recs         = 0;
+  int              not_done;
+
+  if (!rec_list || dl_list_empty(rec_list) || NOT_STR_EXISTS(timestamp) ||
+      !add_list)
+  {
+    log(L_LOG_ERR, MKDB, "index_deleted_records: null data detected");
+    return FALSE;
+  }
+
+  dl_list_first(rec_list);
+  rec       = dl_list_value(rec_list);
+  class     = rec->class;
+  auth_area = rec->auth_area;
+
+  /* no Updated attribute, no Updated index */
+  updated_attr = find_attribute_by_name(class, BC_UPDATED);
+  if (!updated_attr)
+  {
+    return TRUE;
+  }
+
+  dl_list_default(&index_file_list, FALSE, destroy_index_fp_data);
+  if (!build_index_list(class, auth_area, &index_file_list,
+                        class->db_dir, "delind"))
+  {
+    dl_list_destroy(&index_file_list);
+    return FALSE;
+  }
+
+  item.attribute_id = updated_attr->global_id;
+  item.deleted_flag = TRUE;
+  item.value        = timestamp;
+
+  not_done = dl_list_first(rec_list);
+  while (not_done)
+  {
+    rec = dl_list_value(rec_list);
+
+    item.offset       = rec->offset;
+    item.data_file_no = rec->data_file_no;
+
+    if (!write_typed_index_line(&index_file_list, MKDB_UPDATED_INDEX_FILE,
+                                &item))
+    {
+      unlink_index_tmp_files(&index_file_list);
+      dl_list_destroy(&index_file_list);
+      return FALSE;
+    }
+    num_recs++;
+
+    not_done = dl_list_next(rec_list);
+  }
+
+  if (!finish_index_files(class, &index_file_list, num_recs, add_list))
+  {
+    unlink_index_tmp_files(&index_file_list);
+    dl_list_destroy(&index_file_list);
+    return FALSE;
+  }
+
+  dl_list_destroy(&index_file_list);
+
+  return TRUE;
+}
+
+void
+set_binary_index_mode(val)
+  int val;
+{
+  binary_index_mode = val;
+}
+
+int
+get_binary_index_mode()
+{
+  return(binary_index_mode);
+}
+
+void
+set_index_workers(val)
+  int val;
+{
+  index_workers = val > 0 ? val : 1;
+}
+
+int
+get_index_workers()
+{
+  return(index_workers);
+}
+
 /* --------------- Destructor Components ------------ */
 
 int
@@ -913,7 +1728,7 @@ destroy_index_item(item)
 
   if (item->value)
   {
-    free(item->value);
+    arena_free(item->value);
   }
 
   free(item);
@@ -14,6 +14,13 @@
 #include "common.h"
 #include "mkdb_types.h"
 
+/* defines */
+
+/* the value of the lines at the head of an Updated index file that
+   say which data files it covers, one line per data file.  It sorts
+   before any real Updated value. */
+#define UPDATED_INDEX_COVER_VALUE   "0"
+
 /* prototypes */
 long index_data_file PROTO((class_struct *class,
                             auth_area_struct *auth_area,
@@ -22,6 +29,18 @@ long index_data_file PROTO((class_struct *class,
                             int validate_flag,
                             int *status));
 
+long index_record PROTO((record_struct    *rec,
+                         auth_area_struct *auth_area,
+                         dl_list_type     *files,
+                         int              *status));
+
+void index_data_file_coverage PROTO((class_struct *class,
+                                     file_struct  *data_file,
+                                     dl_list_type *files));
+
+/* decode_index_line: fills in 'item' from the index file line 'line'.
+   Its value comes from arena_xstrdup(), so give it back with
+   arena_free(). */
 int decode_index_line PROTO((char *line, index_struct *item));
 
 int encode_index_line PROTO((char *line, index_struct *item));
@@ -33,6 +52,15 @@ int index_files PROTO((class_struct     *class,
                        int              validate_flag,
                        int              hold_lock_flag));
 
+/* finish_index_files: sorts the temporary files in 'index_file_list'
+   into place and appends a file_struct for each (covering 'num_recs'
+   records) to 'add_list', ready for modify_file_list().  Returns FALSE
+   on error, leaving the caller to remove the temporary files. */
+int finish_index_files PROTO((class_struct *class,
+                              dl_list_type *index_file_list,
+                              long         num_recs,
+                              dl_list_type *add_list));
+
 int index_files_by_name PROTO((char *class_name,
                                char *auth_area_name,
                                char *base_dir,
@@ -45,6 +73,15 @@ int index_files_by_suffix PROTO((char *class_name,
                                  char *suffix,
                                  int  validate_flag));
 
+/* index_deleted_records: notes in a single new Updated index file
+   that the records in 'rec_list', all of one class and authority
+   area, were deleted at 'timestamp' (an Updated value).  The file is
+   appended to 'add_list', for the caller to add to the master file
+   list.  Returns FALSE on error. */
+int index_deleted_records PROTO((dl_list_type *rec_list,
+                                 char         *timestamp,
+                                 dl_list_type *add_list));
+
 int destroy_index_item PROTO((index_struct *item));
 
 char *soundex_index_to_var PROTO((char      *result,
@@ -54,4 +91,13 @@ int is_soundexable PROTO((char *str));
 
 int sort_index_files PROTO((dl_list_type *files));
 
+/* if set, index_files() writes exact indexes as binary index files */
+void set_binary_index_mode PROTO((int val));
+int  get_binary_index_mode PROTO((void));
+
+/* the number of processes index_files() uses to index data files; the
+   default is 1, which indexes them one at a time, in process */
+void set_index_workers PROTO((int val));
+int  get_index_workers PROTO((void));
+
 #endif /* _INDEX_H_ */
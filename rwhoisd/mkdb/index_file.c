@@ -9,10 +9,12 @@
 
 #include "index_file.h"
 
+#include "attributes.h"
 #include "defines.h"
 #include "fileinfo.h"
 #include "fileutils.h"
 #include "log.h"
+#include "main_config.h"
 #include "misc.h"
 
 /* ------------------- Private Functions -------------------- */
@@ -29,6 +31,12 @@ mkdb_ft_2_ft_templ(mkdb_type)
     return(INDEX_CIDR_FILE_TEMPL);
   case MKDB_SOUNDEX_INDEX_FILE:
     return(INDEX_SOUNDEX_FILE_TEMPL);
+  case MKDB_BINARY_INDEX_FILE:
+    return(INDEX_BINARY_FILE_TEMPL);
+  case MKDB_UPDATED_INDEX_FILE:
+    return(INDEX_UPDATED_FILE_TEMPL);
+  case MKDB_TRIGRAM_INDEX_FILE:
+    return(INDEX_TRIGRAM_FILE_TEMPL);
   default:
     return("");
   }
@@ -46,6 +54,12 @@ translate_type_to_str(mkdb_type)
     return("cidr");
   case MKDB_SOUNDEX_INDEX_FILE:
     return("soundex");
+  case MKDB_BINARY_INDEX_FILE:
+    return("binary");
+  case MKDB_UPDATED_INDEX_FILE:
+    return("updated");
+  case MKDB_TRIGRAM_INDEX_FILE:
+    return("trigram");
   default:
     return("");
   }
@@ -284,6 +298,27 @@ build_index_list(class, auth_area, index_file_list, base_dir, base_name)
     not_done = dl_list_next(attr_list);
   } /* while */
 
+  /* where substring searches are allowed, a class with anything
+     indexed also gets an index of the trigrams of its indexed
+     values */
+  if (get_query_allow_substr() && !dl_list_empty(index_file_list) &&
+      !does_index_type_exist(MKDB_TRIGRAM_INDEX_FILE, index_file_list))
+  {
+    index_file = create_index_fp(MKDB_TRIGRAM_INDEX_FILE, class, auth_area,
+                                 base_dir, base_name);
+    dl_list_append(index_file_list, index_file);
+  }
+
+  /* every class with an Updated attribute also gets an index of when
+     its records changed, whether or not Updated is itself indexed */
+  if (find_attribute_by_name(class, BC_UPDATED) &&
+      !does_index_type_exist(MKDB_UPDATED_INDEX_FILE, index_file_list))
+  {
+    index_file = create_index_fp(MKDB_UPDATED_INDEX_FILE, class, auth_area,
+                                 base_dir, base_name);
+    dl_list_append(index_file_list, index_file);
+  }
+
   /* if we didn't create anything return FALSE */
   if (dl_list_empty(index_file_list))
   {
@@ -0,0 +1,173 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "index_map.h"
+
+#include "defines.h"
+#include "dl_list.h"
+#include "log.h"
+#include "misc.h"
+
+#ifdef HAVE_MMAP
+
+/* local types */
+
+/* index_map_struct: a mapped index file, along with what we need to
+   tell if the file has since been replaced or changed size.  Index
+   lines changed in place (e.g., marked deleted) show up through the
+   mapping on their own. */
+typedef struct _index_map_struct
+{
+  char    *filename;
+  dev_t   dev;
+  ino_t   ino;
+  off_t   size;
+  time_t  mtime;
+  char    *map;
+} index_map_struct;
+
+/* local statics */
+
+static dl_list_type index_map_cache;
+static int          index_map_cache_init = FALSE;
+
+/* ------------------- Local Functions --------------------- */
+
+static int
+destroy_index_map_data(im)
+  index_map_struct *im;
+{
+  if (!im)
+  {
+    return TRUE;
+  }
+
+  if (im->map)
+  {
+    munmap(im->map, im->size);
+  }
+
+  if (im->filename)
+  {
+    free(im->filename);
+  }
+
+  free(im);
+
+  return TRUE;
+}
+
+#endif /* HAVE_MMAP */
+
+/* ------------------- Public Functions -------------------- */
+
+char *
+map_index_file(file, size)
+  file_struct *file;
+  off_t       *size;
+{
+#ifdef HAVE_MMAP
+  index_map_struct *im;
+  struct stat      sb;
+  int              fd;
+  int              not_done;
+  char             *map;
+
+  if (!file || !file->filename || !size)
+  {
+    return NULL;
+  }
+
+  if (!index_map_cache_init)
+  {
+    dl_list_default(&index_map_cache, FALSE, destroy_index_map_data);
+    index_map_cache_init = TRUE;
+  }
+
+  if (stat(file->filename, &sb) < 0)
+  {
+    return NULL;
+  }
+
+  not_done = dl_list_first(&index_map_cache);
+  while (not_done)
+  {
+    im = dl_list_value(&index_map_cache);
+    if (STR_EQ(im->filename, file->filename))
+    {
+      if (im->dev == sb.st_dev && im->ino == sb.st_ino &&
+          im->size == sb.st_size && im->mtime == sb.st_mtime)
+      {
+        *size = im->size;
+        return(im->map);
+      }
+
+      /* stale: unmap it and map the current file */
+      dl_list_delete(&index_map_cache);
+      break;
+    }
+    not_done = dl_list_next(&index_map_cache);
+  }
+
+  /* there's nothing to map in an empty file */
+  if (sb.st_size <= 0)
+  {
+    return NULL;
+  }
+
+  if ((fd = open(file->filename, O_RDONLY)) < 0)
+  {
+    return NULL;
+  }
+
+  /* use the size of what we actually opened */
+  if (fstat(fd, &sb) < 0 || sb.st_size <= 0)
+  {
+    close(fd);
+    return NULL;
+  }
+
+  map = mmap((void *) NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (map == (char *) MAP_FAILED)
+  {
+    log(L_LOG_WARNING, MKDB, "could not map index file '%s': %s",
+        file->filename, strerror(errno));
+    return NULL;
+  }
+
+  im           = xcalloc(1, sizeof(*im));
+  im->filename = xstrdup(file->filename);
+  im->dev      = sb.st_dev;
+  im->ino      = sb.st_ino;
+  im->size     = sb.st_size;
+  im->mtime    = sb.st_mtime;
+  im->map      = map;
+
+  dl_list_append(&index_map_cache, im);
+
+  *size = im->size;
+  return(map);
+#else
+  return NULL;
+#endif /* HAVE_MMAP */
+}
+
+void
+clear_index_map_cache()
+{
+#ifdef HAVE_MMAP
+  if (index_map_cache_init)
+  {
+    dl_list_destroy(&index_map_cache);
+    index_map_cache_init = FALSE;
+  }
+#endif /* HAVE_MMAP */
+}
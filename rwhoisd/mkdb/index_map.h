@@ -0,0 +1,30 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _INDEX_MAP_H_
+#define _INDEX_MAP_H_
+
+/* includes */
+
+#include "common.h"
+#include "mkdb_types.h"
+
+/* prototypes */
+
+/* map_index_file: returns a read only memory mapping of the whole of
+   the index file 'file', and sets 'size' to its length.  Each file is
+   mapped once and the mapping kept until the file changes on disk.
+   Returns NULL if the file could not be mapped (or mmap() is not
+   available), in which case the caller should read it normally. */
+char *map_index_file PROTO((file_struct *file, off_t *size));
+
+/* unmaps all of the cached index file mappings */
+void clear_index_map_cache PROTO((void));
+
+#endif /* _INDEX_MAP_H_ */
@@ -0,0 +1,598 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "index_merge.h"
+
+#include "arena.h"
+#include "binary_index.h"
+#include "defines.h"
+#include "fileinfo.h"
+#include "fileutils.h"
+#include "index.h"
+#include "index_file.h"
+#include "index_sort.h"
+#include "index_stats.h"
+#include "log.h"
+#include "misc.h"
+#include "tombstone.h"
+
+/* the merge lock, in the class's directory */
+#define MERGE_LOCK_NAME     ".merge.lock"
+
+/* the prefix of merged index file names */
+#define MERGE_BASE_NAME     "merge"
+
+/* the types of index file merged.  Binary index files are merged
+   along with the (text) exact index files, as they hold the same
+   thing. */
+static mkdb_file_type merge_types[] =
+{
+  MKDB_EXACT_INDEX_FILE,
+  MKDB_SOUNDEX_INDEX_FILE,
+  MKDB_CIDR_INDEX_FILE,
+  MKDB_UPDATED_INDEX_FILE,
+  MKDB_TRIGRAM_INDEX_FILE,
+  MKDB_NO_FILE
+};
+
+/* ------------------- Local Functions --------------------- */
+
+static int
+is_merge_type(type, merge_type)
+  mkdb_file_type type;
+  mkdb_file_type merge_type;
+{
+  return(type == merge_type ||
+         (merge_type == MKDB_EXACT_INDEX_FILE &&
+          type == MKDB_BINARY_INDEX_FILE));
+}
+
+static int
+compare_segment_size(a, b)
+  const void  *a;
+  const void  *b;
+{
+  file_struct *fa = *((file_struct **) a);
+  file_struct *fb = *((file_struct **) b);
+
+  if (fa->num_recs != fb->num_recs)
+  {
+    return((fa->num_recs < fb->num_recs) ? -1 : 1);
+  }
+
+  return(fa->file_no - fb->file_no);
+}
+
+/* get_segments: sets 'segments_p' to an array of the active index
+   files of 'merge_type' in 'file_list', smallest first, and returns
+   how many there are */
+static int
+get_segments(file_list, merge_type, segments_p)
+  dl_list_type   *file_list;
+  mkdb_file_type merge_type;
+  file_struct    ***segments_p;
+{
+  file_struct *file;
+  file_struct **segments    = NULL;
+  int         num_segments  = 0;
+  int         not_done;
+
+  not_done = dl_list_first(file_list);
+  while (not_done)
+  {
+    file = dl_list_value(file_list);
+
+    if (file->lock == MKDB_LOCK_OFF && is_merge_type(file->type, merge_type))
+    {
+      segments = xrealloc(segments, (num_segments + 1) * sizeof(*segments));
+      segments[num_segments++] = file;
+    }
+
+    not_done = dl_list_next(file_list);
+  }
+
+  if (num_segments > 1)
+  {
+    qsort(segments, num_segments, sizeof(*segments), compare_segment_size);
+  }
+
+  *segments_p = segments;
+  return(num_segments);
+}
+
+/* select_segments: returns how many of the (sorted) segments to
+   merge, which is zero if there are few enough of them already */
+static int
+select_segments(segments, num_segments)
+  file_struct **segments;
+  int         num_segments;
+{
+  long  num_recs  = 0;
+  int   n;
+
+  if (num_segments <= MAX_INDEX_SEGMENTS)
+  {
+    return(0);
+  }
+
+  /* enough of the smallest to leave half the limit ... */
+  for (n = 0; n <= num_segments - MAX_INDEX_SEGMENTS / 2; n++)
+  {
+    num_recs += segments[n]->num_recs;
+  }
+
+  /* ... and any others no bigger than those put together */
+  while (n < num_segments && segments[n]->num_recs <= num_recs)
+  {
+    num_recs += segments[n]->num_recs;
+    n++;
+  }
+
+  return(n);
+}
+
+/* get_merge_lock: takes the merge lock 'lockname', without waiting
+   for it.  Returns FALSE if another merge has it. */
+static int
+get_merge_lock(lockname)
+  char  *lockname;
+{
+  struct stat sb;
+  int         fd;
+  int         tries;
+
+  for (tries = 0; tries < 2; tries++)
+  {
+    if ((fd = open(lockname, O_WRONLY | O_CREAT | O_EXCL, 0644)) >= 0)
+    {
+      close(fd);
+      return TRUE;
+    }
+
+    if (errno != EEXIST)
+    {
+      log(L_LOG_ERR, MKDB, "could not create merge lock '%s': %s",
+          lockname, strerror(errno));
+      return FALSE;
+    }
+
+    if (stat(lockname, &sb) < 0 ||
+        time((time_t *) NULL) - sb.st_mtime < MERGE_LOCK_TIMEOUT)
+    {
+      return FALSE;
+    }
+
+    log(L_LOG_WARNING, MKDB, "breaking stale merge lock '%s'", lockname);
+    unlink(lockname);
+  }
+
+  return FALSE;
+}
+
+/* compare_record_position: orders index items by the record they
+   point at */
+static int
+compare_record_position(a, b)
+  const void  *a;
+  const void  *b;
+{
+  index_struct *ia = (index_struct *) a;
+  index_struct *ib = (index_struct *) b;
+
+  if (ia->data_file_no != ib->data_file_no)
+  {
+    return((ia->data_file_no < ib->data_file_no) ? -1 : 1);
+  }
+  if (ia->offset != ib->offset)
+  {
+    return((ia->offset < ib->offset) ? -1 : 1);
+  }
+
+  return(0);
+}
+
+/* count_records: returns the number of different records pointed at
+   by the 'num_items' items of 'items' (which are sorted) */
+static long
+count_records(items, num_items)
+  index_struct  *items;
+  long          num_items;
+{
+  long  num_recs  = 0;
+  long  i;
+
+  if (num_items > 1)
+  {
+    qsort(items, num_items, sizeof(index_struct), compare_record_position);
+  }
+
+  for (i = 0; i < num_items; i++)
+  {
+    if (i == 0 || compare_record_position(&items[i - 1], &items[i]) != 0)
+    {
+      num_recs++;
+    }
+  }
+
+  return(num_recs);
+}
+
+/* drop_tombstoned_entries: copies the index file 'in_file' to
+   'out_file', leaving out the entries of deleted records, which are
+   found in the data files in 'file_list'.  The number of records
+   whose entries were left out is put in 'num_recs_dropped'.  Returns
+   the number of entries left out, or -1 on error. */
+static long
+drop_tombstoned_entries(in_file, out_file, file_list, num_recs_dropped)
+  char          *in_file;
+  char          *out_file;
+  dl_list_type  *file_list;
+  long          *num_recs_dropped;
+{
+  FILE          *in_fp;
+  FILE          *out_fp;
+  file_struct   *data_file;
+  index_struct  item;
+  index_struct  *dropped     = NULL;
+  char          line[MAX_LINE * 2];
+  long          num_dropped = 0;
+  long          size        = 0;
+  int           deleted;
+
+  *num_recs_dropped = 0;
+
+  if ((in_fp = fopen(in_file, "r")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open index file '%s': %s", in_file,
+        strerror(errno));
+    return(-1);
+  }
+
+  if ((out_fp = fopen(out_file, "w")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not create index file '%s': %s", out_file,
+        strerror(errno));
+    fclose(in_fp);
+    return(-1);
+  }
+
+  while (fgets(line, sizeof(line), in_fp))
+  {
+    deleted = FALSE;
+
+    if (decode_index_line(line, &item))
+    {
+      data_file = find_file_by_id(file_list, item.data_file_no,
+                                  MKDB_DATA_FILE);
+      deleted = (data_file && is_tombstoned(data_file, item.offset));
+      arena_free(item.value);
+    }
+
+    if (deleted)
+    {
+      /* a record may have many entries; note which it was */
+      if (num_dropped == size)
+      {
+        size    = size ? size * 2 : 64;
+        dropped = xrealloc(dropped, size * sizeof(index_struct));
+      }
+      dropped[num_dropped].data_file_no = item.data_file_no;
+      dropped[num_dropped].offset       = item.offset;
+      num_dropped++;
+    }
+    else
+    {
+      fputs(line, out_fp);
+    }
+  }
+
+  fclose(in_fp);
+
+  if (dropped)
+  {
+    *num_recs_dropped = count_records(dropped, num_dropped);
+    free(dropped);
+  }
+
+  if (fclose(out_fp) != 0)
+  {
+    log(L_LOG_ERR, MKDB, "could not write index file '%s': %s", out_file,
+        strerror(errno));
+    return(-1);
+  }
+
+  return(num_dropped);
+}
+
+/* merge_segments: merges the index files 'segments' into the file
+   named by 'index_fp', and appends a file_struct for it to 'add_list'
+   and for each of the segments to 'delete_list'.  The entries of
+   records deleted from the data files in 'file_list' are dropped, and
+   the records are no longer counted in the merged file. */
+static int
+merge_segments(class, file_list, segments, num_segments, index_fp,
+               add_list, delete_list)
+  class_struct    *class;
+  dl_list_type    *file_list;
+  file_struct     **segments;
+  int             num_segments;
+  index_fp_struct *index_fp;
+  dl_list_type    *add_list;
+  dl_list_type    *delete_list;
+{
+  file_struct     *index_file;
+  index_stats_struct *stats     = NULL;
+  mkdb_file_type  type          = index_fp->type;
+  char            **in_files;
+  char            **text_files;
+  char            name[MAX_FILE];
+  long            num_recs      = 0;
+  long            num_dropped   = 0;
+  long            recs_dropped  = 0;
+  int             status        = TRUE;
+  int             i;
+
+  in_files   = xcalloc(num_segments, sizeof(char *));
+  text_files = xcalloc(num_segments, sizeof(char *));
+
+  for (i = 0; i < num_segments && status; i++)
+  {
+    num_recs += segments[i]->num_recs;
+
+    if (segments[i]->type != MKDB_BINARY_INDEX_FILE)
+    {
+      in_files[i] = segments[i]->filename;
+      continue;
+    }
+
+    /* binary index files are merged as text, and the merge of them is
+       itself binary */
+    type = MKDB_BINARY_INDEX_FILE;
+
+    sprintf(name, "%.*s.%d", MAX_FILE - 16, index_fp->tmp_filename, i);
+    text_files[i] = xstrdup(name);
+    in_files[i]   = text_files[i];
+
+    if (write_text_index_file(segments[i], text_files[i]) < 0)
+    {
+      status = FALSE;
+    }
+  }
+
+  if (status)
+  {
+    status = merge_index_file_list(in_files, num_segments,
+                                   index_fp->real_filename);
+  }
+
+  /* the Updated index keeps its deleted records' entries, as
+     incremental xfers need them */
+  if (status && type != MKDB_UPDATED_INDEX_FILE)
+  {
+    num_dropped = drop_tombstoned_entries(index_fp->real_filename,
+                                          index_fp->tmp_filename, file_list,
+                                          &recs_dropped);
+    if (num_dropped < 0)
+    {
+      status = FALSE;
+    }
+    else if (rename(index_fp->tmp_filename, index_fp->real_filename) < 0)
+    {
+      log(L_LOG_ERR, MKDB, "could not rename '%s' to '%s': %s",
+          index_fp->tmp_filename, index_fp->real_filename,
+          strerror(errno));
+      status = FALSE;
+    }
+
+    num_recs -= recs_dropped;
+  }
+
+  /* the statistics are read before any conversion to binary */
+  if (status)
+  {
+    stats = read_index_stats(index_fp->real_filename);
+  }
+
+  if (status && type == MKDB_BINARY_INDEX_FILE)
+  {
+    if (write_binary_index_file(index_fp->real_filename,
+                                index_fp->tmp_filename) < 0)
+    {
+      status = FALSE;
+    }
+    else if (rename(index_fp->tmp_filename, index_fp->real_filename) < 0)
+    {
+      log(L_LOG_ERR, MKDB, "could not rename '%s' to '%s': %s",
+          index_fp->tmp_filename, index_fp->real_filename,
+          strerror(errno));
+      status = FALSE;
+    }
+  }
+
+  for (i = 0; i < num_segments; i++)
+  {
+    if (text_files[i])
+    {
+      unlink(text_files[i]);
+      free(text_files[i]);
+    }
+  }
+  free(text_files);
+  free(in_files);
+
+  if (status)
+  {
+    index_file = build_tmp_base_file_struct(index_fp->real_filename, NULL,
+                                            type, num_recs);
+    status = (index_file != NULL);
+  }
+
+  if (!status)
+  {
+    destroy_index_stats(stats);
+    unlink(index_fp->real_filename);
+    unlink(index_fp->tmp_filename);
+    log(L_LOG_ERR, MKDB, "could not merge index files in '%s'",
+        class->db_dir);
+    return FALSE;
+  }
+
+  index_file->base_filename
+    = generate_index_file_basename(type, class->db_dir, index_fp->prefix);
+  index_file->stats = stats;
+  dl_list_append(add_list, index_file);
+
+  for (i = 0; i < num_segments; i++)
+  {
+    dl_list_append(delete_list, copy_file_struct(segments[i]));
+  }
+
+  log(L_LOG_INFO, MKDB,
+      "merged %d index files (%ld records, %ld deleted entries dropped) in '%s'",
+      num_segments, num_recs, num_dropped, class->db_dir);
+
+  return TRUE;
+}
+
+/* ------------------- Public Functions -------------------- */
+
+int
+index_segments_over_limit(class, auth_area)
+  class_struct     *class;
+  auth_area_struct *auth_area;
+{
+  dl_list_type  file_list;
+  file_struct   **segments;
+  int           over        = FALSE;
+  int           i;
+
+  if (!class || !auth_area)
+  {
+    return FALSE;
+  }
+
+  dl_list_default(&file_list, FALSE, destroy_file_struct_data);
+
+  if (!get_file_list(class, auth_area, &file_list))
+  {
+    dl_list_destroy(&file_list);
+    return FALSE;
+  }
+
+  for (i = 0; merge_types[i] != MKDB_NO_FILE && !over; i++)
+  {
+    over = (get_segments(&file_list, merge_types[i], &segments) >
+            MAX_INDEX_SEGMENTS);
+
+    if (segments)
+    {
+      free(segments);
+    }
+  }
+
+  dl_list_destroy(&file_list);
+
+  return(over);
+}
+
+
+int
+merge_index_segments(class, auth_area)
+  class_struct     *class;
+  auth_area_struct *auth_area;
+{
+  dl_list_type    file_list;
+  dl_list_type    index_fp_list;
+  dl_list_type    add_list;
+  dl_list_type    delete_list;
+  index_fp_struct *index_fp;
+  file_struct     **segments;
+  file_struct     *file;
+  char            lockname[MAX_FILE];
+  int             num_segments;
+  int             num_merge;
+  int             status        = TRUE;
+  int             not_done;
+  int             i;
+
+  if (!class || !auth_area)
+  {
+    log(L_LOG_ERR, MKDB, "merge_index_segments: null data detected");
+    return FALSE;
+  }
+
+  path_rel_to_full(lockname, MAX_FILE, MERGE_LOCK_NAME, class->db_dir);
+  if (!get_merge_lock(lockname))
+  {
+    return TRUE;
+  }
+
+  dl_list_default(&file_list, FALSE, destroy_file_struct_data);
+  dl_list_default(&index_fp_list, FALSE, destroy_index_fp_data);
+  dl_list_default(&add_list, FALSE, destroy_file_struct_data);
+  dl_list_default(&delete_list, FALSE, destroy_file_struct_data);
+
+  if (!get_file_list(class, auth_area, &file_list) ||
+      !build_index_list(class, auth_area, &index_fp_list, class->db_dir,
+                        MERGE_BASE_NAME))
+  {
+    status = FALSE;
+  }
+
+  for (i = 0; status && merge_types[i] != MKDB_NO_FILE; i++)
+  {
+    num_segments = get_segments(&file_list, merge_types[i], &segments);
+    num_merge    = select_segments(segments, num_segments);
+
+    if (num_merge > 1 &&
+        (index_fp = find_index_file_by_type(&index_fp_list,
+                                            merge_types[i])) != NULL)
+    {
+      status = merge_segments(class, &file_list, segments, num_merge,
+                              index_fp, &add_list, &delete_list);
+    }
+
+    if (segments)
+    {
+      free(segments);
+    }
+  }
+
+  /* swap the merged files in for their segments all at once */
+  if (status && !dl_list_empty(&add_list))
+  {
+    status = modify_file_list(class, auth_area, &add_list, &delete_list,
+                              NULL, &add_list, NULL);
+    if (status)
+    {
+      sleep(MERGE_DELETE_WAIT);
+      unlink_file_list(&delete_list);
+    }
+  }
+
+  if (!status && !dl_list_empty(&add_list))
+  {
+    not_done = dl_list_first(&add_list);
+    while (not_done)
+    {
+      file = dl_list_value(&add_list);
+      unlink(file->tmp_filename);
+      not_done = dl_list_next(&add_list);
+    }
+  }
+
+  dl_list_destroy(&file_list);
+  dl_list_destroy(&index_fp_list);
+  dl_list_destroy(&add_list);
+  dl_list_destroy(&delete_list);
+
+  unlink(lockname);
+
+  return(status);
+}
@@ -0,0 +1,52 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _INDEX_MERGE_H_
+#define _INDEX_MERGE_H_
+
+/* includes */
+
+#include "common.h"
+#include "mkdb_types.h"
+#include "types.h"
+
+/* defines */
+
+/* the most index files of one type a class may have in an authority
+   area before they are merged.  Each -register adds a small one. */
+#define MAX_INDEX_SEGMENTS  8
+
+/* a merge lock older than this (in seconds) was left by a merge that
+   died, and is broken */
+#define MERGE_LOCK_TIMEOUT  600
+
+/* number of seconds to wait between removing merged index files from
+   the master file list and actually deleting them, for searches that
+   have just read the old list */
+#define MERGE_DELETE_WAIT   2
+
+/* prototypes */
+
+/* index_segments_over_limit: returns TRUE if 'class' in 'auth_area'
+   has more than MAX_INDEX_SEGMENTS index files of any one type */
+int index_segments_over_limit PROTO((class_struct     *class,
+                                     auth_area_struct *auth_area));
+
+/* merge_index_segments: merges the smallest index files of each type
+   of 'class' in 'auth_area' into one, for each type with more than
+   MAX_INDEX_SEGMENTS of them.  Enough are merged to leave at most
+   half that many, along with any others no larger than the merged
+   ones put together, so the sizes of the index files grow
+   geometrically and the biggest are seldom rewritten.  Does nothing
+   if another merge of the class is in progress.  Returns FALSE on
+   error. */
+int merge_index_segments PROTO((class_struct     *class,
+                                auth_area_struct *auth_area));
+
+#endif /* _INDEX_MERGE_H_ */
@@ -0,0 +1,795 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "index_sort.h"
+
+#include "defines.h"
+#include "log.h"
+#include "misc.h"
+
+/* the longest index line we can merge */
+#define MAX_SORT_LINE       (MAX_LINE * 4)
+
+/* local types */
+
+/* sort_file_struct: an index file being sorted, and the runs it was
+   split into.  A file that fits in one run is sorted straight into
+   'out_file', and has no run files. */
+typedef struct _sort_file_struct
+{
+  char  *in_file;
+  char  *out_file;
+  int   num_runs;
+  int   next_run;
+  char  **run_files;
+} sort_file_struct;
+
+typedef enum
+{
+  SORT_RUN_TASK,
+  SORT_MERGE_TASK
+} sort_task_type;
+
+/* sort_task_struct: one piece of work for a sort process: either
+   sorting the lines of 'file' between 'start' and 'end' into
+   'out_file', or merging all of the runs of 'file' */
+typedef struct _sort_task_struct
+{
+  sort_task_type    type;
+  sort_file_struct  *file;
+  off_t             start;
+  off_t             end;
+  char              *out_file;
+  pid_t             pid;
+} sort_task_struct;
+
+/* sort_line_struct: an index line, and where its keys are */
+typedef struct _sort_line_struct
+{
+  char  *line;
+  char  *value;
+  int   attribute_id;
+} sort_line_struct;
+
+/* merge_run_struct: a run being merged, and its current line */
+typedef struct _merge_run_struct
+{
+  FILE              *fp;
+  char              *filename;
+  char              *buf;
+  sort_line_struct  line;
+} merge_run_struct;
+
+/* local statics */
+
+static int sort_workers = 0;
+
+/* ------------------- Local Functions --------------------- */
+
+/* parse_sort_line: finds the keys of an index line
+   (offset:file_no:deleted:attr_id:value).  A line without all of its
+   fields sorts as if the missing ones were empty. */
+static void
+parse_sort_line(sl, line)
+  sort_line_struct  *sl;
+  char              *line;
+{
+  char  *p = line;
+  int   i;
+
+  sl->line = line;
+
+  for (i = 0; i < 3 && p; i++)
+  {
+    if ((p = strchr(p, ':')) != NULL)
+    {
+      p++;
+    }
+  }
+
+  sl->attribute_id = p ? atoi(p) : 0;
+
+  if (p && (p = strchr(p, ':')) != NULL)
+  {
+    sl->value = p + 1;
+  }
+  else
+  {
+    sl->value = line + strlen(line);
+  }
+}
+
+static int
+compare_sort_lines(a, b)
+  sort_line_struct  *a;
+  sort_line_struct  *b;
+{
+  int   r;
+
+  if ((r = strcmp(a->value, b->value)) != 0)
+  {
+    return(r);
+  }
+
+  if (a->attribute_id != b->attribute_id)
+  {
+    return((a->attribute_id < b->attribute_id) ? -1 : 1);
+  }
+
+  return(strcmp(a->line, b->line));
+}
+
+static int
+qsort_compare_lines(a, b)
+  const void  *a;
+  const void  *b;
+{
+  return(compare_sort_lines((sort_line_struct *) a, (sort_line_struct *) b));
+}
+
+/* sort_run: reads the lines of one run into memory, sorts them, and
+   writes them out */
+static int
+sort_run(task)
+  sort_task_struct  *task;
+{
+  FILE              *fp;
+  char              *buf;
+  char              *p;
+  char              *nl;
+  sort_line_struct  *lines;
+  size_t            len        = task->end - task->start;
+  long              num_lines  = 0;
+  long              max_lines  = 1;
+  long              i;
+  int               status     = TRUE;
+
+  if ((fp = fopen(task->file->in_file, "r")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open file '%s': %s",
+        task->file->in_file, strerror(errno));
+    return FALSE;
+  }
+
+  buf = xcalloc(1, len + 1);
+
+  if (fseek(fp, task->start, SEEK_SET) ||
+      fread(buf, 1, len, fp) != len)
+  {
+    log(L_LOG_ERR, MKDB, "could not read file '%s': %s",
+        task->file->in_file, strerror(errno));
+    fclose(fp);
+    free(buf);
+    return FALSE;
+  }
+  fclose(fp);
+
+  for (p = buf; p < buf + len; p++)
+  {
+    if (*p == '\n')
+    {
+      max_lines++;
+    }
+  }
+
+  lines = xcalloc(max_lines, sizeof(*lines));
+
+  for (p = buf; p < buf + len; p = nl + 1)
+  {
+    if ((nl = memchr(p, '\n', buf + len - p)) == NULL)
+    {
+      /* the last line had no newline; buf[len] is already a NUL */
+      nl = buf + len;
+    }
+    *nl = '\0';
+
+    parse_sort_line(&lines[num_lines++], p);
+  }
+
+  qsort(lines, num_lines, sizeof(*lines), qsort_compare_lines);
+
+  if ((fp = fopen(task->out_file, "w")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open file '%s': %s", task->out_file,
+        strerror(errno));
+    free(lines);
+    free(buf);
+    return FALSE;
+  }
+
+  for (i = 0; i < num_lines; i++)
+  {
+    fputs(lines[i].line, fp);
+    putc('\n', fp);
+  }
+
+  if (ferror(fp) | fclose(fp))
+  {
+    log(L_LOG_ERR, MKDB, "could not write file '%s': %s", task->out_file,
+        strerror(errno));
+    unlink(task->out_file);
+    status = FALSE;
+  }
+
+  free(lines);
+  free(buf);
+
+  return(status);
+}
+
+/* read_merge_line: reads the next line of a run.  Returns 1 if there
+   was one, 0 at the end of the run, and -1 on error. */
+static int
+read_merge_line(run)
+  merge_run_struct  *run;
+{
+  char  *nl;
+
+  if (!fgets(run->buf, MAX_SORT_LINE, run->fp))
+  {
+    return(ferror(run->fp) ? -1 : 0);
+  }
+
+  if ((nl = strchr(run->buf, '\n')) != NULL)
+  {
+    *nl = '\0';
+  }
+  else if (!feof(run->fp))
+  {
+    log(L_LOG_ERR, MKDB, "index line too long in '%s'", run->filename);
+    return(-1);
+  }
+
+  parse_sort_line(&(run->line), run->buf);
+
+  return(1);
+}
+
+/* heap_sift_down: restores the heap order of 'heap' below 'i' */
+static void
+heap_sift_down(heap, size, i)
+  merge_run_struct  **heap;
+  int               size;
+  int               i;
+{
+  merge_run_struct  *tmp;
+  int               child;
+
+  while ((child = 2 * i + 1) < size)
+  {
+    if (child + 1 < size &&
+        compare_sort_lines(&(heap[child + 1]->line),
+                           &(heap[child]->line)) < 0)
+    {
+      child++;
+    }
+
+    if (compare_sort_lines(&(heap[i]->line), &(heap[child]->line)) <= 0)
+    {
+      break;
+    }
+
+    tmp         = heap[i];
+    heap[i]     = heap[child];
+    heap[child] = tmp;
+    i           = child;
+  }
+}
+
+/* merge_runs: merges the sorted runs 'run_files' into 'out_file',
+   with a heap of the current line of each run */
+static int
+merge_runs(run_files, num_runs, out_file)
+  char  **run_files;
+  int   num_runs;
+  char  *out_file;
+{
+  FILE              *out;
+  merge_run_struct  *runs;
+  merge_run_struct  **heap;
+  merge_run_struct  *top;
+  int               heap_size  = 0;
+  int               status     = TRUE;
+  int               r;
+  int               i;
+
+  runs = xcalloc(num_runs, sizeof(*runs));
+  heap = xcalloc(num_runs, sizeof(*heap));
+
+  for (i = 0; i < num_runs && status; i++)
+  {
+    runs[i].filename = run_files[i];
+    if ((runs[i].fp = fopen(run_files[i], "r")) == NULL)
+    {
+      log(L_LOG_ERR, MKDB, "could not open file '%s': %s", run_files[i],
+          strerror(errno));
+      status = FALSE;
+      break;
+    }
+    runs[i].buf = xcalloc(1, MAX_SORT_LINE);
+
+    if ((r = read_merge_line(&runs[i])) < 0)
+    {
+      status = FALSE;
+    }
+    else if (r > 0)
+    {
+      heap[heap_size++] = &runs[i];
+    }
+  }
+
+  out = NULL;
+  if (status && (out = fopen(out_file, "w")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open file '%s': %s", out_file,
+        strerror(errno));
+    status = FALSE;
+  }
+
+  if (status)
+  {
+    for (i = heap_size / 2 - 1; i >= 0; i--)
+    {
+      heap_sift_down(heap, heap_size, i);
+    }
+
+    while (heap_size > 0)
+    {
+      top = heap[0];
+      fputs(top->line.line, out);
+      putc('\n', out);
+
+      if ((r = read_merge_line(top)) < 0)
+      {
+        status = FALSE;
+        break;
+      }
+      if (r == 0)
+      {
+        heap[0] = heap[--heap_size];
+      }
+      heap_sift_down(heap, heap_size, 0);
+    }
+  }
+
+  if (out && (ferror(out) | fclose(out)))
+  {
+    log(L_LOG_ERR, MKDB, "could not write file '%s': %s", out_file,
+        strerror(errno));
+    status = FALSE;
+  }
+  if (out && !status)
+  {
+    unlink(out_file);
+  }
+
+  for (i = 0; i < num_runs; i++)
+  {
+    if (runs[i].fp)
+    {
+      fclose(runs[i].fp);
+    }
+    if (runs[i].buf)
+    {
+      free(runs[i].buf);
+    }
+  }
+  free(runs);
+  free(heap);
+
+  return(status);
+}
+
+static char *
+new_run_filename(file)
+  sort_file_struct  *file;
+{
+  char  name[MAX_FILE];
+
+  sprintf(name, "%.*s.run%d", MAX_FILE - 16, file->in_file,
+          file->next_run++);
+
+  return(xstrdup(name));
+}
+
+/* merge_file: merges all of the runs of 'file' into its output file,
+   first in passes of MAX_MERGE_RUNS if there are too many to merge at
+   once.  The runs are removed as they are used. */
+static int
+merge_file(file)
+  sort_file_struct  *file;
+{
+  char  *name;
+  int   status;
+  int   i;
+
+  while (file->num_runs > MAX_MERGE_RUNS)
+  {
+    name = new_run_filename(file);
+    if (!merge_runs(file->run_files, MAX_MERGE_RUNS, name))
+    {
+      free(name);
+      return FALSE;
+    }
+
+    for (i = 0; i < MAX_MERGE_RUNS; i++)
+    {
+      unlink(file->run_files[i]);
+      free(file->run_files[i]);
+    }
+    file->num_runs -= MAX_MERGE_RUNS;
+    bcopy(file->run_files + MAX_MERGE_RUNS, file->run_files,
+          file->num_runs * sizeof(char *));
+    file->run_files[file->num_runs++] = name;
+  }
+
+  status = merge_runs(file->run_files, file->num_runs, file->out_file);
+
+  for (i = 0; i < file->num_runs; i++)
+  {
+    unlink(file->run_files[i]);
+  }
+
+  return(status);
+}
+
+static int
+do_sort_task(task)
+  sort_task_struct  *task;
+{
+  if (task->type == SORT_RUN_TASK)
+  {
+    return(sort_run(task));
+  }
+
+  return(merge_file(task->file));
+}
+
+/* run_sort_tasks: does all of the tasks, in up to 'workers' child
+   processes at once.  Returns FALSE if any of them failed. */
+static int
+run_sort_tasks(tasks, num_tasks, workers)
+  sort_task_struct  *tasks;
+  int               num_tasks;
+  int               workers;
+{
+  pid_t pid;
+  int   proc_stat;
+  int   running = 0;
+  int   next    = 0;
+  int   status  = TRUE;
+  int   i;
+
+  if (workers <= 1 || num_tasks <= 1)
+  {
+    for (i = 0; i < num_tasks && status; i++)
+    {
+      status = do_sort_task(&tasks[i]);
+    }
+    return(status);
+  }
+
+  while (running > 0 || (status && next < num_tasks))
+  {
+    if (status && next < num_tasks && running < workers)
+    {
+      pid = fork();
+      if (pid == 0)
+      {
+        i = do_sort_task(&tasks[next]);
+        flush_log_files();
+        _exit(i ? 0 : 1);
+      }
+
+      if (pid < 0)
+      {
+        log(L_LOG_WARNING, MKDB, "fork failed: %s; sorting in process",
+            strerror(errno));
+        status = do_sort_task(&tasks[next]);
+      }
+      else
+      {
+        tasks[next].pid = pid;
+        running++;
+      }
+      next++;
+      continue;
+    }
+
+    if ((pid = wait(&proc_stat)) < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      log(L_LOG_ERR, MKDB, "wait failed: %s", strerror(errno));
+      return FALSE;
+    }
+
+    for (i = 0; i < next; i++)
+    {
+      if (tasks[i].pid == pid)
+      {
+        break;
+      }
+    }
+    if (i == next)
+    {
+      /* not one of ours */
+      continue;
+    }
+
+    tasks[i].pid = 0;
+    running--;
+
+    if (!WIFEXITED(proc_stat) || WEXITSTATUS(proc_stat) != 0)
+    {
+      status = FALSE;
+    }
+  }
+
+  return(status);
+}
+
+/* split_sort_file: adds the run tasks for 'file' to 'tasks', splitting
+   it at line boundaries into pieces of about SORT_RUN_SIZE */
+static int
+split_sort_file(file, tasks, num_tasks)
+  sort_file_struct  *file;
+  sort_task_struct  **tasks;
+  int               *num_tasks;
+{
+  FILE              *fp;
+  struct stat       sb;
+  sort_task_struct  *task;
+  off_t             start = 0;
+  off_t             end;
+  int               c;
+
+  if ((fp = fopen(file->in_file, "r")) == NULL || fstat(fileno(fp), &sb))
+  {
+    log(L_LOG_ERR, MKDB, "could not open file '%s': %s", file->in_file,
+        strerror(errno));
+    if (fp)
+    {
+      fclose(fp);
+    }
+    return FALSE;
+  }
+
+  do
+  {
+    end = start + SORT_RUN_SIZE;
+    if (end >= sb.st_size)
+    {
+      end = sb.st_size;
+    }
+    else
+    {
+      /* move up to the start of the next line */
+      fseek(fp, end, SEEK_SET);
+      while ((c = getc(fp)) != EOF && c != '\n')
+        ;
+      end = (c == EOF) ? sb.st_size : ftell(fp);
+    }
+
+    *tasks = xrealloc(*tasks, (*num_tasks + 1) * sizeof(**tasks));
+    task   = &((*tasks)[(*num_tasks)++]);
+    bzero(task, sizeof(*task));
+
+    task->type  = SORT_RUN_TASK;
+    task->file  = file;
+    task->start = start;
+    task->end   = end;
+
+    file->run_files = xrealloc(file->run_files,
+                               (file->num_runs + 1) * sizeof(char *));
+    file->run_files[file->num_runs++] = new_run_filename(file);
+
+    start = end;
+  } while (start < sb.st_size);
+
+  fclose(fp);
+
+  return TRUE;
+}
+
+static int
+get_num_sort_workers()
+{
+  if (sort_workers > 0)
+  {
+    return(sort_workers);
+  }
+
+#ifdef _SC_NPROCESSORS_ONLN
+  if (sysconf(_SC_NPROCESSORS_ONLN) > 1)
+  {
+    return((int) sysconf(_SC_NPROCESSORS_ONLN));
+  }
+#endif
+
+  return(1);
+}
+
+/* ------------------- Public Functions -------------------- */
+
+int
+sort_index_file_list(in_files, out_files, num_files)
+  char  **in_files;
+  char  **out_files;
+  int   num_files;
+{
+  sort_file_struct  *files;
+  sort_task_struct  *tasks      = NULL;
+  int               num_tasks   = 0;
+  int               status      = TRUE;
+  int               first_task;
+  int               i;
+  int               j;
+  RETSIGTYPE        (*old_handler)();
+
+  if (num_files <= 0)
+  {
+    return TRUE;
+  }
+
+  files = xcalloc(num_files, sizeof(*files));
+
+  /* split each file into runs */
+  for (i = 0; i < num_files && status; i++)
+  {
+    files[i].in_file  = in_files[i];
+    files[i].out_file = out_files[i];
+
+    first_task = num_tasks;
+    status = split_sort_file(&files[i], &tasks, &num_tasks);
+
+    /* if it fit in one run, there is nothing to merge */
+    if (status && files[i].num_runs == 1)
+    {
+      tasks[first_task].out_file = files[i].out_file;
+      free(files[i].run_files[0]);
+      files[i].num_runs = 0;
+    }
+    else
+    {
+      for (j = first_task; j < num_tasks; j++)
+      {
+        tasks[j].out_file = files[i].run_files[j - first_task];
+      }
+    }
+  }
+
+  /* we have to be able to wait() for our own children */
+  old_handler = signal(SIGCHLD, SIG_DFL);
+
+  /* sort every run of every file ... */
+  if (status)
+  {
+    status = run_sort_tasks(tasks, num_tasks, get_num_sort_workers());
+  }
+
+  /* ... then merge the runs of every file that had more than one */
+  if (status)
+  {
+    num_tasks = 0;
+    for (i = 0; i < num_files; i++)
+    {
+      if (files[i].num_runs > 0)
+      {
+        bzero(&tasks[num_tasks], sizeof(*tasks));
+        tasks[num_tasks].type = SORT_MERGE_TASK;
+        tasks[num_tasks].file = &files[i];
+        num_tasks++;
+      }
+    }
+
+    status = run_sort_tasks(tasks, num_tasks, get_num_sort_workers());
+  }
+
+  signal(SIGCHLD, old_handler);
+
+  /* clean up; on success the runs are already gone */
+  for (i = 0; i < num_files; i++)
+  {
+    for (j = 0; j < files[i].num_runs; j++)
+    {
+      if (!status)
+      {
+        unlink(files[i].run_files[j]);
+      }
+      free(files[i].run_files[j]);
+    }
+    if (files[i].run_files)
+    {
+      free(files[i].run_files);
+    }
+  }
+
+  if (tasks)
+  {
+    free(tasks);
+  }
+  free(files);
+
+  return(status);
+}
+
+int
+merge_index_file_list(in_files, num_files, out_file)
+  char  **in_files;
+  int   num_files;
+  char  *out_file;
+{
+  sort_file_struct  file;
+  int               status     = TRUE;
+  int               n;
+  int               i;
+
+  if (num_files <= MAX_MERGE_RUNS)
+  {
+    return(merge_runs(in_files, num_files, out_file));
+  }
+
+  /* merge the inputs in groups into runs of our own, which (unlike
+     the inputs) merge_file() is free to remove */
+  bzero(&file, sizeof(file));
+  file.in_file   = out_file;
+  file.out_file  = out_file;
+  file.run_files = xcalloc(num_files / MAX_MERGE_RUNS + 1, sizeof(char *));
+
+  for (i = 0; i < num_files && status; i += n)
+  {
+    n = num_files - i;
+    if (n > MAX_MERGE_RUNS)
+    {
+      n = MAX_MERGE_RUNS;
+    }
+
+    file.run_files[file.num_runs] = new_run_filename(&file);
+    status = merge_runs(in_files + i, n, file.run_files[file.num_runs]);
+    file.num_runs++;
+  }
+
+  if (status)
+  {
+    status = merge_file(&file);
+  }
+
+  for (i = 0; i < file.num_runs; i++)
+  {
+    if (!status)
+    {
+      unlink(file.run_files[i]);
+    }
+    free(file.run_files[i]);
+  }
+  free(file.run_files);
+
+  return(status);
+}
+
+void
+set_sort_workers(val)
+  int val;
+{
+  if (val < 0)
+  {
+    val = 0;
+  }
+
+  sort_workers = val;
+}
+
+int
+get_sort_workers()
+{
+  return(sort_workers);
+}
@@ -0,0 +1,54 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _INDEX_SORT_H_
+#define _INDEX_SORT_H_
+
+/* includes */
+
+#include "common.h"
+#include "mkdb_types.h"
+
+/* defines */
+
+/* the most index data (in bytes) a sort process holds in memory at
+   once; larger index files are sorted in runs of about this size and
+   then merged */
+#define SORT_RUN_SIZE       (8 * 1024 * 1024)
+
+/* the most runs merged in a single pass */
+#define MAX_MERGE_RUNS      64
+
+/* prototypes */
+
+/* sort_index_file_list: sorts each of the 'num_files' index files
+   'in_files' into the corresponding 'out_files'.  Lines are ordered
+   by value, then attribute id, then the whole line, all by byte value
+   (as 'sort -k 5,5 -k 4,4n -t :' would in the C locale, except that
+   the whole value is the key, even if it contains a ':').  All of the
+   files are sorted together by up to get_sort_workers() processes.
+   The input files are left alone.  Returns FALSE on error. */
+int sort_index_file_list PROTO((char **in_files,
+                                char **out_files,
+                                int  num_files));
+
+/* merge_index_file_list: merges the 'num_files' sorted index files
+   'in_files' into the one sorted index file 'out_file', in the order
+   sort_index_file_list() sorts them.  The input files are left alone.
+   Returns FALSE on error. */
+int merge_index_file_list PROTO((char **in_files,
+                                 int  num_files,
+                                 char *out_file));
+
+/* the number of processes used to sort; 0 (the default) means one
+   per processor */
+void set_sort_workers PROTO((int val));
+int  get_sort_workers PROTO((void));
+
+#endif /* _INDEX_SORT_H_ */
@@ -0,0 +1,245 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "index_stats.h"
+
+#include "arena.h"
+#include "defines.h"
+#include "index.h"
+#include "log.h"
+#include "misc.h"
+
+/* ------------------- Local Functions --------------------- */
+
+/* sample_index_keys: fills in the key samples of 'stats', whose entry
+   count is known, from the index file 'fp' */
+static void
+sample_index_keys(fp, stats)
+  FILE                *fp;
+  index_stats_struct  *stats;
+{
+  index_struct  item;
+  char          line[MAX_LINE];
+  long          n               = 0;
+  long          next;
+
+  next = stats->num_entries / (INDEX_STATS_SAMPLES + 1);
+
+  while (stats->num_samples < INDEX_STATS_SAMPLES &&
+         readline(fp, line, MAX_LINE))
+  {
+    if (!decode_index_line(line, &item))
+    {
+      continue;
+    }
+
+    if (n++ >= next)
+    {
+      stats->samples[stats->num_samples++] = item.value;
+      next = (stats->num_samples + 1) * stats->num_entries /
+        (INDEX_STATS_SAMPLES + 1);
+    }
+    else
+    {
+      free(item.value);
+    }
+  }
+}
+
+/* ------------------- Public Functions -------------------- */
+
+index_stats_struct *
+read_index_stats(filename)
+  char  *filename;
+{
+  index_stats_struct  *stats;
+  index_struct        item;
+  arena_type          *old_arena;
+  char                line[MAX_LINE];
+  FILE                *fp;
+
+  if ((fp = fopen(filename, "r")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open index file '%s': %s",
+        filename, strerror(errno));
+    return NULL;
+  }
+
+  /* the keys kept outlive any arena */
+  old_arena = arena_bind(NULL);
+
+  stats = xcalloc(1, sizeof(*stats));
+
+  while (readline(fp, line, MAX_LINE))
+  {
+    if (!decode_index_line(line, &item))
+    {
+      continue;
+    }
+
+    stats->num_entries++;
+
+    /* the file is sorted, so equal keys are together */
+    if (!stats->max_key || strcmp(stats->max_key, item.value))
+    {
+      stats->num_keys++;
+      if (!stats->min_key)
+      {
+        stats->min_key = xstrdup(item.value);
+      }
+      if (stats->max_key)
+      {
+        free(stats->max_key);
+      }
+      stats->max_key = item.value;
+    }
+    else
+    {
+      free(item.value);
+    }
+  }
+
+  if (stats->num_entries == 0)
+  {
+    fclose(fp);
+    destroy_index_stats(stats);
+    arena_bind(old_arena);
+    return NULL;
+  }
+
+  rewind(fp);
+  sample_index_keys(fp, stats);
+
+  fclose(fp);
+  arena_bind(old_arena);
+
+  return(stats);
+}
+
+index_stats_struct *
+copy_index_stats(stats)
+  index_stats_struct  *stats;
+{
+  index_stats_struct  *copy;
+  int                 i;
+
+  if (!stats)
+  {
+    return NULL;
+  }
+
+  copy = xcalloc(1, sizeof(*copy));
+
+  copy->num_entries = stats->num_entries;
+  copy->num_keys    = stats->num_keys;
+  copy->num_samples = stats->num_samples;
+
+  if (stats->min_key)
+  {
+    copy->min_key = xstrdup(stats->min_key);
+  }
+  if (stats->max_key)
+  {
+    copy->max_key = xstrdup(stats->max_key);
+  }
+  for (i = 0; i < stats->num_samples; i++)
+  {
+    copy->samples[i] = xstrdup(stats->samples[i]);
+  }
+
+  return(copy);
+}
+
+long
+estimate_index_hits(file, query_item)
+  file_struct       *file;
+  query_term_struct *query_item;
+{
+  index_stats_struct  *stats = file->stats;
+  char                *value = query_item->search_value;
+  long                per_key;
+  long                est;
+  int                 len;
+  int                 n;
+  int                 i;
+
+  if (!stats || !stats->min_key || !stats->max_key || !value ||
+      stats->num_keys <= 0)
+  {
+    return(-1);
+  }
+
+  /* the average number of entries with the same key */
+  per_key = (stats->num_entries + stats->num_keys - 1) / stats->num_keys;
+
+  switch (query_item->comp_type)
+  {
+  case MKDB_FULL_COMPARE:
+    if (strcmp(value, stats->min_key) < 0 ||
+        strcmp(value, stats->max_key) > 0)
+    {
+      return(0);
+    }
+    return(per_key);
+  case MKDB_PARTIAL_COMPARE:
+    len = strlen(value);
+    if (strncmp(value, stats->min_key, len) < 0 ||
+        strncmp(value, stats->max_key, len) > 0)
+    {
+      return(0);
+    }
+
+    /* each sample stands for an even share of the entries; a prefix
+       that no sample has gets half a share */
+    for (i = 0, n = 0; i < stats->num_samples; i++)
+    {
+      if (!strncmp(value, stats->samples[i], len))
+      {
+        n++;
+      }
+    }
+    est = stats->num_entries * (2 * n + 1) / (2 * (INDEX_STATS_SAMPLES + 1));
+
+    return(est > per_key ? est : per_key);
+  case MKDB_SUBSTR_COMPARE:
+    /* the whole file is scanned */
+    return(stats->num_entries);
+  default:
+    return(-1);
+  }
+}
+
+int
+destroy_index_stats(stats)
+  index_stats_struct  *stats;
+{
+  int i;
+
+  if (!stats)
+  {
+    return TRUE;
+  }
+
+  if (stats->min_key)
+  {
+    free(stats->min_key);
+  }
+  if (stats->max_key)
+  {
+    free(stats->max_key);
+  }
+  for (i = 0; i < stats->num_samples; i++)
+  {
+    free(stats->samples[i]);
+  }
+
+  free(stats);
+
+  return TRUE;
+}
@@ -0,0 +1,38 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _INDEX_STATS_H_
+#define _INDEX_STATS_H_
+
+/* includes */
+
+#include "common.h"
+#include "mkdb_types.h"
+
+/* prototypes */
+
+/* read_index_stats: gathers the statistics of the sorted (text) index
+   file 'filename'.  Returns NULL if the file can't be read or has no
+   entries. */
+index_stats_struct *read_index_stats PROTO((char *filename));
+
+/* copies 'stats' into newly allocated space */
+index_stats_struct *copy_index_stats PROTO((index_stats_struct *stats));
+
+/* estimate_index_hits: estimates how many entries of the index file
+   'file' the full, partial or substring term 'query_item' matches,
+   from the file's statistics alone.  Returns 0 only if none can
+   match, and -1 if there is no telling. */
+long estimate_index_hits PROTO((file_struct       *file,
+                                query_term_struct *query_item));
+
+/* the destructor */
+int destroy_index_stats PROTO((index_stats_struct *stats));
+
+#endif /* _INDEX_STATS_H_ */
@@ -0,0 +1,292 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "index_stream.h"
+
+#include "defines.h"
+#include "fileinfo.h"
+#include "fileutils.h"
+#include "index.h"
+#include "index_file.h"
+#include "log.h"
+#include "misc.h"
+#include "records.h"
+
+/* ------------------- Public Functions -------------------- */
+
+index_stream_struct *
+open_index_stream(class, auth_area, file_name)
+  class_struct     *class;
+  auth_area_struct *auth_area;
+  char             *file_name;
+{
+  index_stream_struct *stream;
+  FILE                *fp;
+
+  if (!class || !auth_area || NOT_STR_EXISTS(file_name))
+  {
+    log(L_LOG_ERR, MKDB, "open_index_stream: null data detected");
+    return NULL;
+  }
+
+  if ((fp = get_file_lock(file_name, "w", 60)) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open data file '%s': %s", file_name,
+        strerror(errno));
+    return NULL;
+  }
+
+  stream            = xcalloc(1, sizeof(*stream));
+  stream->class     = class;
+  stream->auth_area = auth_area;
+  dl_list_default(&(stream->index_file_list), FALSE, destroy_index_fp_data);
+
+  /* a class with nothing indexed still gets its data file */
+  build_index_list(class, auth_area, &(stream->index_file_list),
+                   class->db_dir, NULL);
+
+  /* the data file has to have its number before anything is indexed */
+  stream->data_file = add_single_file(class, auth_area, file_name,
+                                      MKDB_DATA_FILE, 0);
+  if (!stream->data_file)
+  {
+    log(L_LOG_ERR, MKDB, "could not add data file '%s' to master list",
+        file_name);
+    release_file_lock(file_name, fp);
+    unlink(file_name);
+    destroy_index_stream_data(stream);
+    return NULL;
+  }
+  stream->data_file->fp = fp;
+
+  if ((stream->read_fp = fopen(stream->data_file->filename, "r")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open data file '%s' for reading: %s",
+        stream->data_file->filename, strerror(errno));
+    abort_index_stream(stream);
+    destroy_index_stream_data(stream);
+    return NULL;
+  }
+
+  return(stream);
+}
+
+
+int
+write_index_stream_record(stream, lines, rec_p)
+  index_stream_struct *stream;
+  dl_list_type        *lines;
+  record_struct       **rec_p;
+{
+  file_struct      *data_file;
+  record_struct    *rec;
+  rec_parse_result read_status;
+  off_t            offset;
+  int              status;
+  int              not_done;
+
+  if (rec_p)
+  {
+    *rec_p = NULL;
+  }
+
+  if (!stream || !stream->data_file || !stream->data_file->fp || !lines)
+  {
+    log(L_LOG_ERR, MKDB, "write_index_stream_record: null data detected");
+    return FALSE;
+  }
+
+  if (dl_list_empty(lines))
+  {
+    return TRUE;
+  }
+
+  data_file = stream->data_file;
+
+  if (data_file->num_recs > 0)
+  {
+    fprintf(data_file->fp, "---\n");
+  }
+  offset = ftell(data_file->fp);
+
+  not_done = dl_list_first(lines);
+  while (not_done)
+  {
+    fprintf(data_file->fp, "%s\n", (char *) dl_list_value(lines));
+    not_done = dl_list_next(lines);
+  }
+
+  if (fflush(data_file->fp) != 0)
+  {
+    log(L_LOG_ERR, MKDB, "could not write data file '%s': %s",
+        data_file->filename, strerror(errno));
+    return FALSE;
+  }
+
+  /* read the record back, so it is indexed just as the indexer would
+     index it from the finished file */
+  if (fseek(stream->read_fp, offset, SEEK_SET) < 0)
+  {
+    log(L_LOG_ERR, MKDB, "could not seek in data file '%s': %s",
+        data_file->filename, strerror(errno));
+    return FALSE;
+  }
+
+  rec = mkdb_read_record(stream->class, stream->auth_area,
+                         data_file->file_no, FALSE, &read_status,
+                         stream->read_fp);
+  if (!rec)
+  {
+    /* nothing usable in it; the next record will follow on */
+    return(read_status != REC_FATAL);
+  }
+
+  data_file->num_recs++;
+
+  index_record(rec, stream->auth_area, &(stream->index_file_list), &status);
+
+  if (status && rec_p)
+  {
+    *rec_p = rec;
+  }
+  else
+  {
+    destroy_record_data(rec);
+  }
+
+  return(status);
+}
+
+
+int
+close_index_stream(stream, add_list, mod_list)
+  index_stream_struct *stream;
+  dl_list_type        *add_list;
+  dl_list_type        *mod_list;
+{
+  file_struct *data_file;
+  struct stat sb;
+
+  if (!stream || !stream->data_file || !add_list || !mod_list)
+  {
+    log(L_LOG_ERR, MKDB, "close_index_stream: null data detected");
+    return FALSE;
+  }
+
+  data_file = stream->data_file;
+
+  if (data_file->fp)
+  {
+    release_file_lock(data_file->filename, data_file->fp);
+    data_file->fp = NULL;
+  }
+  if (stream->read_fp)
+  {
+    fclose(stream->read_fp);
+    stream->read_fp = NULL;
+  }
+
+  if (stat(data_file->filename, &sb) == 0)
+  {
+    data_file->size = sb.st_size;
+  }
+
+  if (!dl_list_empty(&(stream->index_file_list)))
+  {
+    index_data_file_coverage(stream->class, data_file,
+                             &(stream->index_file_list));
+
+    if (!finish_index_files(stream->class, &(stream->index_file_list),
+                            data_file->num_recs, add_list))
+    {
+      log(L_LOG_ERR, MKDB, "error indexing data file '%s'",
+          data_file->filename);
+      return FALSE;
+    }
+  }
+
+  dl_list_append(mod_list, copy_file_struct(data_file));
+
+  return TRUE;
+}
+
+
+void
+abort_index_stream(stream)
+  index_stream_struct *stream;
+{
+  dl_list_type delete_list;
+  file_struct  *data_file;
+
+  if (!stream)
+  {
+    return;
+  }
+
+  unlink_index_tmp_files(&(stream->index_file_list));
+
+  if (stream->read_fp)
+  {
+    fclose(stream->read_fp);
+    stream->read_fp = NULL;
+  }
+
+  data_file = stream->data_file;
+  if (!data_file)
+  {
+    return;
+  }
+
+  if (data_file->fp)
+  {
+    release_file_lock(data_file->filename, data_file->fp);
+    data_file->fp = NULL;
+  }
+
+  dl_list_default(&delete_list, FALSE, destroy_file_struct_data);
+  dl_list_append(&delete_list, copy_file_struct(data_file));
+
+  modify_file_list(stream->class, stream->auth_area, NULL, &delete_list,
+                   NULL, NULL, NULL);
+  unlink_file_list(&delete_list);
+
+  dl_list_destroy(&delete_list);
+}
+
+
+int
+destroy_index_stream_data(stream)
+  index_stream_struct *stream;
+{
+  if (!stream)
+  {
+    return TRUE;
+  }
+
+  if (stream->read_fp)
+  {
+    fclose(stream->read_fp);
+  }
+
+  if (stream->data_file)
+  {
+    if (stream->data_file->fp)
+    {
+      release_file_lock(stream->data_file->filename, stream->data_file->fp);
+      stream->data_file->fp = NULL;
+    }
+    destroy_file_struct_data(stream->data_file);
+  }
+
+  dl_list_destroy(&(stream->index_file_list));
+
+  free(stream);
+
+  return TRUE;
+}
@@ -0,0 +1,69 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _INDEX_STREAM_H_
+#define _INDEX_STREAM_H_
+
+/* includes */
+
+#include "common.h"
+#include "dl_list.h"
+#include "mkdb_types.h"
+#include "types.h"
+
+/* types */
+
+/* index_stream_struct: a data file that is indexed one record at a
+   time, as it is written.  The data file is in the master file list
+   from the start, but locked (inactive) until the caller installs the
+   finished index files. */
+typedef struct _index_stream_struct
+{
+  class_struct     *class;
+  auth_area_struct *auth_area;
+  file_struct      *data_file;
+  FILE             *read_fp;
+  dl_list_type     index_file_list;
+} index_stream_struct;
+
+/* prototypes */
+
+/* open_index_stream: creates the data file 'file_name' for 'class' in
+   'auth_area' and adds it, locked, to the master file list.  Returns
+   NULL on error. */
+index_stream_struct *
+open_index_stream PROTO((class_struct     *class,
+                         auth_area_struct *auth_area,
+                         char             *file_name));
+
+/* write_index_stream_record: appends a record, given as a list of
+   data file lines ("Attribute:value"), to the data file and indexes
+   it.  If 'rec_p' is not NULL, the record as it will be read back
+   from the data file is returned in it, for the caller to destroy.
+   Returns FALSE on error. */
+int write_index_stream_record PROTO((index_stream_struct *stream,
+                                     dl_list_type        *lines,
+                                     record_struct       **rec_p));
+
+/* close_index_stream: closes the data file and sorts its index files.
+   A file_struct for each index file is appended to 'add_list', and
+   one for the data file (with its final size and record count) to
+   'mod_list', for the caller to install with modify_file_list(),
+   unlocking the data file as it does.  Returns FALSE on error. */
+int close_index_stream PROTO((index_stream_struct *stream,
+                              dl_list_type        *add_list,
+                              dl_list_type        *mod_list));
+
+/* abort_index_stream: removes the data file from the master file list
+   and removes it and any temporary index files from the disk */
+void abort_index_stream PROTO((index_stream_struct *stream));
+
+int destroy_index_stream_data PROTO((index_stream_struct *stream));
+
+#endif /* _INDEX_STREAM_H_ */
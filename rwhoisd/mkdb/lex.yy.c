@@ -408,6 +408,7 @@ char *yytext;
 
 #include "parse.h"
 
+#include "arena.h"
 #include "auth_area.h"
 #include "defines.h"
 #include "misc.h"
@@ -696,12 +697,12 @@ YY_RULE_SETUP
 case 5:
 YY_RULE_SETUP
 #line 54 "parse.l"
-{ yylval.val = xstrdup(yytext); return(QUOTEDVALUE); }
+{ yylval.val = arena_xstrdup(yytext); return(QUOTEDVALUE); }
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
 #line 55 "parse.l"
-{ yylval.val = xstrdup(yytext);
+{ yylval.val = arena_xstrdup(yytext);
                   if (find_global_class_by_name(yytext)) {
                     return(CLASS);
                   } else if (find_truly_global_attr_by_name(yytext)) {
@@ -713,7 +714,7 @@ YY_RULE_SETUP
 case 7:
 YY_RULE_SETUP
 #line 63 "parse.l"
-{ yylval.val = xstrdup(yytext);
+{ yylval.val = arena_xstrdup(yytext);
                   if (find_truly_global_attr_by_name(yytext)) {
                     return(ATTR);
                   }
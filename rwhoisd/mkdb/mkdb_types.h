@@ -29,6 +29,9 @@ typedef enum
   MKDB_EXACT_INDEX_FILE,
   MKDB_SOUNDEX_INDEX_FILE,
   MKDB_CIDR_INDEX_FILE,
+  MKDB_BINARY_INDEX_FILE,   /* an exact index, in binary form */
+  MKDB_UPDATED_INDEX_FILE,  /* Updated values, for incremental xfers */
+  MKDB_TRIGRAM_INDEX_FILE,  /* trigrams of values, for substring searches */
   /* new mkdb file types go here */
   MKDB_MAX_FILE_TYPE    /* this type MUST be last */
 } mkdb_file_type;
@@ -66,6 +69,21 @@ typedef enum
   MKDB_NOT_EQ_OP
 } mkdb_operator_type;
 
+/* the number of keys sampled, evenly spaced, from an index file */
+#define INDEX_STATS_SAMPLES  8
+
+/* index_stats_struct: what the indexer found out about a (sorted)
+   index file, for the query planner.  Deleted entries are counted. */
+typedef struct _index_stats_struct
+{
+  long             num_entries;
+  long             num_keys;        /* distinct values */
+  char             *min_key;
+  char             *max_key;
+  int              num_samples;
+  char             *samples[INDEX_STATS_SAMPLES];
+} index_stats_struct;
+
 typedef struct _file_struct
 {
   mkdb_file_type   type;
@@ -77,6 +95,8 @@ typedef struct _file_struct
   char             *tmp_filename;
   char             *base_filename;
   FILE             *fp;
+  index_stats_struct *stats;        /* NULL if not known */
+  struct _tombstone_set_struct *tombstones; /* NULL until looked at */
 } file_struct;
 
 typedef struct _index_struct
@@ -10,6 +10,7 @@
 
 #include "parse.h"
 
+#include "arena.h"
 #include "client_msgs.h"
 #include "defines.h"
 #include "log.h"
@@ -113,7 +114,7 @@ set_query_term(attribute_name, value, op)
     return NULL;
   }
 
-  qt = xcalloc(1, sizeof(*qt));
+  qt = arena_xcalloc(1, sizeof(*qt));
   
   if (attribute_name && *attribute_name)
   {
@@ -286,15 +287,15 @@ destroy_query_term(qt)
 
   if (qt->attribute_name)
   {
-    free(qt->attribute_name);
+    arena_free(qt->attribute_name);
   }
 
   if (qt->search_value)
   {
-    free(qt->search_value);
+    arena_free(qt->search_value);
   }
 
-  free(qt);
+  arena_free(qt);
 
   return TRUE;
 }
@@ -329,12 +330,12 @@ destroy_query(q)
   
   if (q->class_name)
   {
-    free(q->class_name);
+    arena_free(q->class_name);
   }
 
   if (q->auth_area_name)
   {
-    free(q->auth_area_name);
+    arena_free(q->auth_area_name);
   }
 
   free(q);
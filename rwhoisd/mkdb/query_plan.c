@@ -0,0 +1,204 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "query_plan.h"
+
+#include "attributes.h"
+#include "defines.h"
+#include "index_stats.h"
+#include "log.h"
+#include "misc.h"
+
+/* an estimate that couldn't be made */
+#define PLAN_UNKNOWN  -1
+
+/* local types */
+
+typedef struct _plan_term_struct
+{
+  query_term_struct *term;
+  long              cost;       /* estimated index hits */
+  int               can_drive;  /* searching with it finds what
+                                   checking a record against it does */
+} plan_term_struct;
+
+/* ------------------- Local Functions --------------------- */
+
+/* estimate_term: estimates the index hits of 'term' in the exact
+   index files in 'index_fi_list'.  Returns 0 if nothing can match
+   it, and PLAN_UNKNOWN if there is no telling. */
+static long
+estimate_term(class, index_fi_list, plan_term)
+  class_struct      *class;
+  dl_list_type      *index_fi_list;
+  plan_term_struct  *plan_term;
+{
+  query_term_struct *term       = plan_term->term;
+  attribute_struct  *attr;
+  file_struct       *file;
+  long              total       = 0;
+  long              est;
+  int               have_file   = FALSE;
+  int               not_done;
+
+  if (term->attribute_id <= 0)
+  {
+    return(PLAN_UNKNOWN);
+  }
+
+  attr = find_attribute_by_global_id(class, term->attribute_id);
+  if (!attr)
+  {
+    log(L_LOG_DEBUG, MKDB, "plan: class '%s' has no attribute for '%s'",
+        class->name, term->search_value);
+    plan_term->can_drive = TRUE;
+    return(0);
+  }
+
+  if ((attr->index != INDEX_EXACTLY && attr->index != INDEX_ALL) ||
+      (term->comp_type != MKDB_FULL_COMPARE &&
+       term->comp_type != MKDB_PARTIAL_COMPARE &&
+       term->comp_type != MKDB_SUBSTR_COMPARE))
+  {
+    return(PLAN_UNKNOWN);
+  }
+
+  /* a soundex or CIDR search may find more than the exact index */
+  plan_term->can_drive = (attr->index == INDEX_EXACTLY);
+
+  not_done = dl_list_first(index_fi_list);
+  while (not_done)
+  {
+    file = dl_list_value(index_fi_list);
+
+    if (file->type == MKDB_EXACT_INDEX_FILE ||
+        file->type == MKDB_BINARY_INDEX_FILE)
+    {
+      if ((est = estimate_index_hits(file, term)) < 0)
+      {
+        return(PLAN_UNKNOWN);
+      }
+      total    += est;
+      have_file = TRUE;
+    }
+
+    not_done = dl_list_next(index_fi_list);
+  }
+
+  return(have_file ? total : PLAN_UNKNOWN);
+}
+
+/* cheaper: returns TRUE if 'a' is known to cost less than 'b' */
+static int
+cheaper(a, b)
+  plan_term_struct  *a;
+  plan_term_struct  *b;
+{
+  if (a->cost == PLAN_UNKNOWN)
+  {
+    return FALSE;
+  }
+
+  return(b->cost == PLAN_UNKNOWN || a->cost < b->cost);
+}
+
+/* ------------------- Public Functions -------------------- */
+
+query_term_struct *
+plan_query_branch(class, index_fi_list, branch)
+  class_struct      *class;
+  dl_list_type      *index_fi_list;
+  query_term_struct *branch;
+{
+  plan_term_struct  *plan;
+  plan_term_struct  tmp;
+  query_term_struct *result;
+  query_term_struct *term;
+  int               num_terms  = 0;
+  int               driver     = 0;
+  int               i;
+  int               j;
+
+  for (term = branch; term; term = term->and_list)
+  {
+    num_terms++;
+  }
+
+  plan = xcalloc(num_terms, sizeof(plan_term_struct));
+
+  for (term = branch, i = 0; term; term = term->and_list, i++)
+  {
+    plan[i].term = term;
+    plan[i].cost = estimate_term(class, index_fi_list, &(plan[i]));
+
+    /* the search term only rules a record out if it is searched with
+       as it is checked */
+    if (plan[i].cost == 0 && (i > 0 || plan[i].can_drive))
+    {
+      log(L_LOG_DEBUG, MKDB, "plan: '%s' can't match in class '%s'",
+          term->search_value, class->name);
+      free(plan);
+      return NULL;
+    }
+  }
+
+  /* search with the cheapest term that finds the same records */
+  if (plan[0].can_drive)
+  {
+    for (i = 1; i < num_terms; i++)
+    {
+      if (plan[i].can_drive && cheaper(&(plan[i]), &(plan[driver])))
+      {
+        driver = i;
+      }
+    }
+  }
+
+  tmp          = plan[0];
+  plan[0]      = plan[driver];
+  plan[driver] = tmp;
+
+  /* then check the rest cheapest first, which is also the order the
+     AND filter is built in */
+  for (i = 2; i < num_terms; i++)
+  {
+    tmp = plan[i];
+    for (j = i; j > 1 && cheaper(&tmp, &(plan[j - 1])); j--)
+    {
+      plan[j] = plan[j - 1];
+    }
+    plan[j] = tmp;
+  }
+
+  result = xcalloc(num_terms, sizeof(query_term_struct));
+
+  for (i = 0; i < num_terms; i++)
+  {
+    result[i]          = *(plan[i].term);
+    result[i].and_list = (i + 1 < num_terms) ? &(result[i + 1]) : NULL;
+    result[i].or_list  = NULL;
+
+    if (plan[i].cost == PLAN_UNKNOWN)
+    {
+      log(L_LOG_DEBUG, MKDB, "plan: %s '%s' in class '%s' (no estimate)",
+          i == 0 ? "search with" : "then check", result[i].search_value,
+          class->name);
+    }
+    else
+    {
+      log(L_LOG_DEBUG, MKDB, "plan: %s '%s' in class '%s' (about %ld hits)",
+          i == 0 ? "search with" : "then check", result[i].search_value,
+          class->name, plan[i].cost);
+    }
+  }
+
+  free(plan);
+
+  return(result);
+}
@@ -0,0 +1,32 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _QUERY_PLAN_H_
+#define _QUERY_PLAN_H_
+
+/* includes */
+
+#include "common.h"
+#include "dl_list.h"
+#include "mkdb_types.h"
+#include "types.h"
+
+/* prototypes */
+
+/* plan_query_branch: plans the search of 'branch', one OR branch of a
+   query, in 'class', using the statistics of the index files in
+   'index_fi_list'.  Returns an allocated array of copies of the
+   branch's terms, chained by their and_list in the order to use them,
+   the first being the one to search with; free() it when done.
+   Returns NULL if nothing in the class can match the branch. */
+query_term_struct *plan_query_branch PROTO((class_struct      *class,
+                                            dl_list_type      *index_fi_list,
+                                            query_term_struct *branch));
+
+#endif /* _QUERY_PLAN_H_ */
@@ -10,6 +10,7 @@
 #include "records.h"
 
 #include "anon_record.h"
+#include "arena.h"
 #include "attributes.h"
 #include "client_msgs.h"
 #include "defines.h"
@@ -88,9 +89,9 @@ translate_anon_av_pair(anon_av, class, auth_area, validate_flag, status)
   }
 
   /* fill out the av_pair */
-  av        = xcalloc(1, sizeof(*av));
+  av        = arena_xcalloc(1, sizeof(*av));
   av->attr  = attr;
-  av->value = xstrdup(anon_av->value);
+  av->value = arena_xstrdup(anon_av->value);
 
   return(av);
 }
@@ -126,7 +127,7 @@ mkdb_translate_anon_record(anon, class, auth_area, validate_flag)
 
   decode_validate_flag(validate_flag, NULL, NULL, &find_all_flag);
 
-  rec               = xcalloc(1, sizeof(*rec));
+  rec               = arena_xcalloc(1, sizeof(*rec));
   rec->data_file_no = anon->data_file_no;
   rec->offset       = anon->offset;
   rec->auth_area    = auth_area;
@@ -134,6 +135,7 @@ mkdb_translate_anon_record(anon, class, auth_area, validate_flag)
 
   av_list           = &(rec->av_pair_list);
   dl_list_default(av_list, FALSE, destroy_av_pair_data);
+  dl_list_use_arena(av_list);
   
   /* handle auth_area */
   anon_av = find_anon_auth_area_in_rec(anon);
@@ -364,14 +366,15 @@ append_attribute_to_record(record, class, attrib_name, value)
 {
   av_pair_struct    *av;
 
-  av = xcalloc(1, sizeof(*av));
+  av = arena_xcalloc(1, sizeof(*av));
   
   if ((av->attr = find_attribute_by_name(class, attrib_name)) == NULL) 
   {
+    arena_free(av);
     return FALSE;
   }
 
-  av->value = xstrdup(value);
+  av->value = arena_xstrdup(value);
   dl_list_append(&(record->av_pair_list), av);
 
   return TRUE;
@@ -416,14 +419,14 @@ copy_av_pair(av)
     return NULL;
   }
   
-  copy = xcalloc(1, sizeof(*copy));
+  copy = arena_xcalloc(1, sizeof(*copy));
   bcopy(av, copy, sizeof(*copy));
 
   /* since the value typically gets freed, duplicate it */
   /* FIXME: this routine definately assumes that the value is a
      string, but so far, this is always true.  If it isn't a string,
      then the struct would probably need a length field */
-  copy->value = xstrdup((char *)av->value);
+  copy->value = arena_xstrdup((char *)av->value);
   
   return(copy);
 }
@@ -443,11 +446,12 @@ copy_record(rec)
   }
   
   /* first copy the main body */
-  copy = xcalloc(1, sizeof(*copy));
+  copy = arena_xcalloc(1, sizeof(*copy));
   bcopy(rec, copy, sizeof(*copy));
 
   /* copy the av_pair list */
   dl_list_default(&(copy->av_pair_list), FALSE, destroy_av_pair_data);
+  dl_list_use_arena(&(copy->av_pair_list));
 
   not_done = dl_list_first(&(rec->av_pair_list));
   while (not_done)
@@ -473,7 +477,7 @@ destroy_record_data(rec)
 
   dl_list_destroy(&(rec->av_pair_list));
 
-  free(rec);
+  arena_free(rec);
 
   return TRUE;
 }
@@ -486,10 +490,10 @@ destroy_av_pair_data(av)
 
   if (av->value)
   {
-    free(av->value);
+    arena_free(av->value);
   }
 
-  free(av);
+  arena_free(av);
 
   return TRUE;
 }
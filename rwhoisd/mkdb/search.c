@@ -12,6 +12,8 @@
 #include "common_regexps.h"
 #include "attributes.h"
 #include "auth_area.h"
+#include "binary_index.h"
+#include "cidr_tree.h"
 #include "client_msgs.h"
 #include "defines.h"
 #include "fileinfo.h"
@@ -21,10 +23,12 @@
 #include "log.h"
 #include "main_config.h"
 #include "misc.h"
+#include "query_plan.h"
 #include "records.h"
 #include "schema.h"
 #include "strutil.h"
 #include "search_prim.h"
+#include "trigram_index.h"
 
 /* ----------------------- Local Functions --------------- */
 
@@ -143,6 +147,57 @@ search_exact_index_file(class, auth_area, file, data_fi_list,
   return(ret_code);
 }
 
+/* search_binary_index_file: search_exact_index_file() for an exact
+   index in binary form */
+static ret_code_type
+search_binary_index_file(class, auth_area, file, data_fi_list,
+                         query_tree, record_list, max_hits)
+  class_struct      *class;
+  auth_area_struct  *auth_area;
+  file_struct       *file;
+  dl_list_type      *data_fi_list;
+  query_term_struct *query_tree;
+  dl_list_type      *record_list;
+  int               max_hits;
+{
+  binary_index_struct bi;
+  off_t               entry;
+  ret_code_type       ret_code    = SEARCH_SUCCESSFUL;
+
+  if (!load_binary_index(file, &bi))
+  {
+    return(UNKNOWN_SEARCH_ERROR);
+  }
+
+  switch (query_tree->search_type)
+  {
+  case MKDB_BINARY_SEARCH:
+    entry = binary_index_search(&bi, query_tree);
+    if (entry != -1)
+    {
+      ret_code = binary_full_scan(class, auth_area, file, &bi,
+                                  data_fi_list, query_tree, record_list,
+                                  max_hits, entry, FALSE);
+    }
+    break;
+
+  case MKDB_FULL_SCAN:
+    ret_code = binary_full_scan(class, auth_area, file, &bi,
+                                data_fi_list, query_tree, record_list,
+                                max_hits, 0, TRUE);
+    break;
+  default:
+    log(L_LOG_ERR, MKDB, "invalid search type '%d'",
+        query_tree->search_type);
+    ret_code = INVALID_SEARCH_TYPE;
+    break;
+  }
+
+  release_binary_index(&bi);
+
+  return(ret_code);
+}
+
 static ret_code_type
 search_soundex_index_file(class, auth_area, file, data_fi_list,
                           query_tree, record_list, max_hits)
@@ -181,6 +236,61 @@ search_soundex_index_file(class, auth_area, file, data_fi_list,
   return(ret_code);
 }
 
+/* search_cidr_by_prefix: search_cidr_index_file() without a network
+   tree: binary searches the index for the query network at each
+   prefix length, longest first */
+static ret_code_type
+search_cidr_by_prefix(class, auth_area, file, data_fi_list,
+                      query_tree, record_list, max_hits, prefix)
+  class_struct      *class;
+  auth_area_struct  *auth_area;
+  file_struct       *file;
+  dl_list_type      *data_fi_list;
+  query_term_struct *query_tree;
+  dl_list_type      *record_list;
+  int               max_hits;
+  struct netinfo    *prefix;
+{
+  off_t                  fposition;
+  char                   search_val_buf[MAX_LINE];
+  char                   *orig_search_val;
+  ret_code_type          ret_code = SEARCH_SUCCESSFUL;
+
+  orig_search_val = query_tree->search_value;
+
+  /* replace the original query string with our ever changing buffer */
+  query_tree->search_value = search_val_buf;
+
+  for (; prefix->masklen >= 0 && ret_code == SEARCH_SUCCESSFUL;
+       prefix->masklen--)
+  {
+    /* mask off the bits that are now in the host part */
+    mask_addr_to_len( prefix, prefix->masklen );
+
+    /* convert back into a string */
+    write_network( search_val_buf, prefix );
+
+    fposition = binary_search(file, query_tree);
+    if (fposition != -1)
+    {
+      ret_code = full_scan(class, auth_area, file,
+                           data_fi_list, query_tree, record_list, max_hits,
+                           fposition, FALSE);
+    }
+  }
+
+  /* restore the query term back its original state */
+  query_tree->search_value = orig_search_val;
+
+  return(ret_code);
+}
+
+/* search_cidr_index_file: finds the query network and every network
+   that contains it, most specific first.  The covering networks are
+   found with a single walk of the index file's network tree, so only
+   the networks actually present in the index are ever scanned.  If
+   the daemon has no tree for the file (it is new, or this isn't a
+   daemon), each prefix length is looked for instead. */
 static ret_code_type
 search_cidr_index_file(class, auth_area, file, data_fi_list,
                        query_tree, record_list, max_hits)
@@ -193,11 +303,22 @@ search_cidr_index_file(class, auth_area, file, data_fi_list,
   int               max_hits;
 {
   struct netinfo         prefix;
-  off_t                  fposition;
+  cidr_node_struct       *matches[MAX_CIDR_MATCHES];
   char                   search_val_buf[MAX_LINE];
   char                   *orig_search_val;
   ret_code_type          ret_code = SEARCH_SUCCESSFUL;
-  int                    not_done = TRUE;
+  int                    num_matches;
+  int                    i;
+  int                    j;
+
+  /* this don't make sense bud! */
+  if (query_tree->search_type != MKDB_BINARY_SEARCH)
+  {
+    log(L_LOG_DEBUG, MKDB,
+        "invalid search type '%d' for search_cidr_index_file",
+        query_tree->search_type);
+    return(INVALID_SEARCH_TYPE);
+  }
 
   orig_search_val = query_tree->search_value;
 
@@ -206,46 +327,34 @@ search_cidr_index_file(class, auth_area, file, data_fi_list,
     return(SEARCH_SUCCESSFUL);
   }
 
+  num_matches = find_covering_networks(file, &prefix, matches);
+  if (num_matches < 0)
+  {
+    return(search_cidr_by_prefix(class, auth_area, file, data_fi_list,
+                                 query_tree, record_list, max_hits,
+                                 &prefix));
+  }
+  if (num_matches == 0)
+  {
+    return(SEARCH_SUCCESSFUL);
+  }
+
   /* replace the original query string with our ever changing buffer */
   query_tree->search_value = search_val_buf;
 
-  while (not_done)
+  for (i = 0; i < num_matches && ret_code == SEARCH_SUCCESSFUL; i++)
   {
-    /* mask off the bits that are now in the host part */
-    mask_addr_to_len( &prefix, prefix.masklen );
-
-    /* convert back into a string */
-    write_network( search_val_buf, &prefix );
+    /* convert back into a string, for full_scan's key comparisons */
+    write_network( search_val_buf, &(matches[i]->net) );
 
-    switch (query_tree->search_type)
+    for (j = 0;
+         j < matches[i]->num_positions && ret_code == SEARCH_SUCCESSFUL;
+         j++)
     {
-    case MKDB_BINARY_SEARCH:
-      fposition = binary_search(file, query_tree);
-      if (fposition != -1)
-      {
-        ret_code = full_scan(class, auth_area, file,
-                             data_fi_list, query_tree, record_list, max_hits,
-                             fposition, FALSE);
-      }
-      break;
-
-      /* this don't make sense bud! */
-    case MKDB_FULL_SCAN:
-      log(L_LOG_DEBUG, MKDB,
-          "invalid search type '%d' for search_cidr_index_file",
-          query_tree->search_type);
-      return(INVALID_SEARCH_TYPE);
-      break;
-    default:
-      log(L_LOG_ERR, MKDB, "invalid search type '%d'",
-          query_tree->search_type);
-      return(INVALID_SEARCH_TYPE);
-      break;
+      ret_code = full_scan(class, auth_area, file,
+                           data_fi_list, query_tree, record_list, max_hits,
+                           matches[i]->positions[j], FALSE);
     }
-
-    /* advance the prefix either up (the network tree) */
-    prefix.masklen--;
-    if ( prefix.masklen < 0 ) not_done = FALSE;
   }
 
   /* restore the query term back its original state */
@@ -272,6 +381,15 @@ search_index_file(class, auth_area, index_fi_list, data_fi_list, query_tree,
   ret_code_type  ret_code           = SEARCH_SUCCESSFUL;
   int            not_done;
 
+  /* a substring search only has to look at the records the trigram
+     index turns up, if it covers all of the data */
+  if (query_tree->comp_type == MKDB_SUBSTR_COMPARE &&
+      search_trigram_index(class, auth_area, index_fi_list, data_fi_list,
+                           query_tree, record_list, max_hits, &ret_code))
+  {
+    return(ret_code);
+  }
+
   not_done = dl_list_first(index_fi_list);
   while (not_done)
   {
@@ -279,8 +397,14 @@ search_index_file(class, auth_area, index_fi_list, data_fi_list, query_tree,
     file = dl_list_value(index_fi_list);
     file_type_of_term = convert_file_type(index_type);
 
-    /* if that file's type does not match the index type then skip it */
-    if (index_type != INDEX_ALL && (file->type != file_type_of_term))
+    /* if that file's type does not match the index type then skip it
+       (a binary index holds the same thing as an exact one, and the
+       Updated and trigram indexes aren't searched directly) */
+    if (file->type == MKDB_UPDATED_INDEX_FILE ||
+        file->type == MKDB_TRIGRAM_INDEX_FILE ||
+        (index_type != INDEX_ALL && (file->type != file_type_of_term) &&
+         !(file->type == MKDB_BINARY_INDEX_FILE &&
+           file_type_of_term == MKDB_EXACT_INDEX_FILE)))
     {
       not_done = dl_list_next(index_fi_list);
       continue;
@@ -288,7 +412,8 @@ search_index_file(class, auth_area, index_fi_list, data_fi_list, query_tree,
 
     /* if the index_type is INDEX_ALL then the query_term type doesn't */
     /* get passed but instead we pass the index file's type */
-    if (index_type == INDEX_ALL)
+    if (index_type == INDEX_ALL ||
+        file->type == MKDB_BINARY_INDEX_FILE)
     {
       file_type_of_term = file->type;
     }
@@ -300,6 +425,11 @@ search_index_file(class, auth_area, index_fi_list, data_fi_list, query_tree,
                                          data_fi_list, query_tree,
                                          record_list, max_hits);
       break;
+    case MKDB_BINARY_INDEX_FILE:
+      ret_code = search_binary_index_file(class, auth_area, file,
+                                          data_fi_list, query_tree,
+                                          record_list, max_hits);
+      break;
     case MKDB_SOUNDEX_INDEX_FILE:
       ret_code = search_soundex_index_file(class, auth_area, file,
                                            data_fi_list, query_tree,
@@ -331,6 +461,144 @@ search_index_file(class, auth_area, index_fi_list, data_fi_list, query_tree,
   return(ret_code);
 }
 
+/* find_term_postings: sets 'result' to the postings of the records
+   that can match the AND term 'term', read from the index files in
+   'index_fi_list' without looking at any record.  Returns FALSE if
+   the indexes can't tell, which is the case for terms without an
+   attribute, negated terms and attributes that aren't indexed
+   exactly. */
+static int
+find_term_postings(class, index_fi_list, data_fi_list, term, result)
+  class_struct        *class;
+  dl_list_type        *index_fi_list;
+  dl_list_type        *data_fi_list;
+  query_term_struct   *term;
+  posting_list_struct *result;
+{
+  attribute_struct  *attr;
+  file_struct       *file;
+  long              n;
+  int               not_done;
+
+  if (term->attribute_id <= 0)
+  {
+    return FALSE;
+  }
+
+  attr = find_attribute_by_global_id(class, term->attribute_id);
+  if (!attr)
+  {
+    /* nothing in this class can match */
+    return TRUE;
+  }
+
+  switch (term->comp_type)
+  {
+  case MKDB_FULL_COMPARE:
+  case MKDB_PARTIAL_COMPARE:
+    if (attr->index != INDEX_EXACTLY && attr->index != INDEX_ALL)
+    {
+      return FALSE;
+    }
+
+    not_done = dl_list_first(index_fi_list);
+    while (not_done)
+    {
+      file = dl_list_value(index_fi_list);
+      if ((file->type == MKDB_EXACT_INDEX_FILE ||
+           file->type == MKDB_BINARY_INDEX_FILE) &&
+          !read_index_postings(file, term, result))
+      {
+        clear_postings(result);
+        return FALSE;
+      }
+
+      not_done = dl_list_next(index_fi_list);
+    }
+    break;
+  case MKDB_SUBSTR_COMPARE:
+    if (attr->index == INDEX_NONE ||
+        !find_trigram_postings(index_fi_list, data_fi_list, term, result))
+    {
+      return FALSE;
+    }
+    break;
+  default:
+    return FALSE;
+  }
+
+  /* the hit filter is by record, not attribute */
+  for (n = 0; n < result->num_postings; n++)
+  {
+    result->postings[n].attribute_id = 0;
+  }
+  sort_postings(result);
+
+  return TRUE;
+}
+
+/* build_and_filter: sets 'filter' to the records that can match all
+   of the (indexed) AND terms of 'query_item', for use as a hit
+   filter while the first term is searched.  Returns FALSE, with an
+   empty filter, if none of the AND terms can be looked up this
+   way. */
+static int
+build_and_filter(class, index_fi_list, data_fi_list, query_item, filter)
+  class_struct        *class;
+  dl_list_type        *index_fi_list;
+  dl_list_type        *data_fi_list;
+  query_term_struct   *query_item;
+  posting_list_struct *filter;
+{
+  posting_list_struct postings;
+  query_term_struct   *term;
+  int                 have_filter   = FALSE;
+
+  bzero((char *) filter, sizeof(*filter));
+
+  for (term = query_item->and_list; term; term = term->and_list)
+  {
+    bzero((char *) &postings, sizeof(postings));
+
+    if (!find_term_postings(class, index_fi_list, data_fi_list, term,
+                            &postings))
+    {
+      continue;
+    }
+
+    if (!have_filter)
+    {
+      *filter     = postings;
+      have_filter = TRUE;
+    }
+    else
+    {
+      /* keep the smaller list as the result */
+      if (postings.num_postings < filter->num_postings)
+      {
+        intersect_postings(&postings, filter);
+        clear_postings(filter);
+        *filter = postings;
+      }
+      else
+      {
+        intersect_postings(filter, &postings);
+        clear_postings(&postings);
+      }
+    }
+
+    log(L_LOG_DEBUG, MKDB, "AND term '%s' leaves %ld candidate records",
+        term->search_value, filter->num_postings);
+
+    if (filter->num_postings == 0)
+    {
+      break;
+    }
+  }
+
+  return(have_filter);
+}
+
 static ret_code_type
 search_class(query_tree, auth_area, class, record_list, max_hits)
   query_term_struct *query_tree;
@@ -339,13 +607,16 @@ search_class(query_tree, auth_area, class, record_list, max_hits)
   dl_list_type      *record_list;
   int               max_hits;
 {
-  dl_list_type     master_fi_list;
-  dl_list_type     index_fi_list;
-  dl_list_type     data_fi_list;
-  char             index_file[MAX_LINE];
-  attribute_struct *attr;
-  attr_index_type  index_type;
-  ret_code_type    ret_code             = FALSE;
+  dl_list_type        master_fi_list;
+  dl_list_type        index_fi_list;
+  dl_list_type        data_fi_list;
+  posting_list_struct and_filter;
+  query_term_struct   *plan;
+  char                index_file[MAX_LINE];
+  attribute_struct    *attr;
+  attr_index_type     index_type;
+  ret_code_type       ret_code             = FALSE;
+  int                 have_filter;
 
   bzero((char *)index_file, sizeof(index_file));
 
@@ -370,16 +641,19 @@ search_class(query_tree, auth_area, class, record_list, max_hits)
   /* while we have a term to look at */
   while (query_tree && ((max_hits == 0) || (get_hit_count() <= max_hits)))
   {
-    if (query_tree->attribute_id > 0)
+    /* this is also where a branch using an attribute that this class
+       doesn't have is found to be successful with nothing found */
+    plan = plan_query_branch(class, &index_fi_list, query_tree);
+    if (!plan)
     {
-      attr = find_attribute_by_global_id(class, query_tree->attribute_id);
-      if (!attr)
-      {
-        /* this is the situation where this class doesn't have the
-           particular attribute being looked for, so the search is
-           successful with nothing found. */
-        return SEARCH_SUCCESSFUL;
-      }
+      ret_code   = SEARCH_SUCCESSFUL;
+      query_tree = query_tree->or_list;
+      continue;
+    }
+
+    if (plan->attribute_id > 0)
+    {
+      attr       = find_attribute_by_global_id(class, plan->attribute_id);
       index_type = attr->index;
     }
     else
@@ -387,9 +661,30 @@ search_class(query_tree, auth_area, class, record_list, max_hits)
       index_type = INDEX_ALL;
     }
 
-    ret_code = search_index_file(class, auth_area, &index_fi_list,
-                                 &data_fi_list, query_tree, record_list,
-                                 max_hits, index_type);
+    /* the first term drives the search; the other terms of an AND
+       query that are indexed narrow the records it has to read */
+    have_filter = build_and_filter(class, &index_fi_list, &data_fi_list,
+                                   plan, &and_filter);
+
+    if (have_filter && and_filter.num_postings == 0)
+    {
+      ret_code = SEARCH_SUCCESSFUL;
+    }
+    else
+    {
+      if (have_filter)
+      {
+        set_hit_filter(&and_filter);
+      }
+
+      ret_code = search_index_file(class, auth_area, &index_fi_list,
+                                   &data_fi_list, plan, record_list,
+                                   max_hits, index_type);
+
+      set_hit_filter(NULL);
+    }
+    clear_postings(&and_filter);
+    free(plan);
 
     if (ret_code != 0)
     {
@@ -417,6 +712,7 @@ search_auth_area(auth_area, class_name, query, record_list, max_hits)
 {
   class_struct  *class;
   dl_list_type  *class_list;
+  dl_node_type  *pos;
   int           not_done;
   ret_code_type ret_code = SEARCH_SUCCESSFUL;
 
@@ -445,8 +741,12 @@ search_auth_area(auth_area, class_name, query, record_list, max_hits)
         continue;
       }
 
+      /* a streamed search's hits may be searched on as they are found
+         (see search_stream()), so hold our place in the class list */
+      pos      = dl_list_get_pos(class_list);
       ret_code = search_class(query->query_tree, auth_area, class,
                              record_list, max_hits);
+      dl_list_put_pos(class_list, pos);
 
       if (ret_code != SEARCH_SUCCESSFUL)
       {
@@ -490,6 +790,7 @@ search(query, record_list, max_hits, ret_code)
   dl_list_type     *auth_area_list = NULL;
   auth_area_struct *auth_area      = NULL;
   class_ref_struct *class_ref      = NULL;
+  dl_node_type     *pos;
   char             *auth_area_name;
   char             *class_name;
   int              not_done;
@@ -519,6 +820,7 @@ search(query, record_list, max_hits, ret_code)
 
   /* reset the hit count */
   set_hit_count(0);
+  clear_hit_set();
 
   auth_area_name = query->auth_area_name;
   class_name     = query->class_name;
@@ -581,8 +883,11 @@ search(query, record_list, max_hits, ret_code)
   {
     auth_area = dl_list_value(auth_area_list);
 
+    /* as in search_auth_area(), hold our place in the list */
+    pos       = dl_list_get_pos(auth_area_list);
     *ret_code = search_auth_area(auth_area, class_name, query, record_list,
                                  max_hits);
+    dl_list_put_pos(auth_area_list, pos);
 
     not_done = dl_list_next(auth_area_list);
   }
@@ -590,6 +895,29 @@ search(query, record_list, max_hits, ret_code)
   return(get_hit_count());
 }
 
+int
+search_stream(query, func, data, max_hits, ret_code)
+  query_struct  *query;
+  int           (*func)();
+  void          *data;
+  int           max_hits;
+  ret_code_type *ret_code;
+{
+  dl_list_type  record_list;
+  int           num_hits;
+
+  /* the list stays empty; it is only there for search() */
+  dl_list_default(&record_list, FALSE, destroy_record_data);
+
+  set_hit_func(func, data);
+  num_hits = search(query, &record_list, max_hits, ret_code);
+  set_hit_func(NULL, NULL);
+
+  dl_list_destroy(&record_list);
+
+  return(num_hits);
+}
+
 int
 check_query_complexity(query)
   query_struct *query;
@@ -28,6 +28,16 @@ int search PROTO((query_struct  *query,
                   int           max_hits,
                   ret_code_type *ret_code));
 
+/* search_stream: does the search like search(), but passes each hit
+   to 'func', as func(record, data), as soon as it is found instead of
+   collecting them, so only their keys are kept.  The record is
+   destroyed when 'func' returns. */
+int search_stream PROTO((query_struct  *query,
+                         int           (*func)(),
+                         void          *data,
+                         int           max_hits,
+                         ret_code_type *ret_code));
+
  
 int check_query_complexity PROTO((query_struct *query));
 
@@ -9,18 +9,63 @@
 
 #include "search_prim.h"
 
+#include "arena.h"
 #include "attributes.h"
 #include "defines.h"
 #include "fileinfo.h"
 #include "index.h"
+#include "index_map.h"
 #include "log.h"
 #include "misc.h"
 #include "records.h"
 #include "strutil.h"
+#include "tombstone.h"
 
 
+/* the smallest (and first) size of the hit set; a power of two */
+#define MIN_HIT_SET_SIZE 64
+
 static int hit_count = 0;
 
+/* the hit set is an open addressed hash of the keys of the records
+   found so far by the current search, so that full_scan can tell if a
+   hit is already there without walking the whole list.  Only the keys
+   are kept, as a streamed search doesn't keep its records.  If the
+   records are collected, 'hit_set_list' is the list they are in. */
+typedef struct _hit_key_struct
+{
+  auth_area_struct  *auth_area;     /* NULL in an empty slot */
+  class_struct      *class;
+  int               data_file_no;
+  off_t             offset;
+} hit_key_struct;
+
+static hit_key_struct *hit_set      = NULL;
+static int            hit_set_size  = 0;
+static int            hit_set_count = 0;
+static dl_list_type   *hit_set_list = NULL;
+
+/* if set, each hit is passed to 'hit_func' instead of being added to
+   the record list (see set_hit_func()) */
+static int            (*hit_func)() = NULL;
+static void           *hit_func_data = NULL;
+
+/* the records a hit has to be among to be read, if set (see
+   set_hit_filter()) */
+static posting_list_struct *hit_filter = NULL;
+
+/* what check_index_item() tells a scan to do next */
+typedef enum
+{
+  SCAN_NEXT,            /* go on to the next index item */
+  SCAN_END,             /* we're past the run of matching keys */
+  SCAN_LIMIT,           /* the hit limit has been reached */
+  SCAN_ERROR
+} scan_result_type;
+
+/* the smallest number of postings a posting list is grown to */
+#define MIN_POSTINGS 64
+
 /* --------------------- Private Functions ------------------- */
 
 static int
@@ -54,8 +99,129 @@ close_fp(file)
 }
 
 
-/* check_hit_list_for_hit: returns TRUE if the index_item already
-   exists in the record_list */
+/* hash_hit: hashes the key that identifies a record: its auth area,
+   class, data file and offset */
+static unsigned long
+hash_hit(auth_area_name, class_name, data_file_no, offset)
+  char  *auth_area_name;
+  char  *class_name;
+  int   data_file_no;
+  long  offset;
+{
+  unsigned long h = 5381;
+  char          *p;
+
+  for (p = auth_area_name; *p; p++)
+  {
+    h = (h << 5) + h + (unsigned char) *p;
+  }
+  for (p = class_name; *p; p++)
+  {
+    h = (h << 5) + h + (unsigned char) *p;
+  }
+  h = (h << 5) + h + (unsigned long) data_file_no;
+  h = (h * 2654435761UL) ^ (unsigned long) offset;
+  h ^= h >> 15;
+
+  return(h);
+}
+
+/* find_hit_slot: returns the slot in the hit set that holds the given
+   record's key, or the empty slot where it would go */
+static int
+find_hit_slot(auth_area, class, data_file_no, offset)
+  auth_area_struct  *auth_area;
+  class_struct      *class;
+  int               data_file_no;
+  off_t             offset;
+{
+  hit_key_struct  *key;
+  int             i;
+
+  i = hash_hit(auth_area->name, class->name, data_file_no, offset) &
+    (hit_set_size - 1);
+
+  while ((key = &(hit_set[i]))->auth_area != NULL)
+  {
+    if (key->data_file_no == data_file_no &&
+        key->offset       == offset       &&
+        STR_EQ(key->class->name, class->name) &&
+        STR_EQ(key->auth_area->name, auth_area->name))
+    {
+      break;
+    }
+    i = (i + 1) & (hit_set_size - 1);
+  }
+
+  return(i);
+}
+
+static void
+add_hit_to_set(record)
+  record_struct *record;
+{
+  hit_key_struct  *old_set  = hit_set;
+  hit_key_struct  *key;
+  int             old_size  = hit_set_size;
+  int             i;
+
+  /* keep the table no more than half full */
+  if ((hit_set_count + 1) * 2 > hit_set_size)
+  {
+    hit_set_size = old_size ? old_size * 2 : MIN_HIT_SET_SIZE;
+    hit_set      = xcalloc(hit_set_size, sizeof(hit_key_struct));
+    hit_set_count = 0;
+
+    for (i = 0; i < old_size; i++)
+    {
+      if (old_set[i].auth_area)
+      {
+        hit_set[find_hit_slot(old_set[i].auth_area, old_set[i].class,
+                              old_set[i].data_file_no,
+                              old_set[i].offset)] = old_set[i];
+        hit_set_count++;
+      }
+    }
+
+    if (old_set)
+    {
+      free(old_set);
+    }
+  }
+
+  key = &(hit_set[find_hit_slot(record->auth_area, record->class,
+                                record->data_file_no, record->offset)]);
+
+  key->auth_area    = record->auth_area;
+  key->class        = record->class;
+  key->data_file_no = record->data_file_no;
+  key->offset       = record->offset;
+
+  hit_set_count++;
+}
+
+/* load_hit_set: makes the hit set hold exactly the records in
+   'record_list' */
+static void
+load_hit_set(record_list)
+  dl_list_type *record_list;
+{
+  int           not_done;
+
+  clear_hit_set();
+
+  not_done = dl_list_first(record_list);
+  while (not_done)
+  {
+    add_hit_to_set(dl_list_value(record_list));
+    not_done = dl_list_next(record_list);
+  }
+
+  hit_set_list = record_list;
+}
+
+/* check_hit_list_for_hit: returns TRUE if the index_item has already
+   been found (and is in the record_list, if the hits are collected) */
 static int
 check_hit_list_for_hit(class, auth_area, record_list, index_item)
   class_struct     *class;
@@ -63,25 +229,79 @@ check_hit_list_for_hit(class, auth_area, record_list, index_item)
   dl_list_type     *record_list;
   index_struct     index_item;
 {
-  int           not_done;
-  record_struct *record;
+  if (!hit_func && hit_set_list != record_list)
+  {
+    load_hit_set(record_list);
+  }
 
-  not_done = dl_list_first(record_list);
-  while (not_done)
+  if (hit_set_count == 0)
   {
-    record = dl_list_value(record_list);
-    if ( (STR_EQ(record->auth_area->name, auth_area->name)) &&
-         (STR_EQ(record->class->name, class->name))         &&
-         (record->data_file_no == index_item.data_file_no)  &&
-         (record->offset == index_item.offset) )
-    {
-      return(TRUE);
-    }
+    return FALSE;
+  }
 
-    not_done = dl_list_next(record_list);
+  return(hit_set[find_hit_slot(auth_area, class, index_item.data_file_no,
+                               index_item.offset)].auth_area != NULL);
+}
+
+static int
+compare_posting(a, b)
+  const void *a;
+  const void *b;
+{
+  const posting_struct *pa = a;
+  const posting_struct *pb = b;
+
+  if (pa->data_file_no != pb->data_file_no)
+  {
+    return(pa->data_file_no - pb->data_file_no);
+  }
+  if (pa->offset != pb->offset)
+  {
+    return(pa->offset < pb->offset ? -1 : 1);
   }
 
-  return FALSE;
+  return(pa->attribute_id - pb->attribute_id);
+}
+
+/* passes_hit_filter: returns TRUE if there is no hit filter, or the
+   index item's record is in it.  The filter's postings have no
+   attribute. */
+static int
+passes_hit_filter(index_item)
+  index_struct *index_item;
+{
+  posting_struct key;
+
+  if (!hit_filter)
+  {
+    return TRUE;
+  }
+  if (hit_filter->num_postings == 0)
+  {
+    return FALSE;
+  }
+
+  key.offset       = index_item->offset;
+  key.data_file_no = index_item->data_file_no;
+  key.attribute_id = 0;
+
+  return(bsearch(&key, hit_filter->postings, hit_filter->num_postings,
+                 sizeof(posting_struct), compare_posting) != NULL);
+}
+
+/* compare_pair_value: search_compare() of an av pair's value, which is
+   upcased in a copy, as the record may yet be displayed */
+static int
+compare_pair_value(query_item, pair)
+  query_term_struct *query_item;
+  av_pair_struct    *pair;
+{
+  char  value[MAX_LINE];
+
+  strncpy(value, (char *) pair->value, sizeof(value) - 1);
+  value[sizeof(value) - 1] = '\0';
+
+  return(search_compare(query_item, strupr(value)));
 }
 
 /* validate_search_cond: compares the hit against the search item that
@@ -137,7 +357,7 @@ validate_and_list(record, query_list)
            (query_list->attribute_id == pair->attr->global_id) )
       {
         if ( (pair->value != NULL) &&
-             (!search_compare(query_list, strupr((char *) pair->value))) )
+             (!compare_pair_value(query_list, pair)) )
         {
           valid = TRUE;
           break;
@@ -157,6 +377,37 @@ validate_and_list(record, query_list)
   return TRUE;
 }
 
+/* validate_candidate: returns TRUE if the record's value of the
+   attribute 'attribute_id' matches the query term itself, for a
+   candidate hit whose index value isn't known */
+static int
+validate_candidate(record, query_item, attribute_id)
+  record_struct     *record;
+  query_term_struct *query_item;
+  int               attribute_id;
+{
+  dl_list_type   *pair_list;
+  av_pair_struct *pair;
+  int            not_done;
+
+  pair_list = &(record->av_pair_list);
+  not_done  = dl_list_first(pair_list);
+
+  while (not_done)
+  {
+    pair = dl_list_value(pair_list);
+
+    if (pair->attr->global_id == attribute_id && pair->value != NULL &&
+        !compare_pair_value(query_item, pair))
+    {
+      return TRUE;
+    }
+
+    not_done = dl_list_next(pair_list);
+  }
+
+  return FALSE;
+}
 
 /* note: this routine should probably reside in some form in records.c */
 static record_struct *
@@ -172,7 +423,19 @@ fill_out_record(class, auth_area, index_item, data_fi_list, status)
 
   fi = find_file_by_id(data_fi_list, index_item->data_file_no, MKDB_DATA_FILE);
 
-  if (!fi || !open_fp(fi))
+  if (!fi)
+  {
+    return NULL;
+  }
+
+  /* don't bother reading a record we know was deleted */
+  if (is_tombstoned(fi, index_item->offset))
+  {
+    *status = REC_NULL;
+    return NULL;
+  }
+
+  if (!open_fp(fi))
   {
     return NULL;
   }
@@ -198,6 +461,387 @@ fill_out_record(class, auth_area, index_item, data_fi_list, status)
 }
 
 
+/* call_hit_func: passes 'record' to the hit function.  That may well
+   search itself (a guardian check, say), so the state of this search
+   is put aside while it runs. */
+static void
+call_hit_func(record)
+  record_struct *record;
+{
+  hit_key_struct      *saved_set       = hit_set;
+  int                 saved_set_size   = hit_set_size;
+  int                 saved_set_count  = hit_set_count;
+  dl_list_type        *saved_set_list  = hit_set_list;
+  int                 (*saved_func)()  = hit_func;
+  void                *saved_data      = hit_func_data;
+  posting_list_struct *saved_filter    = hit_filter;
+  int                 saved_count      = hit_count;
+
+  hit_set       = NULL;
+  hit_set_size  = 0;
+  hit_set_count = 0;
+  hit_set_list  = NULL;
+  hit_func      = NULL;
+  hit_func_data = NULL;
+  hit_filter    = NULL;
+
+  (*saved_func)(record, saved_data);
+
+  if (hit_set)
+  {
+    free(hit_set);
+  }
+
+  hit_set       = saved_set;
+  hit_set_size  = saved_set_size;
+  hit_set_count = saved_set_count;
+  hit_set_list  = saved_set_list;
+  hit_func      = saved_func;
+  hit_func_data = saved_data;
+  hit_filter    = saved_filter;
+  hit_count     = saved_count;
+}
+
+/* check_index_item: the heart of a linear scan.  Checks one index
+   item against the query and, if it is a good hit that we don't
+   already have, reads its record and adds it to 'record_list'.  An
+   item without a value is a candidate, checked against its record
+   instead. */
+static scan_result_type
+check_index_item(class, auth_area, file, data_fi_list, query_item,
+                 record_list, max_hits, index_item, find_all_flag)
+  class_struct      *class;
+  auth_area_struct  *auth_area;
+  file_struct       *file;
+  dl_list_type      *data_fi_list;
+  query_term_struct *query_item;
+  dl_list_type      *record_list;
+  int               max_hits;
+  index_struct      *index_item;
+  int               find_all_flag;
+{
+  record_struct    *hi_ptr;
+  rec_parse_result status;
+  arena_mark_type  mark;
+  int              y;
+
+  /* skip it if it was deleted */
+  if (index_item->deleted_flag)
+  {
+    return SCAN_NEXT;
+  }
+
+  /* if we have an attribute type */
+  if (query_item->attribute_id)
+  {
+    /* then skip it if it doesn't match the attribute type for this hit */
+    if ((query_item->attribute_id != -2) &&
+        (query_item->attribute_id != index_item->attribute_id))
+    {
+      return SCAN_NEXT;
+    }
+  }
+
+  /* check it (a candidate is checked once its record is read) */
+  y = index_item->value ? search_compare(query_item, index_item->value) : 0;
+
+  /* if the index value doesn't match what we are looking for, then   */
+  /* we have hit the end of the range                 */
+  if (y && !find_all_flag)
+  {
+    return SCAN_END;
+  }
+
+  if (y)
+  {
+    return SCAN_NEXT;
+  }
+
+  /* then check and see if the search condition was valid */
+  if (!validate_search_cond(class, auth_area, query_item, index_item))
+  {
+    return SCAN_NEXT;
+  }
+
+  /* then check that the rest of an AND query didn't rule it out */
+  if (!passes_hit_filter(index_item))
+  {
+    return SCAN_NEXT;
+  }
+
+  /* then check and see if we already have it. If so then just continue*/
+  if (check_hit_list_for_hit(class, auth_area, record_list, *index_item))
+  {
+    return SCAN_NEXT;
+  }
+
+  /* then fill out the rest of the actual record.  Unless it is kept,
+     what it took from the arena goes straight back. */
+  arena_get_mark(&mark);
+  hi_ptr = fill_out_record(class, auth_area, index_item, data_fi_list,
+                           &status);
+  if (!hi_ptr)
+  {
+    arena_release(&mark);
+
+    if (status == REC_NULL || status == REC_EOF)
+    {
+      /* the record was deleted */
+      return SCAN_NEXT;
+    }
+
+    /* the record was actually bad */
+    return SCAN_ERROR;
+  }
+
+  if (!index_item->value &&
+      !validate_candidate(hi_ptr, query_item, index_item->attribute_id))
+  {
+    destroy_record_data(hi_ptr);
+    arena_release(&mark);
+    return SCAN_NEXT;
+  }
+
+  /* if there's an AND tree in this query validate this record
+     against it and if it isn't then go to the next hit if it is
+     valid then fall through below and add it to the hit list */
+  if (query_item->and_list && !validate_and_list(hi_ptr,
+                                                 query_item->and_list))
+  {
+    destroy_record_data(hi_ptr);
+    arena_release(&mark);
+    return SCAN_NEXT;
+  }
+
+  /* add the hit to the hit list */
+  hi_ptr->index_file_no = file->file_no;
+
+  /* don't add the record that would bring hit_count up to max hits
+     (max number of records is really (max_hits - 1) */
+  if ((max_hits == 0) || (get_hit_count() < max_hits))
+  {
+    add_hit_to_set(hi_ptr);
+    inc_hit_count();
+
+    if (hit_func)
+    {
+      /* hand it over now, keeping only its key */
+      call_hit_func(hi_ptr);
+      destroy_record_data(hi_ptr);
+      arena_release(&mark);
+    }
+    else
+    {
+      dl_list_append(record_list, hi_ptr);
+    }
+  }
+  else
+  {
+    destroy_record_data(hi_ptr);
+    arena_release(&mark);
+    return SCAN_LIMIT;
+  }
+
+  return SCAN_NEXT;
+}
+
+static ret_code_type
+scan_result_to_ret_code(result)
+  scan_result_type result;
+{
+  switch (result)
+  {
+  case SCAN_LIMIT:
+    return HIT_LIMIT_EXCEEDED;
+  case SCAN_ERROR:
+    return UNKNOWN_SEARCH_ERROR;
+  default:
+    return SEARCH_SUCCESSFUL;
+  }
+}
+
+/* map_scan_for_bol: the scan_for_bol() of a mapped index file: moves
+   'offset' back to the beginning of its line, or, if that would take
+   it below 'low', forward to the beginning of the next line. */
+static int
+map_scan_for_bol(map, low, offset, high)
+  char  *map;
+  off_t low;
+  off_t *offset;
+  off_t high;
+{
+  off_t pos = *offset;
+  char  *nl;
+
+  if (pos == 0)
+  {
+    return(TRUE);
+  }
+
+  for ( ; pos >= low - 1; pos--)
+  {
+    if (map[pos] == '\n')
+    {
+      *offset = pos + 1;
+      return(TRUE);
+    }
+    if (pos == 0)
+    {
+      *offset = 0;
+      return(TRUE);
+    }
+  }
+
+  if ((nl = memchr(map + *offset, '\n', high - *offset)) == NULL)
+  {
+    return(FALSE);
+  }
+
+  *offset = (nl - map) + 1;
+  return(TRUE);
+}
+
+/* compare_value_n: search_compare() for a value that isn't
+   terminated, but is 'len' characters long */
+static int
+compare_value_n(query_item, value, len)
+  query_term_struct *query_item;
+  char              *value;
+  int               len;
+{
+  char  buf[MAX_BUF];
+  int   qlen;
+  int   r;
+
+  switch (query_item->comp_type)
+  {
+  case MKDB_FULL_COMPARE:
+  case MKDB_PARTIAL_COMPARE:
+    qlen = strlen(query_item->search_value);
+    r = memcmp(query_item->search_value, value, MIN(qlen, len));
+    if (r)
+    {
+      return((r < 0) ? -1 : 1);
+    }
+    if (qlen > len)
+    {
+      return(1);
+    }
+    if (qlen < len && query_item->comp_type == MKDB_FULL_COMPARE)
+    {
+      return(-1);
+    }
+    return(0);
+  default:
+    if (len >= (int) sizeof(buf))
+    {
+      len = sizeof(buf) - 1;
+    }
+    bcopy(value, buf, len);
+    buf[len] = '\0';
+    return(search_compare(query_item, buf));
+  }
+}
+
+/* map_compare_line: compares the query against the value of the
+   index line at 'bol' in the mapping, in place.  Sets 'eol' to the
+   beginning of the next line. */
+static int
+map_compare_line(query_item, map, bol, size, eol)
+  query_term_struct *query_item;
+  char              *map;
+  off_t             bol;
+  off_t             size;
+  off_t             *eol;
+{
+  char  *line = map + bol;
+  char  *end;
+  char  *p;
+  int   i;
+
+  if ((end = memchr(line, '\n', size - bol)) != NULL)
+  {
+    *eol = (end - map) + 1;
+  }
+  else
+  {
+    end  = map + size;
+    *eol = size;
+  }
+
+  /* the value is everything after the fourth ':' (see
+     decode_index_line()) */
+  for (p = line, i = 0; i < 4; i++, p++)
+  {
+    if ((p = memchr(p, ':', end - p)) == NULL)
+    {
+      return(-2);
+    }
+  }
+
+  /* readline() would have trimmed these */
+  while (end > p && (unsigned char) end[-1] <= ' ')
+  {
+    end--;
+  }
+
+  return(compare_value_n(query_item, p, end - p));
+}
+
+/* map_binary_search: binary_search() over a mapped index file; no
+   reads or allocations are done at all. */
+static off_t
+map_binary_search(map, size, query_item)
+  char              *map;
+  off_t             size;
+  query_term_struct *query_item;
+{
+  int               found       = FALSE;
+  int               y;
+  off_t             high        = size;
+  off_t             low         = 0;
+  off_t             mid;
+  off_t             beg_of_line = -1;
+  off_t             end_of_line = -1;
+  off_t             save        = -1;
+
+  while (low < high)
+  {
+    mid = low + (high - low) / 2;
+
+    if (!map_scan_for_bol(map, low, &mid, high) ||
+        beg_of_line == mid || mid == high)
+    {
+      break;
+    }
+    beg_of_line = mid;
+
+    y = map_compare_line(query_item, map, beg_of_line, size, &end_of_line);
+
+    if (y == 0)
+    {
+      found = TRUE;
+      save = high = beg_of_line;
+    }
+    else if (y < 0)
+    {
+      high = beg_of_line;
+    }
+    else
+    {
+      low = end_of_line;
+    }
+  }
+
+  if (!found)
+  {
+    return(-1);
+  }
+
+  return(save);
+}
+
+
 /* --------------------- Public Functions -------------------- */
 
 void
@@ -219,6 +863,209 @@ get_hit_count()
   return(hit_count);
 }
 
+void
+set_hit_func(func, data)
+  int   (*func)();
+  void  *data;
+{
+  hit_func      = func;
+  hit_func_data = data;
+}
+
+void
+set_hit_filter(filter)
+  posting_list_struct *filter;
+{
+  hit_filter = filter;
+}
+
+void
+add_posting(list, offset, data_file_no, attribute_id)
+  posting_list_struct *list;
+  off_t               offset;
+  int                 data_file_no;
+  int                 attribute_id;
+{
+  posting_struct *posting;
+
+  if (list->num_postings >= list->max_postings)
+  {
+    list->max_postings = list->max_postings ?
+      list->max_postings * 2 : MIN_POSTINGS;
+    list->postings     = xrealloc(list->postings,
+                                  list->max_postings * sizeof(posting_struct));
+  }
+
+  posting = &(list->postings[list->num_postings++]);
+
+  posting->offset       = offset;
+  posting->data_file_no = data_file_no;
+  posting->attribute_id = attribute_id;
+}
+
+void
+sort_postings(list)
+  posting_list_struct *list;
+{
+  long  i;
+  long  n;
+
+  if (list->num_postings < 2)
+  {
+    return;
+  }
+
+  qsort(list->postings, list->num_postings, sizeof(posting_struct),
+        compare_posting);
+
+  for (i = 1, n = 1; i < list->num_postings; i++)
+  {
+    if (compare_posting(&(list->postings[n - 1]), &(list->postings[i])))
+    {
+      list->postings[n++] = list->postings[i];
+    }
+  }
+  list->num_postings = n;
+}
+
+void
+intersect_postings(result, list)
+  posting_list_struct *result;
+  posting_list_struct *list;
+{
+  long  i = 0;
+  long  j = 0;
+  long  n = 0;
+  int   r;
+
+  while (i < result->num_postings && j < list->num_postings)
+  {
+    r = compare_posting(&(result->postings[i]), &(list->postings[j]));
+    if (r < 0)
+    {
+      i++;
+    }
+    else if (r > 0)
+    {
+      j++;
+    }
+    else
+    {
+      result->postings[n++] = result->postings[i];
+      i++;
+      j++;
+    }
+  }
+
+  result->num_postings = n;
+}
+
+void
+clear_postings(list)
+  posting_list_struct *list;
+{
+  if (list->postings)
+  {
+    free(list->postings);
+  }
+  bzero((char *) list, sizeof(*list));
+}
+
+int
+read_index_postings(file, query_item, list)
+  file_struct         *file;
+  query_term_struct   *query_item;
+  posting_list_struct *list;
+{
+  binary_index_struct       bi;
+  binary_index_entry_struct *entry;
+  index_struct              item;
+  char                      line[MAX_LINE];
+  FILE                      *fp;
+  off_t                     pos;
+  off_t                     n;
+
+  if (file->type == MKDB_BINARY_INDEX_FILE)
+  {
+    if (!load_binary_index(file, &bi))
+    {
+      return FALSE;
+    }
+
+    n = binary_index_search(&bi, query_item);
+    for ( ; n >= 0 && n < bi.num_entries; n++)
+    {
+      if (search_compare(query_item, binary_index_key(&bi, n)))
+      {
+        break;
+      }
+
+      entry = &(bi.entries[n]);
+      if (!entry->deleted_flag &&
+          (query_item->attribute_id == -2 ||
+           entry->attribute_id == query_item->attribute_id))
+      {
+        add_posting(list, entry->offset, entry->data_file_no,
+                    entry->attribute_id);
+      }
+    }
+
+    release_binary_index(&bi);
+    return TRUE;
+  }
+
+  if ((pos = binary_search(file, query_item)) < 0)
+  {
+    return TRUE;
+  }
+
+  if ((fp = fopen(file->filename, "r")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open index file '%s': %s",
+        file->filename, strerror(errno));
+    return FALSE;
+  }
+
+  fseek(fp, pos, SEEK_SET);
+
+  while (readline(fp, line, MAX_LINE))
+  {
+    if (!decode_index_line(line, &item))
+    {
+      continue;
+    }
+
+    if (search_compare(query_item, item.value))
+    {
+      arena_free(item.value);
+      break;
+    }
+    arena_free(item.value);
+
+    if (!item.deleted_flag &&
+        (query_item->attribute_id == -2 ||
+         item.attribute_id == query_item->attribute_id))
+    {
+      add_posting(list, item.offset, item.data_file_no, item.attribute_id);
+    }
+  }
+
+  fclose(fp);
+
+  return TRUE;
+}
+
+void
+clear_hit_set()
+{
+  if (hit_set_count > 0)
+  {
+    bzero(hit_set, hit_set_size * sizeof(hit_key_struct));
+  }
+  hit_set_count = 0;
+  hit_set_list  = NULL;
+}
+
 /* binary_search: This function performs a binary search of an index
    file. It returns the file position that points to the first hit in
    the index. The business of actually checking AND operations and
@@ -239,6 +1086,14 @@ binary_search(file, query_item)
   off_t             beg_of_line = -1;
   off_t             end_of_line = -1;
   off_t             save = -1;
+  char              *map;
+  off_t             map_size;
+
+  /* if we can, search the file in memory */
+  if ((map = map_index_file(file, &map_size)) != NULL)
+  {
+    return(map_binary_search(map, MIN(file->size, map_size), query_item));
+  }
 
   low   = 0;
   high  = file->size;
@@ -291,7 +1146,7 @@ binary_search(file, query_item)
 
     y = search_compare(query_item, index_item.value);
 
-    free(index_item.value);
+    arena_free(index_item.value);
     index_item.value = NULL;
 
     if (y == 0)
@@ -342,11 +1197,8 @@ full_scan(class, auth_area, file, data_fi_list, query_item, record_list,
 {
   FILE             *fp;
   char             line[MAX_LINE];
-  record_struct    *hi_ptr         = NULL;
   index_struct     index_item;
-  rec_parse_result status;
-  int              hit_limit_flag  = FALSE;
-  int              y;
+  scan_result_type result          = SCAN_NEXT;
 
   bzero(&index_item, sizeof(index_item));
 
@@ -359,7 +1211,7 @@ full_scan(class, auth_area, file, data_fi_list, query_item, record_list,
 
   fseek(fp, start_pos, SEEK_SET);
 
-  while (TRUE)
+  while (result == SCAN_NEXT)
   {
     if (!readline(fp, line, MAX_LINE))
     {
@@ -369,122 +1221,145 @@ full_scan(class, auth_area, file, data_fi_list, query_item, record_list,
 
     if (index_item.value)
     {
-      free(index_item.value);
+      arena_free(index_item.value);
       index_item.value = NULL;
     }
 
     /* this routine allocates space for .value */
-    decode_index_line(line, &index_item);
-
-    /* skip it if it was deleted */
-    if (index_item.deleted_flag)
+    if (!decode_index_line(line, &index_item))
     {
       continue;
     }
 
-    /* if we have an attribute type */
-    if (query_item->attribute_id)
-    {
-      /* then skip it if it doesn't match the attribute type for this hit */
-      if ((query_item->attribute_id != -2) &&
-          (query_item->attribute_id != index_item.attribute_id))
-      {
-        continue;
-      }
-    }
-
-    /* check it */
-    y = search_compare(query_item, index_item.value);
+    result = check_index_item(class, auth_area, file, data_fi_list,
+                              query_item, record_list, max_hits,
+                              &index_item, find_all_flag);
+  }
 
-    /* if the index value doesn't match what we are looking for, then   */
-    /* we have hit the end of the range                 */
-    if (y && !find_all_flag)
-    {
-      break;
-    }
+  if (index_item.value)
+  {
+    arena_free(index_item.value);
+    index_item.value = NULL;
+  }
 
-    if (y) continue;
+  close_fp(file);
 
-    /* if the match was good */
-    if (!y)
-    {
-      /* then check and see if the search condition was valid */
-      if (!validate_search_cond(class, auth_area, query_item, &index_item))
-      {
-        continue;
-      }
+  return(scan_result_to_ret_code(result));
+}
 
-      /* then check and see if we already have it. If so then just continue*/
-      if (check_hit_list_for_hit(class, auth_area, record_list, index_item))
-      {
-        continue;
-      }
+/* binary_index_search: the binary_search() of a binary index file.
+   Since the entries are all the same size, this is a plain bisection
+   of the entry array.  Returns the number of the first matching
+   entry, or -1 if there isn't one. */
+off_t
+binary_index_search(bi, query_item)
+  binary_index_struct *bi;
+  query_term_struct   *query_item;
+{
+  off_t low   = 0;
+  off_t high  = bi->num_entries;
+  off_t mid;
+  off_t save  = -1;
+  int   y;
+
+  /* as with binary_search, keep going until the range collapses so we
+     end at the first of a run of equal keys */
+  while (low < high)
+  {
+    mid = low + (high - low) / 2;
 
-      /* then fill out the rest of the actual record */
-      hi_ptr = fill_out_record(class, auth_area, &index_item, data_fi_list,
-                               &status);
-      if (!hi_ptr)
-      {
-        if (status == REC_NULL || status == REC_EOF)
-        {
-          /* the record was deleted */
-          continue;
-        }
-        else
-        {
-          /* the record was actually bad */
-          close_fp(file);
-          if (index_item.value) free(index_item.value);
-          return UNKNOWN_SEARCH_ERROR;
-        }
-      }
+    y = search_compare(query_item, binary_index_key(bi, mid));
 
-      /* if there's an AND tree in this query validate this record
-         against it and if it isn't then go to the next hit if it is
-         valid then fall through below and add it to the hit list */
-      if (query_item->and_list && !validate_and_list(hi_ptr,
-                                                     query_item->and_list))
-      {
-        destroy_record_data(hi_ptr);
-        continue;
-      }
+    if (y == 0)
+    {
+      save = high = mid;
     }
-
-
-    /* add the hit to the hit list */
-    hi_ptr->index_file_no = file->file_no;
-
-    /* don't add the record that would bring hit_count up to max hits
-       (max number of records is really (max_hits - 1) */
-    if ((max_hits == 0) || (get_hit_count() < max_hits))
+    else if (y < 0)
     {
-      dl_list_append(record_list, hi_ptr);
-      inc_hit_count();
+      high = mid;
     }
     else
     {
-      hit_limit_flag = TRUE;
-      destroy_record_data(hi_ptr);
-      break;
+      low = mid + 1;
     }
   }
 
-  if (index_item.value)
+  return(save);
+}
+
+/* binary_full_scan: the full_scan() of a binary index file, starting
+   at entry 'start_entry'.  The index values are used in place. */
+ret_code_type
+binary_full_scan(class, auth_area, file, bi, data_fi_list, query_item,
+                 record_list, max_hits, start_entry, find_all_flag)
+  class_struct        *class;
+  auth_area_struct    *auth_area;
+  file_struct         *file;
+  binary_index_struct *bi;
+  dl_list_type        *data_fi_list;
+  query_term_struct   *query_item;
+  dl_list_type        *record_list;
+  int                 max_hits;
+  off_t               start_entry;
+  int                 find_all_flag;
+{
+  binary_index_entry_struct *entry;
+  index_struct              index_item;
+  scan_result_type          result       = SCAN_NEXT;
+  off_t                     n;
+
+  for (n = start_entry; n < bi->num_entries && result == SCAN_NEXT; n++)
   {
-    free(index_item.value);
-    index_item.value = NULL;
+    entry = &(bi->entries[n]);
+
+    index_item.offset       = entry->offset;
+    index_item.data_file_no = entry->data_file_no;
+    index_item.deleted_flag = entry->deleted_flag;
+    index_item.attribute_id = entry->attribute_id;
+    index_item.value        = binary_index_key(bi, n);
+
+    result = check_index_item(class, auth_area, file, data_fi_list,
+                              query_item, record_list, max_hits,
+                              &index_item, find_all_flag);
   }
 
-  close_fp(file);
+  return(scan_result_to_ret_code(result));
+}
 
-  if (hit_limit_flag)
+/* candidate_scan: the full_scan() of a list of candidate index items,
+   whose values aren't known.  The record of each is read and checked
+   against the query. */
+ret_code_type
+candidate_scan(class, auth_area, file, data_fi_list, query_item,
+               record_list, max_hits, candidates, num_candidates)
+  class_struct      *class;
+  auth_area_struct  *auth_area;
+  file_struct       *file;
+  dl_list_type      *data_fi_list;
+  query_term_struct *query_item;
+  dl_list_type      *record_list;
+  int               max_hits;
+  index_struct      *candidates;
+  long              num_candidates;
+{
+  index_struct      index_item;
+  scan_result_type  result       = SCAN_NEXT;
+  long              n;
+
+  for (n = 0; n < num_candidates && result == SCAN_NEXT; n++)
   {
-    return HIT_LIMIT_EXCEEDED;
+    index_item       = candidates[n];
+    index_item.value = NULL;
+
+    result = check_index_item(class, auth_area, file, data_fi_list,
+                              query_item, record_list, max_hits,
+                              &index_item, TRUE);
   }
 
-  return SEARCH_SUCCESSFUL;
+  return(scan_result_to_ret_code(result));
 }
 
+
 /* scan_for_bol: search backwards for newline - if none found then
    reverse direction and start over. */
 
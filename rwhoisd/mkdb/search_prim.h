@@ -12,6 +12,7 @@
 
 #include "common.h"
 
+#include "binary_index.h"
 #include "dl_list.h"
 #include "mkdb_types.h"
 #include "types.h"
@@ -30,12 +31,72 @@ typedef enum
   HIT_LIMIT_EXCEEDED   =  1
 } ret_code_type;
 
+/* posting_struct: an index entry's record (and the attribute of it
+   the entry is for) */
+typedef struct _posting_struct
+{
+  off_t offset;
+  int   data_file_no;
+  int   attribute_id;
+} posting_struct;
+
+/* posting_list_struct: a set of postings, gathered from one or more
+   index files */
+typedef struct _posting_list_struct
+{
+  posting_struct  *postings;
+  long            num_postings;
+  long            max_postings;
+} posting_list_struct;
+
 /* prototypes */
 
 void set_hit_count PROTO((int value));
 void inc_hit_count PROTO((void));
 int  get_hit_count PROTO((void));
 
+/* forgets the records found so far; must be called at the start of
+   each search, since the record list it was tracking may be gone */
+void clear_hit_set PROTO((void));
+
+/* sets the function each hit is passed to, as func(record, data), as
+   soon as it is found, instead of being added to the record list.
+   The record is destroyed when 'func' returns.  NULL, the default,
+   collects the hits in the record list. */
+void set_hit_func PROTO((int (*func)(), void *data));
+
+/* sets the postings a hit has to be among for a scan to read its
+   record; NULL, the default, lets every hit through.  The list must
+   be sorted by sort_postings() and outlive the scan. */
+void set_hit_filter PROTO((posting_list_struct *filter));
+
+/* adds a posting to 'list' */
+void add_posting PROTO((posting_list_struct *list,
+                        off_t               offset,
+                        int                 data_file_no,
+                        int                 attribute_id));
+
+/* sort_postings: sorts the list by data file, offset and attribute,
+   dropping duplicates */
+void sort_postings PROTO((posting_list_struct *list));
+
+/* intersect_postings: leaves in the (sorted) 'result' only the
+   postings also in the (sorted) 'list' */
+void intersect_postings PROTO((posting_list_struct *result,
+                               posting_list_struct *list));
+
+/* frees the postings of 'list', leaving it empty */
+void clear_postings PROTO((posting_list_struct *list));
+
+/* read_index_postings: adds to 'list' the postings of the entries of
+   the (text or binary) index file 'file' that match 'query_item', a
+   full or partial compare.  Entries of deleted records and, unless
+   the term's attribute_id is -2, of other attributes are left out.
+   Returns FALSE on error. */
+int read_index_postings PROTO((file_struct         *file,
+                               query_term_struct   *query_item,
+                               posting_list_struct *list));
+
 /* This function performs a binary search of an index file. It returns
    the file position that points to the first hit in the index. The
    business of actually checking AND operations and such is done in
@@ -57,6 +118,39 @@ ret_code_type full_scan PROTO((class_struct      *class,
                                off_t             start_pos,
                                int               find_all_flag));
 
+/* binary_index_search: the binary_search() of a binary index file.
+   Returns the number of the entry of the first hit, or -1 if there is
+   none. */
+off_t binary_index_search PROTO((binary_index_struct *bi,
+                                 query_term_struct   *query_item));
+
+/* binary_full_scan: the full_scan() of a binary index file, starting
+   at entry 'start_entry' */
+ret_code_type binary_full_scan PROTO((class_struct        *class,
+                                      auth_area_struct    *auth_area,
+                                      file_struct         *file,
+                                      binary_index_struct *bi,
+                                      dl_list_type        *data_fi_list,
+                                      query_term_struct   *query_item,
+                                      dl_list_type        *record_list,
+                                      int                 max_hits,
+                                      off_t               start_entry,
+                                      int                 find_all_flag));
+
+/* candidate_scan: the full_scan() of the 'num_candidates' index items
+   'candidates', whose values are unknown (and ignored).  Each item's
+   record is read and its value of the item's attribute compared with
+   the query. */
+ret_code_type candidate_scan PROTO((class_struct      *class,
+                                    auth_area_struct  *auth_area,
+                                    file_struct       *file,
+                                    dl_list_type      *data_fi_list,
+                                    query_term_struct *query_item,
+                                    dl_list_type      *record_list,
+                                    int               max_hits,
+                                    index_struct      *candidates,
+                                    long              num_candidates));
+
 /* scan_for_bol: search backwards for newline - if none found then
    reverse direction and start over. */
 int scan_for_bol PROTO((FILE *fp, off_t low, off_t *offset, off_t high));
@@ -0,0 +1,297 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "tombstone.h"
+
+#include "defines.h"
+#include "dl_list.h"
+#include "fileutils.h"
+#include "log.h"
+#include "misc.h"
+
+/* local types */
+
+/* tombstone_set_struct: the (sorted) offsets of the deleted records
+   of one data file, along with what we need to tell if its tombstone
+   file has since changed.  A data file without a tombstone file has
+   an empty set.  A set is read again in place when its file changes,
+   and never freed, since file_structs point at it. */
+typedef struct _tombstone_set_struct
+{
+  char    *filename;
+  ino_t   ino;
+  off_t   size;
+  time_t  mtime;
+  off_t   *offsets;
+  int     num_offsets;
+} tombstone_set_struct;
+
+/* local statics */
+
+static dl_list_type tombstone_cache;
+static int          tombstone_cache_init = FALSE;
+
+/* ------------------- Local Functions --------------------- */
+
+static int
+destroy_tombstone_set_data(ts)
+  tombstone_set_struct *ts;
+{
+  if (!ts)
+  {
+    return TRUE;
+  }
+
+  if (ts->offsets)
+  {
+    free(ts->offsets);
+  }
+
+  if (ts->filename)
+  {
+    free(ts->filename);
+  }
+
+  free(ts);
+
+  return TRUE;
+}
+
+static int
+compare_offsets(a, b)
+  const void  *a;
+  const void  *b;
+{
+  off_t oa = *((off_t *) a);
+  off_t ob = *((off_t *) b);
+
+  if (oa == ob)
+  {
+    return(0);
+  }
+
+  return((oa < ob) ? -1 : 1);
+}
+
+/* get_tombstone_filename: puts the name of the tombstone file of
+   'data_file' into 'filename' */
+static int
+get_tombstone_filename(data_file, filename)
+  file_struct *data_file;
+  char        *filename;
+{
+  if (!data_file || !data_file->filename ||
+      strlen(data_file->filename) + sizeof(TOMBSTONE_SUFFIX) > MAX_FILE)
+  {
+    return FALSE;
+  }
+
+  sprintf(filename, "%s%s", data_file->filename, TOMBSTONE_SUFFIX);
+
+  return TRUE;
+}
+
+/* read_tombstone_set: reads the tombstone file 'filename' into 'ts' */
+static void
+read_tombstone_set(filename, ts)
+  char                 *filename;
+  tombstone_set_struct *ts;
+{
+  FILE  *fp;
+  char  line[MAX_LINE];
+  int   size  = 0;
+
+  if ((fp = fopen(filename, "r")) == NULL)
+  {
+    return;
+  }
+
+  while (readline(fp, line, MAX_LINE))
+  {
+    if (!*line)
+    {
+      continue;
+    }
+
+    if (ts->num_offsets == size)
+    {
+      size = size ? size * 2 : 16;
+      ts->offsets = xrealloc(ts->offsets, size * sizeof(off_t));
+    }
+
+#if defined(OFF_T64) && defined(HAVE_ATOLL)
+    ts->offsets[ts->num_offsets++] = atoll(line);
+#else
+    ts->offsets[ts->num_offsets++] = atol(line);
+#endif
+  }
+
+  fclose(fp);
+
+  if (ts->num_offsets > 1)
+  {
+    qsort(ts->offsets, ts->num_offsets, sizeof(off_t), compare_offsets);
+  }
+}
+
+/* get_tombstone_set: returns the (cached) tombstone set of the
+   tombstone file 'filename', first reading it again if it has
+   changed */
+static tombstone_set_struct *
+get_tombstone_set(filename)
+  char  *filename;
+{
+  tombstone_set_struct *ts;
+  struct stat          sb;
+  int                  not_done;
+
+  if (!tombstone_cache_init)
+  {
+    dl_list_default(&tombstone_cache, FALSE, destroy_tombstone_set_data);
+    tombstone_cache_init = TRUE;
+  }
+
+  if (stat(filename, &sb) < 0)
+  {
+    bzero((char *) &sb, sizeof(sb));
+  }
+
+  not_done = dl_list_first(&tombstone_cache);
+  while (not_done)
+  {
+    ts = dl_list_value(&tombstone_cache);
+    if (STR_EQ(ts->filename, filename))
+    {
+      if (ts->ino == sb.st_ino && ts->size == sb.st_size &&
+          ts->mtime == sb.st_mtime)
+      {
+        return(ts);
+      }
+
+      /* stale: read it again */
+      if (ts->offsets)
+      {
+        free(ts->offsets);
+        ts->offsets = NULL;
+      }
+      ts->num_offsets = 0;
+      break;
+    }
+    not_done = dl_list_next(&tombstone_cache);
+  }
+
+  if (!not_done)
+  {
+    ts           = xcalloc(1, sizeof(*ts));
+    ts->filename = xstrdup(filename);
+    dl_list_append(&tombstone_cache, ts);
+  }
+
+  ts->ino   = sb.st_ino;
+  ts->size  = sb.st_size;
+  ts->mtime = sb.st_mtime;
+
+  if (sb.st_size > 0)
+  {
+    read_tombstone_set(filename, ts);
+  }
+
+  return(ts);
+}
+
+/* ------------------- Public Functions -------------------- */
+
+int
+add_tombstone(data_file, offset)
+  file_struct *data_file;
+  off_t       offset;
+{
+  char  filename[MAX_FILE];
+  char  line[MAX_LINE];
+  int   fd;
+  int   len;
+
+  if (!get_tombstone_filename(data_file, filename))
+  {
+    log(L_LOG_ERR, MKDB, "add_tombstone: null data detected");
+    return FALSE;
+  }
+
+#ifdef OFF_T64
+  sprintf(line, "%lld\n", (long long) offset);
+#else
+  sprintf(line, "%ld\n", offset);
+#endif
+  len = strlen(line);
+
+  /* a single appended write, so concurrent deletions don't mix */
+  if ((fd = open(filename, O_WRONLY | O_APPEND | O_CREAT, 0644)) < 0)
+  {
+    log(L_LOG_ERR, MKDB, "could not open tombstone file '%s': %s",
+        filename, strerror(errno));
+    return FALSE;
+  }
+
+  if (write(fd, line, len) != len)
+  {
+    log(L_LOG_ERR, MKDB, "could not write tombstone file '%s': %s",
+        filename, strerror(errno));
+    close(fd);
+    return FALSE;
+  }
+
+  close(fd);
+
+  return TRUE;
+}
+
+int
+is_tombstoned(data_file, offset)
+  file_struct *data_file;
+  off_t       offset;
+{
+  tombstone_set_struct *ts;
+  char                 filename[MAX_FILE];
+
+  if (!data_file)
+  {
+    return FALSE;
+  }
+
+  if (!data_file->tombstones)
+  {
+    if (!get_tombstone_filename(data_file, filename))
+    {
+      return FALSE;
+    }
+
+    data_file->tombstones = get_tombstone_set(filename);
+  }
+
+  ts = data_file->tombstones;
+  if (ts->num_offsets == 0)
+  {
+    return FALSE;
+  }
+
+  return(bsearch(&offset, ts->offsets, ts->num_offsets, sizeof(off_t),
+                 compare_offsets) != NULL);
+}
+
+void
+unlink_tombstones(data_file)
+  file_struct *data_file;
+{
+  char  filename[MAX_FILE];
+
+  if (get_tombstone_filename(data_file, filename))
+  {
+    unlink(filename);
+  }
+}
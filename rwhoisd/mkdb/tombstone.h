@@ -0,0 +1,44 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _TOMBSTONE_H_
+#define _TOMBSTONE_H_
+
+/* includes */
+
+#include "common.h"
+#include "mkdb_types.h"
+
+/* defines */
+
+/* the tombstone file of a data file is the data file's name with
+   this appended */
+#define TOMBSTONE_SUFFIX    ".del"
+
+/* prototypes */
+
+/* add_tombstone: records that the record at 'offset' in the data file
+   'data_file' has been deleted.  The index entries of the record are
+   left alone; searches skip them, and index merges drop them.
+   Returns FALSE on error. */
+int add_tombstone PROTO((file_struct *data_file, off_t offset));
+
+/* is_tombstoned: returns TRUE if the record at 'offset' in the data
+   file 'data_file' has been deleted.  Each data file's tombstones are
+   read once and kept until its tombstone file changes.  'data_file'
+   holds on to them, so the tombstone file is only checked the first
+   time a given file_struct (normally one per search) is asked
+   about. */
+int is_tombstoned PROTO((file_struct *data_file, off_t offset));
+
+/* unlink_tombstones: deletes the tombstone file of 'data_file', for
+   when the data file itself is deleted or reindexed */
+void unlink_tombstones PROTO((file_struct *data_file));
+
+#endif /* _TOMBSTONE_H_ */
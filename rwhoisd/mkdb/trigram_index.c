@@ -0,0 +1,338 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "trigram_index.h"
+
+#include "defines.h"
+#include "fileinfo.h"
+#include "index.h"
+#include "log.h"
+#include "misc.h"
+
+/* ------------------- Local Functions --------------------- */
+
+static int
+compare_trigram(a, b)
+  const void *a;
+  const void *b;
+{
+  return(strcmp((const char *) a, (const char *) b));
+}
+
+static int
+compare_posting_list_size(a, b)
+  const void *a;
+  const void *b;
+{
+  const posting_list_struct *la = a;
+  const posting_list_struct *lb = b;
+
+  if (la->num_postings != lb->num_postings)
+  {
+    return(la->num_postings < lb->num_postings ? -1 : 1);
+  }
+
+  return(0);
+}
+
+static int
+compare_posting_file(a, b)
+  const void *a;
+  const void *b;
+{
+  return(((const posting_struct *) a)->data_file_no -
+         ((const posting_struct *) b)->data_file_no);
+}
+
+/* read_postings: adds to 'list' the postings for 'value' in the
+   trigram index file 'file', leaving out those of deleted records
+   and, unless 'attribute_id' is -2, of other attributes */
+static int
+read_postings(file, value, attribute_id, list)
+  file_struct         *file;
+  char                *value;
+  int                 attribute_id;
+  posting_list_struct *list;
+{
+  query_term_struct key;
+
+  bzero((char *) &key, sizeof(key));
+  key.search_type  = MKDB_BINARY_SEARCH;
+  key.comp_type    = MKDB_FULL_COMPARE;
+  key.attribute_id = attribute_id;
+  key.search_value = value;
+
+  return(read_index_postings(file, &key, list));
+}
+
+/* is_index_complete: returns TRUE if the trigram index files in
+   'trigram_fi_list' cover every data file in 'data_fi_list' */
+static int
+is_index_complete(trigram_fi_list, data_fi_list)
+  dl_list_type  *trigram_fi_list;
+  dl_list_type  *data_fi_list;
+{
+  posting_list_struct covered;
+  posting_struct      key;
+  file_struct         *file;
+  int                 status        = TRUE;
+  int                 not_done;
+
+  bzero((char *) &covered, sizeof(covered));
+
+  not_done = dl_list_first(trigram_fi_list);
+  while (not_done && status)
+  {
+    file   = dl_list_value(trigram_fi_list);
+    status = read_postings(file, TRIGRAM_INDEX_COVER_VALUE, -2, &covered);
+
+    not_done = dl_list_next(trigram_fi_list);
+  }
+
+  sort_postings(&covered);
+
+  not_done = status && dl_list_first(data_fi_list);
+  while (not_done)
+  {
+    file = dl_list_value(data_fi_list);
+
+    /* the cover lines don't name a record, so only the data file
+       tells them apart */
+    bzero((char *) &key, sizeof(key));
+    key.data_file_no = file->file_no;
+
+    if (covered.num_postings == 0 ||
+        !bsearch(&key, covered.postings, covered.num_postings,
+                 sizeof(posting_struct), compare_posting_file))
+    {
+      log(L_LOG_DEBUG, MKDB, "data file '%s' has no trigram index",
+          file->filename);
+      status = FALSE;
+      break;
+    }
+
+    not_done = dl_list_next(data_fi_list);
+  }
+
+  clear_postings(&covered);
+
+  return(status);
+}
+
+
+/* ------------------- Public Functions -------------------- */
+
+int
+split_trigrams(value, trigrams_p)
+  char  *value;
+  char  **trigrams_p;
+{
+  char  *trigrams;
+  int   len;
+  int   num_trigrams  = 0;
+  int   n;
+  int   i;
+  int   j;
+
+  *trigrams_p = NULL;
+
+  if (!value || (len = strlen(value)) < TRIGRAM_LEN)
+  {
+    return(0);
+  }
+
+  trigrams = xcalloc(len - TRIGRAM_LEN + 1, TRIGRAM_LEN + 1);
+
+  for (i = 0; i + TRIGRAM_LEN <= len; i++)
+  {
+    for (j = 0; j < TRIGRAM_LEN; j++)
+    {
+      if (isspace((int) value[i + j]))
+      {
+        break;
+      }
+    }
+    if (j < TRIGRAM_LEN)
+    {
+      continue;
+    }
+
+    bcopy(value + i, trigrams + num_trigrams * (TRIGRAM_LEN + 1),
+          TRIGRAM_LEN);
+    num_trigrams++;
+  }
+
+  if (num_trigrams == 0)
+  {
+    free(trigrams);
+    return(0);
+  }
+
+  qsort(trigrams, num_trigrams, TRIGRAM_LEN + 1, compare_trigram);
+
+  for (i = 1, n = 1; i < num_trigrams; i++)
+  {
+    if (strcmp(trigrams + (n - 1) * (TRIGRAM_LEN + 1),
+               trigrams + i * (TRIGRAM_LEN + 1)))
+    {
+      bcopy(trigrams + i * (TRIGRAM_LEN + 1),
+            trigrams + n * (TRIGRAM_LEN + 1), TRIGRAM_LEN + 1);
+      n++;
+    }
+  }
+
+  *trigrams_p = trigrams;
+  return(n);
+}
+
+int
+find_trigram_postings(index_fi_list, data_fi_list, query_item, result)
+  dl_list_type        *index_fi_list;
+  dl_list_type        *data_fi_list;
+  query_term_struct   *query_item;
+  posting_list_struct *result;
+{
+  dl_list_type        trigram_fi_list;
+  posting_list_struct *lists          = NULL;
+  file_struct         *file;
+  char                *trigrams       = NULL;
+  int                 num_trigrams;
+  int                 status          = TRUE;
+  int                 not_done;
+  int                 i;
+
+  dl_list_default(&trigram_fi_list, FALSE, destroy_file_struct_data);
+
+  if (!filter_file_list(&trigram_fi_list, MKDB_TRIGRAM_INDEX_FILE,
+                        index_fi_list) ||
+      dl_list_empty(&trigram_fi_list))
+  {
+    dl_list_destroy(&trigram_fi_list);
+    return FALSE;
+  }
+
+  num_trigrams = split_trigrams(query_item->search_value, &trigrams);
+
+  if (num_trigrams == 0 ||
+      !is_index_complete(&trigram_fi_list, data_fi_list))
+  {
+    if (trigrams)
+    {
+      free(trigrams);
+    }
+    dl_list_destroy(&trigram_fi_list);
+    return FALSE;
+  }
+
+  /* gather each trigram's postings */
+  lists = xcalloc(num_trigrams, sizeof(posting_list_struct));
+
+  for (i = 0; i < num_trigrams && status; i++)
+  {
+    not_done = dl_list_first(&trigram_fi_list);
+    while (not_done && status)
+    {
+      file   = dl_list_value(&trigram_fi_list);
+      status = read_postings(file, trigrams + i * (TRIGRAM_LEN + 1),
+                             query_item->attribute_id, &(lists[i]));
+
+      not_done = dl_list_next(&trigram_fi_list);
+    }
+
+    sort_postings(&(lists[i]));
+  }
+
+  if (status)
+  {
+    /* starting with the rarest trigram keeps the intersection small */
+    qsort(lists, num_trigrams, sizeof(posting_list_struct),
+          compare_posting_list_size);
+
+    for (i = 1; i < num_trigrams && lists[0].num_postings > 0; i++)
+    {
+      intersect_postings(&(lists[0]), &(lists[i]));
+    }
+
+    *result = lists[0];
+    bzero((char *) &(lists[0]), sizeof(lists[0]));
+  }
+
+  for (i = 0; i < num_trigrams; i++)
+  {
+    clear_postings(&(lists[i]));
+  }
+  free(lists);
+  free(trigrams);
+
+  dl_list_destroy(&trigram_fi_list);
+
+  return(status);
+}
+
+int
+search_trigram_index(class, auth_area, index_fi_list, data_fi_list,
+                     query_item, record_list, max_hits, ret_code)
+  class_struct      *class;
+  auth_area_struct  *auth_area;
+  dl_list_type      *index_fi_list;
+  dl_list_type      *data_fi_list;
+  query_term_struct *query_item;
+  dl_list_type      *record_list;
+  int               max_hits;
+  ret_code_type     *ret_code;
+{
+  posting_list_struct candidates;
+  index_struct        *items;
+  file_struct         *file         = NULL;
+  long                n;
+  int                 not_done;
+
+  *ret_code = SEARCH_SUCCESSFUL;
+
+  bzero((char *) &candidates, sizeof(candidates));
+
+  if (!find_trigram_postings(index_fi_list, data_fi_list, query_item,
+                             &candidates))
+  {
+    return FALSE;
+  }
+
+  /* the hits are credited to the first trigram index file */
+  not_done = dl_list_first(index_fi_list);
+  while (not_done && !file)
+  {
+    file = dl_list_value(index_fi_list);
+    if (file->type != MKDB_TRIGRAM_INDEX_FILE)
+    {
+      file = NULL;
+    }
+    not_done = dl_list_next(index_fi_list);
+  }
+
+  if (candidates.num_postings > 0)
+  {
+    items = xcalloc(candidates.num_postings, sizeof(index_struct));
+
+    for (n = 0; n < candidates.num_postings; n++)
+    {
+      items[n].offset       = candidates.postings[n].offset;
+      items[n].data_file_no = candidates.postings[n].data_file_no;
+      items[n].attribute_id = candidates.postings[n].attribute_id;
+    }
+
+    *ret_code = candidate_scan(class, auth_area, file, data_fi_list,
+                               query_item, record_list, max_hits, items,
+                               candidates.num_postings);
+    free(items);
+  }
+
+  clear_postings(&candidates);
+
+  return TRUE;
+}
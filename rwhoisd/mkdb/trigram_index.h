@@ -0,0 +1,67 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _TRIGRAM_INDEX_H_
+#define _TRIGRAM_INDEX_H_
+
+/* includes */
+
+#include "common.h"
+#include "dl_list.h"
+#include "mkdb_types.h"
+#include "search_prim.h"
+#include "types.h"
+
+/* defines */
+
+#define TRIGRAM_LEN                 3
+
+/* the value of the lines of a trigram index file that say which data
+   files it covers, one line per data file.  No trigram is this
+   short. */
+#define TRIGRAM_INDEX_COVER_VALUE   "0"
+
+/* prototypes */
+
+/* split_trigrams: sets 'trigrams_p' to an allocated block of the
+   distinct trigrams of 'value', in order, each a NUL terminated
+   string TRIGRAM_LEN + 1 bytes apart.  Trigrams with whitespace in
+   them are left out, as an index line can't end in whitespace.
+   Returns the number of trigrams, leaving 'trigrams_p' NULL if there
+   are none. */
+int split_trigrams PROTO((char *value, char **trigrams_p));
+
+/* find_trigram_postings: sets 'result' to the postings of the records
+   (and attributes) that have every trigram of the substring search
+   'query_item', as found in the trigram index files in
+   'index_fi_list'.  These are the only ones that can match.  Returns
+   FALSE, leaving 'result' alone, if the trigram index can't answer
+   the query: the search value has no trigrams, or some data file in
+   'data_fi_list' isn't covered by the index. */
+int find_trigram_postings PROTO((dl_list_type        *index_fi_list,
+                                 dl_list_type        *data_fi_list,
+                                 query_term_struct   *query_item,
+                                 posting_list_struct *result));
+
+/* search_trigram_index: does the substring search 'query_item' with
+   the trigram index files in 'index_fi_list', reading only the
+   records that have every trigram of the search value.  Returns
+   FALSE, having done nothing, if the trigram index can't answer the
+   query (see find_trigram_postings()).  Otherwise the result of the
+   search is put in 'ret_code'. */
+int search_trigram_index PROTO((class_struct      *class,
+                                auth_area_struct  *auth_area,
+                                dl_list_type      *index_fi_list,
+                                dl_list_type      *data_fi_list,
+                                query_term_struct *query_item,
+                                dl_list_type      *record_list,
+                                int               max_hits,
+                                ret_code_type     *ret_code));
+
+#endif /* _TRIGRAM_INDEX_H_ */
@@ -0,0 +1,311 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "updated_index.h"
+
+#include "arena.h"
+#include "defines.h"
+#include "fileinfo.h"
+#include "index.h"
+#include "log.h"
+#include "misc.h"
+#include "search_prim.h"
+
+/* local types */
+
+/* updated_scan_struct: what has been gathered from the Updated index
+   files so far */
+typedef struct _updated_scan_struct
+{
+  int           *covered;       /* data file numbers covered */
+  int           num_covered;
+  index_struct  **hits;
+  int           num_hits;
+} updated_scan_struct;
+
+/* ------------------- Local Functions --------------------- */
+
+static int
+compare_file_no(a, b)
+  const void *a;
+  const void *b;
+{
+  return(*(const int *) a - *(const int *) b);
+}
+
+/* compare_hit: orders hits by data file and offset, putting any
+   deletion of a record first */
+static int
+compare_hit(a, b)
+  const void *a;
+  const void *b;
+{
+  const index_struct *ha = *(index_struct * const *) a;
+  const index_struct *hb = *(index_struct * const *) b;
+
+  if (ha->data_file_no != hb->data_file_no)
+  {
+    return(ha->data_file_no - hb->data_file_no);
+  }
+  if (ha->offset != hb->offset)
+  {
+    return(ha->offset < hb->offset ? -1 : 1);
+  }
+
+  return(hb->deleted_flag - ha->deleted_flag);
+}
+
+/* find_first_updated: returns the position of the first line at or
+   after 'low' (the start of a line) that might be at or after
+   'serial_no'.  Every line before it is known to be earlier. */
+static off_t
+find_first_updated(fp, low, high, serial_no)
+  FILE  *fp;
+  off_t low;
+  off_t high;
+  char  *serial_no;
+{
+  char          line[MAX_LINE];
+  index_struct  item;
+  off_t         mid;
+  off_t         beg_of_line = -1;
+  off_t         end_of_line;
+
+  while (low < high)
+  {
+    /* avoid overflow: K&R 2nd Ed. p. 138 */
+    mid = low + (high - low) / 2;
+
+    if (!scan_for_bol(fp, low, &mid, high) ||
+        beg_of_line == mid || mid == high)
+    {
+      break;
+    }
+    beg_of_line = mid;
+
+    if (!readline(fp, line, MAX_LINE))
+    {
+      break;
+    }
+    end_of_line = ftell(fp);
+
+    if (!decode_index_line(line, &item))
+    {
+      break;
+    }
+
+    if (strcmp(item.value, serial_no) >= 0)
+    {
+      high = beg_of_line;
+    }
+    else
+    {
+      low = end_of_line;
+    }
+
+    arena_free(item.value);
+  }
+
+  return(low);
+}
+
+/* read_updated_index_file: adds the data files the Updated index file
+   covers, and its lines at or after 'serial_no', to 'scan' */
+static int
+read_updated_index_file(file, serial_no, scan)
+  file_struct         *file;
+  char                *serial_no;
+  updated_scan_struct *scan;
+{
+  FILE          *fp;
+  char          line[MAX_LINE];
+  index_struct  item;
+  off_t         pos               = 0;
+  off_t         size;
+
+  if ((fp = fopen(file->filename, "r")) == NULL)
+  {
+    log(L_LOG_ERR, MKDB, "could not open index file '%s': %s",
+        file->filename, strerror(errno));
+    return FALSE;
+  }
+
+  /* the lines naming the data files covered sort first */
+  while (readline(fp, line, MAX_LINE))
+  {
+    if (!decode_index_line(line, &item))
+    {
+      pos = ftell(fp);
+      continue;
+    }
+
+    if (!STR_EQ(item.value, UPDATED_INDEX_COVER_VALUE))
+    {
+      arena_free(item.value);
+      break;
+    }
+
+    scan->covered = xrealloc(scan->covered,
+                             (scan->num_covered + 1) * sizeof(int));
+    scan->covered[scan->num_covered++] = item.data_file_no;
+
+    arena_free(item.value);
+    pos = ftell(fp);
+  }
+
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+
+  /* skip to the changes we want, then take the rest of the file */
+  pos = find_first_updated(fp, pos, size, serial_no);
+  fseek(fp, pos, SEEK_SET);
+
+  while (readline(fp, line, MAX_LINE))
+  {
+    if (!decode_index_line(line, &item))
+    {
+      continue;
+    }
+
+    if (strcmp(item.value, serial_no) < 0)
+    {
+      arena_free(item.value);
+      continue;
+    }
+
+    scan->hits = xrealloc(scan->hits,
+                          (scan->num_hits + 1) * sizeof(index_struct *));
+    scan->hits[scan->num_hits++] = xmemdup(&item, sizeof(item));
+  }
+
+  fclose(fp);
+
+  return TRUE;
+}
+
+/* is_file_covered: returns TRUE if the data file number is among the
+   (sorted) covered file numbers */
+static int
+is_file_covered(scan, file_no)
+  updated_scan_struct *scan;
+  int                 file_no;
+{
+  if (scan->num_covered == 0)
+  {
+    return FALSE;
+  }
+
+  return(bsearch(&file_no, scan->covered, scan->num_covered, sizeof(int),
+                 compare_file_no) != NULL);
+}
+
+
+/* ------------------- Public Functions -------------------- */
+
+int
+find_updated_records(file_list, serial_no, hit_list)
+  dl_list_type *file_list;
+  char         *serial_no;
+  dl_list_type *hit_list;
+{
+  updated_scan_struct scan;
+  dl_list_type        index_file_list;
+  dl_list_type        data_file_list;
+  file_struct         *file;
+  index_struct        *prev          = NULL;
+  int                 status         = TRUE;
+  int                 not_done;
+  int                 i;
+
+  if (!file_list || NOT_STR_EXISTS(serial_no) || !hit_list)
+  {
+    return FALSE;
+  }
+
+  bzero((char *) &scan, sizeof(scan));
+
+  dl_list_default(&index_file_list, FALSE, destroy_file_struct_data);
+  dl_list_default(&data_file_list, FALSE, destroy_file_struct_data);
+
+  /* no Updated index at all: it predates the index, or the class has
+     no Updated attribute */
+  if (!filter_file_list(&index_file_list, MKDB_UPDATED_INDEX_FILE,
+                        file_list) ||
+      dl_list_empty(&index_file_list))
+  {
+    dl_list_destroy(&index_file_list);
+    return FALSE;
+  }
+  filter_file_list(&data_file_list, MKDB_DATA_FILE, file_list);
+
+  not_done = dl_list_first(&index_file_list);
+  while (not_done && status)
+  {
+    file   = dl_list_value(&index_file_list);
+    status = read_updated_index_file(file, serial_no, &scan);
+
+    not_done = dl_list_next(&index_file_list);
+  }
+
+  if (scan.covered)
+  {
+    qsort(scan.covered, scan.num_covered, sizeof(int), compare_file_no);
+  }
+
+  /* every data file must have been indexed with its Updated values */
+  not_done = status && dl_list_first(&data_file_list);
+  while (not_done)
+  {
+    file = dl_list_value(&data_file_list);
+    if (!is_file_covered(&scan, file->file_no))
+    {
+      log(L_LOG_DEBUG, MKDB, "data file '%s' has no Updated index",
+          file->filename);
+      status = FALSE;
+      break;
+    }
+
+    not_done = dl_list_next(&data_file_list);
+  }
+
+  if (scan.hits)
+  {
+    qsort(scan.hits, scan.num_hits, sizeof(index_struct *), compare_hit);
+  }
+
+  /* hand over one item per record; a deletion sorts before the
+     record's other items */
+  for (i = 0; i < scan.num_hits; i++)
+  {
+    if (!status ||
+        (prev && prev->data_file_no == scan.hits[i]->data_file_no &&
+         prev->offset == scan.hits[i]->offset))
+    {
+      destroy_index_item(scan.hits[i]);
+      continue;
+    }
+
+    prev = scan.hits[i];
+    dl_list_append(hit_list, prev);
+  }
+
+  if (scan.covered)
+  {
+    free(scan.covered);
+  }
+  if (scan.hits)
+  {
+    free(scan.hits);
+  }
+
+  dl_list_destroy(&index_file_list);
+  dl_list_destroy(&data_file_list);
+
+  return(status);
+}
@@ -0,0 +1,33 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _UPDATED_INDEX_H_
+#define _UPDATED_INDEX_H_
+
+/* includes */
+
+#include "common.h"
+#include "mkdb_types.h"
+
+/* prototypes */
+
+/* find_updated_records: using the Updated index files in the master
+   file list 'file_list', appends to 'hit_list' (of index_struct) an
+   item for each record whose Updated value is at or after
+   'serial_no', and for each record deleted since then.  Items for
+   deleted records have their deleted flag set and the time of the
+   deletion as their value.  The items are in data file order, one per
+   record.  Returns FALSE, leaving 'hit_list' alone, if the Updated
+   index doesn't cover every data file in the list, in which case the
+   caller has to look at every record itself. */
+int find_updated_records PROTO((dl_list_type *file_list,
+                                char         *serial_no,
+                                dl_list_type *hit_list));
+
+#endif /* _UPDATED_INDEX_H_ */
@@ -9,10 +9,13 @@
 
 #include "daemon.h"
 
+#include "cidr_tree.h"
 #include "fileutils.h"
 #include "log.h"
 #include "main.h"  /* ugh */
 #include "main_config.h"
+#include "misc.h"
+#include "referral_table.h"
 #include "security.h"
 #include "session.h"
 #include "sslave.h"
@@ -22,6 +25,20 @@
 static int hup_recvd    = FALSE;
 static int num_children = 0;
 
+/* worker pool state: the parent keeps the pids of its pooled workers
+   (0 for an empty slot), and of the workers retired by a SIGHUP that
+   have yet to finish their sessions; a worker notes that it has been
+   told to exit once it is idle */
+static pid_t        *worker_pids      = NULL;
+static int          num_worker_slots  = 0;
+static pid_t        *retiring_pids    = NULL;
+static int          num_retiring      = 0;
+static volatile int worker_recycle    = FALSE;
+
+/* how often (in seconds) the parent checks on its worker pool when it
+   isn't otherwise woken up by a signal */
+#define WORKER_POLL_INTERVAL 2
+
 /* -------------------- Local Functions ----------------- */
 
 /* logpid: put the pid in a specified file */
@@ -90,7 +107,36 @@ daemonize()
   umask(0);
 }
 
-/* the sigchld signal handler */
+/* forget_worker: clears the slot of the pooled worker 'pid', retired
+   or not, once it has gone away.  The worker tables are only changed
+   elsewhere with SIGCHLD blocked. */
+static void
+forget_worker(pid)
+  pid_t pid;
+{
+  int   i;
+
+  for (i = 0; i < num_worker_slots; i++)
+  {
+    if (worker_pids[i] == pid)
+    {
+      worker_pids[i] = 0;
+      return;
+    }
+  }
+
+  for (i = 0; i < num_retiring; i++)
+  {
+    if (retiring_pids[i] == pid)
+    {
+      retiring_pids[i] = 0;
+      return;
+    }
+  }
+}
+
+/* the sigchld signal handler.  This is the only place that the
+   parent reaps its children, so it keeps the count of them. */
 static RETSIGTYPE
 sigchld_handler(arg)
   int   arg;
@@ -102,12 +148,26 @@ sigchld_handler(arg)
      Stevens.. */
   while ( (pid = waitpid((pid_t)-1, &status, WNOHANG)) > 0)
   {
-    num_children--;
+    /* slave refresh children aren't counted against max-children */
+    if (!note_slave_child_exit(pid, status))
+    {
+      num_children--;
+      forget_worker(pid);
+    }
   }
+}
+
+/* block_sigchld: holds off (or with 'block' FALSE, lets in again)
+   SIGCHLD, while the worker tables are changed */
+static void
+block_sigchld(block)
+  int   block;
+{
+  sigset_t  chld_set;
 
-  /* reset the signal handler -- some older systems remove the signal
-     handler upon use.  POSIX systems should not do this */
-  signal(SIGCHLD, sigchld_handler);
+  sigemptyset(&chld_set);
+  sigaddset(&chld_set, SIGCHLD);
+  sigprocmask(block ? SIG_BLOCK : SIG_UNBLOCK, &chld_set, (sigset_t *) NULL);
 }
 
 static RETSIGTYPE
@@ -118,11 +178,37 @@ sighup_handler(arg)
   signal(SIGHUP, sighup_handler);
 }
 
+/* signal_workers: sends 'sig' to every pooled worker, retired or
+   not */
+static void
+signal_workers(sig)
+  int   sig;
+{
+  int   i;
+
+  for (i = 0; i < num_worker_slots; i++)
+  {
+    if (worker_pids[i] > 0)
+    {
+      kill(worker_pids[i], sig);
+    }
+  }
+
+  for (i = 0; i < num_retiring; i++)
+  {
+    if (retiring_pids[i] > 0)
+    {
+      kill(retiring_pids[i], sig);
+    }
+  }
+}
+
 static RETSIGTYPE
 exit_handler(arg)
   int   arg;
 {
   log(L_LOG_NOTICE, UNKNOWN, "Exiting");
+  signal_workers(SIGTERM);
   delpid();
   exit(0);
 }
@@ -156,37 +242,439 @@ reinit()
   }
 
   log(L_LOG_NOTICE, CONFIG, "server re-initialized");
-  if (num_children > 0)
+  if (!worker_pids && num_children > 0)
   {
     log(L_LOG_NOTICE, CONFIG, "%d child(ren) did not reinitialize",
         num_children);
   }
 }
 
+/* the SIGHUP handler for a pooled worker.  The worker exits once it
+   has finished its current session, if it is in one, and the parent
+   replaces it with a worker running the new configuration. */
+static RETSIGTYPE
+worker_hup_handler(arg)
+  int   arg;
+{
+  worker_recycle = TRUE;
+}
+
+/* accept_client: accepts a connection on the listening socket, which
+   is non-blocking so that a process that loses the race for a
+   connection to another doesn't sleep in accept().  The session does
+   blocking I/O, so the new socket is made blocking whatever it
+   inherited.  Returns -1 (with errno set) if there is no connection
+   after all. */
+static int
+accept_client(sockfd)
+  int   sockfd;
+{
+#ifdef HAVE_IPV6
+  struct sockaddr_storage client_addr;
+#else
+  struct sockaddr_in    client_addr;
+#endif
+  socklen_t             clilen;
+  int                   newsockfd;
+  int                   flags;
+
+  clilen    = sizeof(client_addr);
+  newsockfd = accept(sockfd, (struct sockaddr *) &client_addr, &clilen);
+
+  if (newsockfd >= 0 && (flags = fcntl(newsockfd, F_GETFL, 0)) >= 0 &&
+      (flags & O_NONBLOCK))
+  {
+    fcntl(newsockfd, F_SETFL, flags & ~O_NONBLOCK);
+  }
+
+  return(newsockfd);
+}
+
+/* accept_retry: returns TRUE if the accept() error 'err' just means
+   that there was no connection to take */
+static int
+accept_retry(err)
+  int   err;
+{
+  return(err == EINTR || err == EAGAIN || err == EWOULDBLOCK ||
+         err == ECONNABORTED);
+}
+
+/* attach_client: makes the accepted socket the process's stdin and
+   stdout, which is where run_session() does its I/O */
+static int
+attach_client(newsockfd)
+  int   newsockfd;
+{
+  if (dup2(newsockfd, 0) == -1)
+  {
+    log(L_LOG_ERR, CONFIG, "run_daemon: dup error: %s", strerror(errno));
+    return FALSE;
+  }
+  if (dup2(newsockfd, 1) == -1)
+  {
+    log(L_LOG_ERR, CONFIG, "run_daemon: dup error: %s", strerror(errno));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* detach_client: ends the connection attached by attach_client().
+   The socket is shut down rather than just closed, since fds 0 and 1
+   stay pointing at it until the next client is attached (this keeps
+   accept() from ever handing back fd 0 or 1). */
+static void
+detach_client(newsockfd)
+  int   newsockfd;
+{
+  fflush(stdout);
+
+  shutdown(newsockfd, 2);
+  close(newsockfd);
+
+  /* discard anything the client sent that the session didn't read */
+  while (getc(stdin) != EOF)
+    ;
+  clearerr(stdin);
+  clearerr(stdout);
+}
+
+/* run_worker: the main loop of a pooled worker process.  It accepts
+   and serves sessions until it has served its quota, or until it is
+   told to recycle itself. */
+static void
+run_worker(sockfd)
+  int   sockfd;
+{
+  struct sigaction      act;
+  fd_set                accept_fds;
+  sigset_t              wait_set;
+  int                   newsockfd;
+  int                   ready;
+  int                   num_sessions = 0;
+  int                   max_sessions = get_worker_max_sessions();
+
+  /* the parent's handlers don't apply to us */
+  signal(SIGCHLD, SIG_DFL);
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  block_sigchld(FALSE);
+
+  /* SIGHUP (blocked by spawn_worker()) is only let in while we wait
+     in pselect(), which it interrupts; so it never lands between a
+     client being accepted and its session being run, and one that
+     arrives before we wait still wakes us up */
+  sigprocmask(SIG_BLOCK, (sigset_t *) NULL, &wait_set);
+  sigdelset(&wait_set, SIGHUP);
+
+  bzero(&act, sizeof(act));
+  act.sa_handler = worker_hup_handler;
+  sigemptyset(&act.sa_mask);
+  sigaction(SIGHUP, &act, (struct sigaction *) NULL);
+
+  /* renice once for the life of the worker */
+  if (get_child_priority() != 0)
+  {
+    nice(get_child_priority());
+  }
+
+  while (!worker_recycle && (max_sessions <= 0 ||
+                             num_sessions < max_sessions))
+  {
+    FD_ZERO(&accept_fds);
+    FD_SET(sockfd, &accept_fds);
+    ready = pselect(sockfd + 1, &accept_fds, (fd_set *) NULL,
+                    (fd_set *) NULL, (struct timespec *) NULL, &wait_set);
+    if (ready <= 0)
+    {
+      if (ready < 0 && errno != EINTR)
+      {
+        log(L_LOG_ERR, NET, "run_worker: select error: %s",
+            strerror(errno));
+        sleep(1);
+      }
+      continue;
+    }
+
+    newsockfd = accept_client(sockfd);
+    if (newsockfd < 0)
+    {
+      if (!accept_retry(errno))
+      {
+        log(L_LOG_ERR, NET, "run_worker: accept error: %s",
+            strerror(errno));
+        sleep(1);
+      }
+      continue;
+    }
+
+    num_sessions++;
+
+    if (!attach_client(newsockfd))
+    {
+      exit(1);
+    }
+
+    if (authorized_client())
+    {
+      log(L_LOG_INFO, CLIENT, "accepted rwhois connection");
+
+      /* a register or refresh may have changed the CIDR indexes since
+         we were forked */
+      refresh_cidr_tree_cache();
+      run_session(TRUE);
+    }
+    else
+    {
+      log(L_LOG_NOTICE, CLIENT, "rejected rwhoisd connection");
+    }
+
+    detach_client(newsockfd);
+    reset_session();
+  }
+
+  exit(0);
+}
+
+/* spawn_worker: forks a new pooled worker into slot 'slot' */
+static void
+spawn_worker(sockfd, slot)
+  int   sockfd;
+  int   slot;
+{
+  sigset_t  hup_set;
+  sigset_t  old_set;
+  pid_t     pid;
+
+  /* keep SIGHUP out until the worker has its own handler, and SIGCHLD
+     out until its pid is in the table */
+  sigemptyset(&hup_set);
+  sigaddset(&hup_set, SIGHUP);
+  sigaddset(&hup_set, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &hup_set, &old_set);
+
+  if ((pid = fork()) < 0)
+  {
+    log(L_LOG_ERR, CONFIG, "spawn_worker: fork error: %s", strerror(errno));
+    worker_pids[slot] = 0;
+    sigprocmask(SIG_SETMASK, &old_set, (sigset_t *) NULL);
+    return;
+  }
+  else if (pid == 0)
+  {
+    run_worker(sockfd);
+  }
+
+  worker_pids[slot] = pid;
+  num_children++;
+
+  sigprocmask(SIG_SETMASK, &old_set, (sigset_t *) NULL);
+}
+
+/* retire_workers: tells the pooled workers to exit once they are idle
+   and empties the pool.  The retired workers count against the pool
+   size until they have gone, so that old and new workers together
+   never serve more sessions than the pool allows. */
+static void
+retire_workers()
+{
+  int   i;
+
+  signal_workers(SIGHUP);
+
+  block_sigchld(TRUE);
+
+  retiring_pids = xrealloc(retiring_pids,
+                           (num_retiring + num_worker_slots + 1) *
+                           sizeof(pid_t));
+  for (i = 0; i < num_worker_slots; i++)
+  {
+    if (worker_pids[i] > 0)
+    {
+      retiring_pids[num_retiring++] = worker_pids[i];
+      worker_pids[i] = 0;
+    }
+  }
+
+  block_sigchld(FALSE);
+}
+
+/* count_workers: drops the retired workers that have gone away from
+   the table, and returns the number of workers (retired or not) still
+   running.  Our SIGCHLD handler reaps the workers and clears their
+   slots. */
+static int
+count_workers()
+{
+  int   live  = 0;
+  int   i;
+  int   j;
+
+  block_sigchld(TRUE);
+
+  for (i = 0, j = 0; i < num_retiring; i++)
+  {
+    if (retiring_pids[i] > 0)
+    {
+      retiring_pids[j++] = retiring_pids[i];
+    }
+  }
+  num_retiring = j;
+
+  for (i = 0; i < num_worker_slots; i++)
+  {
+    if (worker_pids[i] > 0)
+    {
+      live++;
+    }
+  }
+
+  block_sigchld(FALSE);
+
+  return(live + num_retiring);
+}
+
+/* size_worker_pool: (re)allocates the worker table according to the
+   current configuration.  The pool is never larger than max-children,
+   so max-children still bounds the number of concurrent sessions. */
+static void
+size_worker_pool()
+{
+  int   pool_size = get_worker_pool_size();
+
+  if (get_max_children() > 0 && pool_size > get_max_children())
+  {
+    log(L_LOG_NOTICE, CONFIG,
+        "worker-pool-size %d exceeds max-children; using %d workers",
+        pool_size, get_max_children());
+    pool_size = get_max_children();
+  }
+
+  block_sigchld(TRUE);
+
+  if (worker_pids)
+  {
+    free(worker_pids);
+  }
+  worker_pids      = xcalloc(pool_size, sizeof(pid_t));
+  num_worker_slots = pool_size;
+
+  block_sigchld(FALSE);
+}
+
+/* run_worker_pool: the parent's main loop when using a worker pool.
+   The workers do all of the accept()ing; the parent just keeps the
+   pool full and handles reinitialization.  Returns if a
+   reinitialization turns the pool off. */
+static void
+run_worker_pool(sockfd)
+  int   sockfd;
+{
+  int   live;
+  int   i;
+
+  size_worker_pool();
+
+  log(L_LOG_NOTICE, CONFIG, "starting pool of %d workers", num_worker_slots);
+
+  for (;;)
+  {
+    if (hup_recvd)
+    {
+      reinit();
+      hup_recvd = FALSE;
+
+      /* have the current workers exit (once they are idle) and
+         replace them with a fresh set with the new configuration */
+      retire_workers();
+
+      if (get_worker_pool_size() <= 0)
+      {
+        log(L_LOG_NOTICE, CONFIG,
+            "worker pool turned off; forking a child per connection");
+
+        /* the retired workers are still counted in num_children */
+        block_sigchld(TRUE);
+        free(worker_pids);
+        worker_pids      = NULL;
+        num_worker_slots = 0;
+        free(retiring_pids);
+        retiring_pids    = NULL;
+        num_retiring     = 0;
+        block_sigchld(FALSE);
+        return;
+      }
+
+      size_worker_pool();
+    }
+
+    run_slave_refresh();
+
+    refresh_referral_table();
+    refresh_cidr_tree_cache();
+
+    /* replace any worker that has gone away, as the retired workers
+       leave room */
+    live = count_workers();
+    for (i = 0; i < num_worker_slots && live < num_worker_slots; i++)
+    {
+      if (worker_pids[i] <= 0)
+      {
+        spawn_worker(sockfd, i);
+        if (worker_pids[i] > 0)
+        {
+          live++;
+        }
+      }
+    }
+
+    flush_log_files();
+
+    /* wait for something to happen (SIGCHLD, SIGHUP, SIGALRM) */
+    sleep(WORKER_POLL_INTERVAL);
+  }
+}
+
 /* -------------------- Public Functions ---------------- */
 
+/* recycle_workers: has the pooled workers replaced (once they are
+   idle) by fresh ones forked from the parent's current state */
+void
+recycle_workers()
+{
+  signal_workers(SIGHUP);
+}
+
 void
 no_zombies()
 {
+  struct sigaction act;
+
   /* we need the sigchld handler to limit the number of concurrent
-     processes */
-  signal(SIGCHLD, sigchld_handler);
+     processes.  It is installed without SA_RESTART, so that it also
+     interrupts the main loop when a slave refresh child is done. */
+  bzero(&act, sizeof(act));
+  act.sa_handler = sigchld_handler;
+  sigemptyset(&act.sa_mask);
+  sigaction(SIGCHLD, &act, (struct sigaction *) NULL);
 }
 
 int
 run_daemon()
 {
 #ifdef HAVE_IPV6
-  struct sockaddr_storage client_addr;
   struct sockaddr_in6     server_addr;
 #else
-  struct sockaddr_in    client_addr;
   struct sockaddr_in    server_addr;
 #endif
+  fd_set                accept_fds;
+  sigset_t              wait_set;
+  sigset_t              old_set;
   int                   sockfd;
   int                   newsockfd;
-  int                   clilen;
   int                   childpid;
+  int                   ready;
   int                   one          = 1;
   int                   port         = get_port();
   int                   failure      = 0;
@@ -245,6 +733,10 @@ run_daemon()
 
   listen(sockfd, get_listen_queue_length());
 
+  /* we (or the pooled workers) only accept() once select() has seen a
+     connection, but another process may take it first */
+  fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+
   no_zombies();
 
   if (get_background())
@@ -264,6 +756,19 @@ run_daemon()
 
   log(L_LOG_NOTICE, CONFIG, "rwhoisd ready to answer queries");
 
+  if (get_worker_pool_size() > 0)
+  {
+    run_worker_pool(sockfd);
+  }
+
+  /* (a reinitialization may have turned the worker pool off) */
+
+  /* the signals that need the main loop's attention */
+  sigemptyset(&wait_set);
+  sigaddset(&wait_set, SIGHUP);
+  sigaddset(&wait_set, SIGCHLD);
+  sigaddset(&wait_set, SIGALRM);
+
   /* main loop: accepts a client connection and then forks off a child
      to handle it */
   for (;;)
@@ -274,11 +779,43 @@ run_daemon()
       hup_recvd = FALSE;
     }
 
-    clilen = sizeof(client_addr);
-    newsockfd = accept(sockfd, (struct sockaddr *) &client_addr, &clilen);
+    run_slave_refresh();
+
+    /* pick up any change to the referral data and CIDR indexes
+       before forking more children */
+    refresh_referral_table();
+    refresh_cidr_tree_cache();
+
+    flush_log_files();
+
+    /* wait for a client.  The signals are held off from the checks
+       above until pselect() lets them in, so one that arrives in
+       between still wakes us up, rather than waiting for the next
+       client. */
+    sigprocmask(SIG_BLOCK, &wait_set, &old_set);
+    ready = 0;
+    if (!hup_recvd && !slave_refresh_pending())
+    {
+      FD_ZERO(&accept_fds);
+      FD_SET(sockfd, &accept_fds);
+      ready = pselect(sockfd + 1, &accept_fds, (fd_set *) NULL,
+                      (fd_set *) NULL, (struct timespec *) NULL, &old_set);
+    }
+    sigprocmask(SIG_SETMASK, &old_set, (sigset_t *) NULL);
+
+    if (ready <= 0)
+    {
+      if (ready < 0 && errno != EINTR)
+      {
+        fprintf(stderr, "run_daemon: select error: %s\n", strerror(errno));
+      }
+      continue;
+    }
+
+    newsockfd = accept_client(sockfd);
     if (newsockfd < 0)
     {
-      if (errno == EINTR)
+      if (accept_retry(errno))
       {
         continue;
       }
@@ -20,4 +20,6 @@ int run_daemon PROTO((void));
 
 void no_zombies PROTO((void));
 
+void recycle_workers PROTO((void));
+
 #endif /* _DAEMON_H_ */
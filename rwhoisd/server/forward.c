@@ -13,15 +13,660 @@
 #include "conf.h"
 #include "defines.h"
 #include "directive_conf.h"
-#include "holdconnect.h"
+#include "dl_list.h"
 #include "log.h"
 #include "main_config.h"
 #include "misc.h"
-#include "procutils.h"
+#include "sresponse.h"
 #include "strutil.h"
 
+/* local defines */
+
+/* the number of upstream connections kept open */
+#define MAX_FORWARD_CONNECTIONS 4
+
+/* the number of referrals followed from a referral */
+#define MAX_FORWARD_DEPTH       4
+
+/* the number of forwarded responses kept, if forward-cache-ttl is
+   set */
+#define MAX_FORWARD_CACHE       64
+
+/* local types */
+
+/* forward_conn_struct: an open connection to an upstream server,
+   along with whatever has been read from it but not yet used */
+typedef struct _forward_conn_struct
+{
+  char    host[MAX_LINE];
+  int     port;
+  int     sockfd;       /* -1 if the slot is unused */
+  int     persistent;   /* TRUE if the server held the connection */
+  int     timeout;      /* its forward-timeout */
+  time_t  last_used;
+  char    buf[BUFSIZ];
+  int     buf_len;
+  int     buf_pos;
+} forward_conn_struct;
+
+/* forward_cache_struct: the response of an upstream server to a
+   query */
+typedef struct _forward_cache_struct
+{
+  char          *key;     /* "host:port query" */
+  time_t        expires;
+  dl_list_type  lines;
+} forward_cache_struct;
+
+/* local statics */
+
 static char original_query_buf[MAX_LINE];
 
+/* the connections and the cache last as long as the process: across
+   sessions in a pooled worker, but only for the one session in a
+   child forked for it */
+static forward_conn_struct forward_conns[MAX_FORWARD_CONNECTIONS];
+static int                 forward_conns_init = FALSE;
+
+static dl_list_type        forward_cache;
+static int                 forward_cache_size = 0;
+static int                 forward_cache_init = FALSE;
+
+/* local prototypes */
+
+static int parse_referral PROTO((char *referral, char *host, int *port));
+
+static void close_forward_conn PROTO((forward_conn_struct *conn));
+
+static int read_forward_line PROTO((forward_conn_struct *conn,
+                                    char                *line,
+                                    int                 size));
+
+static int write_forward_line PROTO((forward_conn_struct *conn,
+                                     char                *line));
+
+static forward_conn_struct *get_forward_conn PROTO((char *host, int port,
+                                                    int  *fresh));
+
+static int exchange_query PROTO((forward_conn_struct *conn,
+                                 char                *query,
+                                 dl_list_type        *lines));
+
+static int query_upstream PROTO((char         *host,
+                                 int          port,
+                                 char         *query,
+                                 dl_list_type *lines));
+
+static int destroy_forward_cache_data PROTO((forward_cache_struct *fc));
+
+static int find_cached_response PROTO((char         *key,
+                                       dl_list_type *lines));
+
+static void cache_response PROTO((char *key, dl_list_type *lines));
+
+static int follow_referral PROTO((char         *referral,
+                                  char         *query,
+                                  int          depth,
+                                  dl_list_type *visited,
+                                  int          *found_flag));
+
+/* ------------------- Local Functions --------------------- */
+
+/* parse_referral: gets the host and port out of a referral, either
+   "rwhois://host[:port][/auth-area=name]" or the older
+   "host:port:rwhois".  Returns FALSE if it is neither. */
+static int
+parse_referral(referral, host, port)
+  char  *referral;
+  char  *host;
+  int   *port;
+{
+  char  buf[MAX_LINE];
+  char  *p;
+  char  *q;
+
+  if (NOT_STR_EXISTS(referral) || strlen(referral) >= MAX_LINE)
+  {
+    return FALSE;
+  }
+
+  strcpy(buf, referral);
+  trim(buf);
+
+  *port = DEFAULT_PORT;
+
+  if (STRN_EQ(buf, "rwhois://", 9))
+  {
+    p = buf + 9;
+
+    /* a bracketed IPv6 address */
+    if (*p == '[')
+    {
+      p++;
+      if ((q = strchr(p, ']')) == NULL)
+      {
+        return FALSE;
+      }
+      *q++ = '\0';
+    }
+    else
+    {
+      q = p + strcspn(p, ":/");
+    }
+
+    if (*q == ':')
+    {
+      *q++ = '\0';
+      *port = atoi(q);
+    }
+    else
+    {
+      *q = '\0';
+    }
+  }
+  else
+  {
+    /* host:port:rwhois */
+    p = buf;
+    if ((q = strchr(p, ':')) == NULL)
+    {
+      return FALSE;
+    }
+    *q++ = '\0';
+    *port = atoi(q);
+    if ((q = strchr(q, ':')) == NULL || !STR_EQ(q + 1, "rwhois"))
+    {
+      return FALSE;
+    }
+  }
+
+  if (!*p || *port <= 0)
+  {
+    return FALSE;
+  }
+
+  strcpy(host, p);
+
+  return TRUE;
+}
+
+static void
+close_forward_conn(conn)
+  forward_conn_struct *conn;
+{
+  if (conn->sockfd >= 0)
+  {
+    close(conn->sockfd);
+  }
+
+  conn->sockfd  = -1;
+  conn->buf_len = 0;
+  conn->buf_pos = 0;
+}
+
+/* read_forward_line: reads a line from an upstream server, waiting no
+   more than its forward-timeout for it.  Returns 1 if a line was read, 0
+   if the server closed the connection and -1 if it timed out. */
+static int
+read_forward_line(conn, line, size)
+  forward_conn_struct *conn;
+  char                *line;
+  int                 size;
+{
+  struct timeval  tv;
+  fd_set          rfds;
+  int             timeout = conn->timeout;
+  int             len     = 0;
+  int             n;
+  char            c;
+
+  for (;;)
+  {
+    while (conn->buf_pos < conn->buf_len)
+    {
+      c = conn->buf[conn->buf_pos++];
+      if (c == '\n')
+      {
+        line[len] = '\0';
+        strip_trailing(line, '\r');
+        return(1);
+      }
+      if (len < size - 1)
+      {
+        line[len++] = c;
+      }
+    }
+
+    FD_ZERO(&rfds);
+    FD_SET(conn->sockfd, &rfds);
+    tv.tv_sec  = timeout;
+    tv.tv_usec = 0;
+
+    n = select(conn->sockfd + 1, &rfds, NULL, NULL, timeout ? &tv : NULL);
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n == 0)
+    {
+      log(L_LOG_WARNING, REFERRAL, "forward: %s:%d timed out",
+          conn->host, conn->port);
+      return(-1);
+    }
+
+    n = (n < 0) ? -1 : read(conn->sockfd, conn->buf, sizeof(conn->buf));
+    if (n <= 0)
+    {
+      return(0);
+    }
+
+    conn->buf_len = n;
+    conn->buf_pos = 0;
+  }
+}
+
+/* write_forward_line: sends a line to an upstream server.  Returns
+   FALSE if the server has gone away. */
+static int
+write_forward_line(conn, line)
+  forward_conn_struct *conn;
+  char                *line;
+{
+  char      buf[MAX_LINE + 2];
+  RETSIGTYPE (*old_handler) PROTO((int));
+  int       len;
+  int       n;
+
+  sprintf(buf, "%.*s\r\n", MAX_LINE - 1, line);
+  len = strlen(buf);
+
+  /* a closed connection shouldn't kill us */
+  old_handler = signal(SIGPIPE, SIG_IGN);
+  n = write(conn->sockfd, buf, len);
+  signal(SIGPIPE, old_handler);
+
+  return(n == len);
+}
+
+/* get_forward_conn: returns an open connection to host:port, reusing
+   one if we have it.  'fresh' is set if the connection is new. */
+static forward_conn_struct *
+get_forward_conn(host, port, fresh)
+  char  *host;
+  int   port;
+  int   *fresh;
+{
+  forward_conn_struct *conn = NULL;
+  char                line[MAX_LINE];
+  int                 i;
+
+  if (!forward_conns_init)
+  {
+    for (i = 0; i < MAX_FORWARD_CONNECTIONS; i++)
+    {
+      forward_conns[i].sockfd = -1;
+    }
+    forward_conns_init = TRUE;
+  }
+
+  *fresh = FALSE;
+
+  for (i = 0; i < MAX_FORWARD_CONNECTIONS; i++)
+  {
+    if (forward_conns[i].sockfd >= 0 && forward_conns[i].port == port &&
+        STR_EQ(forward_conns[i].host, host))
+    {
+      forward_conns[i].last_used = time(NULL);
+      return(&forward_conns[i]);
+    }
+  }
+
+  /* an unused slot, or else the least recently used one */
+  for (i = 0; i < MAX_FORWARD_CONNECTIONS; i++)
+  {
+    if (forward_conns[i].sockfd < 0)
+    {
+      conn = &forward_conns[i];
+      break;
+    }
+    if (!conn || forward_conns[i].last_used < conn->last_used)
+    {
+      conn = &forward_conns[i];
+    }
+  }
+
+  close_forward_conn(conn);
+
+  conn->timeout = get_upstream_forward_timeout(host, port);
+  conn->sockfd  = open_server_socket(host, port, conn->timeout);
+  if (conn->sockfd < 0)
+  {
+    return NULL;
+  }
+
+  strncpy(conn->host, host, MAX_LINE - 1);
+  conn->port       = port;
+  conn->persistent = FALSE;
+  conn->last_used  = time(NULL);
+  *fresh           = TRUE;
+
+  /* the banner */
+  if (read_forward_line(conn, line, MAX_LINE) != 1 ||
+      !STRN_EQ(line, "%rwhois", 7))
+  {
+    log(L_LOG_WARNING, REFERRAL, "forward: %s:%d is not an rwhois server",
+        host, port);
+    close_forward_conn(conn);
+    return NULL;
+  }
+
+  /* ask to keep the connection; if the server won't, it is closed
+     after the query */
+  if (write_forward_line(conn, "-holdconnect on") &&
+      read_forward_line(conn, line, MAX_LINE) == 1 &&
+      STRN_EQ(line, "%ok", 3))
+  {
+    conn->persistent = TRUE;
+  }
+
+  return(conn);
+}
+
+/* exchange_query: sends 'query' to an upstream server and reads the
+   response lines (but not the closing %ok or %error) into 'lines'.
+   Returns 1 on success, 0 if the server closed the connection before
+   responding and -1 on any other error. */
+static int
+exchange_query(conn, query, lines)
+  forward_conn_struct *conn;
+  char                *query;
+  dl_list_type        *lines;
+{
+  char  line[MAX_LINE];
+  int   status;
+  int   first_line  = TRUE;
+
+  if (!write_forward_line(conn, query))
+  {
+    return(0);
+  }
+
+  while ((status = read_forward_line(conn, line, MAX_LINE)) == 1)
+  {
+    first_line = FALSE;
+
+    if (STRN_EQ(line, "%ok", 3) || STRN_EQ(line, "%error", 6))
+    {
+      return(1);
+    }
+
+    /* other than referrals, status lines are for the session with
+       the upstream server, not for our client */
+    if (*line == '%' && !STRN_EQ(line, "%referral", 9))
+    {
+      continue;
+    }
+
+    dl_list_append(lines, xstrdup(line));
+  }
+
+  if (status == 0 && first_line)
+  {
+    return(0);
+  }
+
+  return(-1);
+}
+
+/* query_upstream: sends 'query' to the server at host:port, putting
+   the response lines in 'lines'.  Returns FALSE if the server could
+   not be reached. */
+static int
+query_upstream(host, port, query, lines)
+  char          *host;
+  int           port;
+  char          *query;
+  dl_list_type  *lines;
+{
+  forward_conn_struct *conn;
+  int                 fresh;
+  int                 status;
+
+  if ((conn = get_forward_conn(host, port, &fresh)) == NULL)
+  {
+    return FALSE;
+  }
+
+  status = exchange_query(conn, query, lines);
+
+  /* the server may have dropped an idle connection; try a new one */
+  if (status == 0 && !fresh)
+  {
+    close_forward_conn(conn);
+    if ((conn = get_forward_conn(host, port, &fresh)) == NULL)
+    {
+      return FALSE;
+    }
+    status = exchange_query(conn, query, lines);
+  }
+
+  if (status != 1 || !conn->persistent)
+  {
+    close_forward_conn(conn);
+  }
+
+  if (status != 1)
+  {
+    log(L_LOG_WARNING, REFERRAL, "forward: no response from %s:%d",
+        host, port);
+    dl_list_destroy(lines);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static int
+destroy_forward_cache_data(fc)
+  forward_cache_struct  *fc;
+{
+  if (!fc)
+  {
+    return TRUE;
+  }
+
+  if (fc->key)
+  {
+    free(fc->key);
+  }
+
+  dl_list_destroy(&(fc->lines));
+
+  free(fc);
+
+  return TRUE;
+}
+
+/* find_cached_response: copies the cached response for 'key' into
+   'lines', dropping expired responses along the way.  Returns FALSE
+   if there isn't one. */
+static int
+find_cached_response(key, lines)
+  char          *key;
+  dl_list_type  *lines;
+{
+  forward_cache_struct  *fc;
+  time_t                now       = time(NULL);
+  int                   not_done;
+
+  if (!forward_cache_init)
+  {
+    return FALSE;
+  }
+
+  /* responses are kept in the order they were cached, so the expired
+     ones are at the front */
+  while (dl_list_first(&forward_cache))
+  {
+    fc = dl_list_value(&forward_cache);
+    if (fc->expires > now)
+    {
+      break;
+    }
+    dl_list_delete(&forward_cache);
+    forward_cache_size--;
+  }
+
+  not_done = dl_list_first(&forward_cache);
+  while (not_done)
+  {
+    fc = dl_list_value(&forward_cache);
+
+    if (STR_EQ(fc->key, key))
+    {
+      not_done = dl_list_first(&(fc->lines));
+      while (not_done)
+      {
+        dl_list_append(lines, xstrdup(dl_list_value(&(fc->lines))));
+        not_done = dl_list_next(&(fc->lines));
+      }
+      return TRUE;
+    }
+
+    not_done = dl_list_next(&forward_cache);
+  }
+
+  return FALSE;
+}
+
+/* cache_response: keeps a copy of 'lines' as the response for 'key',
+   dropping the oldest response if the cache is full */
+static void
+cache_response(key, lines)
+  char          *key;
+  dl_list_type  *lines;
+{
+  forward_cache_struct  *fc;
+  int                   not_done;
+
+  if (!forward_cache_init)
+  {
+    dl_list_default(&forward_cache, FALSE, destroy_forward_cache_data);
+    forward_cache_init = TRUE;
+  }
+
+  if (forward_cache_size >= MAX_FORWARD_CACHE &&
+      dl_list_first(&forward_cache))
+  {
+    dl_list_delete(&forward_cache);
+    forward_cache_size--;
+  }
+
+  fc          = xcalloc(1, sizeof(*fc));
+  fc->key     = xstrdup(key);
+  fc->expires = time(NULL) + get_forward_cache_ttl();
+  dl_list_default(&(fc->lines), FALSE, simple_destroy_data);
+
+  not_done = dl_list_first(lines);
+  while (not_done)
+  {
+    dl_list_append(&(fc->lines), xstrdup(dl_list_value(lines)));
+    not_done = dl_list_next(lines);
+  }
+
+  dl_list_append(&forward_cache, fc);
+  forward_cache_size++;
+}
+
+/* follow_referral: sends 'query' to the server named by 'referral'
+   and relays its response to the client, following the referrals in
+   it in turn.  'visited' holds the servers already asked, so none is
+   asked twice.  Sets 'found_flag' if anything was relayed.  Returns
+   FALSE if the referral could not be followed. */
+static int
+follow_referral(referral, query, depth, visited, found_flag)
+  char          *referral;
+  char          *query;
+  int           depth;
+  dl_list_type  *visited;
+  int           *found_flag;
+{
+  dl_list_type  lines;
+  char          host[MAX_LINE];
+  char          key[MAX_LINE * 3];
+  char          *line;
+  char          *p;
+  int           port;
+  int           not_done;
+
+  if (!parse_referral(referral, host, &port))
+  {
+    return FALSE;
+  }
+
+  sprintf(key, "%s:%d", host, port);
+
+  not_done = dl_list_first(visited);
+  while (not_done)
+  {
+    if (STR_EQ(dl_list_value(visited), key))
+    {
+      return TRUE;
+    }
+    not_done = dl_list_next(visited);
+  }
+  dl_list_append(visited, xstrdup(key));
+
+  sprintf(key, "%s:%d %s", host, port, query);
+
+  dl_list_default(&lines, FALSE, simple_destroy_data);
+
+  if (get_forward_cache_ttl() <= 0 || !find_cached_response(key, &lines))
+  {
+    log(L_LOG_INFO, REFERRAL, "forwarding query to %s:%d", host, port);
+
+    if (!query_upstream(host, port, query, &lines))
+    {
+      return FALSE;
+    }
+
+    if (get_forward_cache_ttl() > 0)
+    {
+      cache_response(key, &lines);
+    }
+  }
+
+  not_done = dl_list_first(&lines);
+  while (not_done)
+  {
+    line = dl_list_value(&lines);
+
+    if (STRN_EQ(line, "%referral", 9))
+    {
+      p = skip_whitespace(line + 9);
+      if (depth >= MAX_FORWARD_DEPTH ||
+          !follow_referral(p, query, depth + 1, visited, found_flag))
+      {
+        print_response(RESP_REFERRAL, "%s", p);
+        *found_flag = TRUE;
+      }
+    }
+    else
+    {
+      print_response(RESP_QUERY, "%s", line);
+      *found_flag = TRUE;
+    }
+
+    not_done = dl_list_next(&lines);
+  }
+
+  dl_list_destroy(&lines);
+
+  return TRUE;
+}
+
+/* ------------------- Public Functions -------------------- */
+
 /**************************************************************************
   sets the cache value
    toggles it for now
@@ -37,7 +682,7 @@ forward_directive( str )
   }
 
   log(L_LOG_DEBUG, CLIENT, "forward directive: %s", str);
-    
+
 /*   print_ok(); */
   return TRUE;
 }
@@ -46,18 +691,26 @@ forward_directive( str )
   forwards the request
 **************************************************************************/
 int
-forward_request(host, query, auth_area)
-  char *host;
-  char *query;
-  char *auth_area;
-
+forward_request(referral, found_flag)
+  char *referral;
+  int  *found_flag;
 {
-  char param_str[MAX_LINE];
+  dl_list_type  visited;
+  int           rval;
 
-  sprintf(param_str, "-h %s %s", host, query);
-  run_program(DEFAULT_CLIENT_PROG, param_str);
+  if (!*original_query_buf)
+  {
+    return FALSE;
+  }
 
-  return TRUE;
+  dl_list_default(&visited, FALSE, simple_destroy_data);
+
+  rval = follow_referral(referral, original_query_buf, 0, &visited,
+                         found_flag);
+
+  dl_list_destroy(&visited);
+
+  return(rval);
 }
 
 /**************************************************************************
@@ -68,7 +721,7 @@ save_original_query (query_str)
   char *query_str;
 
 {
-  strcpy(original_query_buf, query_str);
+  strncpy(original_query_buf, query_str, MAX_LINE - 1);
 
   return TRUE;
 }
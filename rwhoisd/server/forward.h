@@ -18,10 +18,16 @@
 
 int forward_directive PROTO((char *str));
 
-/* useless
-int forward_request PROTO((char *host, char *query, char *auth_area));
+/* forward_request: follows 'referral' for a -forward client: sends
+   the saved original query to the server it names and relays the
+   response, following any referrals in it in turn.  Upstream
+   connections are kept open between queries.  Sets 'found_flag' if
+   anything was relayed.  Returns FALSE if the server could not be
+   reached, in which case the referral should be given instead. */
+int forward_request PROTO((char *referral, int *found_flag));
+
 int save_original_query PROTO((char *query_str));
+
 char *original_query PROTO((void));
-*/
 
 #endif /* _FORWARD_H_ */
@@ -10,6 +10,7 @@
 #include "security_directive.h"
 #include "guardian.h"
 
+#include "arena.h"
 #include "attributes.h"
 #include "client_msgs.h"
 #include "defines.h"
@@ -26,6 +27,25 @@
 #include "types.h"
 
 
+/* the most guardians remembered at once */
+#define GUARDIAN_CACHE_SIZE   64
+
+/* guardian_cache_struct: a guardian looked up during this session,
+   and the outcome of checking the session's credentials against it.
+   'guard' is NULL if the guardian link was stale. */
+typedef struct _guardian_cache_struct
+{
+  char          *guard_id;
+  record_struct *guard;
+  int           checked;
+  char          *scheme;        /* the credentials last checked */
+  char          *info;
+  int           check_result;
+} guardian_cache_struct;
+
+static dl_list_type guardian_cache;
+static int          guardian_cache_init = FALSE;
+
 /*--------------------- LOCAL FUNCTIONS ---------------------------*/
 
 static int
@@ -203,6 +223,7 @@ lookup_guardian_record(guard_id)
   dl_list_type      new_rec_list;
   record_struct     *guard;
   record_struct     *result;
+  arena_type        *old_arena;
   ret_code_type     ret_code;
   int               num_recs;
 
@@ -250,7 +271,10 @@ lookup_guardian_record(guard_id)
     return NULL;
   }
 
-  result = copy_record(guard);
+  /* the cached copy outlives the query it was looked up for */
+  old_arena = arena_bind(NULL);
+  result    = copy_record(guard);
+  arena_bind(old_arena);
 
   dl_list_destroy(&new_rec_list);
 
@@ -258,6 +282,117 @@ lookup_guardian_record(guard_id)
 }
 
 
+static int
+destroy_guardian_cache_data(gc)
+  guardian_cache_struct *gc;
+{
+  if (!gc)
+  {
+    return TRUE;
+  }
+
+  if (gc->guard)
+  {
+    destroy_record_data(gc->guard);
+  }
+  if (gc->guard_id)
+  {
+    free(gc->guard_id);
+  }
+  if (gc->scheme)
+  {
+    free(gc->scheme);
+  }
+  if (gc->info)
+  {
+    free(gc->info);
+  }
+
+  free(gc);
+
+  return TRUE;
+}
+
+/* get_cached_guardian: returns the cache entry for 'guard_id',
+   looking the guardian up if this session hasn't yet.  Stale links
+   are remembered as well. */
+static guardian_cache_struct *
+get_cached_guardian(guard_id)
+  char *guard_id;
+{
+  guardian_cache_struct *gc;
+  int                   not_done;
+
+  if (!guardian_cache_init)
+  {
+    dl_list_default(&guardian_cache, FALSE, destroy_guardian_cache_data);
+    guardian_cache_init = TRUE;
+  }
+
+  not_done = dl_list_first(&guardian_cache);
+  while (not_done)
+  {
+    gc = dl_list_value(&guardian_cache);
+    if (STR_EQ(gc->guard_id, guard_id))
+    {
+      return(gc);
+    }
+    not_done = dl_list_next(&guardian_cache);
+  }
+
+  /* make room by dropping the oldest */
+  if (dl_list_first(&guardian_cache) &&
+      dl_list_next_value(&guardian_cache, GUARDIAN_CACHE_SIZE - 1))
+  {
+    dl_list_delete(&guardian_cache);
+  }
+
+  gc           = xcalloc(1, sizeof(*gc));
+  gc->guard_id = xstrdup(guard_id);
+  gc->guard    = lookup_guardian_record(guard_id);
+
+  dl_list_append(&guardian_cache, gc);
+
+  return(gc);
+}
+
+/* check_cached_credentials: check_credentials() against a cached
+   guardian, reusing the last outcome if the credentials are the
+   same */
+static int
+check_cached_credentials(gc, request)
+  guardian_cache_struct *gc;
+  auth_struct           *request;
+{
+  if (!request || !request->scheme || !request->info)
+  {
+    return(check_credentials(gc->guard, request));
+  }
+
+  if (gc->checked &&
+      strcmp(gc->scheme, request->scheme) == 0 &&
+      strcmp(gc->info, request->info) == 0)
+  {
+    return(gc->check_result);
+  }
+
+  if (gc->scheme)
+  {
+    free(gc->scheme);
+  }
+  if (gc->info)
+  {
+    free(gc->info);
+  }
+
+  gc->check_result = check_credentials(gc->guard, request);
+  gc->scheme       = xstrdup(request->scheme);
+  gc->info         = xstrdup(request->info);
+  gc->checked      = TRUE;
+
+  return(gc->check_result);
+}
+
 /* this function returns TRUE if the record is guarded, FALSE if not.  */
 static int
 is_record_guarded(record)
@@ -305,9 +440,9 @@ int
 check_guardian(record)
   record_struct *record;
 {
-  av_pair_struct *av_pair;
-  record_struct  *guard;
-  auth_struct    *request         = get_request_auth_struct();
+  av_pair_struct        *av_pair;
+  guardian_cache_struct *guard;
+  auth_struct           *request  = get_request_auth_struct();
   char           *guard_id;
   char           *rec_id;
   char           *scheme;
@@ -365,9 +500,9 @@ check_guardian(record)
       continue;
     }
     guard_id = (char *)av_pair->value;
-    guard = lookup_guardian_record(guard_id);
+    guard = get_cached_guardian(guard_id);
 
-    if (!guard)
+    if (!guard->guard)
     {
       /* we have discovered a stale guardian link */
       log(L_LOG_WARNING, UNKNOWN, "stale guardian link '%s' in object '%s'",
@@ -381,12 +516,10 @@ check_guardian(record)
        get to fail immediately */
     if (get_rwhois_secure_mode() == FALSE)
     {
-      destroy_record_data(guard);
       return FALSE;
     }
 
-    status = check_credentials(guard, request);
-    destroy_record_data(guard);
+    status = check_cached_credentials(guard, request);
 
     if (status > 0)
     {
@@ -403,10 +536,10 @@ check_guardian(record)
     while (not_done)
     {
       guard_id = dl_list_value(record->auth_area->guardian_list);
-      guard = lookup_guardian_record(guard_id);
+      guard = get_cached_guardian(guard_id);
       not_done = dl_list_next(record->auth_area->guardian_list);
 
-      if (!guard)
+      if (!guard->guard)
       {
         /* we have discovered a stale guardian link */
         log(L_LOG_WARNING, UNKNOWN,
@@ -417,12 +550,10 @@ check_guardian(record)
 
       if (get_rwhois_secure_mode() == FALSE)
       {
-        destroy_record_data(guard);
         return FALSE;
       }
 
-      status = check_credentials(guard, request);
-      destroy_record_data(guard);
+      status = check_cached_credentials(guard, request);
 
       if (status > 0)
       {
@@ -521,7 +652,7 @@ transform_guardian_record(rec)
       (STR_EQ(scheme, "pw") || STR_EQ(scheme, "passwd") ||
        STR_EQ(scheme, "password")))
   {
-    free(av->value);
+    arena_free(av->value);
     av->value = xstrdup("pw");
     scheme = (char *)av->value;
   }
@@ -537,9 +668,21 @@ transform_guardian_record(rec)
   if (STR_EXISTS(info) && STR_EXISTS(scheme) && STR_EQ(scheme, "crypt-pw"))
   {
     info = crypt(info, generate_salt());
-    free(av->value);
+    arena_free(av->value);
     av->value = xstrdup(info);
   }
 
   return TRUE;
 }
+
+/* forgets every guardian looked up so far; for the end of a session,
+   or when a guardian object has been registered */
+void
+clear_guardian_cache()
+{
+  if (guardian_cache_init)
+  {
+    dl_list_destroy(&guardian_cache);
+    guardian_cache_init = FALSE;
+  }
+}
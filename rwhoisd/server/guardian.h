@@ -25,5 +25,10 @@ int is_guardian_record PROTO((record_struct *record));
 
 int transform_guardian_record PROTO((record_struct *record));
 
+/* check_guardian() remembers each guardian it looks up (and the
+   outcome of checking the session's credentials against it) until
+   this is called */
+void clear_guardian_cache PROTO((void));
+
 #endif /* _GUARDIAN_H_ */
 
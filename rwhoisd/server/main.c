@@ -10,6 +10,7 @@
 #include "main.h"
 
 #include "auth_area.h"
+#include "cidr_tree.h"
 #include "conf.h"
 #include "daemon.h"
 #include "defines.h"
@@ -17,6 +18,7 @@
 #include "log.h"
 #include "main_config.h"
 #include "read_config.h"
+#include "referral_table.h"
 #include "security.h"
 #include "session.h"
 
@@ -207,6 +209,15 @@ initialize()
   init_server_state(); 
   
   chdir_root_dir();
+
+  /* a daemon builds the referral table and CIDR index trees once,
+     for all of its children, rather than each building them on its
+     first query */
+  if (is_daemon_server())
+  {
+    build_referral_table();
+    build_cidr_tree_cache();
+  }
 }
 
   
@@ -14,13 +14,14 @@
 #include "client_msgs.h"
 #include "common_regexps.h"
 #include "defines.h"
+#include "forward.h"
 #include "ip_network.h"
 #include "log.h"
 #include "misc.h"
 #include "mkdb_types.h"
 #include "parse.h"
 #include "records.h"
-#include "search.h"
+#include "referral_table.h"
 #include "strutil.h"
 #include "main_config.h"
 
@@ -45,20 +46,12 @@ static int within_network PROTO((char *subnetwork,
 
 static int get_up_referral PROTO((dl_list_type *referral_list));
 
-static int get_down_referral PROTO((char         *hvalue,
-                                    int          htype,
-                                    char         *aa_name,
-                                    dl_list_type *referral_list));
+static int get_down_referral PROTO((char             *hvalue,
+                                    int              htype,
+                                    auth_area_struct *auth_area,
+                                    dl_list_type     *referral_list));
 
-static int reduce_domain PROTO((char *domain));
-
-static int reduce_network PROTO((char *network));
-
-static int build_referral_query PROTO((query_struct *query,
-                                       char         *search_value,
-                                       char         *aa_name));
-
-static void print_referral_list PROTO((dl_list_type *referral_list));
+static int print_referral_list PROTO((dl_list_type *referral_list));
 
 static void destroy_referral_list PROTO((dl_list_type *referral_list));
 
@@ -281,11 +274,6 @@ static int
 get_up_referral(referral_list)
   dl_list_type *referral_list;
 {
-  FILE            *fp;
-  char            *punt_file;
-  char            line[MAX_LINE];
-  referral_struct *referral;
- 
   if (!referral_list)
   {
     return(FALSE);
@@ -297,243 +285,40 @@ get_up_referral(referral_list)
     return(FALSE);
   }
 
-  /* Read the punt file.  There can be multiple referral entries in
-     the punt file */
-
-  punt_file = get_punt_file();
-  if ((fp = fopen(punt_file, "r")) == NULL)
-  {
-    log(L_LOG_ERR, REFERRAL, "could not open punt file '%s'", punt_file);
-    return(FALSE);
-  }
- 
-  bzero((char *) line, MAX_LINE);
-  while (readline(fp, line, MAX_LINE) != NULL)
-  {
-    if (line[0] != '\0' && line[0] != '#')
-    {
-      referral          = xcalloc(1, sizeof(*referral));
-      referral->to      = NEW_STRING(line);
-      referral->type    = UP_HIERARCHICAL;
-      referral->aa_name = NULL;
-      
-      dl_list_append(referral_list, referral);
-    }
-    bzero((char *) line, MAX_LINE);
-  }
-
-  fclose(fp);
-
-  if (!dl_list_empty(referral_list))
-  {
-    return(TRUE);
-  }
-
-  return(FALSE);
+  /* There can be multiple referral entries in the punt file */
+  return(find_punt_referrals(referral_list));
 }
 
 
 /* get_down_referral: This function gets link referrals to a
    referred authority area */ 
 static int
-get_down_referral(hvalue, htype, aa_name, referral_list)
-  char         *hvalue;
-  int          htype;
-  char         *aa_name;
-  dl_list_type *referral_list;
+get_down_referral(hvalue, htype, auth_area, referral_list)
+  char             *hvalue;
+  int              htype;
+  auth_area_struct *auth_area;
+  dl_list_type     *referral_list;
 {
-  query_struct      *query;
-  dl_list_type      record_list;
-  record_struct     *record;
-  dl_list_type      *pair_list;
-  av_pair_struct    *pair;
-  referral_struct   *referral;
-  int               not_done;
-  ret_code_type     ret_code;
-  char              *referred_aa_name = NULL;
-  
-  if (!hvalue  || !*hvalue  ||
-      !aa_name || !*aa_name ||
+  if (!hvalue    || !*hvalue  ||
+      !auth_area ||
       !referral_list)
   {
     return(TRUE);
   }
 
-  while (TRUE)
-  {
-    /* Search referral records in the authority area for
-       Referred-Auth-Area attribute equal to hierarchical
-       value */
-    query = xcalloc(1, sizeof(*query));
-    
-    if (!build_referral_query(query, hvalue, aa_name))
-    {
-      break;
-    }
-
-    dl_list_default(&record_list, FALSE, destroy_record_data);
-
-    search(query, &record_list, 1, &ret_code);
-
-    destroy_query(query);
-    
-    if (!dl_list_empty(&record_list))
-    {
-      dl_list_first(&record_list);
-      record    = dl_list_value(&record_list);
-
-      /* get the auth-area name from the "referred-auth-area" attribute */
-      pair = find_attr_in_record_by_name(record, "Referred-Auth-Area");
-      if (pair && STR_EXISTS((char *)pair->value))
-      {
-        referred_aa_name = (char *)pair->value;
-      }
-
-      /* for each "Referral" attribute, generate a referral structure */
-      pair_list = &(record->av_pair_list);
-      if (!dl_list_empty(pair_list))
-      {
-        not_done = dl_list_first(pair_list);
-        while (not_done)
-        {
-          pair = dl_list_value(pair_list);
-          if (STR_EQ(pair->attr->name, "Referral"))
-          {
-            referral          = xcalloc(1, sizeof(*referral));
-            referral->to      = NEW_STRING(pair->value);
-            referral->aa_name = NEW_STRING(referred_aa_name);
-            referral->type    = DOWN_HIERARCHICAL;
-            
-            dl_list_append(referral_list, referral);
-          }
-          not_done = dl_list_next(pair_list);
-        }
-      }
-    }
-
-    dl_list_destroy(&record_list);
-
-    if (!dl_list_empty(referral_list))
-    {
-      return(TRUE);
-    }
-
-    /* If search failed, reduce hierarchical value.  If
-       hierarchical value still within the authority area,
-       search again */
-    if (htype == NETWORK)
-    {
-      /* note that for networks, if the referred-auth-area attribute
-         was CIDR-indexed, reduction will undoubtedly not be necessary */
-      if (!reduce_network(hvalue))
-      {
-        break;
-      }
-    }
-    else if (htype == DOMAIN)
-    {
-      if (!reduce_domain(hvalue))
-      {
-        break;
-      }
-    }
-    if (!hierarchical_value_within_aa(hvalue, htype, aa_name))
-    {
-       break;
-    }
-  } /* while */
-
-  return(FALSE);
-}
-
-
-/* reduce_domain: This function reduces a domain */
-static int
-reduce_domain(domain)
-  char *domain;
-{
-  int  rval = FALSE;
-  char *p;
-
-  if (!domain || !*domain)
-  {
-    return(rval);
-  }
- 
-  /* Truncate leftmost label-dot */ 
-  strrev(domain);
-  if ((p = strrchr(domain, '.')) != NULL)
-  {
-    *p = '\0';
-    rval = TRUE;
-  }
-  strrev(domain);
-
-  return(rval);
-}
+  /* Find the referral record in the authority area with the most
+     specific Referred-Auth-Area containing the hierarchical value */
+  find_down_referrals(hvalue, htype, auth_area, referral_list);
 
-/* reduce_network: This function reduces a network */
-static int
-reduce_network(network)
-  char *network;
-{
-  struct netinfo ni;
- 
-  if (NOT_STR_EXISTS(network))
-  {
-    return(FALSE);
-  }
-
-  /* Get prefix, prefix length, and mask */
-  if ( ! get_network_prefix_and_len( network, &ni ) )
+  if (!dl_list_empty(referral_list))
   {
-    return(FALSE);
+    return(TRUE);
   }
 
-  /* reduce! */
-  ni.masklen--;
-  
-  /* Left-shift mask by one bit to get the new prefix */
-  mask_addr_to_len( &ni, ni.masklen );
-
-  /* Quad-octet prefix/prefix length format */
-  write_network( network, &ni );
-
-  return(TRUE);
+  return(FALSE);
 }
 
 
-static int
-build_referral_query(query, search_value, aa_name)
-  query_struct *query;
-  char *search_value;
-  char *aa_name;
-{
-  char query_str[MAX_LINE];
-
-  if (!query || NOT_STR_EXISTS(search_value))
-  {
-    log(L_LOG_ERR, REFERRAL, "build_referral_query: null data detected");
-    return FALSE;
-  }
-
-  sprintf(query_str, "referral Referred-Auth-Area=%s", search_value);
-
-  if (!parse_query(query_str, query))
-  {
-    log(L_LOG_ERR, REFERRAL, "referral query failed to parse: %s",
-        query_str);
-    return FALSE;
-  }
-
-  if (STR_EXISTS(aa_name))
-  {
-    query->auth_area_name = xstrdup(aa_name);
-  }
-
-  return TRUE;
-}
-
 static void
 print_referral(referral_to, aa_name)
   char *referral_to;
@@ -559,17 +344,20 @@ print_referral(referral_to, aa_name)
   }
 }
 
-/* print_referral_list: This function prints a referral list */
-static void
+/* print_referral_list: This function prints a referral list, or,
+   if the client has asked for -forward, follows the referrals in it.
+   Returns TRUE if anything was printed. */
+static int
 print_referral_list(referral_list)
   dl_list_type *referral_list;
 {
   int             not_done;
+  int             found_flag  = FALSE;
   referral_struct *referral;
 
   if (!referral_list)
   {
-    return;
+    return(FALSE);
   }
 
   if (!dl_list_empty(referral_list))
@@ -578,10 +366,16 @@ print_referral_list(referral_list)
     while (not_done)
     {
       referral = dl_list_value(referral_list);
-      print_referral(referral->to, referral->aa_name);
+      if (!get_forward() || !forward_request(referral->to, &found_flag))
+      {
+        print_referral(referral->to, referral->aa_name);
+        found_flag = TRUE;
+      }
       not_done = dl_list_next(referral_list);
     }
   }
+
+  return(found_flag);
 }
 
 
@@ -667,7 +461,7 @@ refer_query(query)
   /* Print referral list */
   if (rval)
   {
-    print_referral_list(&referral_list);
+    rval = print_referral_list(&referral_list);
   }
 
   destroy_referral_list(&referral_list);
@@ -685,7 +479,6 @@ refer_query_term(query_term, referral_list)
   dl_list_type     *auth_area_list    = NULL;
   auth_area_struct *auth_area;
   char             hvalue[MAX_LINE];
-  char             *tmp_hvalue;
   int              htype;
   int              not_done;
   int              within_an_aa = FALSE;
@@ -724,13 +517,10 @@ refer_query_term(query_term, referral_list)
          generated referral query. */
       if (!aa_has_referrals(auth_area)) break;
       
-      /* keep the hvalue from getting trashed */
-      tmp_hvalue = xstrdup(hvalue);
-      if (get_down_referral(tmp_hvalue, htype, auth_area->name, referral_list))
+      if (get_down_referral(hvalue, htype, auth_area, referral_list))
       {
         found_referral = TRUE;
       }
-      free(tmp_hvalue);
     }
     not_done = dl_list_next(auth_area_list);
   }
@@ -0,0 +1,802 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#include "referral_table.h"
+
+#include "auth_area.h"
+#include "defines.h"
+#include "dl_list.h"
+#include "fileinfo.h"
+#include "ip_network.h"
+#include "log.h"
+#include "main_config.h"
+#include "misc.h"
+#include "records.h"
+#include "referral.h"
+#include "schema.h"
+
+/* local types */
+
+/* referral_entry_struct: the Referral values of one referral record,
+   filed under one of its Referred-Auth-Area values */
+typedef struct _referral_entry_struct
+{
+  char          *aa_name;       /* the record's first Referred-Auth-Area */
+  dl_list_type  to_list;        /* of char *, the record's Referrals */
+} referral_entry_struct;
+
+/* domain_node_struct: a node in a tree of domain labels, rooted at
+   the top level domains.  Each node's children are its subdomains. */
+typedef struct _domain_node_struct
+{
+  char                        *label;
+  referral_entry_struct       *entry;
+  struct _domain_node_struct  *child;
+  struct _domain_node_struct  *sibling;
+} domain_node_struct;
+
+/* net_node_struct: a node in a binary tree of network prefixes; a
+   node's depth is its prefix length */
+typedef struct _net_node_struct
+{
+  referral_entry_struct     *entry;
+  struct _net_node_struct   *child[2];
+} net_node_struct;
+
+/* referral_area_struct: the referrals of one authority area, along
+   with what we need to tell if the area's referral data has since
+   been reindexed or registered to */
+typedef struct _referral_area_struct
+{
+  char                *aa_name;
+  int                 has_file_list;
+  ino_t               ino;
+  off_t               size;
+  time_t              mtime;
+  time_t              ctime;
+  domain_node_struct  *domain_root;
+  net_node_struct     *v4_root;
+  net_node_struct     *v6_root;
+} referral_area_struct;
+
+/* local statics */
+
+static dl_list_type referral_table;
+static int          referral_table_init = FALSE;
+
+/* the punt file, as last read */
+static char         punt_filename[MAX_FILE];
+static ino_t        punt_ino;
+static off_t        punt_size;
+static time_t       punt_mtime;
+static dl_list_type punt_list;
+static int          punt_list_init      = FALSE;
+
+/* ------------------- Local Functions --------------------- */
+
+static int
+destroy_referral_entry(entry)
+  referral_entry_struct *entry;
+{
+  if (!entry)
+  {
+    return TRUE;
+  }
+
+  dl_list_destroy(&(entry->to_list));
+
+  if (entry->aa_name)
+  {
+    free(entry->aa_name);
+  }
+
+  free(entry);
+
+  return TRUE;
+}
+
+static void
+destroy_domain_nodes(node)
+  domain_node_struct *node;
+{
+  domain_node_struct *next;
+
+  while (node)
+  {
+    next = node->sibling;
+
+    destroy_domain_nodes(node->child);
+    destroy_referral_entry(node->entry);
+    free(node->label);
+    free(node);
+
+    node = next;
+  }
+}
+
+static void
+destroy_net_nodes(node)
+  net_node_struct *node;
+{
+  if (!node)
+  {
+    return;
+  }
+
+  destroy_net_nodes(node->child[0]);
+  destroy_net_nodes(node->child[1]);
+  destroy_referral_entry(node->entry);
+  free(node);
+}
+
+static int
+destroy_referral_area_data(area)
+  referral_area_struct *area;
+{
+  if (!area)
+  {
+    return TRUE;
+  }
+
+  destroy_domain_nodes(area->domain_root);
+  destroy_net_nodes(area->v4_root);
+  destroy_net_nodes(area->v6_root);
+
+  if (area->aa_name)
+  {
+    free(area->aa_name);
+  }
+
+  free(area);
+
+  return TRUE;
+}
+
+/* net_bit: returns the value of bit number 'bit' (0 being the most
+   significant) of the address */
+static int
+net_bit(net, bit)
+  struct netinfo *net;
+  int            bit;
+{
+  return((net->prefix[bit >> 3] >> (7 - (bit & 7))) & 1);
+}
+
+/* next_label: returns the rightmost label of the domain 'domain',
+   which is 'len' characters long, and sets 'len' to the length of
+   what's left of it.  Returns NULL when there are no more labels. */
+static char *
+next_label(domain, len, label_len)
+  char  *domain;
+  int   *len;
+  int   *label_len;
+{
+  int   end;
+
+  /* skip any empty labels */
+  while (*len > 0 && domain[*len - 1] == '.')
+  {
+    (*len)--;
+  }
+  if (*len <= 0)
+  {
+    return NULL;
+  }
+
+  end = *len;
+  while (*len > 0 && domain[*len - 1] != '.')
+  {
+    (*len)--;
+  }
+
+  *label_len = end - *len;
+  return(domain + *len);
+}
+
+/* find_domain_node: finds the node for 'domain', creating it (and
+   any missing parents) if 'create' is set */
+static domain_node_struct *
+find_domain_node(root, domain, create)
+  domain_node_struct **root;
+  char               *domain;
+  int                create;
+{
+  domain_node_struct **link     = root;
+  domain_node_struct *node      = NULL;
+  char               *label;
+  int                len        = strlen(domain);
+  int                label_len;
+
+  while ((label = next_label(domain, &len, &label_len)) != NULL)
+  {
+    for (node = *link; node; node = node->sibling)
+    {
+      if (strlen(node->label) == label_len &&
+          STRN_EQ(node->label, label, label_len))
+      {
+        break;
+      }
+    }
+
+    if (!node)
+    {
+      if (!create)
+      {
+        return NULL;
+      }
+      node          = xcalloc(1, sizeof(*node));
+      node->label   = xcalloc(1, label_len + 1);
+      strncpy(node->label, label, label_len);
+      node->sibling = *link;
+      *link         = node;
+    }
+
+    link = &(node->child);
+  }
+
+  return(node);
+}
+
+/* find_net_node: finds the node for the network 'net', creating it
+   (and any missing parents) if 'create' is set */
+static net_node_struct *
+find_net_node(root, net, create)
+  net_node_struct **root;
+  struct netinfo  *net;
+  int             create;
+{
+  net_node_struct **link  = root;
+  int             bit;
+
+  for (bit = 0; ; bit++)
+  {
+    if (!*link)
+    {
+      if (!create)
+      {
+        return NULL;
+      }
+      *link = xcalloc(1, sizeof(**link));
+    }
+
+    if (bit == net->masklen)
+    {
+      return(*link);
+    }
+
+    link = &((*link)->child[net_bit(net, bit)]);
+  }
+}
+
+/* build_referral_entry: makes an entry out of the referral record
+   'record', or returns NULL if it has no Referrals */
+static referral_entry_struct *
+build_referral_entry(record, aa_name)
+  record_struct *record;
+  char          *aa_name;
+{
+  referral_entry_struct *entry;
+  dl_list_type          *pair_list;
+  av_pair_struct        *pair;
+  int                   not_done;
+
+  entry = xcalloc(1, sizeof(*entry));
+  dl_list_default(&(entry->to_list), FALSE, simple_destroy_data);
+
+  pair_list = &(record->av_pair_list);
+  not_done = dl_list_first(pair_list);
+  while (not_done)
+  {
+    pair = dl_list_value(pair_list);
+    if (pair && pair->attr && STR_EQ(pair->attr->name, "Referral") &&
+        STR_EXISTS((char *) pair->value))
+    {
+      dl_list_append(&(entry->to_list), xstrdup((char *) pair->value));
+    }
+    not_done = dl_list_next(pair_list);
+  }
+
+  if (dl_list_empty(&(entry->to_list)))
+  {
+    destroy_referral_entry(entry);
+    return NULL;
+  }
+
+  entry->aa_name = xstrdup(aa_name);
+
+  return(entry);
+}
+
+/* add_referral_record: files the referral record under each of its
+   Referred-Auth-Area values that falls within the authority area.
+   If a value already has a record, the first one is kept, as a
+   search limited to one hit would have found it. */
+static void
+add_referral_record(area, record)
+  referral_area_struct *area;
+  record_struct        *record;
+{
+  dl_list_type       *pair_list;
+  av_pair_struct     *pair;
+  av_pair_struct     *referred_aa;
+  domain_node_struct *dnode;
+  net_node_struct    *nnode;
+  struct netinfo     net;
+  char               *value;
+  int                not_done;
+
+  referred_aa = find_attr_in_record_by_name(record, "Referred-Auth-Area");
+  if (!referred_aa || NOT_STR_EXISTS((char *) referred_aa->value))
+  {
+    return;
+  }
+
+  pair_list = &(record->av_pair_list);
+  not_done = dl_list_first(pair_list);
+  while (not_done)
+  {
+    pair  = dl_list_value(pair_list);
+    value = pair ? (char *) pair->value : NULL;
+
+    if (!pair || !pair->attr || NOT_STR_EXISTS(value) ||
+        !STR_EQ(pair->attr->name, "Referred-Auth-Area"))
+    {
+      not_done = dl_list_next(pair_list);
+      continue;
+    }
+
+    if (is_network_valid_for_index(value) &&
+        get_network_prefix_and_len(value, &net))
+    {
+      mask_addr_to_len(&net, net.masklen);
+      nnode = NULL;
+      if (hierarchical_value_within_aa(value, NETWORK, area->aa_name))
+      {
+        nnode = find_net_node(net.af == AF_INET ? &(area->v4_root) :
+                              &(area->v6_root), &net, TRUE);
+      }
+      if (nnode && !nnode->entry)
+      {
+        nnode->entry = build_referral_entry(record,
+                                            (char *) referred_aa->value);
+      }
+    }
+    else if (hierarchical_value_within_aa(value, DOMAIN, area->aa_name))
+    {
+      dnode = find_domain_node(&(area->domain_root), value, TRUE);
+      if (dnode && !dnode->entry)
+      {
+        dnode->entry = build_referral_entry(record,
+                                            (char *) referred_aa->value);
+      }
+    }
+
+    not_done = dl_list_next(pair_list);
+  }
+}
+
+/* load_referral_area: reads every referral record of the authority
+   area into 'area' */
+static int
+load_referral_area(area, auth_area, class)
+  referral_area_struct *area;
+  auth_area_struct     *auth_area;
+  class_struct         *class;
+{
+  dl_list_type      file_list;
+  dl_list_type      data_file_list;
+  file_struct       *data_file;
+  record_struct     *record;
+  rec_parse_result  status;
+  FILE              *fp;
+  int               not_done;
+
+  dl_list_default(&file_list, FALSE, destroy_file_struct_data);
+  dl_list_default(&data_file_list, FALSE, destroy_file_struct_data);
+
+  if (!get_file_list(class, auth_area, &file_list) ||
+      !filter_file_list(&data_file_list, MKDB_DATA_FILE, &file_list))
+  {
+    dl_list_destroy(&file_list);
+    dl_list_destroy(&data_file_list);
+    return FALSE;
+  }
+
+  not_done = dl_list_first(&data_file_list);
+  while (not_done)
+  {
+    data_file = dl_list_value(&data_file_list);
+
+    if ((fp = fopen(data_file->filename, "r")) == NULL)
+    {
+      log(L_LOG_ERR, REFERRAL, "could not open data file '%s': %s",
+          data_file->filename, strerror(errno));
+      not_done = dl_list_next(&data_file_list);
+      continue;
+    }
+
+    while ((record = mkdb_read_next_record(class, auth_area,
+                                           data_file->file_no, FALSE,
+                                           &status, fp)) != NULL)
+    {
+      add_referral_record(area, record);
+      destroy_record_data(record);
+    }
+
+    fclose(fp);
+
+    not_done = dl_list_next(&data_file_list);
+  }
+
+  dl_list_destroy(&file_list);
+  dl_list_destroy(&data_file_list);
+
+  return TRUE;
+}
+
+/* build_referral_area: builds the referrals of the authority area.
+   An area without any referral data gets an empty entry. */
+static referral_area_struct *
+build_referral_area(auth_area)
+  auth_area_struct *auth_area;
+{
+  referral_area_struct *area;
+  class_struct         *class       = NULL;
+  struct stat          sb;
+  struct stat          post_sb;
+
+  area          = xcalloc(1, sizeof(*area));
+  area->aa_name = xstrdup(auth_area->name);
+
+  if (auth_area->schema)
+  {
+    class = find_class_by_name(auth_area->schema, "referral");
+  }
+
+  if (!class || !stat_master_file_list(class, auth_area, &sb))
+  {
+    return(area);
+  }
+
+  if (!load_referral_area(area, auth_area, class))
+  {
+    return(area);
+  }
+
+  /* if the referral data changed while we were reading it, leave the
+     area looking stale so that it gets read again */
+  if (!stat_master_file_list(class, auth_area, &post_sb) ||
+      post_sb.st_ino != sb.st_ino || post_sb.st_size != sb.st_size ||
+      post_sb.st_mtime != sb.st_mtime || post_sb.st_ctime != sb.st_ctime)
+  {
+    return(area);
+  }
+
+  area->has_file_list = TRUE;
+  area->ino           = sb.st_ino;
+  area->size          = sb.st_size;
+  area->mtime         = sb.st_mtime;
+  area->ctime         = sb.st_ctime;
+
+  return(area);
+}
+
+/* is_referral_area_current: returns TRUE if the area's referral data
+   is the same as when it was built */
+static int
+is_referral_area_current(area, auth_area)
+  referral_area_struct *area;
+  auth_area_struct     *auth_area;
+{
+  class_struct     *class       = NULL;
+  struct stat      sb;
+  int              has_file_list;
+
+  if (auth_area->schema)
+  {
+    class = find_class_by_name(auth_area->schema, "referral");
+  }
+
+  has_file_list = class && stat_master_file_list(class, auth_area, &sb);
+
+  if (!has_file_list || !area->has_file_list)
+  {
+    return(has_file_list == area->has_file_list);
+  }
+
+  return(area->ino == sb.st_ino && area->size == sb.st_size &&
+         area->mtime == sb.st_mtime && area->ctime == sb.st_ctime);
+}
+
+/* get_referral_area: returns the referrals of the authority area,
+   first (re)building them if necessary */
+static referral_area_struct *
+get_referral_area(auth_area)
+  auth_area_struct *auth_area;
+{
+  referral_area_struct *area;
+  int                  not_done;
+
+  if (!referral_table_init)
+  {
+    dl_list_default(&referral_table, FALSE, destroy_referral_area_data);
+    referral_table_init = TRUE;
+  }
+
+  not_done = dl_list_first(&referral_table);
+  while (not_done)
+  {
+    area = dl_list_value(&referral_table);
+    if (STR_EQ(area->aa_name, auth_area->name))
+    {
+      if (is_referral_area_current(area, auth_area))
+      {
+        return(area);
+      }
+
+      /* stale: throw it away and rebuild */
+      dl_list_delete(&referral_table);
+      break;
+    }
+    not_done = dl_list_next(&referral_table);
+  }
+
+  area = build_referral_area(auth_area);
+  dl_list_append(&referral_table, area);
+
+  return(area);
+}
+
+/* append_referrals: adds a referral to 'referral_list' for each
+   Referral of the entry */
+static void
+append_referrals(entry, referral_list)
+  referral_entry_struct *entry;
+  dl_list_type          *referral_list;
+{
+  referral_struct *referral;
+  int             not_done;
+
+  not_done = dl_list_first(&(entry->to_list));
+  while (not_done)
+  {
+    referral          = xcalloc(1, sizeof(*referral));
+    referral->to      = xstrdup(dl_list_value(&(entry->to_list)));
+    referral->aa_name = xstrdup(entry->aa_name);
+    referral->type    = DOWN_HIERARCHICAL;
+
+    dl_list_append(referral_list, referral);
+
+    not_done = dl_list_next(&(entry->to_list));
+  }
+}
+
+/* load_punt_list: reads the punt file into the punt list */
+static int
+load_punt_list(punt_file)
+  char  *punt_file;
+{
+  FILE  *fp;
+  char  line[MAX_LINE];
+
+  if ((fp = fopen(punt_file, "r")) == NULL)
+  {
+    log(L_LOG_ERR, REFERRAL, "could not open punt file '%s'", punt_file);
+    return FALSE;
+  }
+
+  bzero((char *) line, MAX_LINE);
+  while (readline(fp, line, MAX_LINE) != NULL)
+  {
+    if (line[0] != '\0' && line[0] != '#')
+    {
+      dl_list_append(&punt_list, xstrdup(line));
+    }
+    bzero((char *) line, MAX_LINE);
+  }
+
+  fclose(fp);
+
+  return TRUE;
+}
+
+
+/* ------------------- Public Functions -------------------- */
+
+void
+build_referral_table()
+{
+  destroy_referral_table();
+
+  refresh_referral_table();
+}
+
+void
+refresh_referral_table()
+{
+  dl_list_type     *auth_area_list;
+  auth_area_struct *auth_area;
+  int              not_done;
+
+  auth_area_list = get_auth_area_list();
+  if (!auth_area_list)
+  {
+    return;
+  }
+
+  not_done = dl_list_first(auth_area_list);
+  while (not_done)
+  {
+    auth_area = dl_list_value(auth_area_list);
+    get_referral_area(auth_area);
+
+    not_done = dl_list_next(auth_area_list);
+  }
+}
+
+int
+find_down_referrals(hvalue, htype, auth_area, referral_list)
+  char             *hvalue;
+  int              htype;
+  auth_area_struct *auth_area;
+  dl_list_type     *referral_list;
+{
+  referral_area_struct  *area;
+  referral_entry_struct *entry  = NULL;
+  domain_node_struct    *dnode;
+  net_node_struct       *nnode;
+  struct netinfo        net;
+  char                  *label;
+  int                   len;
+  int                   label_len;
+  int                   bit;
+
+  if (NOT_STR_EXISTS(hvalue) || !auth_area || NOT_STR_EXISTS(auth_area->name)
+      || !referral_list)
+  {
+    return FALSE;
+  }
+
+  area = get_referral_area(auth_area);
+
+  /* walk down towards the value, keeping the most specific referral
+     on the way */
+  if (htype == NETWORK)
+  {
+    if (!get_network_prefix_and_len(hvalue, &net))
+    {
+      return FALSE;
+    }
+
+    nnode = (net.af == AF_INET) ? area->v4_root : area->v6_root;
+    for (bit = 0; nnode; bit++)
+    {
+      if (nnode->entry)
+      {
+        entry = nnode->entry;
+      }
+      if (bit == net.masklen)
+      {
+        break;
+      }
+      nnode = nnode->child[net_bit(&net, bit)];
+    }
+  }
+  else if (htype == DOMAIN)
+  {
+    dnode = NULL;
+    len   = strlen(hvalue);
+    while ((label = next_label(hvalue, &len, &label_len)) != NULL)
+    {
+      for (dnode = dnode ? dnode->child : area->domain_root; dnode;
+           dnode = dnode->sibling)
+      {
+        if (strlen(dnode->label) == label_len &&
+            STRN_EQ(dnode->label, label, label_len))
+        {
+          break;
+        }
+      }
+      if (!dnode)
+      {
+        break;
+      }
+      if (dnode->entry)
+      {
+        entry = dnode->entry;
+      }
+    }
+  }
+
+  if (!entry)
+  {
+    return FALSE;
+  }
+
+  append_referrals(entry, referral_list);
+
+  return TRUE;
+}
+
+int
+find_punt_referrals(referral_list)
+  dl_list_type *referral_list;
+{
+  referral_struct *referral;
+  char            *punt_file;
+  struct stat     sb;
+  int             not_done;
+
+  if (!referral_list)
+  {
+    return FALSE;
+  }
+
+  punt_file = get_punt_file();
+
+  if (stat(punt_file, &sb) < 0)
+  {
+    log(L_LOG_ERR, REFERRAL, "could not open punt file '%s'", punt_file);
+    return FALSE;
+  }
+
+  if (!punt_list_init || !STR_EQ(punt_filename, punt_file) ||
+      punt_ino != sb.st_ino || punt_size != sb.st_size ||
+      punt_mtime != sb.st_mtime)
+  {
+    if (punt_list_init)
+    {
+      dl_list_destroy(&punt_list);
+    }
+    dl_list_default(&punt_list, FALSE, simple_destroy_data);
+    punt_list_init = TRUE;
+    bzero(punt_filename, sizeof(punt_filename));
+
+    if (!load_punt_list(punt_file))
+    {
+      return FALSE;
+    }
+
+    strncpy(punt_filename, punt_file, sizeof(punt_filename) - 1);
+    punt_ino   = sb.st_ino;
+    punt_size  = sb.st_size;
+    punt_mtime = sb.st_mtime;
+  }
+
+  not_done = dl_list_first(&punt_list);
+  while (not_done)
+  {
+    referral          = xcalloc(1, sizeof(*referral));
+    referral->to      = xstrdup(dl_list_value(&punt_list));
+    referral->type    = UP_HIERARCHICAL;
+    referral->aa_name = NULL;
+
+    dl_list_append(referral_list, referral);
+
+    not_done = dl_list_next(&punt_list);
+  }
+
+  return(!dl_list_empty(referral_list));
+}
+
+void
+destroy_referral_table()
+{
+  if (referral_table_init)
+  {
+    dl_list_destroy(&referral_table);
+    referral_table_init = FALSE;
+  }
+
+  if (punt_list_init)
+  {
+    dl_list_destroy(&punt_list);
+    punt_list_init = FALSE;
+  }
+}
@@ -0,0 +1,50 @@
+/* *************************************************************
+   RWhois Software
+
+   Copyright (c) 1994 Scott Williamson and Mark Kosters
+   Copyright (c) 1996-2000 Network Solutions, Inc.
+
+   See the file LICENSE for conditions of use and distribution.
+**************************************************************** */
+
+#ifndef _REFERRAL_TABLE_H_
+#define _REFERRAL_TABLE_H_
+
+/* includes */
+
+#include "common.h"
+#include "types.h"
+
+/* prototypes */
+
+/* build_referral_table: (re)builds the referral table from the
+   referral records of every authority area.  Parts of the table are
+   also rebuilt as they are used, whenever the area's referral data
+   has been reindexed or registered to since. */
+void build_referral_table PROTO((void));
+
+/* refresh_referral_table: rebuilds just the parts of the referral
+   table whose referral data has changed.  The daemon does this from
+   its main loop, so that its children don't each have to. */
+void refresh_referral_table PROTO((void));
+
+/* find_down_referrals: appends a DOWN_HIERARCHICAL referral to
+   'referral_list' for each Referral of the most specific referral
+   record in the authority area 'auth_area' whose Referred-Auth-Area
+   contains the hierarchical value 'hvalue' (of type 'htype').
+   Returns TRUE if one was found. */
+int find_down_referrals PROTO((char             *hvalue,
+                               int              htype,
+                               auth_area_struct *auth_area,
+                               dl_list_type     *referral_list));
+
+/* find_punt_referrals: appends an UP_HIERARCHICAL referral to
+   'referral_list' for each entry in the punt file, which is read
+   again only when it changes.  Returns FALSE if the punt file can't
+   be read. */
+int find_punt_referrals PROTO((dl_list_type *referral_list));
+
+/* frees the whole table */
+void destroy_referral_table PROTO((void));
+
+#endif /* _REFERRAL_TABLE_H_ */
@@ -10,6 +10,7 @@
 #include "reg_utils.h"
 
 #include "anon_record.h"
+#include "arena.h"
 #include "attributes.h"
 #include "auth_area.h"
 #include "client_msgs.h"
@@ -293,7 +294,7 @@ set_updated_attr(record, updated_str)
   }
   else
   {
-    free(av->value);
+    arena_free(av->value);
     av->value = xstrdup(updated_str);
   }
 }
@@ -17,6 +17,7 @@
 #include "guardian.h"
 #include "index.h"
 #include "index_file.h"
+#include "index_merge.h"
 #include "log.h"
 #include "main_config.h"
 #include "misc.h"
@@ -92,6 +93,11 @@ static int mod_record PROTO((record_struct *new_record,
 /* print the add response (the assigned values for ID and Updated) */
 static int print_add_result PROTO((record_struct *rec));
 
+/* merge the class's index files in the background, so the client
+   isn't kept waiting for it */
+static void start_index_merge PROTO((class_struct     *class,
+                                     auth_area_struct *auth_area));
+
 /* ------------------- Local Functions -------------------- */
 
 
@@ -619,6 +625,12 @@ add_record(rec)
   
   status = index_new_record(rec);
 
+  /* a cached guardian may no longer be right */
+  if (is_guardian_record(rec))
+  {
+    clear_guardian_cache();
+  }
+
   return(status);
 }
 
@@ -633,12 +645,24 @@ del_record(record_list, update_soa)
   auth_area_struct  *aa;
   record_struct     *rec;
   char              *updated;
+  int               not_done;
   
   if (dl_list_empty(record_list))
   {
     return TRUE;
   }
 
+  not_done = dl_list_first(record_list);
+  while (not_done)
+  {
+    rec = dl_list_value(record_list);
+    if (is_guardian_record(rec))
+    {
+      clear_guardian_cache();
+    }
+    not_done = dl_list_next(record_list);
+  }
+
   dl_list_first(record_list);
   rec = dl_list_value(record_list);
   aa = rec->auth_area;
@@ -707,6 +731,98 @@ print_add_result(rec)
   return TRUE;
 }
 
+/* close_inherited_fds: closes every descriptor above stderr.  Where
+   the system lists the open ones (in /proc/self/fd or /dev/fd), only
+   those are closed, rather than every descriptor up to the (possibly
+   very large) limit. */
+static void
+close_inherited_fds()
+{
+  DIR           *dir;
+  struct dirent *entry;
+  int           fd;
+
+  if ((dir = opendir("/proc/self/fd")) == NULL)
+  {
+    dir = opendir("/dev/fd");
+  }
+
+  if (dir)
+  {
+    while ((entry = readdir(dir)) != NULL)
+    {
+      if (!isdigit((unsigned char) entry->d_name[0]))
+      {
+        continue;
+      }
+
+      fd = atoi(entry->d_name);
+      if (fd > 2 && fd != dirfd(dir))
+      {
+        close(fd);
+      }
+    }
+
+    closedir(dir);
+    return;
+  }
+
+  for (fd = (int) sysconf(_SC_OPEN_MAX) - 1; fd > 2; fd--)
+  {
+    close(fd);
+  }
+}
+
+static void
+start_index_merge(class, auth_area)
+  class_struct     *class;
+  auth_area_struct *auth_area;
+{
+  pid_t pid;
+  int   fd;
+
+  /* fork twice, so that the merge is not our child to wait for */
+  if ((pid = fork()) < 0)
+  {
+    log(L_LOG_ERR, DIRECTIVES, "could not fork index merge: %s",
+        strerror(errno));
+    return;
+  }
+
+  if (pid > 0)
+  {
+    waitpid(pid, (int *) NULL, 0);
+    return;
+  }
+
+  if (fork() != 0)
+  {
+    _exit(0);
+  }
+
+  /* let go of the client connection, and of everything else we were
+     handed (a pooled worker also has the listening socket): stdin and
+     stdout go to /dev/null and the rest is closed.  The logs are
+     reopened when next used. */
+  close_log_files();
+#ifndef NO_SYSLOG
+  closelog();
+#endif
+
+  if ((fd = open("/dev/null", O_RDWR)) >= 0)
+  {
+    dup2(fd, 0);
+    dup2(fd, 1);
+    if (fd > 1) close(fd);
+  }
+
+  close_inherited_fds();
+
+  merge_index_segments(class, auth_area);
+
+  exit(0);
+}
+
 /* ------------------- Public Functions -------------------- */
 
 int
@@ -717,6 +833,9 @@ process_registration(reg_email, action)
   FILE                 *spool_fp;
   anon_record_struct   *old_rec = NULL;
   record_struct        *new_rec = NULL;
+  record_struct        *rec;
+  class_struct         *class     = NULL;
+  auth_area_struct     *auth_area = NULL;
   dl_list_type         del_record_list;
   int                  status;
   
@@ -784,6 +903,18 @@ process_registration(reg_email, action)
   
   /* COMMIT phase -- apply the changes to the database */
 
+  if (new_rec)
+  {
+    class     = new_rec->class;
+    auth_area = new_rec->auth_area;
+  }
+  else if (dl_list_first(&del_record_list))
+  {
+    rec       = dl_list_value(&del_record_list);
+    class     = rec->class;
+    auth_area = rec->auth_area;
+  }
+
   switch (action)
   {
   case ADD:
@@ -808,6 +939,12 @@ process_registration(reg_email, action)
   dl_list_destroy(&del_record_list);
   
   if (!status) return FALSE;
+
+  /* each change adds index files of its own; keep their number down */
+  if (index_segments_over_limit(class, auth_area))
+  {
+    start_index_merge(class, auth_area);
+  }
   
   return TRUE;
 }
@@ -358,6 +358,27 @@ security_directive(str)
 }
 
 
+/* reset_security_state: forgets any -security request/response
+   settings made during a session */
+void
+reset_security_state()
+{
+  if (request)
+  {
+    free_auth_struct(request);
+    request = NULL;
+  }
+  if (response)
+  {
+    free_auth_struct(response);
+    response = NULL;
+  }
+
+  set_rwhois_secure_mode(FALSE);
+  set_out_fp(stdout);
+}
+
+
 auth_struct *
 get_request_auth_struct()
 {
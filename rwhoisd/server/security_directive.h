@@ -19,6 +19,8 @@
 
 int security_directive PROTO((char *str));
 
+void reset_security_state PROTO((void));
+
 auth_struct * get_request_auth_struct PROTO((void));
 
 auth_struct * get_response_auth_struct PROTO((void));
@@ -9,6 +9,7 @@
 
 #include "session.h"
 
+#include "arena.h"
 #include "client_msgs.h"
 #include "deadman.h"
 #include "defines.h"
@@ -16,6 +17,8 @@
 #include "directive_conf.h"
 #include "dl_list.h"
 #include "dump.h"
+#include "forward.h"
+#include "guardian.h"
 #include "log.h"
 #include "main_config.h"
 #include "misc.h"
@@ -29,7 +32,16 @@
 
 #include "conf.h"
 
+/* the size of the buffer that collects each response to the client */
+#define RESPONSE_BUFFER_SIZE  16384
+
+static char response_buf[RESPONSE_BUFFER_SIZE];
+
+/* what each query's terms and records are allocated from */
+static arena_type *query_arena = NULL;
+
 static int processline PROTO((char *str));
+static int display_hit PROTO((record_struct *record, void *data));
 static int run_query PROTO((char *str));
  
 /* ------------------- LOCAL FUNCTIONS -------------------- */
@@ -85,22 +97,27 @@ processline(str)
 }
 
 
+/* display_hit: shows one record found by run_query()'s search */
+static int
+display_hit(record, data)
+  record_struct *record;
+  void          *data;
+{
+  return(display_dump_format(record));
+}
+
 static int
 run_query(str)
   char *str;
 {
   query_struct      *query;
-  dl_list_type      record_list;
-  record_struct     *record;
-  int               not_done;
+  arena_type        *old_arena;
   int               ret_code;
   int               num_hits;
   int               obj_found_flag = FALSE;
   
   query = xcalloc(1, sizeof(*query));
   
-  dl_list_default(&record_list, FALSE, destroy_record_data);
-  
   if (!str || !*str)
   {
     log(L_LOG_ERR, QUERY, "run_query: null data detected");
@@ -108,37 +125,43 @@ run_query(str)
     return FALSE;
   }
 
+  /* the parse and the search allocate from the query arena, which is
+     all given back when the query is done */
+  if (!query_arena)
+  {
+    query_arena = arena_create(0);
+  }
+  old_arena = arena_bind(query_arena);
+
   log(L_LOG_INFO, CLIENT, "query: %s", str);
+  save_original_query(str);
   if (!parse_query(str, query))
   {
     log(L_LOG_INFO, CLIENT, "invalid query syntax: %s", str);
+    arena_bind(old_arena);
+    arena_reset(query_arena);
     return FALSE;
   }
 
   if (!check_query_complexity(query))
   {
     destroy_query(query);
+    arena_bind(old_arena);
+    arena_reset(query_arena);
     return FALSE;
   }
 
   
-  num_hits = search(query, &record_list, get_hit_limit(), &ret_code);
+  /* the object results are displayed as they are found */
+  num_hits = search_stream(query, display_hit, NULL, get_hit_limit(),
+                           &ret_code);
   log(L_LOG_INFO, CLIENT, "query response: %d hits", num_hits);
 
-  /* display the object results */
-  if (!dl_list_empty(&record_list))
+  arena_bind(old_arena);
+
+  if (num_hits > 0)
   {
     obj_found_flag = TRUE;
-    
-    not_done = dl_list_first(&record_list);
-    while (not_done)
-    {
-      record = dl_list_value(&record_list);
-      display_dump_format(record);
-      not_done = dl_list_next(&record_list);
-    }
-
-    dl_list_destroy(&record_list);
   }
 
   /* always check for referrals -- except when the query could have
@@ -177,6 +200,7 @@ run_query(str)
   }   
 
   destroy_query(query);
+  arena_reset(query_arena);
   return TRUE;
 }
  
@@ -196,8 +220,6 @@ run_session(real_flag)
 
   set_out_fp(stdout);
 
-  print_welcome_header();
-
   /* set the input to line buffering, not block buffering */
 #ifdef SETVBUF_REVERSED
   setvbuf(stdin, _IOLBF, (char *)NULL, 0);
@@ -205,16 +227,23 @@ run_session(real_flag)
   setvbuf(stdin, (char *)NULL, _IOLBF, 0);
 #endif
 
-  /* unbuffer the output */
+  /* fully buffer the output: each response is collected and sent when
+     it is complete (or the buffer fills), rather than a write per
+     line.  The output is flushed after every line of input is
+     processed, so an interactive (holdconnect) client always sees the
+     whole response before we wait on it again. */
 #ifdef SETVBUF_REVERSED
-  setvbuf(stdout, _IONBF, (char *)NULL, 0);
+  setvbuf(stdout, _IOFBF, response_buf, sizeof(response_buf));
 #else
-  setvbuf(stdout, (char *)NULL, _IONBF, 0);
+  setvbuf(stdout, response_buf, _IOFBF, sizeof(response_buf));
 #endif
 
+  print_welcome_header();
+
   if (!real_flag)
   {
     print_error(SERVICE_NOT_AVAIL, "exceeded max client sessions");
+    fflush(stdout);
 
     return;
   }
@@ -234,11 +263,29 @@ run_session(real_flag)
     {
       unset_timer();
       not_finished = processline(target);
+      fflush(stdout);
     }    
   } while (not_finished);
 }
 
 
+/* reset_session: clears the per-client state left behind by
+   run_session() so that the same process can serve another client */
+void
+reset_session()
+{
+  fflush(stdout);
+  unset_timer();
+  flush_log_files();
+
+  clear_printed_error_flag();
+  reset_rwhois_state();
+  reset_security_state();
+  clear_guardian_cache();
+  init_server_state();
+}
+
+
 /* print_welcome_header: prints the standard rwhois banner greeting */
 void
 print_welcome_header()
@@ -21,6 +21,8 @@
 
 void run_session PROTO((int real_flag));
 
+void reset_session PROTO((void));
+
 void print_welcome_header PROTO((void));
 
 #endif /* _SESSION_H_ */
@@ -9,6 +9,11 @@ static int processline PROTO((char         *line,
                               char         *delimiter,
                               dl_list_type *response));
 
+static int connect_socket PROTO((int             sockfd,
+                                 struct sockaddr *addr,
+                                 int             addrlen,
+                                 int             timeout));
+
 
 /* ------------------- LOCAL FUNCTIONS -------------------- */
 
@@ -51,17 +56,78 @@ processline(line, delimiter, response)
 }
 
 
+/* connect_socket: This function connects 'sockfd' to 'addr', giving
+   up after 'timeout' seconds (0 means the system's own limit) */
+static int
+connect_socket(sockfd, addr, addrlen, timeout)
+  int             sockfd;
+  struct sockaddr *addr;
+  int             addrlen;
+  int             timeout;
+{
+  struct timeval tv;
+  fd_set         wfds;
+  int            flags;
+  int            err;
+  socklen_t      len;
+
+  if (timeout <= 0)
+  {
+    return(connect(sockfd, addr, addrlen));
+  }
+
+  flags = fcntl(sockfd, F_GETFL, 0);
+  fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+
+  if (connect(sockfd, addr, addrlen) < 0)
+  {
+    if (errno != EINPROGRESS)
+    {
+      return(-1);
+    }
+
+    FD_ZERO(&wfds);
+    FD_SET(sockfd, &wfds);
+    tv.tv_sec  = timeout;
+    tv.tv_usec = 0;
+
+    if (select(sockfd + 1, NULL, &wfds, NULL, &tv) <= 0)
+    {
+      errno = ETIMEDOUT;
+      return(-1);
+    }
+
+    len = sizeof(err);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, (char *) &err, &len) < 0)
+    {
+      return(-1);
+    }
+    if (err)
+    {
+      errno = err;
+      return(-1);
+    }
+  }
+
+  fcntl(sockfd, F_SETFL, flags);
+
+  return(0);
+}
+
+
 /* ------------------- PUBLIC FUNCTIONS ------------------- */
 
 
-/* connect_server: This function sets up a TCP connection to
-   an RWhois server running at addr:port */
-void
-connect_server(addr, port, sockfd)
+/* open_server_socket: This function opens a TCP connection to an
+   RWhois server running at addr:port.  Returns the socket, or -1 on
+   error. */
+int
+open_server_socket(addr, port, timeout)
   char *addr;
   int  port;
-  int  *sockfd;
+  int  timeout;
 {
+  int             sockfd         = -1;
 #ifdef HAVE_IPV6
   struct addrinfo hints, *gai_result, *server_aip;
   char            portstr[MAX_LINE];
@@ -73,9 +139,9 @@ connect_server(addr, port, sockfd)
   snprintf( portstr, sizeof portstr, "%d", port );
   if ( getaddrinfo( addr, portstr, &hints, &gai_result ) )
   {
-    log( L_LOG_ERR, SECONDARY, "connect_server: bad address or port: %s", 
-         strerror( errno ) );
-    exit( 1 );
+    log( L_LOG_ERR, NET, "open_server_socket: bad address or port: %s:%d",
+         addr, port );
+    return( -1 );
   }
 
   /* Try each returned address until we get a connection. */
@@ -83,28 +149,36 @@ connect_server(addr, port, sockfd)
        server_aip = server_aip->ai_next )
   {
     /* Open socket */
-    if ( ( *sockfd = socket( server_aip->ai_family, 
-                             server_aip->ai_socktype,
-                             server_aip->ai_protocol ) ) < 0 )
+    if ( ( sockfd = socket( server_aip->ai_family, 
+                            server_aip->ai_socktype,
+                            server_aip->ai_protocol ) ) < 0 )
       continue;
  
     /* Connect */
-    if ( ( connect_status = connect( *sockfd,
-                                     (struct sockaddr *) server_aip->ai_addr, 
-                                     server_aip->ai_addrlen ) ) == 0 )
+    if ( ( connect_status = connect_socket( sockfd,
+                                            server_aip->ai_addr, 
+                                            server_aip->ai_addrlen,
+                                            timeout ) ) == 0 )
       break;
+
+    close( sockfd );
+    sockfd = -1;
   }
 
-  if ( ! connect_status )
+  freeaddrinfo( gai_result );
+
+  if ( connect_status != 0 )
   {
-    log(L_LOG_ERR, SECONDARY,
-        "connect_server: connect error: %s", strerror(errno));
-    exit(1);
+    log(L_LOG_ERR, NET,
+        "open_server_socket: connect error: %s:%d: %s", addr, port,
+        strerror(errno));
+    return( -1 );
   }
 
 #else
 
   struct sockaddr_in  server;
+  struct hostent      *hp;
 
   bzero((char *) &server, sizeof(server));
 
@@ -112,23 +186,54 @@ connect_server(addr, port, sockfd)
   server.sin_addr.s_addr = inet_addr(addr);
   server.sin_port        = htons(port);
 
+  if (server.sin_addr.s_addr == (unsigned long) -1)
+  {
+    if ((hp = gethostbyname(addr)) == NULL)
+    {
+      log(L_LOG_ERR, NET, "open_server_socket: bad address: %s", addr);
+      return(-1);
+    }
+    bcopy(hp->h_addr, (char *) &server.sin_addr, hp->h_length);
+  }
+
   /* Open socket */
-  if ((*sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
+  if ((sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
   {
-    log(L_LOG_ERR, SECONDARY,
-        "connect_server: could not open socket: %s", strerror(errno));
-    exit(1);
+    log(L_LOG_ERR, NET,
+        "open_server_socket: could not open socket: %s", strerror(errno));
+    return(-1);
   }
  
   /* Connect */
-  if (connect(*sockfd, (struct sockaddr *) &server, sizeof(server)) < 0)
+  if (connect_socket(sockfd, (struct sockaddr *) &server, sizeof(server),
+                     timeout) < 0)
   {
-    log(L_LOG_ERR, SECONDARY,
-        "connect_server: connect error: %s", strerror(errno));
-    exit(1);
+    log(L_LOG_ERR, NET,
+        "open_server_socket: connect error: %s:%d: %s", addr, port,
+        strerror(errno));
+    close(sockfd);
+    return(-1);
   }
   
 #endif
+
+  return(sockfd);
+}
+
+
+/* connect_server: This function sets up a TCP connection to
+   an RWhois server running at addr:port */
+void
+connect_server(addr, port, sockfd)
+  char *addr;
+  int  port;
+  int  *sockfd;
+{
+  if ((*sockfd = open_server_socket(addr, port, 0)) < 0)
+  {
+    exit(1);
+  }
+
   /* Redirect stdin and stdout to socket */
   if (dup2(*sockfd, 0) == -1)
   {
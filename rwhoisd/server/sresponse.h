@@ -8,6 +8,10 @@
 
 /* prototypes */
 
+int open_server_socket PROTO((char *addr,
+                              int  port,
+                              int  timeout));
+
 void connect_server PROTO((char *addr,
                            int  port,
                            int  *sockfd));
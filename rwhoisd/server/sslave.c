@@ -1,10 +1,12 @@
 #include "sslave.h"
 
 #include "auth_area.h"
+#include "daemon.h"
 #include "deadman.h"
 #include "defines.h"
 #include "fileutils.h"
 #include "log.h"
+#include "main_config.h"
 #include "misc.h"
 #include "schema.h"
 #include "sschema.h"
@@ -12,476 +14,546 @@
 #include "sstate.h"
 #include "sxfer.h"
 
+/* set (from signal handlers) when the refresh schedule needs looking
+   at: a refresh child has exited or the next refresh has come due */
+static volatile int refresh_pending = FALSE;
 
-/* ------------------- PUBLIC FUNCTIONS ------------------- */
+static int          num_running     = 0;
+static int          timer_started   = FALSE;
 
+static RETSIGTYPE slave_alarm_handler PROTO((int arg));
 
-/* init_slave_auth_areas: This function initially creates
-   SOA file, schema file, attribute definitions directory,
-   and data directory for each slave authority area */
-int
-init_slave_auth_areas()
+
+/* ------------------- LOCAL FUNCTIONS -------------------- */
+
+
+/* slave_alarm_handler: This function handles the SIGALRM set for the
+   next refresh.  The work is done by run_slave_refresh(), from the
+   daemon's main loop. */
+static RETSIGTYPE
+slave_alarm_handler(arg)
+  int arg;
 {
-  dl_list_type       *aa_list;
-  dl_list_type       slave_aa_list;
-  auth_area_struct   *aa;
-  server_struct      *server;
+  refresh_pending = TRUE;
+}
+
+
+/* block_sigchld: This function holds off (or, if 'block' is FALSE,
+   lets back in) the SIGCHLD handler while the state table is being
+   changed */
+static void
+block_sigchld(block)
+  int block;
+{
+  sigset_t set;
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGCHLD);
+  sigprocmask(block ? SIG_BLOCK : SIG_UNBLOCK, &set, (sigset_t *) NULL);
+}
+
+
+/* schedule_retry: This function schedules an area whose action
+   failed to start again from an SOA poll, backing off exponentially
+   from its retry interval up to its refresh interval */
+static void
+schedule_retry(slave_state, aa, now)
   slave_state_struct *slave_state;
-  int                not_done;
-  int                childpid;
-  int                count;
+  auth_area_struct   *aa;
+  long               now;
+{
+  long limit;
 
-  /* Set initial time */
-  set_initial_time();
+  schedule_slave_state(slave_state, ACTION_SOA, now + slave_state->backoff);
 
-  /* Get slave authority areas */
-  aa_list = get_auth_area_list();
-  if (dl_list_empty(aa_list))
+  log(L_LOG_INFO, SECONDARY,
+      "refresh of authority area '%s' failed; retrying in %ld seconds",
+      slave_state->name, slave_state->backoff);
+
+  limit = aa->refresh_interval;
+  if (limit < aa->retry_interval)
   {
-    return(FALSE);
+    limit = aa->retry_interval;
   }
- 
-  dl_list_default(&slave_aa_list, FALSE, null_destroy_data);
- 
-  not_done = dl_list_first(aa_list);
-  while (not_done)
+  slave_state->backoff *= 2;
+  if (slave_state->backoff > limit)
   {
-    aa = dl_list_value(aa_list);
-    if (aa->type == AUTH_AREA_SECONDARY)
-    {
-      dl_list_append(&slave_aa_list, aa);
-    }
- 
-    not_done = dl_list_next(aa_list);
+    slave_state->backoff = limit;
   }
- 
-  if (dl_list_empty(&slave_aa_list))
+  if (slave_state->backoff <= 0)
   {
-    return(TRUE);
+    slave_state->backoff = 1;
   }
+}
 
-  /* Initialize slave authority area state list */
-  init_slave_state_list(&slave_aa_list);
 
-  /* Create SOA files */
-  count = 0;
-  not_done = dl_list_first(&slave_aa_list);
-  while (not_done)
+/* schedule_refresh: This function schedules the next SOA poll of an
+   area that is up to date */
+static void
+schedule_refresh(slave_state, aa, now)
+  slave_state_struct *slave_state;
+  auth_area_struct   *aa;
+  long               now;
+{
+  slave_state->backoff = aa->retry_interval;
+  schedule_slave_state(slave_state, ACTION_SOA, now + aa->refresh_interval);
+}
+
+
+/* start_slave_action: This function forks the child that does the
+   scheduled action for an area.  Returns FALSE if it could not. */
+static int
+start_slave_action(slave_state, aa, now)
+  slave_state_struct *slave_state;
+  auth_area_struct   *aa;
+  long               now;
+{
+  server_struct *server;
+  int           childpid;
+  int           status;
+
+  if (dl_list_empty(aa->master))
   {
-    aa = dl_list_value(&slave_aa_list);
+    log(L_LOG_ERR, SECONDARY, "authority area '%s' has no master server",
+        aa->name);
+    return(FALSE);
+  }
 
-    if ((childpid = fork()) < 0)
-    {
-      log(L_LOG_ERR, SECONDARY,
-          "init_slave_auth_areas: fork error: %s", strerror(errno));
-      exit(1);
-    }
-    else if (childpid == 0)
-    {
-      /* Child process */
-      signal(SIGCHLD, SIG_DFL);
+  if ((childpid = fork()) < 0)
+  {
+    log(L_LOG_ERR, SECONDARY,
+        "start_slave_action: fork error: %s", strerror(errno));
+    return(FALSE);
+  }
+  else if (childpid == 0)
+  {
+    /* Child process */
+    signal(SIGCHLD, SIG_DFL);
 
-      if (dl_list_empty(aa->master))
+    dl_list_first(aa->master);
+    server = dl_list_value(aa->master);
+
+    switch (slave_state->action)
+    {
+    case ACTION_SOA:
+      status = create_soa_file(aa, server);
+      break;
+    case ACTION_SCHEMA:
+      status = create_schema_file(aa, server);
+      break;
+    case ACTION_XFER:
+      if (slave_state->loaded)
       {
-        exit(1);
+        status = create_data_files(aa, server, FALSE,
+                                   slave_state->old_serial_no);
       }
-      dl_list_first(aa->master);
-      server = dl_list_value(aa->master);
-
-      if (!create_soa_file(aa, server))
+      else
       {
-        exit(1);
+        status = create_data_files(aa, server, TRUE, NULL);
       }
-
-      exit(0);
-    }
-    else
-    {
-      /* Parent process */
-      set_slave_state(aa->name, childpid, ACTION_SOA, STATUS_WAIT);
-      count++;
+      break;
+    default:
+      status = FALSE;
+      break;
     }
 
-    not_done = dl_list_next(&slave_aa_list);
+    exit(status ? 0 : 1);
   }
 
-  /* Wait for each child process */
-  wait_for_child_processes(count, get_deadman_time(), ACTION_SOA);
+  /* Parent process */
+  slave_state->pid    = childpid;
+  slave_state->status = STATUS_WAIT;
 
-  /* Read SOA files */
-  not_done = dl_list_first(&slave_aa_list);
-  while (not_done)
+  /* a data xfer takes as long as it takes, but a master that doesn't
+     answer a poll shouldn't hold up the area's next try */
+  if (slave_state->action == ACTION_XFER)
+  {
+    slave_state->deadline = 0;
+  }
+  else
   {
-    aa = dl_list_value(&slave_aa_list);
+    slave_state->deadline = now + get_deadman_time();
+  }
 
-    /* Check slave authority area state */
-    slave_state = get_slave_state(aa->name);
-    if (slave_state->status != STATUS_OK)
-    {
-      not_done = dl_list_next(&slave_aa_list);
-      continue;
-    }
+  num_running++;
 
-    if (!read_soa_file(aa))
-    {
-      return(FALSE);
-    }
- 
-    not_done = dl_list_next(&slave_aa_list);
+  return(TRUE);
+}
+
+
+/* finish_slave_action: This function takes up the result of an
+   area's finished child, and schedules what comes next for it */
+static void
+finish_slave_action(slave_state, now)
+  slave_state_struct *slave_state;
+  long               now;
+{
+  auth_area_struct *aa;
+  char             *old_serial_no;
+  int              ok;
+
+  ok = (slave_state->status == STATUS_OK);
+
+  aa = find_auth_area_by_name(slave_state->name);
+  if (!aa || aa->type != AUTH_AREA_SECONDARY)
+  {
+    /* the area was dropped from the configuration while its child
+       was running */
+    return;
   }
 
-  /* Create schema files */
-  count = 0;
-  not_done = dl_list_first(&slave_aa_list);
-  while (not_done)
+  /* the area was reinitialized while its child was running; start it
+     over from the beginning */
+  if (slave_state->stale)
   {
-    aa = dl_list_value(&slave_aa_list);
+    slave_state->stale   = FALSE;
+    slave_state->backoff = aa->retry_interval;
+    schedule_slave_state(slave_state, ACTION_SOA, now);
+    return;
+  }
 
-    /* Check slave authority area state */
-    slave_state = get_slave_state(aa->name);
-    if (slave_state->status != STATUS_OK)
+  switch (slave_state->action)
+  {
+  case ACTION_SOA:
+    if (!ok)
     {
-      not_done = dl_list_next(&slave_aa_list);
-      continue;
+      break;
     }
 
-    if ((childpid = fork()) < 0)
+    old_serial_no = NEW_STRING(SAFE_STR(aa->serial_no, ""));
+    if (!read_soa_file(aa))
     {
-      log(L_LOG_ERR, SECONDARY,
-          "init_slave_auth_areas: fork error: %s", strerror(errno));
-      exit(1);
+      free(old_serial_no);
+      ok = FALSE;
+      break;
     }
-    else if (childpid == 0)
-    {
-      /* Child process */
-      signal(SIGCHLD, SIG_DFL);
 
-      if (dl_list_empty(aa->master))
-      {
-        exit(1);
-      }
-      dl_list_first(aa->master);
-      server = dl_list_value(aa->master);
-
-      if (!create_schema_file(aa, server))
+    if (!slave_state->loaded)
+    {
+      free(old_serial_no);
+      schedule_slave_state(slave_state, ACTION_SCHEMA, now);
+    }
+    else if (strcmp(aa->serial_no, old_serial_no) > 0)
+    {
+      if (slave_state->old_serial_no)
       {
-        exit(1);
+        free(slave_state->old_serial_no);
       }
- 
-      exit(0);
+      slave_state->old_serial_no = old_serial_no;
+      schedule_slave_state(slave_state, ACTION_XFER, now);
     }
     else
     {
-      /* Parent process */
-      set_slave_state(aa->name, childpid, ACTION_SCHEMA, STATUS_WAIT);
-      count++;
+      free(old_serial_no);
+      schedule_refresh(slave_state, aa, now);
     }
+    break;
 
-    not_done = dl_list_next(&slave_aa_list);
-  }
-
-  /* Wait for each child process */
-  wait_for_child_processes(count, get_deadman_time(), ACTION_SCHEMA);
-
-  /* Read schema files */
-  not_done = dl_list_first(&slave_aa_list);
-  while (not_done)
-  {
-    aa = dl_list_value(&slave_aa_list);
-
-    /* Check slave authority area state */
-    slave_state = get_slave_state(aa->name);
-    if (slave_state->status != STATUS_OK)
+  case ACTION_SCHEMA:
+    if (!ok)
     {
-      not_done = dl_list_next(&slave_aa_list);
-      continue;
+      break;
     }
 
+    if (aa->schema)
+    {
+      destroy_schema_data(aa->schema);
+    }
     aa->schema = xcalloc(1, sizeof(*(aa->schema)));
- 
+
     if (!read_schema(aa))
     {
-      return(FALSE);
+      ok = FALSE;
+      break;
     }
+    schedule_slave_state(slave_state, ACTION_XFER, now);
+    break;
 
-    not_done = dl_list_next(&slave_aa_list);
+  case ACTION_XFER:
+    if (!ok)
+    {
+      break;
+    }
+
+    slave_state->loaded = TRUE;
+    schedule_refresh(slave_state, aa, now);
+
+    /* pooled workers were forked with the old schema and SOA */
+    recycle_workers();
+    break;
+
+  default:
+    ok = FALSE;
+    break;
   }
 
-  /* Create data files */
-  not_done = dl_list_first(&slave_aa_list);
-  while (not_done)
+  if (!ok)
   {
-    aa = dl_list_value(&slave_aa_list);
+    schedule_retry(slave_state, aa, now);
+  }
 
-    /* Check slave authority area state */
-    slave_state = get_slave_state(aa->name);
-    if (slave_state->status != STATUS_OK)
+  aa->xfer_time = slave_state->next_time;
+}
+
+
+/* collect_slave_children: This function takes up the results of the
+   refresh children that have exited, and gives up on polls that have
+   run past their deadline */
+static void
+collect_slave_children(now)
+  long now;
+{
+  slave_state_struct *slave_state;
+  int                count;
+  int                i;
+
+  count = get_slave_state_count();
+  for (i = 0; i < count; i++)
+  {
+    slave_state = get_slave_state_by_index(i);
+    if (slave_state->pid <= 0)
     {
-      not_done = dl_list_next(&slave_aa_list);
       continue;
     }
 
-    if ((childpid = fork()) < 0)
+    if (slave_state->status != STATUS_WAIT)
     {
-      log(L_LOG_ERR, SECONDARY,
-          "init_slave_auth_areas: fork error: %s", strerror(errno));
-      exit(1);
-    }
-    else if (childpid == 0)
-    {
-      /* Child process */
-      signal(SIGCHLD, SIG_DFL);
- 
-      if (dl_list_empty(aa->master))
-      {
-        exit(1);
-      }
-      dl_list_first(aa->master);
-      server = dl_list_value(aa->master);
- 
-      if (!create_data_files(aa, server, TRUE))
-      {
-        exit(1);
-      }
- 
-      exit(0);
+      slave_state->pid = 0;
+      num_running--;
+      finish_slave_action(slave_state, now);
     }
-    else
+    else if (slave_state->deadline > 0 && slave_state->deadline <= now)
     {
-      /* Parent process */
-      set_slave_state(aa->name, childpid, ACTION_XFER, STATUS_WAIT);
+      log(L_LOG_ERR, SECONDARY,
+          "time out for authority area '%s'", slave_state->name);
+      kill(slave_state->pid, SIGTERM);
+
+      /* its exit (with an error) is collected as usual */
+      slave_state->deadline = 0;
     }
- 
-    not_done = dl_list_next(&slave_aa_list);
   }
+}
 
-  /* Set new xfer times */
-  not_done = dl_list_first(&slave_aa_list);
-  while (not_done)
+
+/* start_due_actions: This function starts the actions that have come
+   due, as far as the limit on concurrent refreshes allows */
+static void
+start_due_actions(now)
+  long now;
+{
+  slave_state_struct *slave_state;
+  auth_area_struct   *aa;
+  int                limit              = get_max_slave_refreshes();
+
+  while ((slave_state = next_slave_state()) != NULL &&
+         slave_state->next_time <= now &&
+         (limit <= 0 || num_running < limit))
   {
-    aa = dl_list_value(&slave_aa_list);
- 
-    /* If error, increment xfer time by retry interval.
-       Else, increment xfer time by refresh interval */
-    slave_state = get_slave_state(aa->name);
-    if (slave_state->status == STATUS_ERROR)
+    unschedule_slave_state(slave_state);
+
+    aa = find_auth_area_by_name(slave_state->name);
+    if (!aa)
     {
-      aa->xfer_time = get_time_elapsed() + aa->retry_interval;
+      continue;
     }
-    else
+
+    if (!start_slave_action(slave_state, aa, now))
     {
-      aa->xfer_time = get_time_elapsed() + aa->refresh_interval;
+      schedule_retry(slave_state, aa, now);
+      aa->xfer_time = slave_state->next_time;
     }
- 
-    not_done = dl_list_next(&slave_aa_list);
   }
+}
 
-  dl_list_destroy(&slave_aa_list);
 
-  /* Set poll time */
-  set_timer(3600, update_slave_auth_areas);
+/* set_refresh_timer: This function sets the alarm for the next time
+   the schedule needs looking at, if not sooner woken up by a child */
+static void
+set_refresh_timer(now)
+  long now;
+{
+  slave_state_struct *slave_state;
+  long               wake               = -1;
+  int                limit              = get_max_slave_refreshes();
+  int                count;
+  int                i;
 
-  return(TRUE);
+  slave_state = next_slave_state();
+  if (slave_state && (limit <= 0 || num_running < limit))
+  {
+    wake = slave_state->next_time;
+  }
+
+  count = get_slave_state_count();
+  for (i = 0; i < count; i++)
+  {
+    slave_state = get_slave_state_by_index(i);
+    if (slave_state->pid > 0 && slave_state->deadline > 0 &&
+        (wake < 0 || slave_state->deadline < wake))
+    {
+      wake = slave_state->deadline;
+    }
+  }
+
+  if (wake < 0)
+  {
+    alarm(0);
+    return;
+  }
+
+  if (wake <= now)
+  {
+    wake = now + 1;
+  }
+  alarm((unsigned int) (wake - now));
 }
 
 
-/* update_slave_auth_areas: This function updates data for a
-   slave authority area if serial number has been incremented
-   at the master server */
+/* ------------------- PUBLIC FUNCTIONS ------------------- */
+
+
+/* init_slave_auth_areas: This function schedules each slave authority
+   area for its initial SOA, schema and data xfers.  The xfers are run
+   by run_slave_refresh() as the daemon goes about its business. */
 int
-update_slave_auth_areas()
+init_slave_auth_areas()
 {
   dl_list_type       *aa_list;
   dl_list_type       slave_aa_list;
   auth_area_struct   *aa;
-  server_struct      *server;
   slave_state_struct *slave_state;
-  long               current_time;
+  struct sigaction   act;
   int                not_done;
-  int                childpid;
   int                count;
-  char               *old_serial_no;
+  int                i;
 
-  /* Get current time */
-  current_time = get_time_elapsed();
+  /* Set initial time; the times of any refreshes still running from
+     before a reinitialization are relative to it */
+  if (!timer_started)
+  {
+    set_initial_time();
+    timer_started = TRUE;
+  }
 
-  /* Get slave authority areas with xfer time <= current time */
+  /* Get slave authority areas */
   aa_list = get_auth_area_list();
   if (dl_list_empty(aa_list))
   {
     return(FALSE);
   }
- 
+
   dl_list_default(&slave_aa_list, FALSE, null_destroy_data);
- 
+
   not_done = dl_list_first(aa_list);
   while (not_done)
   {
     aa = dl_list_value(aa_list);
     if (aa->type == AUTH_AREA_SECONDARY)
     {
-      if (aa->xfer_time <= current_time)
-      {
-        dl_list_append(&slave_aa_list, aa);
-      }
+      dl_list_append(&slave_aa_list, aa);
     }
- 
+
     not_done = dl_list_next(aa_list);
   }
- 
-  if (dl_list_empty(&slave_aa_list))
-  {
-    set_timer(3600, update_slave_auth_areas);
-    return(TRUE);
-  }
 
-  /* Create SOA files */
-  count = 0;
-  not_done = dl_list_first(&slave_aa_list);
-  while (not_done)
+  /* the refresh signals interrupt (rather than restart) the main
+     loop's system calls, so that it gets on with the refreshes; the
+     daemon's SIGCHLD handler is installed the same way */
+  bzero(&act, sizeof(act));
+  act.sa_handler = slave_alarm_handler;
+  sigemptyset(&act.sa_mask);
+  sigaction(SIGALRM, &act, (struct sigaction *) NULL);
+
+  block_sigchld(TRUE);
+
+  /* Initialize slave authority area state list */
+  init_slave_state_list(&slave_aa_list);
+
+  count = get_slave_state_count();
+  for (i = 0; i < count; i++)
   {
-    aa = dl_list_value(&slave_aa_list);
+    slave_state = get_slave_state_by_index(i);
 
-    /* Do not interrupt an ongoing xfer */
-    slave_state = get_slave_state(aa->name);
-    if (slave_state->action == ACTION_XFER &&
-        dot_lock_exists(aa->name))
+    /* an area with its child still running is scheduled once the
+       child is done */
+    if (slave_state->pid <= 0)
     {
-      not_done = dl_list_next(&slave_aa_list);
-      continue;
+      schedule_slave_state(slave_state, ACTION_SOA, 0);
     }
+  }
 
-    if ((childpid = fork()) < 0)
-    {
-      log(L_LOG_ERR, SECONDARY,
-          "update_slave_auth_areas: fork error: %s", strerror(errno));
-      exit(1);
-    }
-    else if (childpid == 0)
-    {
-      /* Child process */
-      signal(SIGCHLD, SIG_DFL);
+  block_sigchld(FALSE);
 
-      if (dl_list_empty(aa->master))
-      {
-        exit(1);
-      }
-      dl_list_first(aa->master);
-      server = dl_list_value(aa->master);
+  dl_list_destroy(&slave_aa_list);
 
-      if (!create_soa_file(aa, server))
-      {
-        exit(1);
-      }
+  refresh_pending = TRUE;
+  run_slave_refresh();
 
-      exit(0);
-    }
-    else
-    {
-      /* Parent process */
-      set_slave_state(aa->name, childpid, ACTION_SOA, STATUS_WAIT);
-      count++;
-    }
+  return(TRUE);
+}
 
-    not_done = dl_list_next(&slave_aa_list);
-  }
 
-  /* Wait for each child process */
-  wait_for_child_processes(count, get_deadman_time(), ACTION_SOA);
+/* slave_refresh_pending: This function returns TRUE if something has
+   happened that run_slave_refresh() needs to see to */
+int
+slave_refresh_pending()
+{
+  return(refresh_pending);
+}
+
 
-  not_done = dl_list_first(&slave_aa_list);
-  while (not_done)
+/* run_slave_refresh: This function runs the refresh schedule, if
+   anything has happened since it last ran.  It never waits: finished
+   children are collected, due actions are started in new children,
+   and the alarm is set for the next thing due. */
+void
+run_slave_refresh()
+{
+  long now;
+
+  if (!refresh_pending)
   {
-    aa = dl_list_value(&slave_aa_list);
+    return;
+  }
 
-    /* Do not interrupt an ongoing xfer */
-    slave_state = get_slave_state(aa->name);
-    if (slave_state->action == ACTION_XFER &&
-        dot_lock_exists(aa->name))
-    {
-      not_done = dl_list_next(&slave_aa_list);
-      continue;
-    }
+  block_sigchld(TRUE);
+  refresh_pending = FALSE;
 
-    /* Check slave authority area state */
-    if (slave_state->status != STATUS_OK)
-    {
-      not_done = dl_list_next(&slave_aa_list);
-      continue;
-    }
+  now = get_time_elapsed();
 
-    /* Save old serial no */
-    old_serial_no = NEW_STRING(aa->serial_no);
+  collect_slave_children(now);
+  start_due_actions(now);
+  set_refresh_timer(now);
 
-    /* Read SOA file */
-    if (!read_soa_file(aa))
-    {
-      return(FALSE);
-    }
+  block_sigchld(FALSE);
+}
 
-    /* Create data files if serial no > old serial no */
-    if (strcmp(aa->serial_no, old_serial_no) > 0)
-    {
-      if ((childpid = fork()) < 0)
-      {
-        log(L_LOG_ERR, SECONDARY,
-            "update_slave_auth_areas: fork error: %s", strerror(errno));
-        exit(1);
-      }
-      else if (childpid == 0)
-      {
-        /* Child process */
-        signal(SIGCHLD, SIG_DFL);
- 
-        if (dl_list_empty(aa->master))
-        {
-          exit(1);
-        }
-        dl_list_first(aa->master);
-        server = dl_list_value(aa->master);
- 
-        if (!create_data_files(aa, server, FALSE))
-        {
-          exit(1);
-        }
- 
-        exit(0);
-      }
-      else
-      {
-        /* Parent process */
-        set_slave_state(aa->name, childpid, ACTION_XFER, STATUS_WAIT);
-      }
-    }
 
-    not_done = dl_list_next(&slave_aa_list);
-  }
+/* note_slave_child_exit: This function records the exit status of a
+   refresh child.  It is called from the daemon's SIGCHLD handler, and
+   returns FALSE if 'pid' was not a refresh child. */
+int
+note_slave_child_exit(pid, status)
+  int pid;
+  int status;
+{
+  slave_state_struct *slave_state;
 
-  /* Set new xfer times */
-  not_done = dl_list_first(&slave_aa_list);
-  while (not_done)
+  if ((slave_state = find_slave_state_by_pid(pid)) == NULL)
   {
-    aa = dl_list_value(&slave_aa_list);
- 
-    /* If error, increment xfer time by retry interval.
-       Else, increment xfer time by refresh interval */
-    slave_state = get_slave_state(aa->name);
-    if (slave_state->status == STATUS_ERROR)
-    {
-      aa->xfer_time = get_time_elapsed() + aa->retry_interval;
-    }
-    else
-    {
-      aa->xfer_time = get_time_elapsed() + aa->refresh_interval;
-    }
-
-    not_done = dl_list_next(&slave_aa_list);
+    return(FALSE);
   }
 
-  dl_list_destroy(&slave_aa_list);
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+  {
+    slave_state->status = STATUS_OK;
+  }
+  else
+  {
+    slave_state->status = STATUS_ERROR;
+  }
 
-  /* Set poll time */
-  set_timer(3600, update_slave_auth_areas);
+  refresh_pending = TRUE;
 
   return(TRUE);
 }
@@ -10,6 +10,10 @@
 
 int init_slave_auth_areas PROTO(());
 
-int update_slave_auth_areas PROTO(());
+void run_slave_refresh PROTO((void));
+
+int slave_refresh_pending PROTO((void));
+
+int note_slave_child_exit PROTO((int pid, int status));
 
 #endif /* _SSLAVE_H_ */
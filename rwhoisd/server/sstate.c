@@ -1,23 +1,21 @@
 #include "sstate.h"
 
 #include "auth_area.h"
-#include "daemon.h"
-#include "deadman.h"
 #include "defines.h"
 #include "log.h"
 #include "misc.h"
 
-static dl_list_type slave_state_list;
-static int          childpid;
-static int          childstatus;
+/* the state of every slave authority area, and the refresh schedule:
+   a min-heap of the areas that are not running anything, ordered by
+   the time their next action is due */
+static slave_state_struct **slave_states    = NULL;
+static int                num_slave_states  = 0;
+static slave_state_struct **slave_heap      = NULL;
+static int                slave_heap_size   = 0;
 
 static int
 destroy_slave_state_data PROTO((slave_state_struct *slave_state));
 
-static void sigalrm_handler();
-
-static void sigchld_handler();
-
 
 /* ------------------- LOCAL FUNCTIONS -------------------- */
 
@@ -32,193 +30,305 @@ destroy_slave_state_data(slave_state)
   {
     return(TRUE);
   }
- 
+
   if (slave_state->name)
   {
     free(slave_state->name);
   }
- 
+
+  if (slave_state->old_serial_no)
+  {
+    free(slave_state->old_serial_no);
+  }
+
   free(slave_state);
- 
+
   return(TRUE);
 }
 
 
-/* sigalrm_handler: This function handles SIGALRM signal */
+/* heap_set: puts 'slave_state' at 'index' in the schedule */
 static void
-sigalrm_handler(signo)
-  int signo;
+heap_set(index, slave_state)
+  int                index;
+  slave_state_struct *slave_state;
+{
+  slave_heap[index]       = slave_state;
+  slave_state->heap_index = index;
+}
+
+
+/* heap_sift_up: moves the entry at 'index' toward the top of the
+   schedule until its parent is due no later than it */
+static void
+heap_sift_up(index)
+  int index;
 {
-  return;
+  slave_state_struct *slave_state = slave_heap[index];
+  int                parent;
+
+  while (index > 0)
+  {
+    parent = (index - 1) / 2;
+    if (slave_heap[parent]->next_time <= slave_state->next_time)
+    {
+      break;
+    }
+    heap_set(index, slave_heap[parent]);
+    index = parent;
+  }
+
+  heap_set(index, slave_state);
 }
 
 
-/* sigchld_handler: This function handles SIGCHLD signal */
+/* heap_sift_down: moves the entry at 'index' away from the top of the
+   schedule until its children are due no earlier than it */
 static void
-sigchld_handler(signo)
-  int signo;
+heap_sift_down(index)
+  int index;
 {
-  childpid = wait(&childstatus);
+  slave_state_struct *slave_state = slave_heap[index];
+  int                child;
+
+  for (;;)
+  {
+    child = 2 * index + 1;
+    if (child >= slave_heap_size)
+    {
+      break;
+    }
+    if (child + 1 < slave_heap_size &&
+        slave_heap[child + 1]->next_time < slave_heap[child]->next_time)
+    {
+      child++;
+    }
+    if (slave_state->next_time <= slave_heap[child]->next_time)
+    {
+      break;
+    }
+    heap_set(index, slave_heap[child]);
+    index = child;
+  }
 
-  return;
+  heap_set(index, slave_state);
 }
 
 
 /* ------------------- PUBLIC FUNCTIONS ------------------- */
 
 
-/* set_slave_state: This function sets slave authority area state */
-int
-set_slave_state(name, pid, action, status)
+/* get_slave_state: This function gets slave authority area state */
+slave_state_struct *
+get_slave_state(name)
   char *name;
-  int  pid;
-  int  action;
-  int  status;
 {
-  slave_state_struct *slave_state;
-  int                not_done;
- 
-  not_done = dl_list_first(&slave_state_list);
-  while (not_done)
+  int i;
+
+  for (i = 0; i < num_slave_states; i++)
   {
-    slave_state = dl_list_value(&slave_state_list);
- 
-    if (STR_EQ(slave_state->name, name))
+    if (slave_states[i]->name && STR_EQ(slave_states[i]->name, name))
     {
-      slave_state->pid    = pid;
-      slave_state->action = (action_type) action;
-      slave_state->status = (status_type) status;
-      return(TRUE);
+      return(slave_states[i]);
     }
- 
-    not_done = dl_list_next(&slave_state_list);
   }
- 
-  return(FALSE);
+
+  return(NULL);
 }
 
 
-/* get_slave_state: This function gets slave authority area state */
 slave_state_struct *
-get_slave_state(name)
-  char *name;
+get_slave_state_by_index(index)
+  int index;
 {
-  slave_state_struct *slave_state;
-  int                not_done;
- 
-  not_done = dl_list_first(&slave_state_list);
-  while (not_done)
+  if (index < 0 || index >= num_slave_states)
   {
-    slave_state = dl_list_value(&slave_state_list);
- 
-    if (STR_EQ(slave_state->name, name))
+    return(NULL);
+  }
+
+  return(slave_states[index]);
+}
+
+
+int
+get_slave_state_count()
+{
+  return(num_slave_states);
+}
+
+
+slave_state_struct *
+find_slave_state_by_pid(pid)
+  int pid;
+{
+  int i;
+
+  if (pid <= 0)
+  {
+    return(NULL);
+  }
+
+  for (i = 0; i < num_slave_states; i++)
+  {
+    if (slave_states[i]->pid == pid)
     {
-      return(slave_state);
+      return(slave_states[i]);
     }
- 
-    not_done = dl_list_next(&slave_state_list);
   }
- 
+
   return(NULL);
 }
 
 
 /* init_slave_state_list: This function initializes slave
-   authority area state list */
+   authority area state list.  The state of an area with a child still
+   running is kept (marked stale), so that the child's exit is still
+   recognized; the caller must have SIGCHLD blocked. */
 void
 init_slave_state_list(slave_aa_list)
   dl_list_type *slave_aa_list;
 {
   auth_area_struct   *aa;
+  slave_state_struct **old_states     = slave_states;
+  int                num_old_states   = num_slave_states;
   slave_state_struct *slave_state;
+  int                count;
   int                not_done;
- 
-  if (dl_list_empty(slave_aa_list))
+  int                i;
+
+  count = num_old_states;
+  not_done = dl_list_first(slave_aa_list);
+  while (not_done)
   {
-    return;
+    count++;
+    not_done = dl_list_next(slave_aa_list);
+  }
+
+  slave_states     = xcalloc(count + 1, sizeof(*slave_states));
+  num_slave_states = 0;
+
+  if (slave_heap)
+  {
+    free(slave_heap);
+  }
+  slave_heap      = xcalloc(count + 1, sizeof(*slave_heap));
+  slave_heap_size = 0;
+
+  /* children still running from before carry on; everything else
+     about the old areas is forgotten */
+  for (i = 0; i < num_old_states; i++)
+  {
+    slave_state = old_states[i];
+    if (slave_state->pid > 0)
+    {
+      slave_state->stale      = TRUE;
+      slave_state->loaded     = FALSE;
+      slave_state->heap_index = -1;
+      slave_states[num_slave_states++] = slave_state;
+    }
+    else
+    {
+      destroy_slave_state_data(slave_state);
+    }
   }
- 
-  dl_list_default(&slave_state_list, FALSE, destroy_slave_state_data);
- 
+  if (old_states)
+  {
+    free(old_states);
+  }
+
   not_done = dl_list_first(slave_aa_list);
   while (not_done)
   {
     aa = dl_list_value(slave_aa_list);
- 
-    slave_state         = xcalloc(1, sizeof(*slave_state));
-    slave_state->name   = NEW_STRING(aa->name);
-    dl_list_append(&slave_state_list, slave_state);
- 
+
+    if (!get_slave_state(aa->name))
+    {
+      slave_state             = xcalloc(1, sizeof(*slave_state));
+      slave_state->name       = NEW_STRING(aa->name);
+      slave_state->backoff    = aa->retry_interval;
+      slave_state->heap_index = -1;
+      slave_states[num_slave_states++] = slave_state;
+    }
+
     not_done = dl_list_next(slave_aa_list);
   }
 }
 
 
-/* wait_for_child_processes: This function waits for child processes for
-   slave authority areas */
 void
-wait_for_child_processes(count, seconds, action)
-  int count;
-  int seconds;
-  int action;
-{
+schedule_slave_state(slave_state, action, when)
   slave_state_struct *slave_state;
-  int                not_done;
+  int                action;
+  long               when;
+{
+  long old_time;
 
-  for (; count > 0; count--)
+  if (!slave_state)
   {
-    /* Wait for a child process */
-    signal(SIGCHLD, sigchld_handler);
-    set_timer(seconds, sigalrm_handler);
-    pause();
-    unset_timer();
+    return;
+  }
 
-    /* Record status if wait returned gracefully */
-    if (childpid > 0)
-    {
-      childstatus = (childstatus >> 8) & 255;
-
-      not_done = dl_list_first(&slave_state_list);
-      while (not_done)
-      {
-        slave_state = dl_list_value(&slave_state_list);
-
-        /* Find slave state structure corresponding to pid of
-           the exited child process and record its exit status */
-        if (slave_state->pid == childpid)
-        {
-          if (childstatus == 0)
-          {
-            slave_state->status = STATUS_OK;
-          }
-          else
-          {
-            slave_state->status = STATUS_ERROR;
-          }
-        }
- 
-        not_done = dl_list_next(&slave_state_list);
-      }
-    }
+  slave_state->action = (action_type) action;
+  old_time            = slave_state->next_time;
+  slave_state->next_time = when;
+
+  if (slave_state->heap_index < 0)
+  {
+    heap_set(slave_heap_size++, slave_state);
+    heap_sift_up(slave_state->heap_index);
+  }
+  else if (when < old_time)
+  {
+    heap_sift_up(slave_state->heap_index);
   }
+  else
+  {
+    heap_sift_down(slave_state->heap_index);
+  }
+}
 
-  /* Record status if wait timed out */
-  not_done = dl_list_first(&slave_state_list);
-  while (not_done)
+
+slave_state_struct *
+next_slave_state()
+{
+  if (slave_heap_size == 0)
   {
-    slave_state = dl_list_value(&slave_state_list);
+    return(NULL);
+  }
+
+  return(slave_heap[0]);
+}
 
-    if (slave_state->action == action &&
-        slave_state->status == STATUS_WAIT)
-    {
-      slave_state->status = STATUS_ERROR;
-      log(L_LOG_ERR, SECONDARY,
-          "wait_for_child_processes: time out for authority area '%s'",
-          slave_state->name);
-    }
 
-    not_done = dl_list_next(&slave_state_list);
+void
+unschedule_slave_state(slave_state)
+  slave_state_struct *slave_state;
+{
+  slave_state_struct *last;
+  int                index;
+
+  if (!slave_state || slave_state->heap_index < 0)
+  {
+    return;
   }
 
-  no_zombies();
+  index = slave_state->heap_index;
+  slave_state->heap_index = -1;
+
+  last = slave_heap[--slave_heap_size];
+  if (last == slave_state)
+  {
+    return;
+  }
+
+  heap_set(index, last);
+  if (index > 0 &&
+      slave_heap[(index - 1) / 2]->next_time > last->next_time)
+  {
+    heap_sift_up(index);
+  }
+  else
+  {
+    heap_sift_down(index);
+  }
 }
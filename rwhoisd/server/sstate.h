@@ -15,7 +15,7 @@ typedef enum
   ACTION_SCHEMA,
   ACTION_XFER
 } action_type;
- 
+
 typedef enum
 {
   STATUS_NULL,
@@ -23,29 +23,54 @@ typedef enum
   STATUS_ERROR,
   STATUS_OK
 } status_type;
- 
+
+/* slave_state_struct: the refresh state of a slave authority area.
+   While 'pid' is set, 'action' is running in that child; otherwise
+   the area is in the refresh schedule and 'action' is what will be
+   started at 'next_time'. */
 typedef struct _slave_state_struct
 {
   char        *name;
   int         pid;
   action_type action;
   status_type status;
+  int         loaded;         /* the initial xfer has completed */
+  int         stale;          /* the child predates a reinitialization */
+  long        next_time;      /* elapsed time 'action' is due at */
+  long        deadline;       /* elapsed time a running poll times out */
+  long        backoff;        /* the delay before the next retry */
+  char        *old_serial_no; /* the serial to xfer changes since */
+  int         heap_index;     /* place in the schedule, or -1 */
 } slave_state_struct;
 
 /* prototypes */
 
-int set_slave_state PROTO((char *name,
-                           int  pid,
-                           int  action,
-                           int  status));
-
 slave_state_struct *
 get_slave_state PROTO((char *name));
 
+slave_state_struct *
+get_slave_state_by_index PROTO((int index));
+
+int get_slave_state_count PROTO((void));
+
+/* find_slave_state_by_pid: this is called from the SIGCHLD handler,
+   so it only looks at the state table */
+slave_state_struct *
+find_slave_state_by_pid PROTO((int pid));
+
 void init_slave_state_list PROTO((dl_list_type *slave_aa_list));
 
-void wait_for_child_processes PROTO((int count,
-                                     int seconds,
-                                     int action));
+/* schedule_slave_state: (re)places 'slave_state' in the refresh
+   schedule, to run 'action' at elapsed time 'when' */
+void schedule_slave_state PROTO((slave_state_struct *slave_state,
+                                 int                action,
+                                 long               when));
+
+/* next_slave_state: returns the area due soonest, without removing
+   it from the schedule, or NULL if nothing is scheduled */
+slave_state_struct *
+next_slave_state PROTO((void));
+
+void unschedule_slave_state PROTO((slave_state_struct *slave_state));
 
 #endif /* _SSTATE_H_ */
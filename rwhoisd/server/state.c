@@ -31,6 +31,17 @@ typedef struct _rwhois_state_struct
 
 static rwhois_state_struct  state_info;
 
+/* reset_rwhois_state: returns the session state to its initial
+   (query) state, closing any open spool file.  Used when a process
+   serves more than one client session. */
+void
+reset_rwhois_state()
+{
+  close_spool_file();
+  bzero(&state_info, sizeof(state_info));
+  state_info.state = QUERY_STATE;
+}
+
 int 
 get_rwhois_secure_mode()
 {
@@ -24,6 +24,8 @@ typedef enum
 } rwhois_state_type;
 
 /* prototypes */
+void reset_rwhois_state PROTO((void));
+
 int get_rwhois_secure_mode PROTO((void));
 
 void set_rwhois_secure_mode PROTO((int mode));
@@ -3,15 +3,22 @@
 #include "attributes.h"
 #include "auth_area.h"
 #include "defines.h"
+#include "delete.h"
 #include "fileinfo.h"
 #include "fileutils.h"
-#include "index.h"
-#include "index_file.h"
+#include "index_merge.h"
+#include "index_stream.h"
 #include "log.h"
+#include "main_config.h"
 #include "misc.h"
+#include "parse.h"
+#include "records.h"
+#include "reg_utils.h"
 #include "schema.h"
+#include "search.h"
 #include "sresponse.h"
 #include "strutil.h"
+#include "xfer.h"
 
 #define DATA_FILE_TEMPLATE       "%s/%s.XXXXXX"
 
@@ -28,18 +35,48 @@ typedef struct xfer_arg_struct
   dl_list_type     xfer_class_list;
 } xfer_arg_struct;
 
-static char data_dir[MAX_LINE];
-static char data_file[MAX_LINE];
-static FILE *data_fp             = NULL;
+static index_stream_struct *
+find_xfer_stream PROTO((auth_area_struct *aa,
+                        char             *class_name,
+                        dl_list_type     *stream_list));
+
+static int
+find_replaced_records PROTO((auth_area_struct *aa,
+                             char             *class_name,
+                             char             *id,
+                             dl_list_type     *old_record_list));
+
+static int
+is_replaced_class PROTO((char         *class_name,
+                         dl_list_type *replace_list));
+
+static int
+is_old_record PROTO((record_struct *rec,
+                     dl_list_type  *old_record_list));
+
+static int
+apply_xfer_deletion PROTO((auth_area_struct *aa,
+                           char             *class_name,
+                           char             *id,
+                           dl_list_type     *stream_list,
+                           dl_list_type     *old_record_list,
+                           dl_list_type     *replace_list));
 
 static int
 create_data_file_record PROTO((auth_area_struct *aa,
-                               dl_list_type     *response));
+                               dl_list_type     *response,
+                               dl_list_type     *stream_list,
+                               dl_list_type     *old_record_list,
+                               dl_list_type     *replace_list));
 
-static void
-create_data_file_line PROTO((FILE *fp,
-                             char *tag,
-                             char *value));
+static int
+install_xfer_streams PROTO((auth_area_struct *aa,
+                            dl_list_type     *stream_list,
+                            int              replace_flag,
+                            dl_list_type     *replace_list));
+
+static void merge_xfer_indexes PROTO((auth_area_struct *aa,
+                                      dl_list_type     *stream_list));
 
 static int destroy_xfer_class_data PROTO((xfer_class_struct *xclass));
 
@@ -53,119 +90,415 @@ static xfer_arg_struct *
 xfer_parse_args PROTO((char             *str,
                        auth_area_struct *aa));
 
-static int class_in_xfer_arg PROTO((class_struct    *class,
-                                    xfer_arg_struct *xs));
-
 
 /* ------------------- LOCAL FUNCTIONS -------------------- */
 
 
+/* find_xfer_stream: This function returns the data file stream for
+   a class, opening a new one the first time the class is seen */
+static index_stream_struct *
+find_xfer_stream(aa, class_name, stream_list)
+  auth_area_struct *aa;
+  char             *class_name;
+  dl_list_type     *stream_list;
+{
+  index_stream_struct *stream;
+  class_struct        *class;
+  char                data_file[MAX_LINE];
+  int                 not_done;
+
+  not_done = dl_list_first(stream_list);
+  while (not_done)
+  {
+    stream = dl_list_value(stream_list);
+    if (STR_EQ(stream->class->name, class_name))
+    {
+      return(stream);
+    }
+
+    not_done = dl_list_next(stream_list);
+  }
+
+  class = find_class_by_name(aa->schema, class_name);
+  if (!class)
+  {
+    log(L_LOG_ERR, SECONDARY,
+        "find_xfer_stream: class '%s' is not in the schema of '%s'",
+        class_name, aa->name);
+    return(NULL);
+  }
+
+  if (!directory_exists(class->db_dir))
+  {
+    mkdir(class->db_dir, 493);
+  }
+
+  bzero((char *) data_file, MAX_LINE);
+  create_filename(data_file, DATA_FILE_TEMPLATE, class->db_dir);
+  strcat(data_file, ".txt");
+
+  stream = open_index_stream(class, aa, data_file);
+  if (!stream)
+  {
+    return(NULL);
+  }
+
+  dl_list_append(stream_list, stream);
+
+  return(stream);
+}
+
+
+/* is_replaced_class: This function returns TRUE if class_name is in
+   replace_list, the classes an xfer replaces outright */
+static int
+is_replaced_class(class_name, replace_list)
+  char         *class_name;
+  dl_list_type *replace_list;
+{
+  int not_done;
+
+  not_done = dl_list_first(replace_list);
+  while (not_done)
+  {
+    if (STR_EQ((char *) dl_list_value(replace_list), class_name))
+    {
+      return(TRUE);
+    }
+
+    not_done = dl_list_next(replace_list);
+  }
+
+  return(FALSE);
+}
+
+
+/* is_old_record: This function returns TRUE if old_record_list
+   already holds the record rec (a record can be both deleted and
+   added again in one xfer) */
+static int
+is_old_record(rec, old_record_list)
+  record_struct *rec;
+  dl_list_type  *old_record_list;
+{
+  record_struct *old;
+  int           not_done;
+
+  not_done = dl_list_first(old_record_list);
+  while (not_done)
+  {
+    old = dl_list_value(old_record_list);
+    if (old->class == rec->class && old->data_file_no == rec->data_file_no
+        && old->offset == rec->offset)
+    {
+      return(TRUE);
+    }
+
+    not_done = dl_list_next(old_record_list);
+  }
+
+  return(FALSE);
+}
+
+
+/* find_replaced_records: This function appends the records already
+   held in class class_name with the ID id to old_record_list */
+static int
+find_replaced_records(aa, class_name, id, old_record_list)
+  auth_area_struct *aa;
+  char             *class_name;
+  char             *id;
+  dl_list_type     *old_record_list;
+{
+  query_struct   *query;
+  record_struct  *rec;
+  dl_list_type   record_list;
+  ret_code_type  ret_code;
+  int            not_done;
+
+  if (NOT_STR_EXISTS(id))
+  {
+    return(TRUE);
+  }
+
+  query = xcalloc(1, sizeof(*query));
+  if (!build_object_query(query, id, NULL))
+  {
+    destroy_query(query);
+    return(FALSE);
+  }
+
+  if (!query->class_name)
+  {
+    query->class_name = xstrdup(class_name);
+  }
+  if (!query->auth_area_name)
+  {
+    query->auth_area_name = xstrdup(aa->name);
+  }
+
+  /* the records found move to old_record_list, or are freed here */
+  dl_list_default(&record_list, FALSE, null_destroy_data);
+
+  search(query, &record_list, get_max_hits_ceiling(), &ret_code);
+  destroy_query(query);
+
+  not_done = dl_list_first(&record_list);
+  while (not_done)
+  {
+    rec = dl_list_value(&record_list);
+    if (is_old_record(rec, old_record_list))
+    {
+      destroy_record_data(rec);
+    }
+    else
+    {
+      dl_list_append(old_record_list, rec);
+    }
+
+    not_done = dl_list_next(&record_list);
+  }
+
+  dl_list_destroy(&record_list);
+
+  return(TRUE);
+}
+
+
+/* apply_xfer_deletion: This function applies a deletion sent by
+   the master.  The records held with the ID id are appended to
+   old_record_list.  XFER_DELETED_ALL means the records that follow
+   in the class are all of it, so the class is replaced outright.  A
+   full xfer replaces everything anyway. */
+static int
+apply_xfer_deletion(aa, class_name, id, stream_list, old_record_list,
+                    replace_list)
+  auth_area_struct *aa;
+  char             *class_name;
+  char             *id;
+  dl_list_type     *stream_list;
+  dl_list_type     *old_record_list;
+  dl_list_type     *replace_list;
+{
+  if (STR_EQ(id, XFER_DELETED_ALL))
+  {
+    /* an empty stream still replaces the class */
+    if (!find_xfer_stream(aa, class_name, stream_list))
+    {
+      return(FALSE);
+    }
+
+    if (!is_replaced_class(class_name, replace_list))
+    {
+      dl_list_append(replace_list, xstrdup(class_name));
+    }
+    return(TRUE);
+  }
+
+  if (!old_record_list || is_replaced_class(class_name, replace_list))
+  {
+    return(TRUE);
+  }
+
+  return(find_replaced_records(aa, class_name, id, old_record_list));
+}
+
+
 /* create_data_file_record: This function maps an RWhois server
-   response into a data file record */
+   response into a data file record, indexing it as it is written.
+   If old_record_list is not NULL, the records it replaces, or the
+   records a deletion in the response names, are appended to it.  A
+   class whose deletions can't be named is added to replace_list */
 static int
-create_data_file_record(aa, response)
+create_data_file_record(aa, response, stream_list, old_record_list,
+                        replace_list)
   auth_area_struct *aa;
   dl_list_type     *response;
+  dl_list_type     *stream_list;
+  dl_list_type     *old_record_list;
+  dl_list_type     *replace_list;
 {
-  int         not_done;
-  int         first_str        = TRUE;
-  static int  first_record     = FALSE;
-  char        class[MAX_LINE];
-  char        tag[MAX_LINE];
-  char        value[MAX_LINE];
-  char        *str             = NULL;
-  static char *old_class       = NULL;
+  index_stream_struct *stream = NULL;
+  record_struct       *rec    = NULL;
+  av_pair_struct      *av;
+  dl_list_type        lines;
+  int                 not_done;
+  int                 status;
+  char                class[MAX_LINE];
+  char                tag[MAX_LINE];
+  char                value[MAX_LINE];
+  char                line[MAX_LINE * 2 + 2];
+  char                *str;
 
   if (dl_list_empty(response))
   {
     return(FALSE);
   }
 
+  dl_list_default(&lines, FALSE, destroy_response_data);
+
   not_done = dl_list_first(response);
   while (not_done)
   {
     str = dl_list_value(response);
     if (!get_tuple(class, tag, value, str))
     {
+      dl_list_destroy(&lines);
       return(FALSE);
     }
 
-    /* Check the first line in the response */
-    if (first_str)
+    /* A deletion is the only line in its response */
+    if (!stream && STR_EQ(tag, XFER_DELETED_TAG))
     {
-      /* Check for a new class */
-      if (!old_class || !STR_EQ(class, old_class))
+      dl_list_destroy(&lines);
+      return(apply_xfer_deletion(aa, class, value, stream_list,
+                                 old_record_list, replace_list));
+    }
+
+    /* The first line in the response says which class it is */
+    if (!stream)
+    {
+      stream = find_xfer_stream(aa, class, stream_list);
+      if (!stream)
       {
-        if (old_class)
-        {
-          /* Close data file for the old class */
-          release_file_lock(data_file, data_fp);
-          free(old_class); old_class = NULL;
-          
-          first_record = FALSE;
-        }
+        dl_list_destroy(&lines);
+        return(FALSE);
+      }
+    }
 
-        old_class = NEW_STRING(class);
+    /* Data files don't carry the class name */
+    if (!STR_EQ(tag, "Class-Name"))
+    {
+      sprintf(line, "%s:%s", tag, value);
+      dl_list_append(&lines, NEW_STRING(line));
+    }
 
-        bzero((char *) data_dir, MAX_LINE);
-        sprintf(data_dir, "%s/%s", aa->data_dir, class);
+    not_done = dl_list_next(response);
+  }
 
-        bzero((char *) data_file, MAX_LINE);
-        create_filename(data_file, DATA_FILE_TEMPLATE, data_dir);
-        strcat(data_file, ".txt");
+  status = write_index_stream_record(stream, &lines,
+                                     old_record_list ? &rec : NULL);
+  dl_list_destroy(&lines);
 
-        if (!directory_exists(data_dir))
-        {
-          mkdir(data_dir, 493);
-        }
+  if (status && rec)
+  {
+    av = find_attr_in_record_by_name(rec, "ID");
+    if (av && !is_replaced_class(rec->class->name, replace_list))
+    {
+      status = find_replaced_records(aa, rec->class->name,
+                                     (char *) av->value, old_record_list);
+    }
+    destroy_record_data(rec);
+  }
 
-        /* Open data file for the new class */
-        if ((data_fp = get_file_lock(data_file, "w", 60)) == NULL)
+  return(status);
+}
+
+
+/* install_xfer_streams: This function finishes the index files of
+   each data file stream and swaps them into the master file list of
+   their class in one step.  If replace_flag is set, or the class is
+   in replace_list, the files they replace are removed at the same
+   time */
+static int
+install_xfer_streams(aa, stream_list, replace_flag, replace_list)
+  auth_area_struct *aa;
+  dl_list_type     *stream_list;
+  int              replace_flag;
+  dl_list_type     *replace_list;
+{
+  index_stream_struct *stream;
+  file_struct         *file;
+  dl_list_type        full_file_list;
+  dl_list_type        add_list;
+  dl_list_type        delete_list;
+  dl_list_type        mod_list;
+  dl_list_type        unlock_list;
+  int                 not_done;
+  int                 more;
+  int                 rval             = TRUE;
+
+  not_done = dl_list_first(stream_list);
+  while (not_done)
+  {
+    stream = dl_list_value(stream_list);
+
+    dl_list_default(&add_list, FALSE, destroy_file_struct_data);
+    dl_list_default(&delete_list, FALSE, destroy_file_struct_data);
+    dl_list_default(&mod_list, FALSE, destroy_file_struct_data);
+    dl_list_default(&unlock_list, FALSE, destroy_file_struct_data);
+
+    if (!close_index_stream(stream, &add_list, &mod_list))
+    {
+      abort_index_stream(stream);
+      rval = FALSE;
+    }
+    else
+    {
+      /* everything else in the class is being replaced */
+      if (replace_flag ||
+          is_replaced_class(stream->class->name, replace_list))
+      {
+        dl_list_default(&full_file_list, FALSE, destroy_file_struct_data);
+        get_file_list(stream->class, aa, &full_file_list);
+
+        more = dl_list_first(&full_file_list);
+        while (more)
         {
-          log(L_LOG_ERR, SECONDARY,
-              "create_data_file_record: could not open data file %s: %s",
-              data_file, strerror(errno));
-          return(FALSE);
+          file = dl_list_value(&full_file_list);
+          if (file->file_no != stream->data_file->file_no)
+          {
+            dl_list_append(&delete_list, copy_file_struct(file));
+          }
+          more = dl_list_next(&full_file_list);
         }
-      }
 
-      /* Except for the first record, print the record
-         separator before printing the data file record */
-      if (!first_record)
-      {
-        first_record = TRUE;
-      }
-      else
-      {
-        fprintf(data_fp, "---\n");
+        dl_list_destroy(&full_file_list);
       }
 
-      first_str = FALSE;
+      copy_file_list(&unlock_list, &mod_list);
+      modify_file_list(stream->class, aa, &add_list, &delete_list,
+                       &mod_list, &unlock_list, NULL);
+
+      unlink_file_list(&delete_list);
     }
 
-    /* Print data file line */
-    create_data_file_line(data_fp, tag, value);
+    dl_list_destroy(&add_list);
+    dl_list_destroy(&delete_list);
+    dl_list_destroy(&mod_list);
+    dl_list_destroy(&unlock_list);
 
-    not_done = dl_list_next(response);
+    not_done = dl_list_next(stream_list);
   }
 
-  return(TRUE);
+  return(rval);
 }
 
 
-/* create_data_file_line: This function creates a data file line */
+/* merge_xfer_indexes: This function merges the index files of each
+   class that an xfer has touched, if it has too many of them.  Each
+   refresh adds index files of its own, just as each registration
+   does. */
 static void
-create_data_file_line(fp, tag, value)
-  FILE *fp;
-  char *tag;
-  char *value;
+merge_xfer_indexes(aa, stream_list)
+  auth_area_struct *aa;
+  dl_list_type     *stream_list;
 {
-  if (STR_EQ(tag, "Class-Name"))
+  index_stream_struct *stream;
+  int                 not_done;
+
+  not_done = dl_list_first(stream_list);
+  while (not_done)
   {
-    return;
-  }
+    stream = dl_list_value(stream_list);
+
+    if (index_segments_over_limit(stream->class, aa))
+    {
+      merge_index_segments(stream->class, aa);
+    }
 
-  fprintf(fp, "%s:%s\n", tag, value);
+    not_done = dl_list_next(stream_list);
+  }
 }
 
 
@@ -320,55 +653,35 @@ xfer_parse_args(str, aa)
 }
 
 
-/* class_in_xfer_arg: This function checks if a class is in
-   the xfer-arg parameter for partial replication */
-static int
-class_in_xfer_arg(class, xs)
-  class_struct    *class;
-  xfer_arg_struct *xs;
-{
-  xfer_class_struct *xfer_class;
-  class_struct      *c;
-  int               not_done;
- 
-  not_done = dl_list_first(&(xs->xfer_class_list));
- 
-  while (not_done)
-  {
-    xfer_class = dl_list_value(&(xs->xfer_class_list));
-    c = xfer_class->class;
-
-    if (STR_EQ(c->name, class->name))
-    {
-      return(TRUE);
-    }
- 
-    not_done = dl_list_next(&(xs->xfer_class_list));
-  }
-
-  return(FALSE);
-}
- 
-
 /* ------------------- PUBLIC FUNCTIONS ------------------- */
 
 
 /* create_data_files: This function creates data files for a
-   slave authority area */
+   slave authority area, indexing each record as it arrives.  With
+   a serial number, only the records changed or deleted since then
+   are asked for, and they replace (or delete) the copies already
+   held; otherwise the new files replace everything in their
+   classes */
 int
-create_data_files(aa, server, initial)
+create_data_files(aa, server, initial, serial_no)
   auth_area_struct *aa;
   server_struct    *server;
   int              initial;
+  char             *serial_no;
 {
   int             sockfd;
   int             not_done             = TRUE;
   int             rval                 = FALSE;
+  int             status               = TRUE;
+  int             incremental          = FALSE;
   char            directive[MAX_LINE];
   char            *p;
   char            *aa_dir;
   dl_list_type    response;
-  xfer_arg_struct *xs;
+  dl_list_type    stream_list;
+  dl_list_type    old_record_list;
+  dl_list_type    replace_list;
+  xfer_arg_struct *xs                  = NULL;
 
   if (!aa || !server)
   {
@@ -400,30 +713,50 @@ create_data_files(aa, server, initial)
   }
   get_dot_lock(aa_dir, 1);
 
-  /* Connect to the master server */
-  connect_server(server->addr, server->port, &sockfd);
-
-  bzero((char *) directive, MAX_LINE);
   if (aa->xfer_arg)
   {
-    /* Send '-xfer autharea class=classname attr=attrname'
-       directive for partial replication */
     p  = NEW_STRING(aa->xfer_arg);
     xs = xfer_parse_args(p, aa);
+    free(p);
  
     if (!(xs))
     {
+      release_dot_lock(aa_dir);
       free(aa_dir);
       return(rval);
     }
+  }
 
-    sprintf(directive, "-xfer %s %s\r\n", aa->name, aa->xfer_arg);
+  /* A refresh of an area we already hold only needs what has changed
+     since its last serial number (unless xfer-arg fixes the serial
+     number itself) */
+  if (!initial && STR_EXISTS(serial_no) && (!xs || !xs->serial_no) &&
+      records_in_auth_area(aa) > 0)
+  {
+    incremental = TRUE;
+  }
+
+  /* Connect to the master server */
+  connect_server(server->addr, server->port, &sockfd);
+
+  bzero((char *) directive, MAX_LINE);
+  if (aa->xfer_arg)
+  {
+    /* Send '-xfer autharea class=classname attr=attrname'
+       directive for partial replication */
+    sprintf(directive, "-xfer %s %s", aa->name, aa->xfer_arg);
   }
   else
   {
     /* Send '-xfer autharea' directive for complete replication */
-    sprintf(directive, "-xfer %s\r\n", aa->name);
+    sprintf(directive, "-xfer %s", aa->name);
   }
+  if (incremental)
+  {
+    strcat(directive, " ");
+    strcat(directive, serial_no);
+  }
+  strcat(directive, "\r\n");
   send_directive(sockfd, directive);
 
   if (!directory_exists(aa->data_dir))
@@ -431,7 +764,11 @@ create_data_files(aa, server, initial)
     mkdir(aa->data_dir, 493);
   }
 
-  /* Create data files */
+  dl_list_default(&stream_list, FALSE, destroy_index_stream_data);
+  dl_list_default(&old_record_list, FALSE, destroy_record_data);
+  dl_list_default(&replace_list, FALSE, simple_destroy_data);
+
+  /* Create and index data files */
   do
   {
     recv_response(stdin, "%xfer", &response);
@@ -442,144 +779,67 @@ create_data_files(aa, server, initial)
     }
     else
     {
-      if (create_data_file_record(aa, &response))
+      if (create_data_file_record(aa, &response, &stream_list,
+                                  incremental ? &old_record_list : NULL,
+                                  &replace_list))
       {
         rval = TRUE;
       }
-      dl_list_destroy(&response);
+      else
+      {
+        status = FALSE;
+        not_done = FALSE;
+      }
     }
+    dl_list_destroy(&response);
   } while (not_done);
 
-  release_file_lock(data_file, data_fp);
-
   close(sockfd);
 
-  /* Index data files */
-  if ((p = strchr(strrchr(data_file, '/'), '.')))
+  if (status)
   {
-    p++;
-    index_data_files_by_suffix(aa, p);
-  }
-
-  /* Release lock */
-  release_dot_lock(aa_dir);
-
-  free(aa_dir);
-  
-  return(rval);
-}
+    /* Swap the new files in */
+    status = install_xfer_streams(aa, &stream_list, !incremental,
+                                  &replace_list);
 
-
-/* index_data_files_by_suffix: This function indexes data files
-   by suffix */
-int
-index_data_files_by_suffix(aa, suffix)
-  auth_area_struct *aa;
-  char             *suffix;
-{
-  schema_struct   *schema;
-  dl_list_type    *class_list;
-  class_struct    *class;
-  dl_list_type    full_file_list;
-  dl_list_type    data_file_list;
-  dl_list_type    index_file_list;
-  char            *p;
-  int             not_done;
-  int             rval                       = TRUE;
-  xfer_arg_struct *xs;
-
-  if (!aa || !aa->schema || !suffix)
-  {
-    return(FALSE);
-  }
-
-  schema = aa->schema;
-  class_list = &(schema->class_list);
-
-  if (dl_list_empty(class_list))
-  {
-    return(FALSE);
-  }
-
-  if (aa->xfer_arg)
-  {
-    p  = NEW_STRING(aa->xfer_arg);
-    xs = xfer_parse_args(p, aa);
- 
-    if (!(xs))
-    {
-      return(FALSE);
-    }
-  }
-
-  /* Iterate through each class */
-  not_done = dl_list_first(class_list);
-  while (not_done)
-  {
-    class = dl_list_value(class_list);
-
-    /* Skip if class is not in the xfer-arg parameter for
-       partial replication */
-    if (aa->xfer_arg)
-    {
-      if (!class_in_xfer_arg(class, xs))
-      {
-        not_done = dl_list_next(class_list);
-        continue;
-      }
-    }
-
-    /* Skip if the class doesn't have a directory (and therefore
-       nothing was transferred */
-    if (!directory_exists(class->db_dir))
+    /* then retire the copies they replace */
+    if (status && !dl_list_empty(&old_record_list))
     {
-      not_done = dl_list_next(class_list);
-      continue;
-    }
-    
-    /* Get current data and index files list */ 
-    dl_list_default(&full_file_list, FALSE, destroy_file_struct_data);
-    get_file_list(class, aa, &full_file_list);
-
-    /* Build new data files list */
-    dl_list_default(&data_file_list, FALSE, destroy_file_struct_data);
-    if (!build_file_list_by_suffix(&data_file_list, MKDB_DATA_FILE,
-                                   class->db_dir, suffix))
-    {
-      rval = FALSE;
-      break;
+      mkdb_delete_record_list(&old_record_list);
     }
 
-    dl_list_default(&index_file_list, FALSE, destroy_index_fp_data);
-    if (!build_index_list(class, aa, &index_file_list, class->db_dir, NULL))
+    if (status)
     {
-      rval = FALSE;
-      break;
+      merge_xfer_indexes(aa, &stream_list);
     }
+  }
+  else
+  {
+    log(L_LOG_ERR, SECONDARY,
+        "create_data_files: could not store xfer of '%s'", aa->name);
 
-    /* Index new data files */
-    if (!index_files(class, aa, &index_file_list, &data_file_list, FALSE, TRUE))
+    not_done = dl_list_first(&stream_list);
+    while (not_done)
     {
-      rval = FALSE;
-      break;
+      abort_index_stream(dl_list_value(&stream_list));
+      not_done = dl_list_next(&stream_list);
     }
+    rval = FALSE;
+  }
 
-    /* Replace current data and index files list with the new list */
-    modify_file_list(class, aa, NULL, &full_file_list, NULL,
-                     &data_file_list, NULL);
-
-    unlink_file_list(&full_file_list);
-
-    dl_list_destroy(&index_file_list);
-    dl_list_destroy(&full_file_list);
-    dl_list_destroy(&data_file_list);
+  dl_list_destroy(&old_record_list);
+  dl_list_destroy(&replace_list);
+  dl_list_destroy(&stream_list);
 
-    not_done = dl_list_next(class_list);
+  if (xs)
+  {
+    destroy_xfer_arg_data(xs);
   }
 
-  dl_list_destroy(&index_file_list);
-  dl_list_destroy(&full_file_list);
-  dl_list_destroy(&data_file_list);
+  /* Release lock */
+  release_dot_lock(aa_dir);
 
-  return(rval);
+  free(aa_dir);
+  
+  return(rval && status);
 }
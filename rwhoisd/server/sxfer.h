@@ -11,9 +11,7 @@
 
 int create_data_files PROTO((auth_area_struct *aa,
                              server_struct    *server,
-                             int              initial));
-
-int index_data_files_by_suffix PROTO((auth_area_struct *aa,
-                                      char             *suffix));
+                             int              initial,
+                             char             *serial_no));
 
 #endif /* _SXFER_H_ */
@@ -15,12 +15,14 @@
 #include <ctype.h>
 #include "xfer.h"
 
+#include "arena.h"
 #include "attributes.h"
 #include "auth_area.h"
 #include "client_msgs.h"
 #include "defines.h"
 #include "dl_list.h"
 #include "fileinfo.h"
+#include "index.h"
 #include "log.h"
 #include "misc.h"
 #include "mkdb_types.h"
@@ -29,6 +31,7 @@
 #include "strutil.h"
 #include "schema.h"
 #include "fileutils.h"
+#include "updated_index.h"
 
 /* Data structure for a class; each class consists of a list of
    attributes; This class is an element in a linked-list of classes */
@@ -356,6 +359,109 @@ xfer_display_record(rec, class, curr_class)
 }  /* end of xfer_display_record */
 
 
+/* xfer_display_deletion:  xfer_display_deletion tells the client
+     that the record with the ID id (or, with XFER_DELETED_ALL, any
+     record not sent) has been deleted from class. */
+static void
+xfer_display_deletion(class, id)
+  class_struct *class;
+  char         *id;
+{
+  print_response(RESP_XFER, "%s:%s:%s", class->name, XFER_DELETED_TAG, id);
+  print_response(RESP_XFER, "");
+}
+
+
+/* read_deleted_id:  read_deleted_id finds the ID of the deleted record
+     at offset in fp.  Deleting a record blots out the first character
+     of each of its lines, so its ID line starts with "_D:".  Returns
+     the ID, or NULL if it can't be found. */
+static char *
+read_deleted_id(fp, offset)
+  FILE *fp;
+  long offset;
+{
+  char line[MAX_LINE];
+
+  if (fseek(fp, offset, SEEK_SET) != 0)
+  {
+    return NULL;
+  }
+
+  while (readline(fp, line, MAX_LINE) && *line != '-')
+  {
+    if (STRN_EQ(line, "_D:", 3) && STR_EXISTS(line + 3))
+    {
+      return(xstrdup(line + 3));
+    }
+  }
+
+  return NULL;
+}
+
+
+/* name_deleted_records:  name_deleted_records replaces the value of
+     each deleted record's item in hit_list with the record's ID, read
+     from the data files in file_list.  It returns FALSE if any of them
+     can't be named (its data file is gone or has been repacked). */
+static int
+name_deleted_records(file_list, hit_list)
+  dl_list_type *file_list;
+  dl_list_type *hit_list;
+{
+  index_struct *hit;
+  file_struct  *curr_file;
+  FILE         *fp           = NULL;
+  char         *id           = NULL;
+  int          curr_file_no  = -1;
+  int          not_done;
+
+  not_done = dl_list_first(hit_list);
+
+  while (not_done)
+  {
+    hit = dl_list_value(hit_list);
+
+    if (hit->deleted_flag)
+    {
+      if (hit->data_file_no != curr_file_no)
+      {
+        if (fp)
+        {
+          fclose(fp);
+          fp = NULL;
+        }
+
+        curr_file_no = hit->data_file_no;
+        curr_file    = find_file_by_id(file_list, curr_file_no,
+                                       MKDB_DATA_FILE);
+        if (curr_file)
+        {
+          fp = fopen(curr_file->filename, "r");
+        }
+      }
+
+      if (!fp || (id = read_deleted_id(fp, hit->offset)) == NULL)
+      {
+        break;
+      }
+
+      arena_free(hit->value);
+      hit->value = id;
+    }
+
+    not_done = dl_list_next(hit_list);
+  }
+
+  if (fp)
+  {
+    fclose(fp);
+  }
+
+  return(!not_done);
+}
+
+
 /* xfer_file_xfer:  This function xfers data from curr_file containing data
      of curr_class in authority area aa, depending on the value of serial_no.
      It returns TRUE if any data is xferred. */ 
@@ -397,6 +503,89 @@ xfer_file_xfer(aa, curr_file, class, curr_class, serial_no)
 }  /* end of xfer_file_xfer */
 
 
+/* xfer_updated_xfer:  This function xfers the records listed in hit_list
+     (by find_updated_records()) from the data files in file_list, in
+     the same way as xfer_file_xfer(), but without reading the records
+     that haven't changed.  The records deleted since serial_no, named
+     by name_deleted_records(), are sent as deletions.  It returns
+     TRUE if any data is xferred. */
+static int
+xfer_updated_xfer(aa, file_list, hit_list, class, curr_class, serial_no)
+  auth_area_struct  *aa;
+  dl_list_type      *file_list;
+  dl_list_type      *hit_list;
+  class_struct      *class;
+  xfer_class_struct *curr_class;
+  char              *serial_no;
+{
+  index_struct     *hit;
+  file_struct      *curr_file;
+  record_struct    *rec;
+  FILE             *fp           = NULL;
+  rec_parse_result status;
+  int              curr_file_no  = -1;
+  int              not_done;
+  int              found         = 0;
+
+  not_done = dl_list_first(hit_list);
+
+  while (not_done)
+  {
+    hit = dl_list_value(hit_list);
+
+    if (hit->deleted_flag)
+    {
+      xfer_display_deletion(class, hit->value);
+      found++;
+
+      not_done = dl_list_next(hit_list);
+      continue;
+    }
+
+    /* the hits are in file order, so each file is opened once */
+    if (hit->data_file_no != curr_file_no)
+    {
+      if (fp)
+      {
+        fclose(fp);
+        fp = NULL;
+      }
+
+      curr_file_no = hit->data_file_no;
+      curr_file    = find_file_by_id(file_list, curr_file_no,
+                                     MKDB_DATA_FILE);
+      if (curr_file && (fp = fopen(curr_file->filename, "r")) == NULL)
+      {
+        log(L_LOG_ERR, CLIENT, "could not open data file '%s': %s",
+            curr_file->filename, strerror(errno));
+      }
+    }
+
+    if (fp && fseek(fp, hit->offset, SEEK_SET) == 0)
+    {
+      rec = mkdb_read_record(class, aa, curr_file_no, 0, &status, fp);
+      if (rec)
+      {
+        if (is_record_new(rec, serial_no))
+        {
+          found += xfer_display_record(rec, class, curr_class);
+        }
+        destroy_record_data(rec);
+      }
+    }
+
+    not_done = dl_list_next(hit_list);
+  }
+
+  if (fp)
+  {
+    fclose(fp);
+  }
+
+  return(found);
+}  /* end of xfer_updated_xfer */
+
+
 /* xfer_class:  This function xfers data from a class curr_class in an
    authority area aa, depending upon the value of the serial number.  It
    returns TRUE on successful xfer of data. */
@@ -411,6 +600,7 @@ xfer_class(aa, class, curr_class, serial_no)
   int          found_data       = 0;
   dl_list_type master_file_list;
   dl_list_type file_list;
+  dl_list_type hit_list;
   file_struct  *curr_file;
   
   if (!aa || !class)
@@ -420,6 +610,7 @@ xfer_class(aa, class, curr_class, serial_no)
 
   dl_list_default(&master_file_list, FALSE, destroy_file_struct_data);
   dl_list_default(&file_list, FALSE, destroy_file_struct_data);
+  dl_list_default(&hit_list, FALSE, destroy_index_item);
   
   /* pull all of the data files for the current class */
   if (!get_file_list(class, aa, &master_file_list))
@@ -427,7 +618,39 @@ xfer_class(aa, class, curr_class, serial_no)
     return FALSE;
   }
   filter_file_list(&file_list, MKDB_DATA_FILE, &master_file_list);
+
+  /* with a serial number, go straight to the records changed and
+     deleted since, if the Updated index can tell us which they are */
+  if (serial_no &&
+      find_updated_records(&master_file_list, serial_no, &hit_list))
+  {
+    if (name_deleted_records(&file_list, &hit_list))
+    {
+      found_data = xfer_updated_xfer(aa, &file_list, &hit_list, class,
+                                     curr_class, serial_no);
+
+      dl_list_destroy(&hit_list);
+      dl_list_destroy(&master_file_list);
+      dl_list_destroy(&file_list);
+
+      return(found_data);
+    }
+
+    dl_list_destroy(&hit_list);
+  }
   dl_list_destroy(&master_file_list);
+
+  /* otherwise the deletions are unknown, so send the whole class */
+  if (serial_no)
+  {
+    log(L_LOG_INFO, CLIENT,
+        "xfer of '%s' since %s: sending all of class '%s'", aa->name,
+        serial_no, class->name);
+
+    xfer_display_deletion(class, XFER_DELETED_ALL);
+    found_data++;
+    serial_no = NULL;
+  }
   
   not_done = dl_list_first(&file_list);
     
@@ -14,6 +14,15 @@
 
 #include "common.h"
 
+/* defines */
+
+/* an incremental xfer sends a record deleted since the serial number
+   as the single line "<class>:Deleted:<ID>".  "<class>:Deleted:*"
+   says the deletions in the class can't be told apart, and that the
+   records that follow it are the whole of the class. */
+#define XFER_DELETED_TAG    "Deleted"
+#define XFER_DELETED_ALL    "*"
+
 /* prototypes */
 
 int xfer_directive PROTO((char *str));
@@ -14,11 +14,14 @@
 #include "fileinfo.h"
 #include "fileutils.h"
 #include "index.h"
+#include "index_sort.h"
 #include "log.h"
 #include "main_config.h"
 #include "phonetic.h"
 #include "read_config.h"
 #include "schema.h"
+#include "strutil.h"
+#include "tombstone.h"
 #include "validate_rec.h"
 
 #include "conf.h"
@@ -38,11 +41,11 @@ usage(prog_name)
   fprintf(stderr, "usage:\n");
   fprintf(stderr, " file list mode:\n");
   fprintf(stderr,
-   "   %s [-c config_file] -C class -A auth_area [-ivqn] files...\n",
+   "   %s [-c config_file] -C class -A auth_area [-ivqnb] [-j workers] files...\n",
           prog_name);
   fprintf(stderr, "\n suffix mode:\n");
   fprintf(stderr,
-   "   %s [-c config_file] [-C class] [-A auth_area] [-ivqn] -s suffix\n",
+   "   %s [-c config_file] [-C class] [-A auth_area] [-ivqnb] [-j workers] -s suffix\n",
           prog_name);
   fprintf(stderr, "\n options:\n");
   fprintf(stderr,  
@@ -57,6 +60,9 @@ usage(prog_name)
           "   -v: verbose\n");
   fprintf(stderr, "   -q: quiet\n");
   fprintf(stderr, "   -n: no validity checks\n");
+  fprintf(stderr, "   -b: write exact indexes in binary form\n");
+  fprintf(stderr,
+          "   -j workers: index and sort with this many processes\n");
 
   exit(64);
 }
@@ -81,6 +87,19 @@ delete_index_files(class, auth_area)
     return FALSE;
   }
   filter_file_list(&index_file_list, MKDB_ALL_INDEX_FILES, &master_file_list);
+
+  /* reindexing leaves the deleted records out of the new index files,
+     so the data files' tombstones are of no more use */
+  not_done = dl_list_first(&master_file_list);
+  while (not_done)
+  {
+    index_file = dl_list_value(&master_file_list);
+    if (index_file->type == MKDB_DATA_FILE)
+    {
+      unlink_tombstones(index_file);
+    }
+    not_done = dl_list_next(&master_file_list);
+  }
   dl_list_destroy(&master_file_list);
   
   /* get out now if there is nothing to do */
@@ -322,7 +341,7 @@ main(argc, argv)
   init_server_config_data();
 
   /* parse command line options */
-  while ((c = getopt(argc, argv, "c:C:A:s:iqvn")) != EOF) {
+  while ((c = getopt(argc, argv, "c:C:A:s:iqvnbj:")) != EOF) {
     switch (c) {
     case 'c':
       config_file = optarg;
@@ -351,6 +370,18 @@ main(argc, argv)
     case 'n':
       validate = FALSE;
       break;
+    case 'b':
+      set_binary_index_mode(TRUE);
+      break;
+    case 'j':
+      if (!is_number_str(optarg) || atoi(optarg) <= 0)
+      {
+        badopts = TRUE;
+        break;
+      }
+      set_index_workers(atoi(optarg));
+      set_sort_workers(atoi(optarg));
+      break;
     default:
       badopts = TRUE;
       break;
@@ -26,6 +26,7 @@
 #include "mkdb_types.h"
 #include "fileinfo.h"
 #include "index_file.h"
+#include "index_stats.h"
 #include "index.h"
 
 /* number of seconds to wait between removing index files from master file 
@@ -339,6 +340,42 @@ filter_file_list_by_substring(dl_list_type *file_list, char *substring)
   return TRUE;
 }
 
+/* removes the binary index files from a file list.  These can't be
+   concatenated and sorted like the text index files, so they are
+   left as they are. */
+static int
+filter_file_list_binary(dl_list_type *file_list)
+{
+  file_struct *file;
+  int         not_done = TRUE;
+
+  if (!file_list) {
+    return FALSE;
+  }
+
+  not_done = dl_list_first(file_list);
+  while (not_done)
+  {
+    file = dl_list_value(file_list);
+    if (!file)
+    {
+      not_done = dl_list_next(file_list);
+      continue;
+    }
+
+    if (file->type == MKDB_BINARY_INDEX_FILE)
+    {
+      dl_list_delete(file_list);
+      not_done = (! dl_list_empty(file_list));
+      continue;
+    }
+
+    not_done = dl_list_next(file_list);
+  }
+
+  return TRUE;
+}
+
 static int
 repack_index_files(class_struct *class,
                    auth_area_struct *auth_area,
@@ -484,6 +521,7 @@ repack_index_files(class_struct *class,
       = generate_index_file_basename(index_file->type, class->db_dir,
                                      index_fp->prefix);
     index_file->filename = NULL;
+    index_file->stats    = read_index_stats(index_fp->real_filename);
 
     dl_list_append(&add_file_list, index_file);
     not_done = dl_list_next(&new_index_file_list);
@@ -550,6 +588,12 @@ run_repack_class_aa(class_struct          *class,
     return FALSE;
   }
 
+  /* binary index files don't get repacked */
+  if (! filter_file_list_binary(&index_file_list) )
+  {
+    return FALSE;
+  }
+
   /* filter out the ones that don't contain the substring (if there is
      a substring) */
   if (STR_EXISTS(options->substring))